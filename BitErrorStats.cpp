@@ -0,0 +1,138 @@
+#include "BitErrorStats.h"
+#include "DataKernels.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace ufs {
+
+namespace {
+
+inline int LowestBit(UInt64 value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(value);
+#else
+    int bit = 0;
+    for (; (value & 1) == 0; value >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+} // namespace
+
+BitErrorStats::BitErrorStats()
+    : _firstSector(0), _sectorCount(0), _bytesPerSector(0), _zeroToOne(0), _oneToZero(0),
+      _maxSectorErrors(0), _maxSectorErrorsSector(0), _sectorsWithErrors(0), _wordBits(64, 0) {
+}
+
+BitErrorStats::BitErrorStats(size_t firstSector, size_t sectorCount, size_t bytesPerSector)
+    : _firstSector(firstSector), _sectorCount(sectorCount), _bytesPerSector(bytesPerSector), _zeroToOne(0), _oneToZero(0),
+      _maxSectorErrors(0), _maxSectorErrorsSector(firstSector), _sectorsWithErrors(0), _sectorErrors(sectorCount, 0), _wordBits(64, 0), _columns(bytesPerSector, 0) {
+}
+
+void BitErrorStats::AddSector(size_t sector, const UInt8* expected, const UInt8* actual) {
+    // The direction counts are vectorized; only the words of a sector with
+    // errors are looked at again for where they are.
+    UInt64 zeroToOne = 0;
+    UInt64 oneToZero = 0;
+    kernels::CountBitFlips(expected, actual, _bytesPerSector, zeroToOne, oneToZero);
+    UInt64 errors = zeroToOne + oneToZero;
+    if (errors == 0) {
+        return;
+    }
+
+    _zeroToOne += zeroToOne;
+    _oneToZero += oneToZero;
+    UInt32 sectorErrors = static_cast<UInt32>(errors);
+    _sectorErrors[sector - _firstSector] = sectorErrors;
+    if (sectorErrors > _maxSectorErrors) {
+        _maxSectorErrors = sectorErrors;
+        _maxSectorErrorsSector = sector;
+    }
+    _sectorsWithErrors++;
+
+    size_t i = 0;
+    for (; i + 8 <= _bytesPerSector; i += 8) {
+        UInt64 e;
+        UInt64 a;
+        ::memcpy(&e, expected + i, sizeof(e));
+        ::memcpy(&a, actual + i, sizeof(a));
+        if (e != a) {
+            AddErrors(e ^ a, i);
+        }
+    }
+    for (; i < _bytesPerSector; i++) {
+        if (expected[i] != actual[i]) {
+            AddErrors(static_cast<UInt64>(expected[i] ^ actual[i]) << (8 * (i % 8)), i - i % 8);
+        }
+    }
+}
+
+void BitErrorStats::AddErrors(UInt64 difference, size_t column) {
+    // difference holds the word's errors in little endian byte order.
+    while (difference != 0) {
+        int bit = LowestBit(difference);
+        _wordBits[bit]++;
+        _columns[column + bit / 8]++;
+        difference &= difference - 1;
+    }
+}
+
+void BitErrorStats::Append(const BitErrorStats& next) {
+    _zeroToOne += next._zeroToOne;
+    _oneToZero += next._oneToZero;
+    if (next._maxSectorErrors > _maxSectorErrors) {
+        _maxSectorErrors = next._maxSectorErrors;
+        _maxSectorErrorsSector = next._maxSectorErrorsSector;
+    }
+    _sectorsWithErrors += next._sectorsWithErrors;
+    _sectorErrors.insert(_sectorErrors.end(), next._sectorErrors.begin(), next._sectorErrors.end());
+    _sectorCount += next._sectorCount;
+    for (size_t bit = 0; bit < _wordBits.size(); bit++) {
+        _wordBits[bit] += next._wordBits[bit];
+    }
+    if (_columns.empty()) {
+        _bytesPerSector = next._bytesPerSector;
+        _columns.resize(next._columns.size(), 0);
+    }
+    for (size_t column = 0; column < _columns.size() && column < next._columns.size(); column++) {
+        _columns[column] += next._columns[column];
+    }
+}
+
+double BitErrorStats::GetBitErrorRate() const {
+    UInt64 bits = GetBitsCompared();
+    return bits == 0 ? 0.0 : static_cast<double>(GetBitErrors()) / static_cast<double>(bits);
+}
+
+UInt32 BitErrorStats::GetSectorBitErrors(size_t sector) const {
+    if (sector < _firstSector || sector - _firstSector >= _sectorCount) {
+        return 0;
+    }
+    return _sectorErrors[sector - _firstSector];
+}
+
+std::vector<UInt64> BitErrorStats::GetByteBitCounts() const {
+    std::vector<UInt64> counts(8, 0);
+    for (size_t bit = 0; bit < _wordBits.size(); bit++) {
+        counts[bit % 8] += _wordBits[bit];
+    }
+    return counts;
+}
+
+std::string BitErrorStats::ToString() const {
+    std::stringstream ss;
+    ss << GetBitErrors() << " bit errors in " << GetBitsCompared() << " bits (" << _zeroToOne << " 0->1, "
+       << _oneToZero << " 1->0), BER " << std::scientific << std::setprecision(3) << GetBitErrorRate()
+       << std::defaultfloat << ". " << _sectorsWithErrors << " sectors with errors, at most " << _maxSectorErrors
+       << " in one";
+    if (_maxSectorErrors != 0) {
+        ss << " (sector " << _maxSectorErrorsSector << ")";
+    }
+    return ss.str();
+}
+
+} // namespace ufs
@@ -0,0 +1,131 @@
+#pragma once
+#ifndef _BITERRORSTATS_H_
+#define _BITERRORSTATS_H_
+
+#include "TypeDefs.h"
+#include "Printable.h"
+#include <string>
+#include <vector>
+
+namespace ufs {
+
+/// <summary>
+/// Bit errors of a compare of expected against actual data, for raw bit
+/// error rate measurements: the flipped bits, split by direction, the
+/// errors of each sector, and where in the word and the sector they fell.
+/// Sectors are those of the buffer compared, from GetFirstSector.
+/// </summary>
+class BitErrorStats : public Printable {
+public:
+    /// <summary>
+    /// Constructor for an empty compare
+    /// </summary>
+    BitErrorStats();
+
+    /// <summary>
+    /// Constructor for a compare of sectorCount sectors from firstSector
+    /// </summary>
+    BitErrorStats(size_t firstSector, size_t sectorCount, size_t bytesPerSector);
+
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    virtual ~BitErrorStats() = default;
+
+    /// <summary>
+    /// Add the errors of one sector compared. sector is counted as the
+    /// constructor's, and is added after every sector before it.
+    /// </summary>
+    void AddSector(size_t sector, const UInt8* expected, const UInt8* actual);
+
+    /// <summary>
+    /// Add the errors of the sectors right after this compare's.
+    /// </summary>
+    void Append(const BitErrorStats& next);
+
+    bool AreEqual() const { return GetBitErrors() == 0; }
+    size_t GetFirstSector() const { return _firstSector; }
+    size_t GetSectorCount() const { return _sectorCount; }
+    size_t GetBytesPerSector() const { return _bytesPerSector; }
+    UInt64 GetBitsCompared() const { return static_cast<UInt64>(_sectorCount) * _bytesPerSector * 8; }
+
+    /// <summary>
+    /// Get the number of bits that differ
+    /// </summary>
+    UInt64 GetBitErrors() const { return _zeroToOne + _oneToZero; }
+
+    /// <summary>
+    /// Get the bits expected 0 and read as 1
+    /// </summary>
+    UInt64 GetZeroToOneCount() const { return _zeroToOne; }
+
+    /// <summary>
+    /// Get the bits expected 1 and read as 0
+    /// </summary>
+    UInt64 GetOneToZeroCount() const { return _oneToZero; }
+
+    /// <summary>
+    /// Get the bit errors per bit compared
+    /// </summary>
+    double GetBitErrorRate() const;
+
+    /// <summary>
+    /// Get the bit errors of a sector, or 0 for a sector not compared
+    /// </summary>
+    UInt32 GetSectorBitErrors(size_t sector) const;
+    const std::vector<UInt32>& GetSectorBitErrorCounts() const { return _sectorErrors; }
+
+    /// <summary>
+    /// Get the most bit errors in any one sector, the worst case an ECC
+    /// codeword the size of a sector would have to correct
+    /// </summary>
+    UInt32 GetMaxSectorBitErrors() const { return _maxSectorErrors; }
+
+    /// <summary>
+    /// Get the sector with GetMaxSectorBitErrors errors, the first of them
+    /// on a tie. Only meaningful while GetBitErrors is not zero.
+    /// </summary>
+    size_t GetMaxSectorBitErrorsSector() const { return _maxSectorErrorsSector; }
+    size_t GetSectorsWithErrors() const { return _sectorsWithErrors; }
+
+    /// <summary>
+    /// Get the bit errors at each bit of a little endian 64 bit word,
+    /// words counted from the start of each sector. Bit 8 * i + j is bit j
+    /// of byte i of the word.
+    /// </summary>
+    const std::vector<UInt64>& GetWordBitCounts() const { return _wordBits; }
+
+    /// <summary>
+    /// Get the bit errors at each bit of a byte, bit 0 the least significant
+    /// </summary>
+    std::vector<UInt64> GetByteBitCounts() const;
+
+    /// <summary>
+    /// Get the bit errors at each byte column of a sector
+    /// </summary>
+    const std::vector<UInt64>& GetColumnCounts() const { return _columns; }
+
+    /// <summary>
+    /// Convert to string representation
+    /// </summary>
+    virtual std::string ToString() const override;
+
+private:
+    void AddErrors(UInt64 difference, size_t column);
+
+    size_t _firstSector;
+    size_t _sectorCount;
+    size_t _bytesPerSector;
+    UInt64 _zeroToOne;
+    UInt64 _oneToZero;
+    UInt32 _maxSectorErrors;
+    size_t _maxSectorErrorsSector;
+    size_t _sectorsWithErrors;
+    std::vector<UInt32> _sectorErrors;
+    std::vector<UInt64> _wordBits;
+    std::vector<UInt64> _columns;
+};
+
+} // namespace ufs
+
+#endif // _BITERRORSTATS_H_
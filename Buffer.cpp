@@ -10,28 +10,303 @@
 
 #include "Buffer.h"
 #include "CompareResult.h"
+#include "CounterRandom.h"
+#include "DataKernels.h"
+#include "PatternBuffer.h"
+#include "Prbs.h"
+#include "SectorOverlay.h"
 #include "TypeDefs.h"
 #include "Utils.h"
+#include "WorkerPool.h"
 
+#include <cerrno>
 #include <climits>
 #include <string.h>
 #include <sstream>
 #include <algorithm>
+#include <utility>
 #include <stdexcept>
 #include <boost/thread/mutex.hpp>
 #include <boost/format.hpp>
 #include <boost/random.hpp>
+#include <atomic>
+#include <mutex>
+#include <numeric>
 
 
 
-// NOTE: We are limiting the OMP parallization to 2 threads because at any more
-// than that the CPU usage gets out of control. We probably need to roll our
-// own threading, possibly using boost threads, to get any more performance.
-// const int NUM_OMP_THREADS = 4; // Unused when OpenMP not available
-
-
 namespace
 {
+	// Simulator compression mode will be enabled if DMX_SIMULATOR_ENABLED != 0.
+	// Data generation rule info will embed into data buffer.
+	// Simulator can recover data by using these rules.
+	bool IsPatternModeEnabled()
+	{
+		char *dmxSimulatorEnabled = getenv("DMX_SIMULATOR_ENABLED");
+		return dmxSimulatorEnabled != NULL && atoi(dmxSimulatorEnabled) != 0;
+	}
+
+	// Bytes generated at a time by fills that stream or stamp their data;
+	// small enough to stay in the first level cache.
+	const size_t STAGING_BYTES = 16 * 1024;
+
+	// Largest run of bytes a fused overlay fill keeps together; periods whose
+	// common multiple with the sector size is longer fill and stamp in two
+	// passes instead.
+	const size_t MAX_FUSED_ALIGNMENT = 1024 * 1024;
+
+	// Stamps the buffer's sector overlay into whole sectors as a fill writes
+	// them. Offsets are from the start of the fill, which is sector
+	// firstSector of the buffer. Does nothing without an overlay.
+	struct SectorStamp
+	{
+		const ufs::SectorOverlay* overlay;
+		size_t bytesPerSector;
+		size_t firstSector;
+
+		bool IsActive() const
+		{
+			return overlay != NULL;
+		}
+
+		// Stamp the sectors of block, which is length bytes from offset.
+		// Both are whole sectors.
+		void operator()(UInt8* block, size_t offset, size_t length) const
+		{
+			if (overlay == NULL)
+			{
+				return;
+			}
+
+			for (size_t done = 0; done + bytesPerSector <= length; done += bytesPerSector)
+			{
+				overlay->Apply(block + done, bytesPerSector, firstSector + (offset + done) / bytesPerSector);
+			}
+		}
+	};
+
+	// Adds the differences between length bytes of expected and actual to
+	// result, in the one pass that looks for them. offset is that of the
+	// first byte in the buffer compared. Equal data is passed over by
+	// FindFirstMismatch; each sector holding a difference is split into runs
+	// while the result keeps ranges, and only counted once it keeps no more.
+	// A run continuing the last range kept is still joined to it, so a range
+	// crossing a sector or piece boundary is never what truncates the result.
+	void CollectDifferences(ufs::CompareResult& result, const UInt8* expected, const UInt8* actual, size_t length,
+							size_t offset, size_t bytesPerSector)
+	{
+		size_t position = 0;
+		size_t found = 0;
+		while (position < length && ufs::kernels::FindFirstMismatch(expected + position, actual + position, length - position, found))
+		{
+			position += found;
+			size_t sector = (offset + position) / bytesPerSector;
+			size_t sectorEnd = std::min(length, (sector + 1) * bytesPerSector - offset);
+			while (position < sectorEnd)
+			{
+				if (result.IsRangeDetailFull() && !result.ContinuesLastRange(offset + position))
+				{
+					size_t count = ufs::kernels::CountMismatches(expected + position, actual + position, sectorEnd - position);
+					result.AddSectorDifferences(sector, count, offset + position, expected[position], actual[position]);
+					break;
+				}
+
+				size_t run = sectorEnd - position;
+				ufs::kernels::FindFirstMatch(expected + position, actual + position, sectorEnd - position, run);
+				result.AddDifferenceRange(offset + position, run, expected[position], actual[position]);
+				position += run;
+				if (position == sectorEnd
+					|| !ufs::kernels::FindFirstMismatch(expected + position, actual + position, sectorEnd - position, found))
+				{
+					break;
+				}
+				position += found;
+			}
+			position = sectorEnd;
+		}
+	}
+
+	// The results of the pieces of a compare that finds every difference or
+	// counts bit errors, joined in offset order whichever order the pieces
+	// finish in.
+	template<class Result>
+	class PieceResults
+	{
+	public:
+		void Add(size_t begin, const Result& result)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_pieces.push_back(std::make_pair(begin, result));
+		}
+
+		// Append the pieces to result, which ends where the first begins.
+		Result Join(Result result)
+		{
+			std::sort(_pieces.begin(), _pieces.end(), [](const Piece& a, const Piece& b)
+			{
+				return a.first < b.first;
+			});
+
+			for (size_t i = 0; i < _pieces.size(); i++)
+			{
+				result.Append(_pieces[i].second);
+			}
+			return result;
+		}
+
+	private:
+		typedef std::pair<size_t, Result> Piece;
+
+		std::mutex _mutex;
+		std::vector<Piece> _pieces;
+	};
+
+	// Run body over length bytes compared against pattern: split across the
+	// pool, or in order on this thread for a pattern generated from its start.
+	void ForEachPatternPiece(const ufs::PatternBuffer& pattern, size_t length, size_t bytesPerSector,
+							 const ufs::WorkerPool::RangeFunction& body)
+	{
+		if (!pattern.IsSequential())
+		{
+			ufs::WorkerPool::GetInstance().ParallelForBytes(length, bytesPerSector, body);
+		}
+		else if (length != 0)
+		{
+			body(0, length);
+		}
+	}
+
+	bool UseStreamingStores(size_t length)
+	{
+		return length >= ufs::kernels::GetStreamingThreshold();
+	}
+
+	// Run kernel(data, length) over [0, length) of data, split across the
+	// worker pool for large ranges. Pieces start on a multiple of period, so
+	// patterns restarting every period bytes match a single call.
+	//
+	// Fills of at least the streaming threshold generate a tile of whole
+	// periods once and stream copies of it instead.
+	//
+	// With an active stamp the range is filled a block of whole sectors at a
+	// time and each block is stamped straight after, while still in cache.
+	template<class Kernel>
+	void ParallelFill(UInt8* data, size_t length, size_t period, Kernel kernel, const SectorStamp& stamp)
+	{
+		ufs::WorkerPool& pool = ufs::WorkerPool::GetInstance();
+		bool stream = UseStreamingStores(length);
+		size_t alignment = stamp.IsActive() ? std::lcm(period, stamp.bytesPerSector) : period;
+
+		if (alignment > MAX_FUSED_ALIGNMENT)
+		{
+			ParallelFill(data, length, period, kernel, SectorStamp());
+			pool.ParallelForBytes(length, stamp.bytesPerSector, [&](size_t begin, size_t end)
+			{
+				stamp(data + begin, begin, end - begin);
+			});
+			return;
+		}
+
+		if (!stream && !stamp.IsActive())
+		{
+			pool.ParallelForBytes(length, period, [&](size_t begin, size_t end)
+			{
+				kernel(data + begin, end - begin);
+			});
+			return;
+		}
+
+		// Every block starts on a multiple of the period, so a tile of one
+		// block is the pattern of each of them.
+		size_t blockLength = std::max<size_t>(STAGING_BYTES / alignment, 1) * alignment;
+		std::vector<UInt8> tile;
+		if (stream)
+		{
+			tile.resize(blockLength);
+			kernel(tile.data(), blockLength);
+		}
+
+		pool.ParallelForBytes(length, alignment, [&](size_t begin, size_t end)
+		{
+			if (stream && !stamp.IsActive())
+			{
+				ufs::kernels::StreamRepeat(data + begin, end - begin, tile.data(), blockLength);
+				return;
+			}
+
+			std::vector<UInt8> staging(stream ? blockLength : 0);
+			for (size_t offset = begin; offset < end; offset += blockLength)
+			{
+				size_t count = std::min(blockLength, end - offset);
+				if (stream)
+				{
+					::memcpy(staging.data(), tile.data(), count);
+					stamp(staging.data(), offset, count);
+					ufs::kernels::StreamCopy(data + offset, staging.data(), count);
+				}
+				else
+				{
+					kernel(data + offset, count);
+					stamp(data + offset, offset, count);
+				}
+			}
+		});
+	}
+
+	// Write length bytes from generate(out, count), which produces the next
+	// count bytes of the data each call. Streaming writes go through a small
+	// staging block. Calls are for blockLength bytes except the last, and
+	// with an active stamp blockLength is whole sectors and each block is
+	// stamped as it is generated. Pieces of a larger fill pass whether the
+	// whole fill streams.
+	template<class Generator>
+	void WriteGenerated(UInt8* data, size_t length, size_t blockLength, Generator generate, const SectorStamp& stamp, bool stream)
+	{
+		if (!stream && !stamp.IsActive())
+		{
+			generate(data, length);
+			return;
+		}
+
+		std::vector<UInt32> staging(stream ? (blockLength + 3) / 4 : 0);
+		for (size_t done = 0; done < length; done += blockLength)
+		{
+			size_t count = std::min(blockLength, length - done);
+			UInt8* block = stream ? reinterpret_cast<UInt8*>(staging.data()) : data + done;
+			generate(block, count);
+			stamp(block, done, count);
+			if (stream)
+			{
+				ufs::kernels::StreamCopy(data + done, block, count);
+			}
+		}
+	}
+
+	// Copy length bytes. Large copies between ranges that don't overlap are
+	// split across the worker pool, and streamed above the threshold.
+	void CopyBytes(UInt8* destination, const UInt8* source, size_t length)
+	{
+		if (destination + length <= source || source + length <= destination)
+		{
+			bool stream = UseStreamingStores(length);
+			ufs::WorkerPool::GetInstance().ParallelForBytes(length, 64, [&](size_t begin, size_t end)
+			{
+				if (stream)
+				{
+					ufs::kernels::StreamCopy(destination + begin, source + begin, end - begin);
+				}
+				else
+				{
+					::memcpy(destination + begin, source + begin, end - begin);
+				}
+			});
+		}
+		else
+		{
+			::memmove(destination, source, length);
+		}
+	}
+
 	std::string ByteArrayToString(UInt8* bytes, size_t startByte, size_t endByte, size_t sectorSize, ufs::ByteGrouping grouping)
 	{
 		std::stringstream ss;
@@ -141,1641 +416,3780 @@ ufs::Buffer::Buffer(const ufs::Buffer& buffer)
 	}
 
 	//should we avoid copying the name?
-	this->_allocatedByteCount = buffer._allocatedByteCount;
-	this->_dataBufferSize = buffer._dataBufferSize;
+	this->_allocationMode = buffer._allocationMode;
+	this->_numaPlacement = buffer._numaPlacement;
+	this->_layout = buffer._layout;
+	this->_overlay = buffer._overlay;
 
-	_data = new UInt8[_allocatedByteCount];
-
-	_dataStart = CalculateDataStart(_data, GetDataBufferSize());
+	CalculateTotalBytesToAllocate(GetTotalBytes());
+	AllocateData();
 
-	::memcpy(_dataStart, buffer.GetDataStart(), buffer.GetTotalBytes());
+	// A source still holding its allocator zero pages has nothing to copy.
+	this->_isKnownZero = buffer._isKnownZero;
+	if (!_isKnownZero)
+	{
+		CopyBytes(_dataStart, buffer._dataStart, buffer.GetTotalBytes());
+	}
 
 }
 
 /// <summary>
-/// Creates a new Buffer object. Equivalent: dmx.Buffer(0x10000, 512).
+/// Buffer move constructor. Takes ownership of the data and random number
+/// generator of "buffer" without copying. "buffer" is left empty, with a
+/// SectorCount of zero.
 /// </summary>
-ufs::Buffer::Buffer()
-	: _allocatedByteCount(0)
+/// <param name = "buffer">
+/// The buffer to move from.
+/// </param>
+ufs::Buffer::Buffer(ufs::Buffer&& buffer) noexcept
+	: _name(std::move(buffer._name)),
+	  _data(buffer._data),
+	  _dataStart(buffer._dataStart),
+	  _bytesPerSector(buffer._bytesPerSector),
+	  _sectorCount(buffer._sectorCount),
+	  _random(buffer._random),
+	  _allocatedByteCount(buffer._allocatedByteCount),
+	  _dataBufferSize(buffer._dataBufferSize),
+	  _usePatternMode(buffer._usePatternMode),
+	  _allocationMode(buffer._allocationMode),
+	  _backing(buffer._backing),
+	  _isPooled(buffer._isPooled),
+	  _numaPlacement(buffer._numaPlacement),
+	  _layout(buffer._layout),
+	  _snapshot(std::move(buffer._snapshot)),
+	  _deleter(std::move(buffer._deleter)),
+	  _overlay(std::move(buffer._overlay)),
+	  _isKnownZero(buffer._isKnownZero),
+	  _isSnapshotCurrent(buffer._isSnapshotCurrent)
 {
-	Initialize(ufs::DEFAULT_SECTOR_COUNT, ufs::DEFAULT_BYTES_PER_SECTOR);
+	buffer._data = NULL;
+	buffer._dataStart = NULL;
+	buffer._sectorCount = 0;
+	buffer._random = NULL;
+	buffer._allocatedByteCount = 0;
+	buffer._dataBufferSize = 0;
+	buffer._isPooled = false;
+	buffer._isKnownZero = true;
 }
 
 /// <summary>
-/// Creates a new Buffer object. Equivalent: dmx.Buffer(sectorCount, 512).
+/// Copies the contents of "buffer" into this buffer. The existing allocation
+/// is reused when it has the same data buffer size and layout as "buffer", otherwise a
+/// new one is made. The name of this buffer is kept.
 /// </summary>
-/// <param name = "sectorCount">
-/// The number of sectors in the new buffer.
+/// <param name = "buffer">
+/// The buffer to copy.
 /// </param>
-ufs::Buffer::Buffer(size_t sectorCount)
-	: _allocatedByteCount(0)
+ufs::Buffer& ufs::Buffer::operator=(const ufs::Buffer& buffer)
 {
-	Initialize(sectorCount, ufs::DEFAULT_BYTES_PER_SECTOR);
+	if (this == &buffer)
+	{
+		return *this;
+	}
+
+	if (_data == NULL || IsReadOnly() || _dataBufferSize != buffer._dataBufferSize || _layout != buffer._layout)
+	{
+		std::string name = _name;
+		Buffer copy(buffer);
+		Swap(copy);
+		_name = name;
+		return *this;
+	}
+
+	_bytesPerSector = buffer._bytesPerSector;
+	_sectorCount = buffer._sectorCount;
+	_usePatternMode = buffer._usePatternMode;
+	_overlay = buffer._overlay;
+
+	delete _random;
+	_random = buffer._random != NULL ? new Random32(*buffer._random) : NULL;
+
+	if (!(buffer._isKnownZero && _isKnownZero))
+	{
+		MarkModified();
+		CopyBytes(_dataStart, buffer._dataStart, buffer.GetTotalBytes());
+	}
+
+	return *this;
 }
 
 /// <summary>
-/// Creates a new buffer object and fills with zeros.
+/// Buffer move assignment. Releases the data of this buffer and takes
+/// ownership of the data of "buffer" without copying.
 /// </summary>
-/// <param name = "sectorCount">
-/// The number of sectors in the new buffer.
-/// </param>
-/// <param name = "bytesPerSector">
-/// The number of bytes in each sector in the new buffer.
+/// <param name = "buffer">
+/// The buffer to move from.
 /// </param>
-ufs::Buffer::Buffer(size_t sectorCount, size_t bytesPerSector)
-	: _allocatedByteCount(0)
+ufs::Buffer& ufs::Buffer::operator=(ufs::Buffer&& buffer) noexcept
 {
-	Initialize(sectorCount, bytesPerSector);
+	if (this != &buffer)
+	{
+		Buffer moved(std::move(buffer));
+		Swap(moved);
+	}
+	return *this;
 }
 
-// Not exposed to Python. Used internally when creating buffers that should not be exposed to the gui
-ufs::Buffer::Buffer(size_t sectorCount, size_t bytesPerSector, bool bMakeAvailableToGui)
-	: _allocatedByteCount(0)
+/// <summary>
+/// Exchanges the contents of this buffer and "buffer" without copying any data.
+/// </summary>
+/// <param name = "buffer">
+/// The buffer to exchange contents with.
+/// </param>
+void ufs::Buffer::Swap(ufs::Buffer& buffer) noexcept
 {
-	Initialize(sectorCount, bytesPerSector, bMakeAvailableToGui);
+	std::swap(_name, buffer._name);
+	std::swap(_data, buffer._data);
+	std::swap(_dataStart, buffer._dataStart);
+	std::swap(_bytesPerSector, buffer._bytesPerSector);
+	std::swap(_sectorCount, buffer._sectorCount);
+	std::swap(_random, buffer._random);
+	std::swap(_allocatedByteCount, buffer._allocatedByteCount);
+	std::swap(_dataBufferSize, buffer._dataBufferSize);
+	std::swap(_usePatternMode, buffer._usePatternMode);
+	std::swap(_allocationMode, buffer._allocationMode);
+	std::swap(_backing, buffer._backing);
+	std::swap(_isPooled, buffer._isPooled);
+	std::swap(_numaPlacement, buffer._numaPlacement);
+	std::swap(_layout, buffer._layout);
+	std::swap(_snapshot, buffer._snapshot);
+	std::swap(_deleter, buffer._deleter);
+	std::swap(_overlay, buffer._overlay);
+	std::swap(_isKnownZero, buffer._isKnownZero);
+	std::swap(_isSnapshotCurrent, buffer._isSnapshotCurrent);
 }
 
-void ufs::Buffer::Initialize(size_t sectorCount, size_t bytesPerSector, bool /*bMakeAvailableToGui*/)
+/// <summary>
+/// Creates a copy-on-write clone of this buffer. The clone shares the pages of
+/// this buffer until either of them writes to a page, which then gets a
+/// private copy of just that page. Cloning a large pattern buffer per worker
+/// that only modifies a few sectors therefore costs about the memory of the
+/// modified pages instead of a full copy.
+///
+/// The first clone takes a snapshot of the data (one copy of the buffer, none
+/// when it holds only zeros) and this buffer itself becomes a view of the
+/// snapshot in place, so its address, and every view of it and pointer into
+/// it, stay valid. Further clones reuse the snapshot until this buffer is
+/// modified. CompareTo between buffers sharing a snapshot skips the pages
+/// neither of them has written. Pages privatized by a write are placed by
+/// the NUMA placement of the buffer that writes them.
+///
+/// Where snapshots are not available (not Linux), and for blocks that cannot
+/// become a view in place (small heap blocks) or would lose their huge pages,
+/// the clone is a regular copy.
+/// </summary>
+ufs::Buffer ufs::Buffer::CloneCopyOnWrite()
 {
-	_random = 0;
-
-	// Simulator compression mode will be enabled if DMX_SIMULATOR_ENABLED != 0.
-	// Data generation rule info will embed into data buffer.
-	// Simulator can recover data by using these rules.
-	char *dmxSimulatorEnabled = getenv("DMX_SIMULATOR_ENABLED");
-	if (dmxSimulatorEnabled == NULL)
-	{
-		_usePatternMode = 0;
-	}
-	else
+	// External memory and file mappings must stay where they are, so their
+	// clones are regular copies.
+	if (_backing == ufs::ExternalBacking || _backing == ufs::FileBacking || _backing == ufs::ReadOnlyFileBacking)
 	{
-		_usePatternMode = atoi(dmxSimulatorEnabled);
+		return Buffer(*this);
 	}
 
-	if( sectorCount < 1)
+	if (!_isSnapshotCurrent && !TakeSnapshot())
 	{
-		throw ufs::ArgumentError("sectorCount must be greater than zero.");
+		return Buffer(*this);
 	}
 
-	if( bytesPerSector < 1)
+	ufs::PageBlock view;
+	if (!_snapshot->Map(view))
 	{
-		throw ufs::ArgumentError("bytesPerSector must be greater than zero.");
+		return Buffer(*this);
 	}
+	PlaceView(view);
 
-	_name = "";
-
-	_bytesPerSector = bytesPerSector;
-	_sectorCount = sectorCount;
+	return Buffer(*this, view);
+}
 
-	CalculateTotalBytesToAllocate(GetTotalBytes());
-	_data = new UInt8[_allocatedByteCount];
+// Makes the data block a copy-on-write view of a new snapshot of itself. The
+// view takes the place of the mapping, so data pointers handed out before
+// stay valid; blocks that are not plain mappings are left alone. A pooled
+// mapping is not given back to the pool afterwards.
+bool ufs::Buffer::TakeSnapshot()
+{
+	if (_backing != ufs::MappedBacking && _backing != ufs::SnapshotBacking)
+	{
+		return false;
+	}
 
-	_dataStart = CalculateDataStart(_data, GetDataBufferSize());
+	std::shared_ptr<ufs::PageSnapshot> snapshot = ufs::PageSnapshot::Create(_data, _allocatedByteCount, _isKnownZero);
+	if (!snapshot)
+	{
+		return false;
+	}
 
-	// This IS necessary!!
-	//FillZeros();
-	Fill(0, 0, sectorCount);
+	ufs::PageBlock block = { _data, _allocatedByteCount, _backing };
+	ufs::PageBlock view;
+	if (block.length != snapshot->GetLength() || !snapshot->Map(view, &block))
+	{
+		return false;
+	}
+	PlaceView(view);
+
+	_allocatedByteCount = view.length;
+	_backing = view.backing;
+	_isPooled = false;
+	_snapshot = snapshot;
+	_isSnapshotCurrent = true;
+	return true;
 }
 
-ufs::Buffer::~Buffer()
+// Applies the NUMA placement to an unwritten snapshot view, so the pages a
+// write privatizes are allocated where the buffer's pages belong.
+void ufs::Buffer::PlaceView(const ufs::PageBlock& view) const
 {
-	delete [] _data;
-
-	if (_random)
+	if (_numaPlacement.policy != ufs::NumaLocal)
 	{
-		delete _random;
+		ufs::Numa::Place(view.address, view.length, _numaPlacement);
 	}
 }
 
-void ufs::Buffer::CalculateTotalBytesToAllocate(size_t dataByteCount)
+// Wraps a copy-on-write view of the snapshot of "buffer".
+ufs::Buffer::Buffer(const ufs::Buffer& buffer, const ufs::PageBlock& view)
+	: _name(buffer._name),
+	  _data(view.address),
+	  _bytesPerSector(buffer._bytesPerSector),
+	  _sectorCount(buffer._sectorCount),
+	  _random(buffer._random != NULL ? new Random32(*buffer._random) : NULL),
+	  _allocatedByteCount(view.length),
+	  _dataBufferSize(buffer._dataBufferSize),
+	  _usePatternMode(buffer._usePatternMode),
+	  _allocationMode(buffer._allocationMode),
+	  _backing(view.backing),
+	  _isPooled(false),
+	  _numaPlacement(buffer._numaPlacement),
+	  _layout(buffer._layout),
+	  _snapshot(buffer._snapshot),
+	  _overlay(buffer._overlay),
+	  _isKnownZero(buffer._isKnownZero),
+	  _isSnapshotCurrent(true)
 {
-	// Allocated bytes are not necessarily on a 4K boundary. Need to allocate enough memory
-	// so that the data start can be 4K aligned and another 4K to support putting UFS structures before
-	// the start of the data (still used by users' simulator driver).
-
-	size_t dataByteCountLowBits = dataByteCount & 0xFFF;
-	size_t alignmentOffset = dataByteCountLowBits == 0 ? 0 : 0x1000 - dataByteCountLowBits;
-	_dataBufferSize = dataByteCount + alignmentOffset;
-	_allocatedByteCount = _dataBufferSize + 4095 + 4096;
+	_dataStart = _data + (buffer._dataStart - buffer._data);
 }
 
-UInt8* ufs::Buffer::CalculateDataStart(UInt8* data, size_t dataByteCount)
+/// <summary>
+/// Returns the number of pages of the buffer allocation still shared with
+/// the snapshot of a copy-on-write clone (see CloneCopyOnWrite). Zero when
+/// the buffer is not part of a clone or sharing cannot be determined.
+/// </summary>
+size_t ufs::Buffer::GetSharedPageCount() const
 {
-	// Calculate an offset to achieve a 4K buffer alignment
-	UInt64 dataStartLowBits = ((UInt64)data) & 0xFFF;
-	UInt64 alignmentOffset = dataStartLowBits == 0 ? 0 : 0x1000 - dataStartLowBits;
-	UInt8* dataStart = (UInt8*)((UInt64)data + alignmentOffset);
-
-	// Increase the data start by another 4K to support putting UFS structures before
-	// the start of the data
-	dataStart += 0x1000;
-
-	// Sanity check to make sure all data can fit in the allocated memory.
-	if((UInt64)dataStart + (UInt64)dataByteCount > (UInt64)data + (UInt64)_allocatedByteCount)
+	std::vector<bool> shared;
+	if (!_snapshot || !ufs::PageSnapshot::GetSharedPages(_data, _allocatedByteCount, shared))
 	{
-		throw ufs::RuntimeError("Buffer allocation error");
+		return 0;
 	}
-
-	return dataStart;
+	return static_cast<size_t>(std::count(shared.begin(), shared.end(), true));
 }
 
-//
-// Public Properties
-//
-
 /// <summary>
-/// Gets or sets the Name of the buffer.
+/// Creates a new Buffer object. Equivalent: dmx.Buffer(0x10000, 512).
 /// </summary>
-std::string ufs::Buffer::GetName() const
+ufs::Buffer::Buffer()
+	: _allocatedByteCount(0), _allocationMode(ufs::StandardPages),
+	  _numaPlacement(ufs::NumaPlacement::Local()),
+	  _layout(ufs::BufferLayout::Default())
 {
-	return _name;
+	Initialize(ufs::DEFAULT_SECTOR_COUNT, ufs::DEFAULT_BYTES_PER_SECTOR);
 }
 
 /// <summary>
-/// Sets the Name of the buffer.
+/// Creates a new Buffer object. Equivalent: dmx.Buffer(sectorCount, 512).
 /// </summary>
-/// <param name="name">String assigned as name of the buffer.</param>
-void ufs::Buffer::SetName(const std::string& name)
+/// <param name = "sectorCount">
+/// The number of sectors in the new buffer.
+/// </param>
+ufs::Buffer::Buffer(size_t sectorCount)
+	: _allocatedByteCount(0), _allocationMode(ufs::StandardPages),
+	  _numaPlacement(ufs::NumaPlacement::Local()),
+	  _layout(ufs::BufferLayout::Default())
 {
-	_name = name;
+	Initialize(sectorCount, ufs::DEFAULT_BYTES_PER_SECTOR);
 }
 
-
 /// <summary>
-/// Returns the buffer if is filled all zeros.
+/// Creates a new buffer object and fills with zeros.
 /// </summary>
-bool ufs::Buffer::IsAllZeros()
+/// <param name = "sectorCount">
+/// The number of sectors in the new buffer.
+/// </param>
+/// <param name = "bytesPerSector">
+/// The number of bytes in each sector in the new buffer.
+/// </param>
+ufs::Buffer::Buffer(size_t sectorCount, size_t bytesPerSector)
+	: _allocatedByteCount(0), _allocationMode(ufs::StandardPages),
+	  _numaPlacement(ufs::NumaPlacement::Local()),
+	  _layout(ufs::BufferLayout::Default())
 {
-	if (this->GetDataStart()[0] == 0)
-	{
-		// compare two buffers : buf[0, size-1] and buf[1, size]
-		// 0 to 1, 1 to 2, ..., size-2 to size-1
-		// becuase buf[0] is 0, so it works by this way.
-		return !::memcmp(this->GetDataStart(), this->GetDataStart() + 1, this->GetTotalBytes() - 1);
-	}
-
-	return false;
+	Initialize(sectorCount, bytesPerSector);
 }
 
-//
-// Public Methods
-//
+// Not exposed to Python. Used internally when creating buffers that should not be exposed to the gui
+ufs::Buffer::Buffer(size_t sectorCount, size_t bytesPerSector, bool bMakeAvailableToGui)
+	: _allocatedByteCount(0), _allocationMode(ufs::StandardPages),
+	  _numaPlacement(ufs::NumaPlacement::Local()),
+	  _layout(ufs::BufferLayout::Default())
+{
+	Initialize(sectorCount, bytesPerSector, bMakeAvailableToGui);
+}
 
 /// <summary>
-/// Calculates a checksum byte value for the given range of bytes.
-///
-/// The checksum is the two's complement of the sum of all bytes starting at
-/// startByte for byteCount bytes. Each byte is added with unsigned arithmetic
-/// and overflow is ignored. The sum of all bytes used to calculate the
-/// checksum plus the checksum is zero when the checksum is correct.
-///
-/// | Typical use is to write a checksum in the last sector of a buffer
-/// similar to this:
-///
-///   ``buf.SetByte(511, buf.CalculateChecksumByte(0, 511))``
-///
+/// Creates a new buffer object backed by the kind of pages requested in
+/// "allocationMode" and fills with zeros. Huge and gigantic page requests
+/// try an explicit hugetlb mapping first, then a huge page aligned anonymous
+/// mapping advised for transparent huge pages, and finally fall back to a
+/// standard allocation. Use GetPageBacking to find out which one was used.
 /// </summary>
-/// <param name="startByte">The index of the first byte used to calculate the checksum.</param>
-/// <param name="byteCount">The number of bytes uses to calculate the checksum.</param>
-UInt8 ufs::Buffer::CalculateChecksumByte(size_t startByte, size_t byteCount)
+/// <param name = "sectorCount">
+/// The number of sectors in the new buffer.
+/// </param>
+/// <param name = "bytesPerSector">
+/// The number of bytes in each sector in the new buffer.
+/// </param>
+/// <param name = "allocationMode">
+/// The kind of pages to back the buffer with.
+/// </param>
+ufs::Buffer::Buffer(size_t sectorCount, size_t bytesPerSector, ufs::AllocationMode allocationMode)
+	: _allocatedByteCount(0), _allocationMode(allocationMode),
+	  _numaPlacement(ufs::NumaPlacement::Local()),
+	  _layout(ufs::BufferLayout::Default())
 {
-	if(byteCount == 0)
-	{
-		throw ufs::ArgumentError("byteCount must be greater than 0.");
-	}
+	Initialize(sectorCount, bytesPerSector);
+}
 
-	if(startByte + byteCount > GetTotalBytes())
+/// <summary>
+/// Creates a new buffer object placed on NUMA nodes as requested in
+/// "numaPlacement" and fills with zeros. The pages are bound to one node, or
+/// interleaved over all nodes, before they are first touched, and are then
+/// faulted in by threads running on the CPUs of those nodes. On systems
+/// without NUMA support the placement is ignored.
+/// </summary>
+/// <param name = "sectorCount">
+/// The number of sectors in the new buffer.
+/// </param>
+/// <param name = "bytesPerSector">
+/// The number of bytes in each sector in the new buffer.
+/// </param>
+/// <param name = "numaPlacement">
+/// Where to place the pages, e.g. NumaPlacement::OnNode(1) or
+/// NumaPlacement::Interleaved().
+/// </param>
+ufs::Buffer::Buffer(size_t sectorCount, size_t bytesPerSector, const ufs::NumaPlacement& numaPlacement)
+	: _allocatedByteCount(0), _allocationMode(ufs::StandardPages),
+	  _numaPlacement(numaPlacement), _layout(ufs::BufferLayout::Default())
+{
+	if (numaPlacement.policy == ufs::NumaBind
+		&& (numaPlacement.node < 0 || numaPlacement.node >= ufs::Numa::GetNodeCount()))
 	{
-		throw ufs::OutOfRangeError("startByte + byteCount is greater that TotalBytes.");
+		throw ufs::ArgumentError("numaPlacement.node (" + std::to_string(numaPlacement.node)
+			+ ") must be less than the number of NUMA nodes ("
+			+ std::to_string(ufs::Numa::GetNodeCount()) + ").");
 	}
 
-	UInt8 result = 0;
+	Initialize(sectorCount, bytesPerSector);
+}
 
-	for(size_t i = startByte; i < (startByte + byteCount); i++)
+/// <summary>
+/// Creates a new buffer object with the data alignment and header reserve in
+/// "layout" and fills with zeros. A small buffer that is never handed to a
+/// driver can drop the 4K UFS header slot, e.g. with
+/// BufferLayout::FromPolicy&lt;CompactLayout&gt;(), and O_DIRECT or huge page
+/// users can ask for larger alignments.
+/// </summary>
+/// <param name = "sectorCount">
+/// The number of sectors in the new buffer.
+/// </param>
+/// <param name = "bytesPerSector">
+/// The number of bytes in each sector in the new buffer.
+/// </param>
+/// <param name = "layout">
+/// The alignment of the data start (a power of two) and the number of bytes
+/// kept free in front of it.
+/// </param>
+ufs::Buffer::Buffer(size_t sectorCount, size_t bytesPerSector, const ufs::BufferLayout& layout)
+	: _allocatedByteCount(0), _allocationMode(ufs::StandardPages),
+	  _numaPlacement(ufs::NumaPlacement::Local()), _layout(layout)
+{
+	if (!layout.IsValid())
 	{
-		// Access pointer directly since we already did our bounds checking.
-		result = static_cast<UInt8>(result + _dataStart[i]);
+		throw ufs::ArgumentError("layout.alignment (" + std::to_string(layout.alignment)
+			+ ") must be a power of two.");
 	}
 
-	// 2's complement calculation is the complement of the sum of the values, plus 1;
-	result = static_cast<UInt8>((~result) + 1);
-	return result;
+	Initialize(sectorCount, bytesPerSector);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.GetBitCount(0)
+/// Wraps caller owned memory as a buffer without copying or zero-filling it.
+/// The data starts at "memory", which must have the alignment Buffer
+/// guarantees for its own data (4K), and holds length / bytesPerSector
+/// sectors. There is no header reserve in front of the data.
 /// </summary>
-UInt64 ufs::Buffer::GetBitCount() const
+/// <param name = "memory">
+/// The first byte of the memory to adopt.
+/// </param>
+/// <param name = "length">
+/// The number of bytes of memory; at least one sector.
+/// </param>
+/// <param name = "bytesPerSector">
+/// The number of bytes in each sector.
+/// </param>
+/// <param name = "deleter">
+/// Called with "memory" and "length" when the buffer lets go of the memory
+/// (destruction, or Resize beyond "length"). May be empty to keep ownership.
+/// </param>
+ufs::Buffer::Buffer(UInt8* memory, size_t length, size_t bytesPerSector, const ufs::ExternalDeleter& deleter)
+	: _allocatedByteCount(0), _allocationMode(ufs::StandardPages),
+	  _numaPlacement(ufs::NumaPlacement::Local()),
+	  _layout(ufs::BufferLayout::Create(ufs::DefaultLayout::alignment, 0)), _deleter(deleter)
 {
-	return GetBitCount(0);
+	ufs::PageBlock block = { memory, length, ufs::ExternalBacking };
+	Adopt(block, bytesPerSector == 0 ? 0 : length / bytesPerSector, bytesPerSector);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.GetBitCount(startingOffset, 0)
+/// Wraps caller owned memory as a buffer of "sectorCount" sectors without
+/// copying or zero-filling it. The data starts "layout.headerReserve" bytes
+/// into "memory", and must have the alignment in "layout", exactly as for
+/// memory the buffer allocates itself.
 /// </summary>
-/// <param name="startingOffset">
-/// The starting offset in bytes.  Default is 0.
+/// <param name = "memory">
+/// The first byte of the memory to adopt, where the header reserve starts.
 /// </param>
-UInt64 ufs::Buffer::GetBitCount(size_t startingOffset) const
+/// <param name = "length">
+/// The number of bytes of memory.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors in the buffer.
+/// </param>
+/// <param name = "bytesPerSector">
+/// The number of bytes in each sector.
+/// </param>
+/// <param name = "deleter">
+/// Called with "memory" and "length" when the buffer lets go of the memory.
+/// May be empty to keep ownership.
+/// </param>
+/// <param name = "layout">
+/// The required data alignment and the header reserve in front of the data.
+/// </param>
+ufs::Buffer::Buffer(UInt8* memory, size_t length, size_t sectorCount, size_t bytesPerSector,
+					const ufs::ExternalDeleter& deleter, const ufs::BufferLayout& layout)
+	: _allocatedByteCount(0), _allocationMode(ufs::StandardPages),
+	  _numaPlacement(ufs::NumaPlacement::Local()), _layout(layout), _deleter(deleter)
 {
-	return GetBitCount(startingOffset, 0);
+	if (!layout.IsValid())
+	{
+		throw ufs::ArgumentError("layout.alignment (" + std::to_string(layout.alignment)
+			+ ") must be a power of two.");
+	}
+
+	ufs::PageBlock block = { memory, length, ufs::ExternalBacking };
+	Adopt(block, sectorCount, bytesPerSector);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.GetBitCount(startingOffset, length, 1)
+/// Maps a whole file as a buffer of file size / bytesPerSector sectors.
+/// Reads and writes go straight to the file's pages, nothing is copied.
+/// Resizing the buffer beyond the file detaches it into an ordinary buffer.
 /// </summary>
-/// <param name="startingOffset">
-/// The starting offset in bytes.  Default is 0.
+/// <param name = "fileName">
+/// The file to map. It must hold at least one sector.
 /// </param>
-/// <param name="length">
-/// The length of bytes to count bits in, or 0 to count bits until the end.  Default is 0.
+/// <param name = "bytesPerSector">
+/// The number of bytes in each sector.
 /// </param>
-UInt64 ufs::Buffer::GetBitCount(size_t startingOffset, size_t length) const
+ufs::Buffer ufs::Buffer::MapFile(const std::string& fileName, size_t bytesPerSector)
 {
-	return GetBitCount(startingOffset, length, 1);
+	return MapFile(fileName, bytesPerSector, ufs::MapReadWrite);
 }
 
 /// <summary>
-/// Returns the number of 0 or 1 bits in a range of bytes.
+/// Maps a whole file as MapFile(fileName, bytesPerSector) does. With
+/// MapReadOnly the file is opened and mapped read-only, so files without
+/// write permission can be mapped; every write to the buffer then throws
+/// RuntimeError, and resizing or assigning to it detaches it into an
+/// ordinary buffer.
 /// </summary>
-/// <param name="startingOffset">
-/// The starting offset in bytes.  Default is 0.
+/// <param name = "fileName">
+/// The file to map. It must hold at least one sector.
 /// </param>
-/// <param name="length">
-/// The length of bytes to count bits in, or 0 to count bits until the end.  Default is 0.
+/// <param name = "bytesPerSector">
+/// The number of bytes in each sector.
 /// </param>
-/// <param name="value">
-/// The bit value, 0 or 1, to count.  Default is 1.
+/// <param name = "access">
+/// Whether the buffer may write to the file.
 /// </param>
-UInt64 ufs::Buffer::GetBitCount(size_t startingOffset, size_t length, UInt8 value) const
+ufs::Buffer ufs::Buffer::MapFile(const std::string& fileName, size_t bytesPerSector, ufs::MapAccess access)
 {
-	size_t newLength = ValidateByteRangeAndGetLength(startingOffset, length);
+	ufs::PageBlock block = ufs::PageAllocator::MapFile(fileName, access == ufs::MapReadWrite);
+	if (block.address == NULL)
+	{
+		throw ufs::RuntimeError("Unable to map file " + fileName + ": " + ::strerror(errno));
+	}
 
-	UInt8 invertMaskForCountingZeroes = 0x00;
-	if (value == 0)
+	try
+	{
+		// File backed blocks are unmapped by the PageAllocator, no deleter needed.
+		Buffer buffer(block.address, block.length, bytesPerSector, ufs::ExternalDeleter());
+		buffer._backing = block.backing;
+		return buffer;
+	}
+	catch (...)
 	{
-		// To count 0 bits, invert the bits and count the 1 bits.
-		invertMaskForCountingZeroes = 0xFF;
+		ufs::PageAllocator::Release(block);
+		throw;
 	}
+}
+
+void ufs::Buffer::Adopt(const ufs::PageBlock& block, size_t sectorCount, size_t bytesPerSector)
+{
+	_random = 0;
+	_usePatternMode = IsPatternModeEnabled();
+	_name = "";
 
-	// For performance, use a lookup table of the count of 1s in each byte.
-	static UInt64 lookup[256];
-	if (lookup[255] == 0)	// Lazy initialization (lookup[255] is 0xFF, should be 8)
+	if (block.address == NULL)
 	{
-		for (int i = 0; i < 256; ++i)
-		{
-			UInt64 count = 0;
-			for (int bit = 0; bit < 8; ++bit)
-			{
-				count += (i >> bit) & 0x1;
-			}
-			lookup[i] = count;
-		}
+		throw ufs::ArgumentError("memory must not be NULL.");
 	}
 
-	UInt64 bitCount = 0;
-	const size_t endByte = startingOffset + newLength;
-	for (size_t i = startingOffset; i < endByte; ++i)
+	if (sectorCount < 1 || bytesPerSector < 1)
 	{
-		const UInt8 val = _dataStart[i] ^ invertMaskForCountingZeroes;
-		bitCount += lookup[val];
+		throw ufs::ArgumentError("memory must hold at least one sector.");
 	}
-	return bitCount;
+
+	// The same guarantees CalculateDataStart gives owned memory.
+	UInt8* dataStart = block.address + _layout.headerReserve;
+	if (((UInt64)dataStart & ((UInt64)_layout.alignment - 1)) != 0)
+	{
+		throw ufs::ArgumentError("The data start of adopted memory must be aligned to "
+			+ std::to_string(_layout.alignment) + " bytes.");
+	}
+
+	if (_layout.headerReserve > block.length
+		|| sectorCount > (block.length - _layout.headerReserve) / bytesPerSector)
+	{
+		throw ufs::ArgumentError("memory is too small for the header reserve and sectorCount sectors.");
+	}
+
+	_data = block.address;
+	_dataStart = dataStart;
+	_allocatedByteCount = block.length;
+	_backing = block.backing;
+	_isPooled = false;
+	_sectorCount = sectorCount;
+	_bytesPerSector = bytesPerSector;
+	_dataBufferSize = GetTotalBytes();
+	_isKnownZero = false;
+	_isSnapshotCurrent = false;
 }
 
-/// <summary>
-/// Equivalent:  dmx.Buffer.CompareTo(buffer, 0)
-/// </summary>
-/// <param name = "buffer">
-/// The buffer to compare this buffer object to.
-/// </param>
-ufs::CompareResult ufs::Buffer::CompareTo(Buffer& buffer)
+void ufs::Buffer::Initialize(size_t sectorCount, size_t bytesPerSector, bool /*bMakeAvailableToGui*/)
 {
-	return CompareTo(buffer, 0);
+	_random = 0;
+	_usePatternMode = IsPatternModeEnabled();
+
+	if( sectorCount < 1)
+	{
+		throw ufs::ArgumentError("sectorCount must be greater than zero.");
+	}
+
+	if( bytesPerSector < 1)
+	{
+		throw ufs::ArgumentError("bytesPerSector must be greater than zero.");
+	}
+
+	_name = "";
+
+	_bytesPerSector = bytesPerSector;
+	_sectorCount = sectorCount;
+
+	CalculateTotalBytesToAllocate(GetTotalBytes());
+	AllocateData();
+
+	// The allocator hands out zero-filled memory (untouched zero pages for
+	// large buffers), so there is no need to FillZeros here.
+	_isKnownZero = true;
 }
 
-/// <summary>
-/// Equivalent:  dmx.Buffer.CompareTo(buffer, startSector, 0)
-/// </summary>
-/// <param name = "buffer">
-/// The buffer to compare this buffer object to.
-/// </param>
-/// <param name = "startSector">
-/// The sector to start the comparison at.
-/// </param>
-ufs::CompareResult ufs::Buffer::CompareTo(Buffer& buffer, size_t startSector)
+ufs::Buffer::~Buffer()
 {
-	return CompareTo(buffer, startSector, 0);
+	ReleaseData();
+
+	if (_random)
+	{
+		delete _random;
+	}
 }
 
-/// <summary>
-/// Equivalent:  dmx.Buffer.CompareTo(buffer, startSector, startSector, sectorCount)
-/// </summary>
-/// <param name = "buffer">
-/// The buffer to compare this buffer object to.
-/// </param>
-/// <param name = "startSector">
-/// The sector to start the comparison at.
-/// </param>
-/// <param name = "sectorCount">
-/// The number of sectors to compare.
-/// </param>
-ufs::CompareResult ufs::Buffer::CompareTo(Buffer& buffer, size_t startSector, size_t sectorCount)
+void ufs::Buffer::CalculateTotalBytesToAllocate(size_t dataByteCount)
 {
-	return CompareTo(buffer, startSector, startSector, sectorCount);
+	CalculateAllocationSizes(dataByteCount, _dataBufferSize, _allocatedByteCount);
 }
 
-/// <summary>
-/// Compares this :class:`dmx.Buffer` to another :class:`dmx.Buffer`. Comparison starts
-/// for this :class:`dmx.Buffer` at the sector specified by startSector and for the passed
-/// in :class:`dmx.Buffer` at the sector specified by startSector2. The number of sectors
-/// compared is specified by sectorCount. Returns a :class:`dmx.CompareResult` with the
-/// details  of the comparison.
-/// </summary>
-/// <param name = "buffer">
-/// The buffer to compare this buffer object to.
-/// </param>
-/// <param name = "startSector">
-/// The sector to start the comparison at for this buffer.
-/// </param>
-/// <param name = "startSector2">
-/// The sector to start the comparison at for the buffer passed in as "buffer".
-/// </param>
-/// <param name = "sectorCount">
-/// The number of sectors to compare.
-/// </param>
-ufs::CompareResult ufs::Buffer::CompareTo(Buffer& buffer, size_t startSector, size_t startSector2, size_t sectorCount)
+void ufs::Buffer::CalculateAllocationSizes(size_t dataByteCount, size_t& dataBufferSize, size_t& allocatedByteCount) const
 {
-	size_t startByte = 0;
-	size_t endByte = 0;
-	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+	// The data buffer size is a multiple of the layout alignment. Blocks from
+	// the PageAllocator always start on a page boundary, so alignments up to
+	// the page size need no slack, and larger ones need at most the difference.
+	// The header reserve sits in front of the data start (used by users'
+	// simulator driver for UFS structures in the default layout).
+	size_t alignment = _layout.alignment;
+	size_t pageSize = ufs::PageAllocator::GetPageSize();
+	size_t reserveAlignment = std::min(alignment, pageSize);
+
+	dataBufferSize = ((dataByteCount + alignment - 1) / alignment) * alignment;
+	size_t headerBytes = ((_layout.headerReserve + reserveAlignment - 1) / reserveAlignment) * reserveAlignment;
+	size_t slack = alignment > pageSize ? alignment - pageSize : 0;
+	allocatedByteCount = headerBytes + slack + dataBufferSize;
+}
 
-	size_t startByte2 = 0;
-	size_t endByte2 = 0;
-	buffer.GetStartAndStopBytesFromSectors(startSector2, sectorCount, startByte2, endByte2);
+void ufs::Buffer::AllocateData()
+{
+	bool isPooled = false;
+	ufs::PageBlock block = AllocateBlock(_allocatedByteCount, isPooled);
+	SetDataBlock(block, isPooled);
+}
 
-	size_t bytesToCompare = endByte - startByte;
+// Allocates and places a block of at least byteCount bytes without touching
+// the buffer, so a failed allocation leaves it as it was.
+ufs::PageBlock ufs::Buffer::AllocateBlock(size_t byteCount, bool& isPooled) const
+{
+	// Standard page blocks are drawn from the BufferPool when it is enabled.
+	// NUMA placed blocks are not, the pool does not know where their pages are.
+	ufs::BufferPool& pool = ufs::BufferPool::GetInstance();
+	bool isPlaced = _numaPlacement.policy != ufs::NumaLocal;
+	isPooled = _allocationMode == ufs::StandardPages && !isPlaced && pool.GetEnabled();
+
+	// Pooled and huge page backed blocks come back rounded up to their size
+	// class or page size, so the block length may exceed byteCount.
+	ufs::PageBlock block = isPooled
+		? pool.Acquire(byteCount)
+		: ufs::PageAllocator::Allocate(byteCount, _allocationMode, isPlaced);
+
+	// The policy has to be set while the pages are still untouched.
+	if (isPlaced && block.backing != ufs::HeapBacking
+		&& ufs::Numa::Place(block.address, block.length, _numaPlacement))
+	{
+		ufs::Numa::FirstTouch(block.address, block.length, _numaPlacement);
+	}
+	return block;
+}
 
-	if(sectorCount == 0)
+// Makes a new block from AllocateBlock the data block, laid out for the
+// current data buffer size.
+void ufs::Buffer::SetDataBlock(const ufs::PageBlock& block, bool isPooled)
+{
+	_data = block.address;
+	_allocatedByteCount = block.length;
+	_backing = block.backing;
+	_isPooled = isPooled;
+	_snapshot.reset();
+	_isSnapshotCurrent = false;
+	_dataStart = CalculateDataStart(_data, GetDataBufferSize());
+}
+
+void ufs::Buffer::ReleaseData()
+{
+	// Moved from buffers own no data.
+	if (_data == NULL)
 	{
-		// If sectorCount is 0/not passed in, read to the end using the shortest
-		// of the two buffer lengths from their associated start points.
-		bytesToCompare =  std::min(bytesToCompare, endByte2 - startByte2);
+		return;
 	}
-	else
+
+	ufs::PageBlock block = { _data, _allocatedByteCount, _backing };
+	ReleaseBlock(block, _isPooled);
+	_data = NULL;
+	_dataStart = NULL;
+}
+
+void ufs::Buffer::ReleaseBlock(ufs::PageBlock& block, bool isPooled)
+{
+	if (block.backing == ufs::ExternalBacking)
 	{
-		// If number of sectors was passed in, and we don't calculate the same number of bytes
-		// to compare for each buffer, something has gone horribly wrong!
-		if((endByte2 - startByte2) != bytesToCompare)
+		ufs::ExternalDeleter deleter;
+		deleter.swap(_deleter);
+		if (deleter)
 		{
-			throw ufs::ArgumentError("Unexpected error. Calculated byte counts to compare for the two buffers does not match.");
+			deleter(block.address, block.length);
 		}
+		return;
 	}
 
-	UInt8* left  = _dataStart + startByte;
-	UInt8* right = buffer.GetDataStart() + startByte2;
-
-	int result = ::memcmp(
-		((void*)left),
-		((void*)right),
-		bytesToCompare);
+	if (!isPooled || !ufs::BufferPool::GetInstance().Release(block, _isKnownZero))
+	{
+		ufs::PageAllocator::Release(block);
+	}
+}
 
-	size_t offset = 0;
-	size_t offset2 = 0;
+UInt8* ufs::Buffer::CalculateDataStart(UInt8* data, size_t dataByteCount)
+{
+	// Leave the header reserve free, then align the data start
+	UInt64 alignmentMask = (UInt64)_layout.alignment - 1;
+	UInt8* dataStart = (UInt8*)(((UInt64)data + (UInt64)_layout.headerReserve + alignmentMask) & ~alignmentMask);
 
-	if(result != 0)
+	// Sanity check to make sure all data can fit in the allocated memory.
+	if((UInt64)dataStart + (UInt64)dataByteCount > (UInt64)data + (UInt64)_allocatedByteCount)
 	{
-		for(size_t i = 0; i < bytesToCompare; i++)
-		{
-			if(left[i] != right[i])
-			{
-				offset = startByte + i;
-				offset2 = startByte2 + i;
-				break;
-			}
-		}
+		throw ufs::RuntimeError("Buffer allocation error");
 	}
 
-	if (result == 0) {
-		return ufs::CompareResult();  // Buffers are equal
-	} else {
-		UInt8 expectedValue = _dataStart[offset];
-		UInt8 actualValue = buffer._dataStart[offset2];
-		return ufs::CompareResult(offset, expectedValue, actualValue);
-	}
+	return dataStart;
 }
 
+//
+// Public Properties
+//
 
 /// <summary>
-/// Return a single byte from the buffer.
+/// Gets or sets the Name of the buffer.
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the byte to return, in bytes.
-/// </param>
-UInt8 ufs::Buffer::GetByte(size_t index) const
+std::string ufs::Buffer::GetName() const
 {
-	ValidateIndex(index);
-	return _dataStart[index];
+	return _name;
 }
 
 /// <summary>
-/// Return a single bit from one byte in the buffer.
+/// Sets the Name of the buffer.
+/// </summary>
+/// <param name="name">String assigned as name of the buffer.</param>
+void ufs::Buffer::SetName(const std::string& name)
+{
+	_name = name;
+}
+
+
+// Fills "ranges" with the [begin, end) byte ranges, relative to the start
+// bytes, that CompareTo has to look at. Pages that this buffer and "buffer"
+// both still share with the same snapshot hold the same bytes.
+void ufs::Buffer::SkipSharedPages(const ufs::Buffer& buffer, size_t startByte, size_t startByte2, size_t bytesToCompare,
+								  std::vector<std::pair<size_t, size_t>>& ranges) const
+{
+	ranges.clear();
+	if (bytesToCompare == 0)
+	{
+		return;
+	}
+
+	size_t blockOffset = static_cast<size_t>(_dataStart - _data) + startByte;
+	size_t blockOffset2 = static_cast<size_t>(buffer._dataStart - buffer._data) + startByte2;
+	size_t pageSize = ufs::PageAllocator::GetPageSize();
+	size_t firstPage = blockOffset / pageSize;
+	size_t pagesLength = blockOffset + bytesToCompare - firstPage * pageSize;
+
+	std::vector<bool> shared;
+	std::vector<bool> shared2;
+	if (!_snapshot || _snapshot != buffer._snapshot || blockOffset != blockOffset2
+		|| !ufs::PageSnapshot::GetSharedPages(_data + firstPage * pageSize, pagesLength, shared)
+		|| !ufs::PageSnapshot::GetSharedPages(buffer._data + firstPage * pageSize, pagesLength, shared2))
+	{
+		ranges.push_back(std::make_pair(static_cast<size_t>(0), bytesToCompare));
+		return;
+	}
+
+	for (size_t page = 0; page < shared.size(); page++)
+	{
+		if (shared[page] && shared2[page])
+		{
+			continue;
+		}
+
+		size_t pageStart = (firstPage + page) * pageSize;
+		size_t begin = std::max(pageStart, blockOffset) - blockOffset;
+		size_t end = std::min(pageStart + pageSize, blockOffset + bytesToCompare) - blockOffset;
+		if (!ranges.empty() && ranges.back().second == begin)
+		{
+			ranges.back().second = end;
+		}
+		else
+		{
+			ranges.push_back(std::make_pair(begin, end));
+		}
+	}
+}
+
+/// <summary>
+/// Returns the buffer if is filled all zeros.
+/// </summary>
+bool ufs::Buffer::IsAllZeros()
+{
+	// Nothing has been written since the zero pages were allocated.
+	if (_isKnownZero)
+	{
+		return true;
+	}
+
+	return ufs::kernels::IsAllZeros(_dataStart, GetTotalBytes());
+}
+
+/// <summary>
+/// Returns the number of resident pages of the buffer allocation on each
+/// NUMA node, indexed by node. Pages that have not been touched yet are not
+/// counted.
+/// </summary>
+std::vector<size_t> ufs::Buffer::GetNumaNodePageCounts() const
+{
+	return ufs::Numa::GetPageCountsByNode(_data, _allocatedByteCount);
+}
+
+//
+// Public Methods
+//
+
+/// <summary>
+/// Calculates a checksum byte value for the given range of bytes.
+///
+/// The checksum is the two's complement of the sum of all bytes starting at
+/// startByte for byteCount bytes. Each byte is added with unsigned arithmetic
+/// and overflow is ignored. The sum of all bytes used to calculate the
+/// checksum plus the checksum is zero when the checksum is correct.
+///
+/// | Typical use is to write a checksum in the last sector of a buffer
+/// similar to this:
+///
+///   ``buf.SetByte(511, buf.CalculateChecksumByte(0, 511))``
+///
+/// </summary>
+/// <param name="startByte">The index of the first byte used to calculate the checksum.</param>
+/// <param name="byteCount">The number of bytes uses to calculate the checksum.</param>
+UInt8 ufs::Buffer::CalculateChecksumByte(size_t startByte, size_t byteCount)
+{
+	if(byteCount == 0)
+	{
+		throw ufs::ArgumentError("byteCount must be greater than 0.");
+	}
+
+	if(startByte + byteCount > GetTotalBytes())
+	{
+		throw ufs::OutOfRangeError("startByte + byteCount is greater that TotalBytes.");
+	}
+
+	// Access pointer directly since we already did our bounds checking.
+	return ufs::kernels::ChecksumByte(_dataStart + startByte, byteCount);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.GetBitCount(0)
+/// </summary>
+UInt64 ufs::Buffer::GetBitCount() const
+{
+	return GetBitCount(0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.GetBitCount(startingOffset, 0)
+/// </summary>
+/// <param name="startingOffset">
+/// The starting offset in bytes.  Default is 0.
+/// </param>
+UInt64 ufs::Buffer::GetBitCount(size_t startingOffset) const
+{
+	return GetBitCount(startingOffset, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.GetBitCount(startingOffset, length, 1)
+/// </summary>
+/// <param name="startingOffset">
+/// The starting offset in bytes.  Default is 0.
+/// </param>
+/// <param name="length">
+/// The length of bytes to count bits in, or 0 to count bits until the end.  Default is 0.
+/// </param>
+UInt64 ufs::Buffer::GetBitCount(size_t startingOffset, size_t length) const
+{
+	return GetBitCount(startingOffset, length, 1);
+}
+
+/// <summary>
+/// Returns the number of 0 or 1 bits in a range of bytes.
+/// </summary>
+/// <param name="startingOffset">
+/// The starting offset in bytes.  Default is 0.
+/// </param>
+/// <param name="length">
+/// The length of bytes to count bits in, or 0 to count bits until the end.  Default is 0.
+/// </param>
+/// <param name="value">
+/// The bit value, 0 or 1, to count.  Default is 1.
+/// </param>
+UInt64 ufs::Buffer::GetBitCount(size_t startingOffset, size_t length, UInt8 value) const
+{
+	size_t newLength = ValidateByteRangeAndGetLength(startingOffset, length);
+
+	std::atomic<UInt64> bitCount(0);
+	const UInt8* data = _dataStart + startingOffset;
+	ufs::WorkerPool::GetInstance().ParallelForBytes(newLength, 64, [&](size_t begin, size_t end)
+	{
+		bitCount += ufs::kernels::CountBits(data + begin, end - begin, value);
+	});
+	return bitCount;
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareTo(buffer, 0)
+/// </summary>
+/// <param name = "buffer">
+/// The buffer to compare this buffer object to.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(Buffer& buffer)
+{
+	return CompareTo(buffer, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareTo(buffer, startSector, 0)
+/// </summary>
+/// <param name = "buffer">
+/// The buffer to compare this buffer object to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(Buffer& buffer, size_t startSector)
+{
+	return CompareTo(buffer, startSector, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareTo(buffer, startSector, startSector, sectorCount)
+/// </summary>
+/// <param name = "buffer">
+/// The buffer to compare this buffer object to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to compare.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(Buffer& buffer, size_t startSector, size_t sectorCount)
+{
+	return CompareTo(buffer, startSector, startSector, sectorCount);
+}
+
+/// <summary>
+/// Compares this :class:`dmx.Buffer` to another :class:`dmx.Buffer`. Comparison starts
+/// for this :class:`dmx.Buffer` at the sector specified by startSector and for the passed
+/// in :class:`dmx.Buffer` at the sector specified by startSector2. The number of sectors
+/// compared is specified by sectorCount. Returns a :class:`dmx.CompareResult` with the
+/// details  of the comparison.
+/// </summary>
+/// <param name = "buffer">
+/// The buffer to compare this buffer object to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at for this buffer.
+/// </param>
+/// <param name = "startSector2">
+/// The sector to start the comparison at for the buffer passed in as "buffer".
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to compare.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(Buffer& buffer, size_t startSector, size_t startSector2, size_t sectorCount)
+{
+	return CompareTo(buffer, startSector, startSector2, sectorCount, ufs::CompareOptions());
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareTo(buffer, 0, 0, 0, options)
+/// </summary>
+/// <param name = "buffer">
+/// The buffer to compare this buffer object to.
+/// </param>
+/// <param name = "options">
+/// Whether to stop at the first difference, and how much detail to keep.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(Buffer& buffer, const ufs::CompareOptions& options)
+{
+	return CompareTo(buffer, 0, 0, 0, options);
+}
+
+/// <summary>
+/// Compares this :class:`dmx.Buffer` to another :class:`dmx.Buffer` as
+/// CompareTo(buffer, startSector, startSector2, sectorCount) does. With
+/// CompareAllDifferences every difference is found in the same pass: the
+/// :class:`dmx.CompareResult` counts them, marks the sectors of this buffer
+/// that hold one and keeps the first options.detailLimit runs of differing
+/// bytes and sector counts, by offset in this buffer.
+/// </summary>
+/// <param name = "buffer">
+/// The buffer to compare this buffer object to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at for this buffer.
+/// </param>
+/// <param name = "startSector2">
+/// The sector to start the comparison at for the buffer passed in as "buffer".
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to compare.
+/// </param>
+/// <param name = "options">
+/// Whether to stop at the first difference, and how much detail to keep.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(Buffer& buffer, size_t startSector, size_t startSector2, size_t sectorCount, const ufs::CompareOptions& options)
+{
+	size_t startByte = 0;
+	size_t endByte = 0;
+	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+
+	size_t startByte2 = 0;
+	size_t endByte2 = 0;
+	buffer.GetStartAndStopBytesFromSectors(startSector2, sectorCount, startByte2, endByte2);
+
+	size_t bytesToCompare = endByte - startByte;
+
+	if(sectorCount == 0)
+	{
+		// If sectorCount is 0/not passed in, read to the end using the shortest
+		// of the two buffer lengths from their associated start points.
+		bytesToCompare =  std::min(bytesToCompare, endByte2 - startByte2);
+	}
+	else
+	{
+		// If number of sectors was passed in, and we don't calculate the same number of bytes
+		// to compare for each buffer, something has gone horribly wrong!
+		if((endByte2 - startByte2) != bytesToCompare)
+		{
+			throw ufs::ArgumentError("Unexpected error. Calculated byte counts to compare for the two buffers does not match.");
+		}
+	}
+
+	UInt8* left  = _dataStart + startByte;
+	UInt8* right = buffer._dataStart + startByte2;
+
+	// Only the ranges that may differ are compared.
+	std::vector<std::pair<size_t, size_t>> ranges;
+	SkipSharedPages(buffer, startByte, startByte2, bytesToCompare, ranges);
+
+	if(options.mode == ufs::CompareAllDifferences)
+	{
+		// Each piece collects the differences of its whole sectors, and the
+		// pieces are joined in order.
+		PieceResults<ufs::CompareResult> pieces;
+		ufs::WorkerPool::GetInstance().ParallelForBytes(bytesToCompare, _bytesPerSector, [&](size_t begin, size_t end)
+		{
+			ufs::CompareResult piece(startSector + begin / _bytesPerSector, (end - begin + _bytesPerSector - 1) / _bytesPerSector,
+									 _bytesPerSector, options.detailLimit);
+			for(size_t r = 0; r < ranges.size(); r++)
+			{
+				size_t first = std::max(begin, ranges[r].first);
+				size_t last = std::min(end, ranges[r].second);
+				if(first < last)
+				{
+					CollectDifferences(piece, left + first, right + first, last - first, startByte + first, _bytesPerSector);
+				}
+			}
+			pieces.Add(begin, piece);
+		});
+		return pieces.Join(ufs::CompareResult(startSector, 0, _bytesPerSector, options.detailLimit));
+	}
+
+	int result = 0;
+	size_t offset = 0;
+	size_t offset2 = 0;
+
+	for(size_t r = 0; r < ranges.size() && result == 0; r++)
+	{
+		// Large ranges are handed out to the worker pool a chunk at a time,
+		// in order. The lowest mismatch any chunk finds is the first one, and
+		// once one is found the chunks after it are skipped, while those
+		// before it still finish.
+		size_t rangeStart = ranges[r].first;
+		std::atomic<size_t> first(SIZE_MAX);
+		ufs::WorkerPool::GetInstance().ParallelForBytes(ranges[r].second - rangeStart, 64, [&](size_t begin, size_t end)
+		{
+			size_t mismatch = 0;
+			if(begin < first.load() &&
+			   ufs::kernels::FindFirstMismatch(left + rangeStart + begin, right + rangeStart + begin, end - begin, mismatch))
+			{
+				size_t found = begin + mismatch;
+				size_t current = first.load();
+				while(found < current && !first.compare_exchange_weak(current, found))
+				{
+				}
+			}
+		}, ufs::ScheduleDynamic);
+
+		if(first.load() != SIZE_MAX)
+		{
+			result = 1;
+			offset = startByte + rangeStart + first.load();
+			offset2 = startByte2 + rangeStart + first.load();
+		}
+	}
+
+	if (result == 0) {
+		return ufs::CompareResult();  // Buffers are equal
+	} else {
+		UInt8 expectedValue = _dataStart[offset];
+		UInt8 actualValue = buffer._dataStart[offset2];
+		return ufs::CompareResult(offset, expectedValue, actualValue);
+	}
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareTo(pattern, 0)
+/// </summary>
+/// <param name = "pattern">
+/// The expected data to compare this buffer object to.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(const ufs::PatternBuffer& pattern)
+{
+	return CompareTo(pattern, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareTo(pattern, startSector, 0)
+/// </summary>
+/// <param name = "pattern">
+/// The expected data to compare this buffer object to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(const ufs::PatternBuffer& pattern, size_t startSector)
+{
+	return CompareTo(pattern, startSector, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareTo(pattern, startSector, startSector, sectorCount)
+/// </summary>
+/// <param name = "pattern">
+/// The expected data to compare this buffer object to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to compare.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(const ufs::PatternBuffer& pattern, size_t startSector, size_t sectorCount)
+{
+	return CompareTo(pattern, startSector, startSector, sectorCount);
+}
+
+/// <summary>
+/// Compares this :class:`dmx.Buffer` to the data a :class:`dmx.PatternBuffer` describes,
+/// without ever holding more than a block of it. Comparison starts for this
+/// :class:`dmx.Buffer` at startSector and for the pattern at patternStartSector. A
+/// sectorCount of 0 compares up to the end of the shorter of the two. The
+/// expected value of the :class:`dmx.CompareResult` comes from the pattern.
+/// </summary>
+/// <param name = "pattern">
+/// The expected data to compare this buffer object to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at for this buffer.
+/// </param>
+/// <param name = "patternStartSector">
+/// The sector to start the comparison at for the pattern.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to compare.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(const ufs::PatternBuffer& pattern, size_t startSector, size_t patternStartSector, size_t sectorCount)
+{
+	return CompareTo(pattern, startSector, patternStartSector, sectorCount, ufs::CompareOptions());
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareTo(pattern, 0, 0, 0, options)
+/// </summary>
+/// <param name = "pattern">
+/// The expected data to compare this buffer object to.
+/// </param>
+/// <param name = "options">
+/// Whether to stop at the first difference, and how much detail to keep.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(const ufs::PatternBuffer& pattern, const ufs::CompareOptions& options)
+{
+	return CompareTo(pattern, 0, 0, 0, options);
+}
+
+/// <summary>
+/// Compares this :class:`dmx.Buffer` to the data a :class:`dmx.PatternBuffer` describes
+/// as CompareTo(pattern, startSector, patternStartSector, sectorCount) does,
+/// finding every difference with CompareAllDifferences as
+/// CompareTo(buffer, startSector, startSector2, sectorCount, options) does.
+/// </summary>
+/// <param name = "pattern">
+/// The expected data to compare this buffer object to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at for this buffer.
+/// </param>
+/// <param name = "patternStartSector">
+/// The sector to start the comparison at for the pattern.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to compare.
+/// </param>
+/// <param name = "options">
+/// Whether to stop at the first difference, and how much detail to keep.
+/// </param>
+ufs::CompareResult ufs::Buffer::CompareTo(const ufs::PatternBuffer& pattern, size_t startSector, size_t patternStartSector, size_t sectorCount, const ufs::CompareOptions& options)
+{
+	if (pattern.GetBytesPerSector() != _bytesPerSector)
+	{
+		throw ufs::ArgumentError("The buffer and the pattern must have the same number of bytes per sector.");
+	}
+
+	size_t bufferSectors = ValidateSectorRangeAndGetSectorCount(startSector, sectorCount);
+	size_t patternSectors = pattern.ValidateSectorRange(patternStartSector, sectorCount);
+	sectorCount = std::min(bufferSectors, patternSectors);
+
+	// Each piece generates the expected data a block at a time into its own
+	// small buffer. Pieces and blocks past a known mismatch are skipped.
+	const UInt8* data = _dataStart + startSector * _bytesPerSector;
+	size_t blockSectors = pattern.GetBlockSectors();
+
+	if (options.mode == ufs::CompareAllDifferences)
+	{
+		PieceResults<ufs::CompareResult> pieces;
+		ForEachPatternPiece(pattern, sectorCount * _bytesPerSector, _bytesPerSector, [&](size_t begin, size_t end)
+		{
+			ufs::CompareResult piece(startSector + begin / _bytesPerSector, (end - begin) / _bytesPerSector, _bytesPerSector, options.detailLimit);
+			ufs::Buffer expected(std::min(blockSectors, (end - begin) / _bytesPerSector), _bytesPerSector);
+			size_t blockLength = expected.GetTotalBytes();
+			for (size_t offset = begin; offset < end; offset += blockLength)
+			{
+				size_t count = std::min(blockLength, end - offset);
+				pattern.CopyTo(expected, patternStartSector + offset / _bytesPerSector, 0, count / _bytesPerSector);
+				CollectDifferences(piece, expected._dataStart, data + offset, count, startSector * _bytesPerSector + offset, _bytesPerSector);
+			}
+			pieces.Add(begin, piece);
+		});
+		return pieces.Join(ufs::CompareResult(startSector, 0, _bytesPerSector, options.detailLimit));
+	}
+
+	// The expected value is kept with the lowest mismatch, so it never has
+	// to be generated again.
+	std::atomic<size_t> first(SIZE_MAX);
+	std::mutex firstMutex;
+	UInt8 expectedValue = 0;
+	ForEachPatternPiece(pattern, sectorCount * _bytesPerSector, _bytesPerSector, [&](size_t begin, size_t end)
+	{
+		ufs::Buffer expected(std::min(blockSectors, (end - begin) / _bytesPerSector), _bytesPerSector);
+		size_t blockLength = expected.GetTotalBytes();
+		for (size_t offset = begin; offset < end && offset < first.load(); offset += blockLength)
+		{
+			size_t count = std::min(blockLength, end - offset);
+			pattern.CopyTo(expected, patternStartSector + offset / _bytesPerSector, 0, count / _bytesPerSector);
+
+			size_t mismatch = 0;
+			if (ufs::kernels::FindFirstMismatch(expected._dataStart, data + offset, count, mismatch))
+			{
+				std::lock_guard<std::mutex> lock(firstMutex);
+				if (offset + mismatch < first.load())
+				{
+					first = offset + mismatch;
+					expectedValue = expected._dataStart[mismatch];
+				}
+				return;
+			}
+		}
+	});
+
+	if (first.load() == SIZE_MAX)
+	{
+		return ufs::CompareResult();
+	}
+	return ufs::CompareResult(startSector * _bytesPerSector + first.load(), expectedValue, data[first.load()]);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.VerifyPattern(pattern, 0)
+/// </summary>
+/// <param name = "pattern">
+/// The fill this buffer is expected to hold.
+/// </param>
+ufs::CompareResult ufs::Buffer::VerifyPattern(const ufs::PatternBuffer& pattern)
+{
+	return VerifyPattern(pattern, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.VerifyPattern(pattern, startSector, 0)
+/// </summary>
+/// <param name = "pattern">
+/// The fill this buffer is expected to hold.
+/// </param>
+/// <param name = "startSector">
+/// The first sector to verify.
+/// </param>
+ufs::CompareResult ufs::Buffer::VerifyPattern(const ufs::PatternBuffer& pattern, size_t startSector)
+{
+	return VerifyPattern(pattern, startSector, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.VerifyPattern(pattern, startSector, sectorCount, DEFAULT_COMPARE_DETAIL_LIMIT)
+/// </summary>
+/// <param name = "pattern">
+/// The fill this buffer is expected to hold.
+/// </param>
+/// <param name = "startSector">
+/// The first sector to verify.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to verify.
+/// </param>
+ufs::CompareResult ufs::Buffer::VerifyPattern(const ufs::PatternBuffer& pattern, size_t startSector, size_t sectorCount)
+{
+	return VerifyPattern(pattern, startSector, sectorCount, ufs::DEFAULT_COMPARE_DETAIL_LIMIT);
+}
+
+/// <summary>
+/// Verifies that sectors of this :class:`dmx.Buffer` hold what the fills a
+/// :class:`dmx.PatternBuffer` describes wrote there, without a second buffer: the
+/// expected data of each sector is that of the same sector of the pattern,
+/// generated a block at a time and compared while in cache. Returns every
+/// difference, as CompareTo(pattern, startSector, startSector, sectorCount,
+/// CompareOptions(CompareAllDifferences, detailLimit)) does. A sectorCount of
+/// 0 verifies up to the end of the buffer.
+/// </summary>
+/// <param name = "pattern">
+/// The fill this buffer is expected to hold.
+/// </param>
+/// <param name = "startSector">
+/// The first sector to verify.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to verify.
+/// </param>
+/// <param name = "detailLimit">
+/// The most difference ranges, and sector counts, to keep.
+/// </param>
+ufs::CompareResult ufs::Buffer::VerifyPattern(const ufs::PatternBuffer& pattern, size_t startSector, size_t sectorCount, size_t detailLimit)
+{
+	return CompareTo(pattern, startSector, startSector, sectorCount, ufs::CompareOptions(ufs::CompareAllDifferences, detailLimit));
+}
+
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareBits(buffer, 0)
+/// </summary>
+/// <param name = "buffer">
+/// The data read back, compared against this buffer.
+/// </param>
+ufs::BitErrorStats ufs::Buffer::CompareBits(Buffer& buffer)
+{
+	return CompareBits(buffer, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareBits(buffer, startSector, 0)
+/// </summary>
+/// <param name = "buffer">
+/// The data read back, compared against this buffer.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at for both buffers.
+/// </param>
+ufs::BitErrorStats ufs::Buffer::CompareBits(Buffer& buffer, size_t startSector)
+{
+	return CompareBits(buffer, startSector, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareBits(buffer, startSector, startSector, sectorCount)
+/// </summary>
+/// <param name = "buffer">
+/// The data read back, compared against this buffer.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at for both buffers.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to compare.
+/// </param>
+ufs::BitErrorStats ufs::Buffer::CompareBits(Buffer& buffer, size_t startSector, size_t sectorCount)
+{
+	return CompareBits(buffer, startSector, startSector, sectorCount);
+}
+
+/// <summary>
+/// Counts the bit errors of another :class:`dmx.Buffer` read back against this one,
+/// the expected data, for raw bit error rate measurements. Every sector is
+/// compared in one pass, split across the worker pool, and the returned
+/// :class:`dmx.BitErrorStats` holds the flipped bits split by direction, the
+/// errors of each sector of this buffer, and the bit and byte positions they
+/// fell at. A sectorCount of 0 compares up to the end of the shorter range.
+/// </summary>
+/// <param name = "buffer">
+/// The data read back, compared against this buffer.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at for this buffer.
+/// </param>
+/// <param name = "startSector2">
+/// The sector to start the comparison at for the buffer passed in as "buffer".
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to compare.
+/// </param>
+ufs::BitErrorStats ufs::Buffer::CompareBits(Buffer& buffer, size_t startSector, size_t startSector2, size_t sectorCount)
+{
+	if (buffer._bytesPerSector != _bytesPerSector)
+	{
+		throw ufs::ArgumentError("The buffers must have the same number of bytes per sector.");
+	}
+
+	size_t sectors = ValidateSectorRangeAndGetSectorCount(startSector, sectorCount);
+	size_t sectors2 = buffer.ValidateSectorRangeAndGetSectorCount(startSector2, sectorCount);
+	sectorCount = std::min(sectors, sectors2);
+
+	size_t startByte = startSector * _bytesPerSector;
+	size_t startByte2 = startSector2 * _bytesPerSector;
+	const UInt8* expected = _dataStart + startByte;
+	const UInt8* actual = buffer._dataStart + startByte2;
+
+	// Sectors only in shared pages have no errors and are not looked at.
+	std::vector<std::pair<size_t, size_t>> ranges;
+	SkipSharedPages(buffer, startByte, startByte2, sectorCount * _bytesPerSector, ranges);
+
+	PieceResults<ufs::BitErrorStats> pieces;
+	ufs::WorkerPool::GetInstance().ParallelForBytes(sectorCount * _bytesPerSector, _bytesPerSector, [&](size_t begin, size_t end)
+	{
+		size_t firstSector = begin / _bytesPerSector;
+		ufs::BitErrorStats piece(startSector + firstSector, (end - begin) / _bytesPerSector, _bytesPerSector);
+
+		// Ranges end on page boundaries, so two of them can share a sector.
+		size_t next = firstSector;
+		for (size_t r = 0; r < ranges.size(); r++)
+		{
+			size_t first = std::max(begin, ranges[r].first);
+			size_t last = std::min(end, ranges[r].second);
+			for (size_t sector = std::max(next, first / _bytesPerSector); first < last && sector * _bytesPerSector < last; sector++)
+			{
+				size_t offset = sector * _bytesPerSector;
+				piece.AddSector(startSector + sector, expected + offset, actual + offset);
+				next = sector + 1;
+			}
+		}
+		pieces.Add(begin, piece);
+	});
+	return pieces.Join(ufs::BitErrorStats(startSector, 0, _bytesPerSector));
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareBits(pattern, 0)
+/// </summary>
+/// <param name = "pattern">
+/// The expected data to compare this buffer object to.
+/// </param>
+ufs::BitErrorStats ufs::Buffer::CompareBits(const ufs::PatternBuffer& pattern)
+{
+	return CompareBits(pattern, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareBits(pattern, startSector, 0)
+/// </summary>
+/// <param name = "pattern">
+/// The expected data to compare this buffer object to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at for this buffer and the pattern.
+/// </param>
+ufs::BitErrorStats ufs::Buffer::CompareBits(const ufs::PatternBuffer& pattern, size_t startSector)
+{
+	return CompareBits(pattern, startSector, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.CompareBits(pattern, startSector, startSector, sectorCount)
+/// </summary>
+/// <param name = "pattern">
+/// The expected data to compare this buffer object to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at for this buffer and the pattern.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to compare.
+/// </param>
+ufs::BitErrorStats ufs::Buffer::CompareBits(const ufs::PatternBuffer& pattern, size_t startSector, size_t sectorCount)
+{
+	return CompareBits(pattern, startSector, startSector, sectorCount);
+}
+
+/// <summary>
+/// Counts the bit errors of this :class:`dmx.Buffer`, read back, against the data a
+/// :class:`dmx.PatternBuffer` describes, as CompareBits(buffer, startSector,
+/// startSector2, sectorCount) does. The expected data is generated a block
+/// at a time and compared while in cache, so no second buffer is needed.
+/// </summary>
+/// <param name = "pattern">
+/// The expected data to compare this buffer object to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start the comparison at for this buffer.
+/// </param>
+/// <param name = "patternStartSector">
+/// The sector to start the comparison at for the pattern.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to compare.
+/// </param>
+ufs::BitErrorStats ufs::Buffer::CompareBits(const ufs::PatternBuffer& pattern, size_t startSector, size_t patternStartSector, size_t sectorCount)
+{
+	if (pattern.GetBytesPerSector() != _bytesPerSector)
+	{
+		throw ufs::ArgumentError("The buffer and the pattern must have the same number of bytes per sector.");
+	}
+
+	size_t bufferSectors = ValidateSectorRangeAndGetSectorCount(startSector, sectorCount);
+	size_t patternSectors = pattern.ValidateSectorRange(patternStartSector, sectorCount);
+	sectorCount = std::min(bufferSectors, patternSectors);
+
+	const UInt8* data = _dataStart + startSector * _bytesPerSector;
+	size_t blockSectors = pattern.GetBlockSectors();
+
+	PieceResults<ufs::BitErrorStats> pieces;
+	ForEachPatternPiece(pattern, sectorCount * _bytesPerSector, _bytesPerSector, [&](size_t begin, size_t end)
+	{
+		ufs::BitErrorStats piece(startSector + begin / _bytesPerSector, (end - begin) / _bytesPerSector, _bytesPerSector);
+		ufs::Buffer expected(std::min(blockSectors, (end - begin) / _bytesPerSector), _bytesPerSector);
+		size_t blockLength = expected.GetTotalBytes();
+		for (size_t offset = begin; offset < end; offset += blockLength)
+		{
+			size_t count = std::min(blockLength, end - offset);
+			pattern.CopyTo(expected, patternStartSector + offset / _bytesPerSector, 0, count / _bytesPerSector);
+			for (size_t done = 0; done < count; done += _bytesPerSector)
+			{
+				piece.AddSector(startSector + (offset + done) / _bytesPerSector, expected._dataStart + done, data + offset + done);
+			}
+		}
+		pieces.Add(begin, piece);
+	});
+	return pieces.Join(ufs::BitErrorStats(startSector, 0, _bytesPerSector));
+}
+
+
+/// <summary>
+/// Return a single byte from the buffer.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the byte to return, in bytes.
+/// </param>
+UInt8 ufs::Buffer::GetByte(size_t index) const
+{
+	ValidateIndex(index);
+	return _dataStart[index];
+}
+
+/// <summary>
+/// Return a single bit from one byte in the buffer.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the byte to retrieve the bit from, in bytes.
+/// </param>
+/// <param name = "bit">
+/// The zero based bit number to retrieve from the byte specified in "index".
+/// </param>
+UInt8 ufs::Buffer::GetByteBit(size_t index, UInt8 bit) const
+{
+	if (bit > 7)
+	{
+		boost::format errStr("Invalid bit index. %1% is beyond the width of a byte.");
+		errStr % static_cast<UInt32>(bit);
+		throw ufs::ArgumentError(errStr.str());
+	}
+
+	return (GetByte(index) &  (1 << bit)) > 0;
+}
+
+/// <summary>
+/// Sets the value of a single byte in the buffer.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the byte whose value you wish to set, in bytes.
+/// </param>
+/// <param name = "value">
+/// The byte value to write to the buffer at "index" location.
+/// </param>
+ufs::Buffer& ufs::Buffer::SetByte(size_t index, UInt8 value)
+{
+	ValidateIndex(index);
+	MarkModified();
+	_dataStart[index] = value;
+	return *this;
+}
+
+/// <summary>
+/// Return a single 16 bit (2 byte) word from the buffer. Byte order is
+/// little endian (least significant byte is first), for SATA data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the word to return, in 8 bit bytes.
+/// </param>
+UInt16 ufs::Buffer::GetWord(size_t index) const
+{
+	ValidateIndex(index + 1);
+	// Least significant byte is the lower index.
+	return static_cast<UInt16>(_dataStart[index] | (_dataStart[index + 1] << 8));
+}
+
+/// <summary>
+/// Return a single bit from a 16 bit (2 byte) word in the buffer. Byte order
+/// is little endian (least significant byte is first), for SATA data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the word to retrieve the bit from,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "bit">
+/// The zero based bit number to retrieve from the word specified in "index".
+/// </param>
+UInt8 ufs::Buffer::GetWordBit(size_t index, UInt8 bit) const
+{
+	if (bit > 15)
+	{
+		boost::format errStr("Invalid bit index. %1% is beyond the width of a word.");
+		errStr % static_cast<UInt32>(bit);
+		throw ufs::ArgumentError(errStr.str());
+	}
+
+	return (GetWord(index) &  (1 << bit)) > 0;
+}
+
+/// <summary>
+/// Sets the value of a 16 bit (2 byte) word in the buffer. Byte order is
+/// little endian (least significant byte is first), for SATA data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the word whose value you wish to set,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "value">
+/// The 16 bit value to set starting at the word specified in "index" (least significant byte is first).
+/// </param>
+ufs::Buffer& ufs::Buffer::SetWord(size_t index, UInt16 value)
+{
+	ValidateIndex(index + 1);
+	MarkModified();
+	// Least significant byte is the lower index.
+	_dataStart[index] = static_cast<UInt8>(value & 0xFF);
+	_dataStart[index + 1] = static_cast<UInt8>(value >> 8);
+	return *this;
+}
+
+
+
+
+
+/// <summary>
+/// Return a single 16 bit (2 byte) word from the buffer. Byte order is
+/// big endian (most significant byte is first), for SCSI data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the word to return, in 8 bit bytes.
+/// </param>
+UInt16 ufs::Buffer::GetWordBigEndian(size_t index) const
+{
+	ValidateIndex(index + 1);
+	// Most significant byte is the lower index.
+	return static_cast<UInt16>((_dataStart[index] << 8) | _dataStart[index + 1]);
+}
+
+/// <summary>
+/// Return a single bit from a 16 bit word in the buffer. Byte order is
+/// big endian (most significant byte is first), for SCSI data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the word to retrieve the bit from,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "bit">
+/// The zero based bit number to retrieve from the word specified in "index".
+/// </param>
+UInt8 ufs::Buffer::GetWordBitBigEndian(size_t index, UInt8 bit) const
+{
+	if (bit > 15)
+	{
+		boost::format errStr("Invalid bit index. %1% is beyond the width of a word.");
+		errStr % static_cast<UInt32>(bit);
+		throw ufs::ArgumentError(errStr.str());
+	}
+
+	return (GetWordBigEndian(index) &  (1 << bit)) > 0;
+}
+
+/// <summary>
+/// Sets the value of a 16 bit word (two bytes) in the buffer. Byte order is
+/// big endian (most significant byte is first), for SCSI data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the word whose value you wish to set,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "value">
+/// The 16 bit value to set starting at the word specified in "index" (most significant byte is first).
+/// </param>
+ufs::Buffer& ufs::Buffer::SetWordBigEndian(size_t index, UInt16 value)
+{
+	ValidateIndex(index + 1);
+	MarkModified();
+	// Most significant byte is the lower index.
+	_dataStart[index] = static_cast<UInt8>(value >> 8);
+	_dataStart[index + 1] = static_cast<UInt8>(value & 0xFF);
+	return *this;
+}
+
+
+
+
+
+/// <summary>
+/// Return a single 32 bit (4 byte) dword from the buffer. Byte order is
+/// little endian (least significant byte is first), for SATA data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the dword to return, in 8 bit bytes.
+/// </param>
+UInt32 ufs::Buffer::GetDWord(size_t index) const
+{
+	ValidateIndex(index + 3);
+	// Least significant byte is the lower index.
+	return _dataStart[index]
+		| (_dataStart[index + 1] << 8)
+		| (_dataStart[index + 2] << 16)
+		| (_dataStart[index + 3] << 24);
+}
+
+/// <summary>
+/// Return a single bit from a 32 bit (4 byte) dword in the buffer. Byte order
+/// is little endian (least significant byte is first), for SATA data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the dword to retrieve the bit from,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "bit">
+/// The zero based bit number to retrieve from the word specified in "index".
+/// </param>
+UInt8 ufs::Buffer::GetDWordBit(size_t index, UInt8 bit) const
+{
+	if (bit > 31)
+	{
+		boost::format errStr("Invalid bit index. %1% is beyond the width of a d-word.");
+		errStr % static_cast<UInt32>(bit);
+		throw ufs::ArgumentError(errStr.str());
+	}
+
+	return (GetDWord(index) &  (1 << bit)) > 0;
+}
+
+/// <summary>
+/// Sets the value of a 32 bit (4 byte) dword in the buffer. Byte order is
+/// little endian (least significant byte is first), for SATA data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the dword whose value you wish to set,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "value">
+/// The 32 bit value to set starting at the word specified in "index" (least significant byte is first).
+/// </param>
+ufs::Buffer& ufs::Buffer::SetDWord(size_t index, UInt32 value)
+{
+	ValidateIndex(index + 3);
+	MarkModified();
+	// Least significant byte is the lower index.
+	_dataStart[index] = static_cast<UInt8>(value & 0xFF);
+	_dataStart[index + 1] = static_cast<UInt8>(value >> 8);
+	_dataStart[index + 2] = static_cast<UInt8>(value >> 16);
+	_dataStart[index + 3] = static_cast<UInt8>(value >> 24);
+	return *this;
+}
+
+
+
+
+/// <summary>
+/// Return a single 32 bit (4 byte) dword from the buffer. Byte order is
+/// big endian (most significant byte is first), for SCSI data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the dword to return, in 8 bit bytes.
+/// </param>
+UInt32 ufs::Buffer::GetDWordBigEndian(size_t index) const
+{
+	ValidateIndex(index + 3);
+	// Most significant byte is the lower index.
+	return (_dataStart[index] << 24)
+		 | (_dataStart[index + 1] << 16)
+		 | (_dataStart[index + 2] << 8)
+		 |  _dataStart[index + 3];
+}
+
+/// <summary>
+/// Return a single bit from a 16 bit (4 byte) dword in the buffer. Byte order
+/// is big endian (most significant byte is first), for SCSI data.
 /// </summary>
 /// <param name = "index">
-/// The zero based index location of the byte to retrieve the bit from, in bytes.
+/// The zero based index location of the dword to retrieve the bit from,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "bit">
+/// The zero based bit number to retrieve from the word specified in "index".
+/// </param>
+UInt8 ufs::Buffer::GetDWordBitBigEndian(size_t index, UInt8 bit) const
+{
+	if (bit > 31)
+	{
+		boost::format errStr("Invalid bit index. %1% is beyond the width of a d-word.");
+		errStr % static_cast<UInt32>(bit);
+		throw ufs::ArgumentError(errStr.str());
+	}
+
+	return (GetDWordBigEndian(index) &  (1 << bit)) > 0;
+}
+
+/// <summary>
+/// Sets the value of a 32 bit dword (four bytes) in the buffer. Byte order is
+/// big endian (most significant byte is first), for SCSI data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the dword whose value you wish to set,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "value">
+/// The 32 bit value to set starting at the word specified in "index" (most significant byte is first).
+/// </param>
+ufs::Buffer& ufs::Buffer::SetDWordBigEndian(size_t index, UInt32 value)
+{
+	ValidateIndex(index + 3);
+	MarkModified();
+	// Most significant byte is the lower index.
+	_dataStart[index] = static_cast<UInt8>(value >> 24);
+	_dataStart[index + 1] = static_cast<UInt8>(value >> 16);
+	_dataStart[index + 2] = static_cast<UInt8>(value >> 8);
+	_dataStart[index + 3] = static_cast<UInt8>(value & 0xFF);
+	return *this;
+}
+
+
+
+
+
+/// <summary>
+/// Return a single 64 bit (8 byte) qword from the buffer. Byte order is
+/// little endian (least significant byte is first), for SATA data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the qword to return, in 8 bit bytes.
+/// </param>
+UInt64 ufs::Buffer::GetQWord(size_t index) const
+{
+	ValidateIndex(index + 7);
+	// Least significant byte is the lower index.
+	return (UInt64)_dataStart[index]
+		| ((UInt64)_dataStart[index + 1] << 8)
+		| ((UInt64)_dataStart[index + 2] << 16)
+		| ((UInt64)_dataStart[index + 3] << 24)
+		| ((UInt64)_dataStart[index + 4] << 32)
+		| ((UInt64)_dataStart[index + 5] << 40)
+		| ((UInt64)_dataStart[index + 6] << 48)
+		| ((UInt64)_dataStart[index + 7] << 56);
+}
+
+/// <summary>
+/// Return a single bit from a 64 bit (8 byte) qword in the buffer. Byte order
+/// is little endian (least significant byte is first), for SATA data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the qword to retrieve the bit from,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "bit">
+/// The zero based bit number to retrieve from the word specified in "index".
+/// </param>
+UInt8 ufs::Buffer::GetQWordBit(size_t index, UInt8 bit) const
+{
+	if (bit > 63)
+	{
+		boost::format errStr("Invalid bit index. %1% is beyond the width of a q-word.");
+		errStr % static_cast<UInt32>(bit);
+		throw ufs::ArgumentError(errStr.str());
+	}
+
+	return (GetQWord(index) &  ((UInt64)1 << bit)) > 0;
+}
+
+/// <summary>
+/// Sets the value of a 64 bit (8 byte) qword in the buffer. Byte order is
+/// little endian (least significant byte is first), for SATA data.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the qword whose value you wish to set,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "value">
+/// The 64 bit value to set starting at the word specified in "index" (least significant byte is first).
+/// </param>
+ufs::Buffer& ufs::Buffer::SetQWord(size_t index, UInt64 value)
+{
+	ValidateIndex(index + 7);
+	MarkModified();
+	// Least significant byte is the lower index.
+	_dataStart[index] = static_cast<UInt8>(value);
+	_dataStart[index + 1] = static_cast<UInt8>(value >> 8);
+	_dataStart[index + 2] = static_cast<UInt8>(value >> 16);
+	_dataStart[index + 3] = static_cast<UInt8>(value >> 24);
+	_dataStart[index + 4] = static_cast<UInt8>(value >> 32);
+	_dataStart[index + 5] = static_cast<UInt8>(value >> 40);
+	_dataStart[index + 6] = static_cast<UInt8>(value >> 48);
+	_dataStart[index + 7] = static_cast<UInt8>(value >> 56);
+	return *this;
+}
+
+
+
+
+/// <summary>
+/// Return a single 64 bit qword from the buffer.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the qword to return, in 8 bit bytes.
+/// </param>
+UInt64 ufs::Buffer::GetQWordBigEndian(size_t index) const
+{
+	ValidateIndex(index + 7);
+	// Most significant byte is the lower index.
+	return ((UInt64)_dataStart[index]) << 56
+		| ((UInt64)_dataStart[index + 1] << 48)
+		| ((UInt64)_dataStart[index + 2] << 40)
+		| ((UInt64)_dataStart[index + 3] << 32)
+		| ((UInt64)_dataStart[index + 4] << 24)
+		| ((UInt64)_dataStart[index + 5] << 16)
+		| ((UInt64)_dataStart[index + 6] << 8)
+		| (UInt64)_dataStart[index + 7];
+}
+
+/// <summary>
+/// Return a single bit from a 64 bit qword in the buffer.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the qword to retrieve the bit from,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "bit">
+/// The zero based bit number to retrieve from the word specified in "index".
+/// </param>
+UInt8 ufs::Buffer::GetQWordBitBigEndian(size_t index, UInt8 bit) const
+{
+	if (bit > 63)
+	{
+		boost::format errStr("Invalid bit index. %1% is beyond the width of a q-word.");
+		errStr % static_cast<UInt32>(bit);
+		throw ufs::ArgumentError(errStr.str());
+	}
+
+	return (GetQWordBigEndian(index) &  ((UInt64)1 << bit)) > 0;
+}
+
+/// <summary>
+/// Sets the value of a 64 bit word (eight bytes) in the buffer.
+/// </summary>
+/// <param name = "index">
+/// The zero based index location of the qword whose value you wish to set,
+/// in 8 bit bytes.
+/// </param>
+/// <param name = "value">
+/// The 64 bit value to set starting at the word specified in "index"(most significant byte is first).
+/// </param>
+ufs::Buffer& ufs::Buffer::SetQWordBigEndian(size_t index, UInt64 value)
+{
+	ValidateIndex(index + 7);
+	MarkModified();
+	// Most significant byte is the lower index.
+	_dataStart[index] = static_cast<UInt8>(value >> 56);
+	_dataStart[index + 1] = static_cast<UInt8>(value >> 48);
+	_dataStart[index + 2] = static_cast<UInt8>(value >> 40);
+	_dataStart[index + 3] = static_cast<UInt8>(value >> 32);
+	_dataStart[index + 4] = static_cast<UInt8>(value >> 24);
+	_dataStart[index + 5] = static_cast<UInt8>(value >> 16);
+	_dataStart[index + 6] = static_cast<UInt8>(value >> 8);
+	_dataStart[index + 7] = static_cast<UInt8>(value);
+	return *this;
+}
+
+/// <summary> Gets the data start of the buffer. </summary>
+UInt8* ufs::Buffer::GetDataStart() const
+{
+	// The caller may write through the pointer, unless it is read-only.
+	if (!IsReadOnly())
+	{
+		MarkModified();
+	}
+	return _dataStart;
+}
+
+/// <summary> Gets the start of the block of memeory allocated for the buffer. </summary>
+UInt8* ufs::Buffer::GetAllocationStart() const
+{
+	if (!IsReadOnly())
+	{
+		MarkModified();
+	}
+	return _data;
+}
+
+void ufs::Buffer::ThrowReadOnly() const
+{
+	throw ufs::RuntimeError("The buffer is a read-only file mapping and can not be written.");
+}
+
+
+/// <summary>
+///  Equivalent:  dmx.Buffer.GetBytes(0)
+/// </summary>
+boost::shared_ptr<std::vector<UInt8>> ufs::Buffer::GetBytes() const
+{
+	return GetBytes(0);
+}
+
+/// <summary>
+///  Equivalent:  ufs::Buffer::GetBytes(startingOffset, 0)
+/// </summary>
+///
+/// <param name="startingOffset"> The starting offset in bytes. </param>
+boost::shared_ptr<std::vector<UInt8>> ufs::Buffer::GetBytes(size_t startingOffset) const
+{
+	return GetBytes(startingOffset, 0);
+}
+
+/// <summary>
+///  Return number of bytes from the buffer starting at offset for number of bytes requested.
+///  If length == 0 returns buffers total bytes minus startingOffset.
+/// </summary>
+///
+/// <param name="startingOffset"> The starting offset in bytes. </param>
+/// <param name="length"> The length. </param>
+boost::shared_ptr<std::vector<UInt8>> ufs::Buffer::GetBytes(size_t startingOffset, size_t length) const
+{
+	size_t newLength = ValidateByteRangeAndGetLength(startingOffset, length);
+
+	boost::shared_ptr<std::vector<UInt8>> ptr(new std::vector<UInt8>(newLength));
+	std::copy(_dataStart + startingOffset, _dataStart + startingOffset + newLength, ptr->begin());
+	return ptr;
+}
+
+/// <summary>
+/// Add info related with compression into buffer. e.g. compression type, pattern length.
+/// Save pattern in the fixed position
+/// compression format:
+///    Lba        |   Pattern     | Type(4 higher bits) and Pattern Length(4 lower bits)
+/// 8 bytes       |   12 bytes    |          1 byte
+/// confluence page: https://confluence.micron.com/confluence/display/FE/Simulator+compression+mode
+/// </summary>
+void ufs::Buffer::FillCompressionInfo(UInt8 type, UInt8 pattenLen, size_t startByte, size_t endByte)
+{
+	if (pattenLen > COMPRESSION_MAX_PATTERN_LEN)
+	{
+		return;
+	}
+
+	for (size_t i = startByte + COMPRESSION_LBA_SIZE_IN_BYTE + COMPRESSION_PATTERN_SIZE_IN_BYTE;
+		i<endByte;
+		i += _bytesPerSector)
+	{
+		// FTE scripts use dmx to generate a "0" buffer to verify empty page and compressed pattern is not suitable in this case.
+		if (!(_dataStart[startByte] == 0 && type == eFixPattern))
+		{
+			// Add pattern type and patten length
+			_dataStart[i] = 0;
+			_dataStart[i] = static_cast<UInt8>((type << 4) | pattenLen);
+		}
+		switch (type)
+		{
+		case eFixPattern:
+		case eIncrementingPattern:
+		case eDecrementingPattern:
+		{
+			// copy pattern to the position beginning with 9th byte
+			memcpy(_dataStart + i - COMPRESSION_PATTERN_SIZE_IN_BYTE,
+				_dataStart + i - COMPRESSION_PATTERN_SIZE_IN_BYTE - COMPRESSION_LBA_SIZE_IN_BYTE,
+				pattenLen);
+			break;
+		}
+		case eRandomPattern:
+		{
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+/// <summary>
+/// Copies the contents of the list of bytes to the buffer, starting at
+/// the specified index.
+/// </summary>
+///
+/// <param name="startingOffset"> The starting offset in bytes. </param>
+/// <param name="value"> The value to copy. </param>
+ufs::Buffer& ufs::Buffer::SetBytes(size_t startingOffset, std::vector<UInt8> value)
+{
+	ValidateByteRangeAndGetLength(startingOffset, value.size());
+	MarkModified();
+	std::copy(value.begin(), value.end(), _dataStart + startingOffset);
+	return *this;
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.GetString(0)
+/// </summary>
+std::string ufs::Buffer::GetString() const
+{
+	return GetString(0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.GetString(startingOffset, 0)
+/// </summary>
+/// <param name="startingOffset"> The starting offset in bytes. </param>
+std::string ufs::Buffer::GetString(size_t startingOffset) const
+{
+	return GetString(startingOffset, 0);
+}
+
+/// <summary>
+/// Returns string value of buffer content starting at requested offset
+/// for requested length.  If length == 0 returns buffers total bytes minus
+/// startingOffset.
+/// </summary>
+///
+/// <param name="startingOffset"> The starting offset in bytes. </param>
+/// <param name="length">The length of the string, in bytes. </param>
+std::string ufs::Buffer::GetString(size_t startingOffset, size_t length) const
+{
+	// Validate once up front to avoid validating each byte access.
+	size_t newLength = ValidateByteRangeAndGetLength(startingOffset, length);
+
+	return std::string( (char*)(_dataStart + startingOffset), newLength);
+}
+
+/// <summary>
+/// Copies the contents of the string value to the buffer, starting at
+/// the requested starting offset.
+/// </summary>
+///
+/// <param name="startingOffset"> The starting offset in bytes. </param>
+/// <param name="value"> The value to copy. </param>
+ufs::Buffer& ufs::Buffer::SetString(size_t startingOffset, const std::string& value)
+{
+	ValidateByteRangeAndGetLength(startingOffset, value.length());
+	MarkModified();
+	::memcpy(_dataStart + startingOffset, value.c_str(), value.length());
+	return *this;
+}
+
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.Fill(value, 0)
+/// </summary>
+/// <param name = "value">
+/// The byte value to set every byte in the buffer to.
+/// </param>
+ufs::Buffer& ufs::Buffer::Fill(UInt8 value)
+{
+	return Fill(value, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.Fill(value, startSector, 0)
+/// </summary>
+/// <param name = "value">
+/// The byte value to set the bytes in the buffer to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+ufs::Buffer& ufs::Buffer::Fill(UInt8 value, size_t startSector)
+{
+	return Fill(value, startSector, 0);
+}
+
+
+/// <summary>
+/// Sets the bytes in the buffer to the value passed in,
+/// starting at the sector specified by "startSector",
+/// for the number of sectors specified by "sectorCount".
+/// </summary>
+/// <param name = "value">
+/// The byte value to set the bytes in the buffer to.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill with "value".
+/// </param>
+ufs::Buffer& ufs::Buffer::Fill(UInt8 value, size_t startSector, size_t sectorCount)
+{
+	size_t startByte = 0;
+	size_t endByte = 0;
+	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+
+	// Zero filling untouched zero pages would only fault them in.
+	if (value == 0 && _isKnownZero && !_overlay)
+	{
+		return *this;
+	}
+
+	MarkModified();
+	SectorStamp stamp = { GetFusedOverlay(), _bytesPerSector, startSector };
+	ParallelFill(_dataStart + startByte, endByte - startByte, 1, [value](UInt8* data, size_t length)
+	{
+		::memset(data, value, length);
+	}, stamp);
+	if (_usePatternMode)
+	{
+		FillCompressionInfo(eFixPattern, 1, startByte, endByte);
+		ApplyPatternModeOverlay(startByte, endByte);
+	}
+	return *this;
+}
+
+
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillOnes(0).
+/// </summary>
+
+ufs::Buffer& ufs::Buffer::FillOnes()
+{
+	return FillOnes(0);
+}
+
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillOnes(startSector, 0).
+/// </summary>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillOnes(size_t startSector)
+{
+	return FillOnes(startSector, 0);
+}
+
+/// <summary>
+/// Sets the bytes in the buffer to 0xFF (every bit set to 1),
+/// starting at the sector specified by "startSector", for the number
+/// of sectors specified in "sectorCount".
+/// </summary>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill with 0xFF.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillOnes(size_t startSector, size_t sectorCount)
+{
+	return Fill(0xFF, startSector, sectorCount);
+}
+
+
+
+
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillAddressOverlay(0)
+/// </summary>
+ufs::Buffer& ufs::Buffer::FillAddressOverlay()
+{
+	return FillAddressOverlay(0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillAddressOverlay(startingValue, 0)
+/// </summary>
+/// <param name="startingValue">
+/// The value to be used as the address for the first sector.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillAddressOverlay(UInt64 startingValue)
+{
+	return FillAddressOverlay(startingValue, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillAddressOverlay(startingValue, startSector, 0)
+/// </summary>
+/// <param name="startingValue">
+/// The value to be used as the address for the first sector.
+/// </param>
+/// <param name="startSector">
+/// The sector to start applying the address overlay at
+/// </param>
+ufs::Buffer& ufs::Buffer::FillAddressOverlay(UInt64 startingValue, size_t startSector)
+{
+	return FillAddressOverlay(startingValue, startSector, 0);
+}
+
+/// <summary>
+/// Sets the first and last eight bytes (64 bits) of "sectorCount" sectors to an
+/// address value, starting at the sector specified by "startSector", with the
+/// value specified by "startingValue", and incrementing by one for each sector.
+/// </summary>
+/// <param name="startingValue">
+/// The value to be used as the address for the first sector.
+/// </param>
+/// <param name="startSector">
+/// The sector to start applying the address overlay at.
+/// </param>
+/// <param name="sectorCount">
+/// The number of sectors to apply the address overlay to.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillAddressOverlay(UInt64 startingValue, size_t startSector, size_t sectorCount)
+{
+	sectorCount = ValidateSectorRangeAndGetSectorCount(startSector, sectorCount);
+	MarkModified();
+
+	// Get number of 8 byte (64 bit) chucks per sector.
+	size_t jump = _bytesPerSector/8;
+
+	// 64 bit pointer to the data byte array. Indexing into
+	// this moves us 8 bytes at a time instead of 1.
+	UInt64* data64BitPtr = (UInt64*)_dataStart;
+
+	size_t start64bitOffset = startSector * jump;
+
+	ufs::WorkerPool::GetInstance().ParallelForBytes(sectorCount * _bytesPerSector, _bytesPerSector, [&](size_t begin, size_t end)
+	{
+		for(size_t sector = begin / _bytesPerSector; sector < end / _bytesPerSector; sector++)
+		{
+			UInt64 value = startingValue + sector;
+			size_t i = start64bitOffset + sector * jump;
+			data64BitPtr[i] = value;
+			data64BitPtr[i + jump -1] = value;
+		}
+	});
+
+	return *this;
+}
+
+/// <summary>
+/// Sets the overlay stamped into every sector written by Fill, FillBytes,
+/// FillIncrementing, FillDecrementing and the random fills, in the same
+/// pass that generates the data. The overlay is copied; set it again after
+/// changing it, e.g. for the next pass number.
+/// </summary>
+/// <param name="overlay">
+/// The fields to stamp. Every field has to fit in a sector.
 /// </param>
-/// <param name = "bit">
-/// The zero based bit number to retrieve from the byte specified in "index".
+ufs::Buffer& ufs::Buffer::SetSectorOverlay(const ufs::SectorOverlay& overlay)
+{
+	overlay.Validate(_bytesPerSector);
+	_overlay = overlay.IsEmpty() ? NULL : std::make_shared<const ufs::SectorOverlay>(overlay);
+	return *this;
+}
+
+/// <summary>
+/// Stops the fills stamping a sector overlay.
+/// </summary>
+ufs::Buffer& ufs::Buffer::ClearSectorOverlay()
+{
+	_overlay.reset();
+	return *this;
+}
+
+/// <summary>
+/// Returns the overlay the fills stamp, or NULL when there is none.
+/// </summary>
+const ufs::SectorOverlay* ufs::Buffer::GetSectorOverlay() const
+{
+	return _overlay.get();
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.ApplySectorOverlay(0)
+/// </summary>
+ufs::Buffer& ufs::Buffer::ApplySectorOverlay()
+{
+	return ApplySectorOverlay(0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.ApplySectorOverlay(startSector, 0)
+/// </summary>
+/// <param name="startSector">
+/// The sector to start stamping at.
 /// </param>
-UInt8 ufs::Buffer::GetByteBit(size_t index, UInt8 bit) const
+ufs::Buffer& ufs::Buffer::ApplySectorOverlay(size_t startSector)
 {
-	if (bit > 7)
+	return ApplySectorOverlay(startSector, 0);
+}
+
+/// <summary>
+/// Stamps the sector overlay into "sectorCount" sectors starting at
+/// "startSector" without changing the rest of their data, e.g. after
+/// SetBytes. Does nothing without an overlay.
+/// </summary>
+/// <param name="startSector">
+/// The sector to start stamping at.
+/// </param>
+/// <param name="sectorCount">
+/// The number of sectors to stamp.
+/// </param>
+ufs::Buffer& ufs::Buffer::ApplySectorOverlay(size_t startSector, size_t sectorCount)
+{
+	sectorCount = ValidateSectorRangeAndGetSectorCount(startSector, sectorCount);
+	if (!_overlay)
 	{
-		boost::format errStr("Invalid bit index. %1% is beyond the width of a byte.");
-		errStr % static_cast<UInt32>(bit);
-		throw ufs::ArgumentError(errStr.str());
+		return *this;
 	}
 
-	return (GetByte(index) &  (1 << bit)) > 0;
+	MarkModified();
+	SectorStamp stamp = { _overlay.get(), _bytesPerSector, startSector };
+	UInt8* data = _dataStart + startSector * _bytesPerSector;
+	ufs::WorkerPool::GetInstance().ParallelForBytes(sectorCount * _bytesPerSector, _bytesPerSector, [&](size_t begin, size_t end)
+	{
+		stamp(data + begin, begin, end - begin);
+	});
+
+	return *this;
+}
+
+void ufs::Buffer::ApplyPatternModeOverlay(size_t startByte, size_t endByte)
+{
+	if (_usePatternMode && _overlay && endByte > startByte)
+	{
+		ApplySectorOverlay(startByte / _bytesPerSector, (endByte - startByte) / _bytesPerSector);
+	}
 }
 
+
+
+
 /// <summary>
-/// Sets the value of a single byte in the buffer.
+/// Equivalent:  dmx.Buffer.FillZeros(0)
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the byte whose value you wish to set, in bytes.
+ufs::Buffer& ufs::Buffer::FillZeros()
+{
+	return FillZeros(0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillZeros(startSector, 0)
+/// </summary>
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-/// <param name = "value">
-/// The byte value to write to the buffer at "index" location.
+ufs::Buffer& ufs::Buffer::FillZeros(size_t startSector)
+{
+	return FillZeros(startSector, 0);
+}
+
+/// <summary>
+/// Sets the bytes in the buffer to 0x0 (every bit set to 0), starting at the
+/// sector specified by "startSector", for the number of sectors specified in
+/// "sectorCount".
+/// </summary>
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::SetByte(size_t index, UInt8 value)
+/// <param name = "sectorCount">
+/// The number of sectors to fill with 0x0.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillZeros(size_t startSector, size_t sectorCount)
 {
-	ValidateIndex(index);
-	_dataStart[index] = value;
-	return *this;
+	return Fill(0, startSector, sectorCount);
 }
 
+
+
 /// <summary>
-/// Return a single 16 bit (2 byte) word from the buffer. Byte order is
-/// little endian (least significant byte is first), for SATA data.
+/// Equivalent:  dmx.Buffer.FillBytes(list, 0).
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the word to return, in 8 bit bytes.
+/// <param name = "list">
+/// The list of bytes to use as a pattern to fill the buffer with.
 /// </param>
-UInt16 ufs::Buffer::GetWord(size_t index) const
+ufs::Buffer& ufs::Buffer::FillBytes(const std::vector<UInt8>& list)
 {
-	ValidateIndex(index + 1);
-	// Least significant byte is the lower index.
-	return static_cast<UInt16>(_dataStart[index] | (_dataStart[index + 1] << 8));
+	return FillBytes(list, 0);
 }
 
 /// <summary>
-/// Return a single bit from a 16 bit (2 byte) word in the buffer. Byte order
-/// is little endian (least significant byte is first), for SATA data.
+/// Equivalent:  dmx.Buffer.FillBytes(list, startSector, 0).
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the word to retrieve the bit from,
-/// in 8 bit bytes.
+/// <param name = "list">
+/// The list of bytes to use as a pattern to fill the buffer with.
 /// </param>
-/// <param name = "bit">
-/// The zero based bit number to retrieve from the word specified in "index".
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-UInt8 ufs::Buffer::GetWordBit(size_t index, UInt8 bit) const
+ufs::Buffer& ufs::Buffer::FillBytes(const std::vector<UInt8>& list, size_t startSector)
 {
-	if (bit > 15)
+	return FillBytes(list, startSector, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillBytes(list, startSector, sectorCount, PatternContinuous).
+/// </summary>
+/// <param name = "list">
+/// The list of bytes to use as a pattern to fill the buffer with.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill with the pattern.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillBytes(const std::vector<UInt8>& list, size_t startSector, size_t sectorCount)
+{
+	return FillBytes(list, startSector, sectorCount, ufs::PatternContinuous);
+}
+
+/// <summary>
+/// Sets the bytes in the buffer to the pattern specified in "list",
+/// repeating the pattern to fill the buffer, starting at the sector specified
+/// by "startSector", for the number of sectors specified in "sectorCount".
+/// Lists of any length, such as 3, 7 or 13 bytes, fill at full speed.
+/// </summary>
+/// <param name = "list">
+/// The list of bytes to use as a pattern to fill the buffer with.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill with the pattern.
+/// </param>
+/// <param name = "phase">
+/// Whether the list runs on across sectors or starts again in each one.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillBytes(const std::vector<UInt8>& list, size_t startSector, size_t sectorCount, ufs::PatternPhase phase)
+{
+	size_t byteCount = list.size();
+
+	if (byteCount != 0)
 	{
-		boost::format errStr("Invalid bit index. %1% is beyond the width of a word.");
-		errStr % static_cast<UInt32>(bit);
-		throw ufs::ArgumentError(errStr.str());
+		size_t startByte = 0;
+		size_t endByte = 0;
+		GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+		MarkModified();
+
+		// Pieces start where the list starts again.
+		const UInt8* pattern = list.data();
+		size_t restartPeriod = phase == ufs::PatternPerSector ? _bytesPerSector : 0;
+		size_t period = phase == ufs::PatternPerSector ? _bytesPerSector : byteCount;
+		SectorStamp stamp = { GetFusedOverlay(), _bytesPerSector, startSector };
+		ParallelFill(_dataStart + startByte, endByte - startByte, period, [pattern, byteCount, restartPeriod](UInt8* data, size_t length)
+		{
+			ufs::kernels::FillBytes(data, length, pattern, byteCount, restartPeriod);
+		}, stamp);
+
+		if (_usePatternMode)
+		{
+			FillCompressionInfo(eFixPattern, static_cast<uint8_t>(byteCount), startByte, endByte);
+			ApplyPatternModeOverlay(startByte, endByte);
+		}
+
 	}
 
-	return (GetWord(index) &  (1 << bit)) > 0;
+	return *this;
 }
 
+
+
+
 /// <summary>
-/// Sets the value of a 16 bit (2 byte) word in the buffer. Byte order is
-/// little endian (least significant byte is first), for SATA data.
+/// Equivalent:  dmx.Buffer.FillIncrementing(0)
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the word whose value you wish to set,
-/// in 8 bit bytes.
+ufs::Buffer& ufs::Buffer::FillIncrementing()
+{
+	return FillIncrementing(0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillIncrementing(startValue, 0)
+/// </summary>
+/// <param name="startingValue">
+/// The byte value to start the pattern with.
 /// </param>
-/// <param name = "value">
-/// The 16 bit value to set starting at the word specified in "index" (least significant byte is first).
+ufs::Buffer&ufs:: Buffer::FillIncrementing(UInt8 startingValue)
+{
+	return FillIncrementing(startingValue, 0);
+}
+
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillIncrementing(startValue, startSector, 0)
+/// </summary>
+/// <param name="startingValue">
+/// The byte value to start the pattern with.
 /// </param>
-ufs::Buffer& ufs::Buffer::SetWord(size_t index, UInt16 value)
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillIncrementing(UInt8 startingValue, size_t startSector)
 {
-	ValidateIndex(index + 1);
-	// Least significant byte is the lower index.
-	_dataStart[index] = static_cast<UInt8>(value & 0xFF);
-	_dataStart[index + 1] = static_cast<UInt8>(value >> 8);
+	return FillIncrementing(startingValue, startSector, 0);
+}
+
+/// <summary>
+/// Sets the bytes in the buffer to a sector size boundary, incrementing pattern
+/// (0 - 255), starting with "startingValue", starting at the sector specified
+/// by "startSector", for the number of sectors specified in "sectorCount".
+/// </summary>
+/// <param name="startingValue">
+/// The byte value to start the pattern with.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill with the pattern.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillIncrementing(UInt8 startingValue, size_t startSector, size_t sectorCount)
+{
+	size_t startByte = 0;
+	size_t endByte = 0;
+	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+	MarkModified();
+
+	size_t period = GetBytesPerSector();
+	SectorStamp stamp = { GetFusedOverlay(), _bytesPerSector, startSector };
+	ParallelFill(_dataStart + startByte, endByte - startByte, period, [period, startingValue](UInt8* data, size_t length)
+	{
+		ufs::kernels::FillIncrementing(data, length, period, startingValue);
+	}, stamp);
+
+	if (_usePatternMode)
+	{
+		FillCompressionInfo(eIncrementingPattern, 1, startByte, endByte);
+		ApplyPatternModeOverlay(startByte, endByte);
+	}
+
 	return *this;
 }
 
 
 
 
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillDecrementing(255)
+/// </summary>
+ufs::Buffer& ufs::Buffer::FillDecrementing()
+{
+	return FillDecrementing(255);
+}
 
 /// <summary>
-/// Return a single 16 bit (2 byte) word from the buffer. Byte order is
-/// big endian (most significant byte is first), for SCSI data.
+/// Equivalent:  dmx.Buffer.FillDecrementing(startingValue, 0)
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the word to return, in 8 bit bytes.
+/// <param name="startingValue">
+/// The byte value to start the pattern with.
 /// </param>
-UInt16 ufs::Buffer::GetWordBigEndian(size_t index) const
+ufs::Buffer& ufs::Buffer::FillDecrementing(UInt8 startingValue)
 {
-	ValidateIndex(index + 1);
-	// Most significant byte is the lower index.
-	return static_cast<UInt16>((_dataStart[index] << 8) | _dataStart[index + 1]);
+	return FillDecrementing(startingValue, 0);
 }
 
 /// <summary>
-/// Return a single bit from a 16 bit word in the buffer. Byte order is
-/// big endian (most significant byte is first), for SCSI data.
+/// Equivalent:  dmx.Buffer.FillDecrementing(startingValue, startSector, 0)
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the word to retrieve the bit from,
-/// in 8 bit bytes.
+/// <param name="startingValue">
+/// The byte value to start the pattern with.
 /// </param>
-/// <param name = "bit">
-/// The zero based bit number to retrieve from the word specified in "index".
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-UInt8 ufs::Buffer::GetWordBitBigEndian(size_t index, UInt8 bit) const
+ufs::Buffer& ufs::Buffer::FillDecrementing(UInt8 startingValue, size_t startSector)
 {
-	if (bit > 15)
-	{
-		boost::format errStr("Invalid bit index. %1% is beyond the width of a word.");
-		errStr % static_cast<UInt32>(bit);
-		throw ufs::ArgumentError(errStr.str());
-	}
-
-	return (GetWordBigEndian(index) &  (1 << bit)) > 0;
+	return FillDecrementing(startingValue, startSector, 0);
 }
 
 /// <summary>
-/// Sets the value of a 16 bit word (two bytes) in the buffer. Byte order is
-/// big endian (most significant byte is first), for SCSI data.
+/// Sets the bytes in the buffer to a sector size boundary, decrementing pattern
+/// (255 - 0), starting with "startingValue", starting at the sector specified
+/// by "startSector", for the number of sectors specified in "sectorCount".
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the word whose value you wish to set,
-/// in 8 bit bytes.
+/// <param name="startingValue">
+/// The byte value to start the pattern with.
 /// </param>
-/// <param name = "value">
-/// The 16 bit value to set starting at the word specified in "index" (most significant byte is first).
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::SetWordBigEndian(size_t index, UInt16 value)
+/// <param name = "sectorCount">
+/// The number of sectors to fill with the pattern.  If sectorCount is zero,
+/// fill all sectors.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillDecrementing(UInt8 startingValue, size_t startSector, size_t sectorCount)
 {
-	ValidateIndex(index + 1);
-	// Most significant byte is the lower index.
-	_dataStart[index] = static_cast<UInt8>(value >> 8);
-	_dataStart[index + 1] = static_cast<UInt8>(value & 0xFF);
+	size_t startByte = 0;
+	size_t endByte = 0;
+	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+	MarkModified();
+
+	size_t period = GetBytesPerSector();
+	SectorStamp stamp = { GetFusedOverlay(), _bytesPerSector, startSector };
+	ParallelFill(_dataStart + startByte, endByte - startByte, period, [period, startingValue](UInt8* data, size_t length)
+	{
+		ufs::kernels::FillDecrementing(data, length, period, startingValue);
+	}, stamp);
+
+	if (_usePatternMode)
+	{
+		FillCompressionInfo(eDecrementingPattern, 1, startByte, endByte);
+		ApplyPatternModeOverlay(startByte, endByte);
+	}
+
 	return *this;
 }
 
 
 
 
+/// <summary>
+///  Equivalent:  dmx.Buffer.FillRandom(0)
+/// </summary>
+ufs::Buffer& ufs::Buffer::FillRandom()
+{
+	return ufs::Buffer::FillRandom(0);
+}
 
 /// <summary>
-/// Return a single 32 bit (4 byte) dword from the buffer. Byte order is
-/// little endian (least significant byte is first), for SATA data.
+///  Equivalent:  dmx.Buffer.FillRandom(startSector, 0)
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the dword to return, in 8 bit bytes.
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-UInt32 ufs::Buffer::GetDWord(size_t index) const
+ufs::Buffer& ufs::Buffer:: FillRandom(size_t startSector)
 {
-	ValidateIndex(index + 3);
-	// Least significant byte is the lower index.
-	return _dataStart[index]
-		| (_dataStart[index + 1] << 8)
-		| (_dataStart[index + 2] << 16)
-		| (_dataStart[index + 3] << 24);
+	return ufs::Buffer::FillRandom(startSector, 0);
 }
 
 /// <summary>
-/// Return a single bit from a 32 bit (4 byte) dword in the buffer. Byte order
-/// is little endian (least significant byte is first), for SATA data.
+/// Sets the bytes in the buffer to a pseudo-random sequence of values between
+/// 0 - 255, starting at the sector specified by "startSector", for the number
+/// of sectors specified in "sectorCount". Sequence is  seeded by time and
+/// thread id.
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the dword to retrieve the bit from,
-/// in 8 bit bytes.
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-/// <param name = "bit">
-/// The zero based bit number to retrieve from the word specified in "index".
+/// <param name = "sectorCount">
+/// The number of sectors to fill with the pattern.
 /// </param>
-UInt8 ufs::Buffer::GetDWordBit(size_t index, UInt8 bit) const
+ufs::Buffer& ufs::Buffer::FillRandom(size_t startSector, size_t sectorCount)
 {
-	if (bit > 31)
-	{
-		boost::format errStr("Invalid bit index. %1% is beyond the width of a d-word.");
-		errStr % static_cast<UInt32>(bit);
-		throw ufs::ArgumentError(errStr.str());
-	}
-
-	return (GetDWord(index) &  (1 << bit)) > 0;
+	return ufs::Buffer::FillRandom(startSector, sectorCount, RandomCompatible);
 }
 
 /// <summary>
-/// Sets the value of a 32 bit (4 byte) dword in the buffer. Byte order is
-/// little endian (least significant byte is first), for SATA data.
+/// Same as FillRandom(startSector, sectorCount), with the generator chosen
+/// by "engine". RandomFast is several times faster but gives a different
+/// sequence. Buffers in pattern mode always use RandomCompatible, since the
+/// simulator recovers the data from the taus88 state stored in each sector.
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the dword whose value you wish to set,
-/// in 8 bit bytes.
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-/// <param name = "value">
-/// The 32 bit value to set starting at the word specified in "index" (least significant byte is first).
+/// <param name = "sectorCount">
+/// The number of sectors to fill with the pattern.
 /// </param>
-ufs::Buffer& ufs::Buffer::SetDWord(size_t index, UInt32 value)
+/// <param name = "engine">
+/// The random number generator to fill with.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillRandom(size_t startSector, size_t sectorCount, RandomEngine engine)
 {
-	ValidateIndex(index + 3);
-	// Least significant byte is the lower index.
-	_dataStart[index] = static_cast<UInt8>(value & 0xFF);
-	_dataStart[index + 1] = static_cast<UInt8>(value >> 8);
-	_dataStart[index + 2] = static_cast<UInt8>(value >> 16);
-	_dataStart[index + 3] = static_cast<UInt8>(value >> 24);
-	return *this;
+	return ufs::Buffer::FillRandomImpl(startSector, sectorCount, false, 0, engine);
 }
 
 
 
-
 /// <summary>
-/// Return a single 32 bit (4 byte) dword from the buffer. Byte order is
-/// big endian (most significant byte is first), for SCSI data.
+/// Equivalent:  dmx.Buffer.FillRandomSeeded(seed, 0)
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the dword to return, in 8 bit bytes.
+/// <param name = "seed">
+/// The value to seed the random number generation with.
 /// </param>
-UInt32 ufs::Buffer::GetDWordBigEndian(size_t index) const
+ufs::Buffer& ufs::Buffer::FillRandomSeeded(UInt32 seed)
 {
-	ValidateIndex(index + 3);
-	// Most significant byte is the lower index.
-	return (_dataStart[index] << 24)
-		 | (_dataStart[index + 1] << 16)
-		 | (_dataStart[index + 2] << 8)
-		 |  _dataStart[index + 3];
+	return ufs::Buffer::FillRandomSeeded(seed, 0);
 }
 
 /// <summary>
-/// Return a single bit from a 16 bit (4 byte) dword in the buffer. Byte order
-/// is big endian (most significant byte is first), for SCSI data.
+/// Equivalent:  dmx.Buffer.FillRandomSeeded(seed, startSector, 0)
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the dword to retrieve the bit from,
-/// in 8 bit bytes.
+/// <param name = "seed">
+/// The value to seed the random number generation with.
 /// </param>
-/// <param name = "bit">
-/// The zero based bit number to retrieve from the word specified in "index".
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-UInt8 ufs::Buffer::GetDWordBitBigEndian(size_t index, UInt8 bit) const
+ufs::Buffer& ufs::Buffer::FillRandomSeeded(UInt32 seed, size_t startSector)
 {
-	if (bit > 31)
-	{
-		boost::format errStr("Invalid bit index. %1% is beyond the width of a d-word.");
-		errStr % static_cast<UInt32>(bit);
-		throw ufs::ArgumentError(errStr.str());
-	}
-
-	return (GetDWordBigEndian(index) &  (1 << bit)) > 0;
+	return ufs::Buffer::FillRandomSeeded(seed, startSector, 0);
 }
 
 /// <summary>
-/// Sets the value of a 32 bit dword (four bytes) in the buffer. Byte order is
-/// big endian (most significant byte is first), for SCSI data.
+/// Sets the bytes in the buffer to a pseudo-random sequence of values between
+/// 0 - 255, starting at the sector specified by "startSector", for the number
+/// of sectors specified in "sectorCount". Sequence is  seeded by the value
+/// specified in "seed". Calling this method twice with the same "seed" value
+/// will produce the same pseudo-random sequence of values.
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the dword whose value you wish to set,
-/// in 8 bit bytes.
+/// <param name = "seed">
+/// The value to seed the random number generation with.
 /// </param>
-/// <param name = "value">
-/// The 32 bit value to set starting at the word specified in "index" (most significant byte is first).
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::SetDWordBigEndian(size_t index, UInt32 value)
+/// <param name = "sectorCount">
+/// The number of sectors to fill with the pattern.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillRandomSeeded(UInt32 seed, size_t startSector, size_t sectorCount)
 {
-	ValidateIndex(index + 3);
-	// Most significant byte is the lower index.
-	_dataStart[index] = static_cast<UInt8>(value >> 24);
-	_dataStart[index + 1] = static_cast<UInt8>(value >> 16);
-	_dataStart[index + 2] = static_cast<UInt8>(value >> 8);
-	_dataStart[index + 3] = static_cast<UInt8>(value & 0xFF);
-	return *this;
+	return ufs::Buffer::FillRandomSeeded(seed, startSector, sectorCount, RandomCompatible);
 }
 
+/// <summary>
+/// Same as FillRandomSeeded(seed, startSector, sectorCount), with the
+/// generator chosen by "engine". A seed gives the same bytes every time for
+/// a given engine, but the engines give different bytes for the same seed.
+/// </summary>
+/// <param name = "seed">
+/// The value to seed the random number generation with.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill with the pattern.
+/// </param>
+/// <param name = "engine">
+/// The random number generator to fill with.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillRandomSeeded(UInt32 seed, size_t startSector, size_t sectorCount, RandomEngine engine)
+{
+	return ufs::Buffer::FillRandomImpl(startSector, sectorCount, true, seed, engine);
+}
 
 
 
 
 /// <summary>
-/// Return a single 64 bit (8 byte) qword from the buffer. Byte order is
-/// little endian (least significant byte is first), for SATA data.
+/// Equivalent:  dmx.Buffer.FillRandomSeededBySector(seed, 0)
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the qword to return, in 8 bit bytes.
+/// <param name = "seed">
+/// The value to seed the random number generation with for the first sector.
 /// </param>
-UInt64 ufs::Buffer::GetQWord(size_t index) const
+ufs::Buffer& ufs::Buffer::FillRandomSeededBySector(UInt32 seed)
 {
-	ValidateIndex(index + 7);
-	// Least significant byte is the lower index.
-	return (UInt64)_dataStart[index]
-		| ((UInt64)_dataStart[index + 1] << 8)
-		| ((UInt64)_dataStart[index + 2] << 16)
-		| ((UInt64)_dataStart[index + 3] << 24)
-		| ((UInt64)_dataStart[index + 4] << 32)
-		| ((UInt64)_dataStart[index + 5] << 40)
-		| ((UInt64)_dataStart[index + 6] << 48)
-		| ((UInt64)_dataStart[index + 7] << 56);
+	return ufs::Buffer::FillRandomSeededBySector(seed, 0);
 }
 
 /// <summary>
-/// Return a single bit from a 64 bit (8 byte) qword in the buffer. Byte order
-/// is little endian (least significant byte is first), for SATA data.
+/// Equivalent:  dmx.Buffer.FillRandomSeededBySector(seed, startSector, 0)
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the qword to retrieve the bit from,
-/// in 8 bit bytes.
+/// <param name = "seed">
+/// The value to seed the random number generation with for the first sector.
 /// </param>
-/// <param name = "bit">
-/// The zero based bit number to retrieve from the word specified in "index".
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-UInt8 ufs::Buffer::GetQWordBit(size_t index, UInt8 bit) const
+ufs::Buffer& ufs::Buffer::FillRandomSeededBySector(UInt32 seed, size_t startSector)
 {
-	if (bit > 63)
-	{
-		boost::format errStr("Invalid bit index. %1% is beyond the width of a q-word.");
-		errStr % static_cast<UInt32>(bit);
-		throw ufs::ArgumentError(errStr.str());
-	}
-
-	return (GetQWord(index) &  ((UInt64)1 << bit)) > 0;
+	return ufs::Buffer::FillRandomSeededBySector(seed, startSector, 0);
 }
 
 /// <summary>
-/// Sets the value of a 64 bit (8 byte) qword in the buffer. Byte order is
-/// little endian (least significant byte is first), for SATA data.
+/// Sets the bytes in the buffer to a set of pseudo-random sequences of values
+/// between 0 - 255. Each sector is filled with a different sequence by seeding
+/// a random number generator with a different number for each sector. The
+/// first sector is seeded by the value specified in "seed". The seed value is
+/// incremented by one for each subsequent sector. Calling this method twice
+/// with the same "seed" value will produce the same set of pseudo-random
+/// sequences of values.
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the qword whose value you wish to set,
-/// in 8 bit bytes.
+/// <param name = "seed">
+/// The value to seed the random number generation with for the first sector.
 /// </param>
-/// <param name = "value">
-/// The 64 bit value to set starting at the word specified in "index" (least significant byte is first).
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::SetQWord(size_t index, UInt64 value)
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillRandomSeededBySector(UInt32 seed, size_t startSector, size_t sectorCount)
 {
-	ValidateIndex(index + 7);
-	// Least significant byte is the lower index.
-	_dataStart[index] = static_cast<UInt8>(value);
-	_dataStart[index + 1] = static_cast<UInt8>(value >> 8);
-	_dataStart[index + 2] = static_cast<UInt8>(value >> 16);
-	_dataStart[index + 3] = static_cast<UInt8>(value >> 24);
-	_dataStart[index + 4] = static_cast<UInt8>(value >> 32);
-	_dataStart[index + 5] = static_cast<UInt8>(value >> 40);
-	_dataStart[index + 6] = static_cast<UInt8>(value >> 48);
-	_dataStart[index + 7] = static_cast<UInt8>(value >> 56);
-	return *this;
-}
+	if(GetBytesPerSector() % 4 != 0)
+	{
+		throw ufs::RuntimeError("Filling random data is not supported for sector sizes that are not a mupltiple of 4.");
+	}
+
+	sectorCount = ValidateSectorRangeAndGetSectorCount(startSector, sectorCount);
+	MarkModified();
 
+	// Each piece works with its own copy of the generator.
+	const ufs::Random32 random = *GetRandom(true, seed);
 
+	ufs::WorkerPool::GetInstance().ParallelForBytes(sectorCount * _bytesPerSector, _bytesPerSector, [&](size_t begin, size_t end)
+	{
+		ufs::Random32 sectorRandom(random);
+		for(size_t sector = begin / _bytesPerSector; sector < end / _bytesPerSector; sector++)
+		{
+			sectorRandom.Seed((UInt32)(seed + sector));
+			ufs::Buffer::FillSectorsWithRandomData(sectorRandom, startSector + sector, 1);
+		}
+	});
 
+	return *this;
+}
 
 /// <summary>
-/// Return a single 64 bit qword from the buffer.
+/// Equivalent:  dmx.Buffer.FillRandomCounter(seed, 0)
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the qword to return, in 8 bit bytes.
+/// <param name = "seed">
+/// The value to seed the random number generation with.
 /// </param>
-UInt64 ufs::Buffer::GetQWordBigEndian(size_t index) const
+ufs::Buffer& ufs::Buffer::FillRandomCounter(UInt64 seed)
 {
-	ValidateIndex(index + 7);
-	// Most significant byte is the lower index.
-	return ((UInt64)_dataStart[index]) << 56
-		| ((UInt64)_dataStart[index + 1] << 48)
-		| ((UInt64)_dataStart[index + 2] << 40)
-		| ((UInt64)_dataStart[index + 3] << 32)
-		| ((UInt64)_dataStart[index + 4] << 24)
-		| ((UInt64)_dataStart[index + 5] << 16)
-		| ((UInt64)_dataStart[index + 6] << 8)
-		| (UInt64)_dataStart[index + 7];
+	return ufs::Buffer::FillRandomCounter(seed, 0);
 }
 
 /// <summary>
-/// Return a single bit from a 64 bit qword in the buffer.
+/// Equivalent:  dmx.Buffer.FillRandomCounter(seed, startSector, 0)
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the qword to retrieve the bit from,
-/// in 8 bit bytes.
+/// <param name = "seed">
+/// The value to seed the random number generation with.
 /// </param>
-/// <param name = "bit">
-/// The zero based bit number to retrieve from the word specified in "index".
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-UInt8 ufs::Buffer::GetQWordBitBigEndian(size_t index, UInt8 bit) const
+ufs::Buffer& ufs::Buffer::FillRandomCounter(UInt64 seed, size_t startSector)
 {
-	if (bit > 63)
-	{
-		boost::format errStr("Invalid bit index. %1% is beyond the width of a q-word.");
-		errStr % static_cast<UInt32>(bit);
-		throw ufs::ArgumentError(errStr.str());
-	}
-
-	return (GetQWordBigEndian(index) &  ((UInt64)1 << bit)) > 0;
+	return ufs::Buffer::FillRandomCounter(seed, startSector, 0);
 }
 
 /// <summary>
-/// Sets the value of a 64 bit word (eight bytes) in the buffer.
+/// Equivalent:  dmx.Buffer.FillRandomCounter(seed, startSector, sectorCount, startSector),
+/// so each sector is keyed by its own index in the buffer.
 /// </summary>
-/// <param name = "index">
-/// The zero based index location of the qword whose value you wish to set,
-/// in 8 bit bytes.
+/// <param name = "seed">
+/// The value to seed the random number generation with.
 /// </param>
-/// <param name = "value">
-/// The 64 bit value to set starting at the word specified in "index"(most significant byte is first).
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::SetQWordBigEndian(size_t index, UInt64 value)
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillRandomCounter(UInt64 seed, size_t startSector, size_t sectorCount)
 {
-	ValidateIndex(index + 7);
-	// Most significant byte is the lower index.
-	_dataStart[index] = static_cast<UInt8>(value >> 56);
-	_dataStart[index + 1] = static_cast<UInt8>(value >> 48);
-	_dataStart[index + 2] = static_cast<UInt8>(value >> 40);
-	_dataStart[index + 3] = static_cast<UInt8>(value >> 32);
-	_dataStart[index + 4] = static_cast<UInt8>(value >> 24);
-	_dataStart[index + 5] = static_cast<UInt8>(value >> 16);
-	_dataStart[index + 6] = static_cast<UInt8>(value >> 8);
-	_dataStart[index + 7] = static_cast<UInt8>(value);
-	return *this;
+	return ufs::Buffer::FillRandomCounter(seed, startSector, sectorCount, startSector);
 }
 
-/// <summary> Gets the data start of the buffer. </summary>
-UInt8* ufs::Buffer::GetDataStart() const
+/// <summary>
+/// Sets the bytes of "sectorCount" sectors, starting at "startSector", to
+/// counter-based pseudo-random data (see CounterRandom). The data of each
+/// sector depends only on "seed" and its key sector, "firstKeySector" for
+/// the first sector filled and one more for each following sector, so
+/// filling a range in pieces, in any order or on any number of threads,
+/// gives the same bytes, and CounterRandom(seed).GetSector(key, ...)
+/// regenerates any one sector. Passing the device LBA as the key sector
+/// makes the data a function of the LBA. No simulator compression info is
+/// written, as the simulator cannot regenerate this data.
+/// </summary>
+/// <param name = "seed">
+/// The value to seed the random number generation with.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+/// <param name = "firstKeySector">
+/// The key sector of the first sector filled.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillRandomCounter(UInt64 seed, size_t startSector, size_t sectorCount, UInt64 firstKeySector)
 {
-	return _dataStart;
-}
+	if(GetBytesPerSector() % 4 != 0)
+	{
+		throw ufs::RuntimeError("Filling random data is not supported for sector sizes that are not a multiple of 4.");
+	}
 
-/// <summary> Gets the start of the block of memeory allocated for the buffer. </summary>
-UInt8* ufs::Buffer::GetAllocationStart() const
-{
-	return _data;
-}
+	sectorCount = ValidateSectorRangeAndGetSectorCount(startSector, sectorCount);
+	MarkModified();
+
+	const ufs::CounterRandom random(seed);
+	UInt8* data = _dataStart + startSector * _bytesPerSector;
+	size_t totalBytes = sectorCount * _bytesPerSector;
+	size_t blockLength = std::max<size_t>(STAGING_BYTES / _bytesPerSector, 1) * _bytesPerSector;
+	bool stream = UseStreamingStores(totalBytes);
+	SectorStamp stamp = { GetFusedOverlay(), _bytesPerSector, startSector };
+	ufs::WorkerPool::GetInstance().ParallelForBytes(totalBytes, _bytesPerSector, [&](size_t begin, size_t end)
+	{
+		if (!stream && !stamp.IsActive())
+		{
+			random.FillSectors(data + begin, _bytesPerSector, firstKeySector + begin / _bytesPerSector, (end - begin) / _bytesPerSector);
+			return;
+		}
+
+		std::vector<UInt32> staging(stream ? blockLength / 4 : 0);
+		for (size_t done = begin; done < end; done += blockLength)
+		{
+			size_t count = std::min(blockLength, end - done);
+			UInt8* block = stream ? reinterpret_cast<UInt8*>(staging.data()) : data + done;
+			random.FillSectors(block, _bytesPerSector, firstKeySector + done / _bytesPerSector, count / _bytesPerSector);
+			stamp(block, done, count);
+			if (stream)
+			{
+				ufs::kernels::StreamCopy(data + done, block, count);
+			}
+		}
+	});
 
+	return *this;
+}
 
 /// <summary>
-///  Equivalent:  dmx.Buffer.GetBytes(0)
+/// Equivalent:  dmx.Buffer.FillTestPattern(pattern, 0)
 /// </summary>
-boost::shared_ptr<std::vector<UInt8>> ufs::Buffer::GetBytes() const
+/// <param name = "pattern">
+/// The test pattern to fill with.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillTestPattern(ufs::TestPattern pattern)
 {
-	return GetBytes(0);
+	return FillTestPattern(pattern, 0);
 }
 
 /// <summary>
-///  Equivalent:  ufs::Buffer::GetBytes(startingOffset, 0)
+/// Equivalent:  dmx.Buffer.FillTestPattern(pattern, startSector, 0)
 /// </summary>
-///
-/// <param name="startingOffset"> The starting offset in bytes. </param>
-boost::shared_ptr<std::vector<UInt8>> ufs::Buffer::GetBytes(size_t startingOffset) const
+/// <param name = "pattern">
+/// The test pattern to fill with.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillTestPattern(ufs::TestPattern pattern, size_t startSector)
 {
-	return GetBytes(startingOffset, 0);
+	return FillTestPattern(pattern, startSector, 0);
 }
 
 /// <summary>
-///  Return number of bytes from the buffer starting at offset for number of bytes requested.
-///  If length == 0 returns buffers total bytes minus startingOffset.
+/// Equivalent:  dmx.Buffer.FillTestPattern(pattern, startSector, sectorCount, TestPatternOptions())
 /// </summary>
-///
-/// <param name="startingOffset"> The starting offset in bytes. </param>
-/// <param name="length"> The length. </param>
-boost::shared_ptr<std::vector<UInt8>> ufs::Buffer::GetBytes(size_t startingOffset, size_t length) const
+/// <param name = "pattern">
+/// The test pattern to fill with.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillTestPattern(ufs::TestPattern pattern, size_t startSector, size_t sectorCount)
 {
-	size_t newLength = ValidateByteRangeAndGetLength(startingOffset, length);
-
-	boost::shared_ptr<std::vector<UInt8>> ptr(new std::vector<UInt8>(newLength));
-	std::copy(_dataStart + startingOffset, _dataStart + startingOffset + newLength, ptr->begin());
-	return ptr;
+	return FillTestPattern(pattern, startSector, sectorCount, ufs::TestPatternOptions());
 }
 
 /// <summary>
-/// Add info related with compression into buffer. e.g. compression type, pattern length.
-/// Save pattern in the fixed position
-/// compression format:
-///    Lba        |   Pattern     | Type(4 higher bits) and Pattern Length(4 lower bits)
-/// 8 bytes       |   12 bytes    |          1 byte
-/// confluence page: https://confluence.micron.com/confluence/display/FE/Simulator+compression+mode
+/// Fills "sectorCount" sectors, starting at "startSector", with one of the
+/// storage test patterns (walking ones or zeros, checkerboards, butterfly,
+/// galloping or marching). Each distinct sector is generated once and the
+/// rest are copies, so the fill runs at memory bandwidth.
 /// </summary>
-void ufs::Buffer::FillCompressionInfo(UInt8 type, UInt8 pattenLen, size_t startByte, size_t endByte)
+/// <param name = "pattern">
+/// The test pattern to fill with.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+/// <param name = "options">
+/// The word width of the pattern and the phase of each sector.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillTestPattern(ufs::TestPattern pattern, size_t startSector, size_t sectorCount, const ufs::TestPatternOptions& options)
 {
-	if (pattenLen > COMPRESSION_MAX_PATTERN_LEN)
-	{
-		return;
-	}
+	ufs::patterns::Validate(options, _bytesPerSector);
 
-	for (size_t i = startByte + COMPRESSION_LBA_SIZE_IN_BYTE + COMPRESSION_PATTERN_SIZE_IN_BYTE;
-		i<endByte;
-		i += _bytesPerSector)
+	size_t startByte = 0;
+	size_t endByte = 0;
+	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+	MarkModified();
+
+	// Pieces start a whole number of phase cycles in, where the phases are
+	// the same as at startSector.
+	size_t bytesPerSector = _bytesPerSector;
+	size_t period = ufs::patterns::GetCycleSectors(pattern, options, bytesPerSector) * bytesPerSector;
+	SectorStamp stamp = { GetFusedOverlay(), _bytesPerSector, startSector };
+	ParallelFill(_dataStart + startByte, endByte - startByte, period, [&](UInt8* data, size_t length)
 	{
-		// FTE scripts use dmx to generate a "0" buffer to verify empty page and compressed pattern is not suitable in this case.
-		if (!(_dataStart[startByte] == 0 && type == eFixPattern))
-		{
-			// Add pattern type and patten length
-			_dataStart[i] = 0;
-			_dataStart[i] = static_cast<UInt8>((type << 4) | pattenLen);
-		}
-		switch (type)
-		{
-		case eFixPattern:
-		case eIncrementingPattern:
-		case eDecrementingPattern:
-		{
-			// copy pattern to the position beginning with 9th byte
-			memcpy(_dataStart + i - COMPRESSION_PATTERN_SIZE_IN_BYTE,
-				_dataStart + i - COMPRESSION_PATTERN_SIZE_IN_BYTE - COMPRESSION_LBA_SIZE_IN_BYTE,
-				pattenLen);
-			break;
-		}
-		case eRandomPattern:
-		{
-			break;
-		}
-		default:
-			break;
-		}
-	}
+		ufs::patterns::FillSectors(pattern, options, data, length, bytesPerSector, startSector);
+	}, stamp);
+
+	ApplyPatternModeOverlay(startByte, endByte);
+	return *this;
 }
 
 /// <summary>
-/// Copies the contents of the list of bytes to the buffer, starting at
-/// the specified index.
+/// Equivalent:  dmx.Buffer.FillWalkingOnes(0)
 /// </summary>
-///
-/// <param name="startingOffset"> The starting offset in bytes. </param>
-/// <param name="value"> The value to copy. </param>
-ufs::Buffer& ufs::Buffer::SetBytes(size_t startingOffset, std::vector<UInt8> value)
+ufs::Buffer& ufs::Buffer::FillWalkingOnes()
 {
-	ValidateByteRangeAndGetLength(startingOffset, value.size());
-	std::copy(value.begin(), value.end(), _dataStart + startingOffset);
-	return *this;
+	return FillWalkingOnes(0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.GetString(0)
+/// Equivalent:  dmx.Buffer.FillWalkingOnes(startSector, 0)
 /// </summary>
-std::string ufs::Buffer::GetString() const
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillWalkingOnes(size_t startSector)
 {
-	return GetString(0);
+	return FillWalkingOnes(startSector, 0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.GetString(startingOffset, 0)
+/// Equivalent:  dmx.Buffer.FillWalkingOnes(startSector, sectorCount, TestPatternOptions())
 /// </summary>
-/// <param name="startingOffset"> The starting offset in bytes. </param>
-std::string ufs::Buffer::GetString(size_t startingOffset) const
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillWalkingOnes(size_t startSector, size_t sectorCount)
 {
-	return GetString(startingOffset, 0);
+	return FillWalkingOnes(startSector, sectorCount, ufs::TestPatternOptions());
 }
 
 /// <summary>
-/// Returns string value of buffer content starting at requested offset
-/// for requested length.  If length == 0 returns buffers total bytes minus
-/// startingOffset.
+/// Equivalent:  dmx.Buffer.FillTestPattern(PatternWalkingOnes, startSector, sectorCount, options)
 /// </summary>
-///
-/// <param name="startingOffset"> The starting offset in bytes. </param>
-/// <param name="length">The length of the string, in bytes. </param>
-std::string ufs::Buffer::GetString(size_t startingOffset, size_t length) const
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+/// <param name = "options">
+/// The word width of the pattern and the phase of each sector.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillWalkingOnes(size_t startSector, size_t sectorCount, const ufs::TestPatternOptions& options)
 {
-	// Validate once up front to avoid validating each byte access.
-	size_t newLength = ValidateByteRangeAndGetLength(startingOffset, length);
-
-	return std::string( (char*)(_dataStart + startingOffset), newLength);
+	return FillTestPattern(ufs::PatternWalkingOnes, startSector, sectorCount, options);
 }
 
 /// <summary>
-/// Copies the contents of the string value to the buffer, starting at
-/// the requested starting offset.
+/// Equivalent:  dmx.Buffer.FillWalkingZeros(0)
 /// </summary>
-///
-/// <param name="startingOffset"> The starting offset in bytes. </param>
-/// <param name="value"> The value to copy. </param>
-ufs::Buffer& ufs::Buffer::SetString(size_t startingOffset, const std::string& value)
+ufs::Buffer& ufs::Buffer::FillWalkingZeros()
 {
-	ValidateByteRangeAndGetLength(startingOffset, value.length());
-	::memcpy(_dataStart + startingOffset, value.c_str(), value.length());
-	return *this;
+	return FillWalkingZeros(0);
 }
 
-
 /// <summary>
-/// Equivalent:  dmx.Buffer.Fill(value, 0)
+/// Equivalent:  dmx.Buffer.FillWalkingZeros(startSector, 0)
 /// </summary>
-/// <param name = "value">
-/// The byte value to set every byte in the buffer to.
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::Fill(UInt8 value)
+ufs::Buffer& ufs::Buffer::FillWalkingZeros(size_t startSector)
 {
-	return Fill(value, 0);
+	return FillWalkingZeros(startSector, 0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.Fill(value, startSector, 0)
+/// Equivalent:  dmx.Buffer.FillWalkingZeros(startSector, sectorCount, TestPatternOptions())
 /// </summary>
-/// <param name = "value">
-/// The byte value to set the bytes in the buffer to.
-/// </param>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::Fill(UInt8 value, size_t startSector)
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillWalkingZeros(size_t startSector, size_t sectorCount)
 {
-	return Fill(value, startSector, 0);
+	return FillWalkingZeros(startSector, sectorCount, ufs::TestPatternOptions());
 }
 
-
 /// <summary>
-/// Sets the bytes in the buffer to the value passed in,
-/// starting at the sector specified by "startSector",
-/// for the number of sectors specified by "sectorCount".
+/// Equivalent:  dmx.Buffer.FillTestPattern(PatternWalkingZeros, startSector, sectorCount, options)
 /// </summary>
-/// <param name = "value">
-/// The byte value to set the bytes in the buffer to.
-/// </param>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
 /// <param name = "sectorCount">
-/// The number of sectors to fill with "value".
+/// The number of sectors to fill.
 /// </param>
-ufs::Buffer& ufs::Buffer::Fill(UInt8 value, size_t startSector, size_t sectorCount)
+/// <param name = "options">
+/// The word width of the pattern and the phase of each sector.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillWalkingZeros(size_t startSector, size_t sectorCount, const ufs::TestPatternOptions& options)
 {
-	size_t startByte = 0;
-	size_t endByte = 0;
-	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
-
-	::memset(_dataStart + startByte, value, endByte - startByte);
-	if (_usePatternMode)
-	{
-		FillCompressionInfo(eFixPattern, 1, startByte, endByte);
-	}
-	return *this;
+	return FillTestPattern(ufs::PatternWalkingZeros, startSector, sectorCount, options);
 }
 
-
-
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillOnes(0).
+/// Equivalent:  dmx.Buffer.FillCheckerboard(0)
 /// </summary>
-
-ufs::Buffer& ufs::Buffer::FillOnes()
+ufs::Buffer& ufs::Buffer::FillCheckerboard()
 {
-	return FillOnes(0);
+	return FillCheckerboard(0);
 }
 
-
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillOnes(startSector, 0).
+/// Equivalent:  dmx.Buffer.FillCheckerboard(startSector, 0)
 /// </summary>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillOnes(size_t startSector)
+ufs::Buffer& ufs::Buffer::FillCheckerboard(size_t startSector)
 {
-	return FillOnes(startSector, 0);
+	return FillCheckerboard(startSector, 0);
 }
 
 /// <summary>
-/// Sets the bytes in the buffer to 0xFF (every bit set to 1),
-/// starting at the sector specified by "startSector", for the number
-/// of sectors specified in "sectorCount".
+/// Equivalent:  dmx.Buffer.FillCheckerboard(startSector, sectorCount, TestPatternOptions())
 /// </summary>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
 /// <param name = "sectorCount">
-/// The number of sectors to fill with 0xFF.
+/// The number of sectors to fill.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillOnes(size_t startSector, size_t sectorCount)
+ufs::Buffer& ufs::Buffer::FillCheckerboard(size_t startSector, size_t sectorCount)
 {
-	return Fill(0xFF, startSector, sectorCount);
+	return FillCheckerboard(startSector, sectorCount, ufs::TestPatternOptions());
 }
 
-
-
-
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillTestPattern(PatternCheckerboard, startSector, sectorCount, options)
+/// </summary>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+/// <param name = "options">
+/// The word width of the pattern and the phase of each sector.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillCheckerboard(size_t startSector, size_t sectorCount, const ufs::TestPatternOptions& options)
+{
+	return FillTestPattern(ufs::PatternCheckerboard, startSector, sectorCount, options);
+}
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillAddressOverlay(0)
+/// Equivalent:  dmx.Buffer.FillInverseCheckerboard(0)
 /// </summary>
-ufs::Buffer& ufs::Buffer::FillAddressOverlay()
+ufs::Buffer& ufs::Buffer::FillInverseCheckerboard()
 {
-	return FillAddressOverlay(0);
+	return FillInverseCheckerboard(0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillAddressOverlay(startingValue, 0)
+/// Equivalent:  dmx.Buffer.FillInverseCheckerboard(startSector, 0)
 /// </summary>
-/// <param name="startingValue">
-/// The value to be used as the address for the first sector.
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillAddressOverlay(UInt64 startingValue)
+ufs::Buffer& ufs::Buffer::FillInverseCheckerboard(size_t startSector)
 {
-	return FillAddressOverlay(startingValue, 0);
+	return FillInverseCheckerboard(startSector, 0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillAddressOverlay(startingValue, startSector, 0)
+/// Equivalent:  dmx.Buffer.FillInverseCheckerboard(startSector, sectorCount, TestPatternOptions())
 /// </summary>
-/// <param name="startingValue">
-/// The value to be used as the address for the first sector.
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-/// <param name="startSector">
-/// The sector to start applying the address overlay at
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillAddressOverlay(UInt64 startingValue, size_t startSector)
+ufs::Buffer& ufs::Buffer::FillInverseCheckerboard(size_t startSector, size_t sectorCount)
 {
-	return FillAddressOverlay(startingValue, startSector, 0);
+	return FillInverseCheckerboard(startSector, sectorCount, ufs::TestPatternOptions());
 }
 
 /// <summary>
-/// Sets the first and last eight bytes (64 bits) of "sectorCount" sectors to an
-/// address value, starting at the sector specified by "startSector", with the
-/// value specified by "startingValue", and incrementing by one for each sector.
+/// Equivalent:  dmx.Buffer.FillTestPattern(PatternInverseCheckerboard, startSector, sectorCount, options)
 /// </summary>
-/// <param name="startingValue">
-/// The value to be used as the address for the first sector.
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-/// <param name="startSector">
-/// The sector to start applying the address overlay at.
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
 /// </param>
-/// <param name="sectorCount">
-/// The number of sectors to apply the address overlay to.
+/// <param name = "options">
+/// The word width of the pattern and the phase of each sector.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillAddressOverlay(UInt64 startingValue, size_t startSector, size_t sectorCount)
+ufs::Buffer& ufs::Buffer::FillInverseCheckerboard(size_t startSector, size_t sectorCount, const ufs::TestPatternOptions& options)
 {
-	sectorCount = ValidateSectorRangeAndGetSectorCount(startSector, sectorCount);
-
-	// Get number of 8 byte (64 bit) chucks per sector.
-	size_t jump = _bytesPerSector/8;
-
-	// 64 bit pointer to the data byte array. Indexing into
-	// this moves us 8 bytes at a time instead of 1.
-	UInt64* data64BitPtr = (UInt64*)_dataStart;
-
-	size_t start64bitOffset = startSector * jump;
-	size_t end64bitOffset = (startSector + sectorCount) * jump;
-
-	// HACK: In order to use OMP parallelization, we can't use an unsigned counter variable.
-	ValidateCounterMax(end64bitOffset);
-
-	bool runLoopInParallel = false; // Unused for now
-	if ((startSector < 100 && sectorCount >= 1000) || (startSector >= 100 && sectorCount >= 500))
-	{
-		runLoopInParallel = true;
-	}
-
-	#pragma omp parallel for if(runLoopInParallel) num_threads(NUM_OMP_THREADS)
-	for(Int64 i = (Int64)start64bitOffset; i < (Int64)end64bitOffset; i += jump)
-	{
-		// Calculate the value using existing variables instead of a ++
-		// so the OMP parallelization works better.
-		UInt64 value = startingValue + (i - start64bitOffset)/jump;
-		data64BitPtr[i] = value;
-		data64BitPtr[i + jump -1] = value;
-	}
-
-	return *this;
+	return FillTestPattern(ufs::PatternInverseCheckerboard, startSector, sectorCount, options);
 }
 
-
-
-
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillZeros(0)
+/// Equivalent:  dmx.Buffer.FillButterfly(0)
 /// </summary>
-ufs::Buffer& ufs::Buffer::FillZeros()
+ufs::Buffer& ufs::Buffer::FillButterfly()
 {
-	return FillZeros(0);
+	return FillButterfly(0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillZeros(startSector, 0)
+/// Equivalent:  dmx.Buffer.FillButterfly(startSector, 0)
 /// </summary>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillZeros(size_t startSector)
+ufs::Buffer& ufs::Buffer::FillButterfly(size_t startSector)
 {
-	return FillZeros(startSector, 0);
+	return FillButterfly(startSector, 0);
 }
 
 /// <summary>
-/// Sets the bytes in the buffer to 0x0 (every bit set to 0), starting at the
-/// sector specified by "startSector", for the number of sectors specified in
-/// "sectorCount".
+/// Equivalent:  dmx.Buffer.FillButterfly(startSector, sectorCount, TestPatternOptions())
 /// </summary>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
 /// <param name = "sectorCount">
-/// The number of sectors to fill with 0x0.
+/// The number of sectors to fill.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillZeros(size_t startSector, size_t sectorCount)
+ufs::Buffer& ufs::Buffer::FillButterfly(size_t startSector, size_t sectorCount)
 {
-	return Fill(0, startSector, sectorCount);
+	return FillButterfly(startSector, sectorCount, ufs::TestPatternOptions());
 }
 
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillTestPattern(PatternButterfly, startSector, sectorCount, options)
+/// </summary>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+/// <param name = "options">
+/// The word width of the pattern and the phase of each sector.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillButterfly(size_t startSector, size_t sectorCount, const ufs::TestPatternOptions& options)
+{
+	return FillTestPattern(ufs::PatternButterfly, startSector, sectorCount, options);
+}
 
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillGallopingOnes(0)
+/// </summary>
+ufs::Buffer& ufs::Buffer::FillGallopingOnes()
+{
+	return FillGallopingOnes(0);
+}
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillBytes(list, 0).
+/// Equivalent:  dmx.Buffer.FillGallopingOnes(startSector, 0)
 /// </summary>
-/// <param name = "list">
-/// The list of bytes to use as a pattern to fill the buffer with.
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillBytes(const std::vector<UInt8>& list)
+ufs::Buffer& ufs::Buffer::FillGallopingOnes(size_t startSector)
 {
-	return FillBytes(list, 0);
+	return FillGallopingOnes(startSector, 0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillBytes(list, startSector, 0).
+/// Equivalent:  dmx.Buffer.FillGallopingOnes(startSector, sectorCount, TestPatternOptions())
 /// </summary>
-/// <param name = "list">
-/// The list of bytes to use as a pattern to fill the buffer with.
-/// </param>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillBytes(const std::vector<UInt8>& list, size_t startSector)
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillGallopingOnes(size_t startSector, size_t sectorCount)
 {
-	return FillBytes(list, startSector, 0);
+	return FillGallopingOnes(startSector, sectorCount, ufs::TestPatternOptions());
 }
 
 /// <summary>
-/// Sets the bytes in the buffer to the pattern specified in "list",
-/// repeating the pattern to fill the buffer, starting at the sector specified
-/// by "startSector", for the number of sectors specified in "sectorCount".
+/// Equivalent:  dmx.Buffer.FillTestPattern(PatternGallopingOnes, startSector, sectorCount, options)
 /// </summary>
-/// <param name = "list">
-/// The list of bytes to use as a pattern to fill the buffer with.
-/// </param>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
 /// <param name = "sectorCount">
-/// The number of sectors to fill with the pattern.
+/// The number of sectors to fill.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillBytes(const std::vector<UInt8>& list, size_t startSector, size_t sectorCount)
+/// <param name = "options">
+/// The word width of the pattern and the phase of each sector.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillGallopingOnes(size_t startSector, size_t sectorCount, const ufs::TestPatternOptions& options)
 {
-	size_t byteCount = list.size();
-
-	if (byteCount != 0)
-	{
-		size_t startByte = 0;
-		size_t endByte = 0;
-		GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
-
-		size_t patternEnd = startByte + byteCount;
-
-		for (size_t i = startByte; i < std::min(patternEnd, endByte); i++)
-		{
-			GetDataStart()[i] = list[(i - startByte) % byteCount];
-		}
-
-		if (endByte > patternEnd)
-		{
-			FillPattern(startByte, byteCount, patternEnd, endByte);
-		}
-
-		if (_usePatternMode)
-		{
-			FillCompressionInfo(eFixPattern, static_cast<uint8_t>(byteCount), startByte, endByte);
-		}
-
-	}
-
-	return *this;
+	return FillTestPattern(ufs::PatternGallopingOnes, startSector, sectorCount, options);
 }
 
-
-
-
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillIncrementing(0)
+/// Equivalent:  dmx.Buffer.FillGallopingZeros(0)
 /// </summary>
-ufs::Buffer& ufs::Buffer::FillIncrementing()
+ufs::Buffer& ufs::Buffer::FillGallopingZeros()
 {
-	return FillIncrementing(0);
+	return FillGallopingZeros(0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillIncrementing(startValue, 0)
+/// Equivalent:  dmx.Buffer.FillGallopingZeros(startSector, 0)
 /// </summary>
-/// <param name="startingValue">
-/// The byte value to start the pattern with.
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-ufs::Buffer&ufs:: Buffer::FillIncrementing(UInt8 startingValue)
+ufs::Buffer& ufs::Buffer::FillGallopingZeros(size_t startSector)
 {
-	return FillIncrementing(startingValue, 0);
+	return FillGallopingZeros(startSector, 0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillIncrementing(startValue, startSector, 0)
+/// Equivalent:  dmx.Buffer.FillGallopingZeros(startSector, sectorCount, TestPatternOptions())
 /// </summary>
-/// <param name="startingValue">
-/// The byte value to start the pattern with.
-/// </param>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillIncrementing(UInt8 startingValue, size_t startSector)
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillGallopingZeros(size_t startSector, size_t sectorCount)
 {
-	return FillIncrementing(startingValue, startSector, 0);
+	return FillGallopingZeros(startSector, sectorCount, ufs::TestPatternOptions());
 }
 
 /// <summary>
-/// Sets the bytes in the buffer to a sector size boundary, incrementing pattern
-/// (0 - 255), starting with "startingValue", starting at the sector specified
-/// by "startSector", for the number of sectors specified in "sectorCount".
+/// Equivalent:  dmx.Buffer.FillTestPattern(PatternGallopingZeros, startSector, sectorCount, options)
 /// </summary>
-/// <param name="startingValue">
-/// The byte value to start the pattern with.
-/// </param>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
 /// <param name = "sectorCount">
-/// The number of sectors to fill with the pattern.
+/// The number of sectors to fill.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillIncrementing(UInt8 startingValue, size_t startSector, size_t sectorCount)
+/// <param name = "options">
+/// The word width of the pattern and the phase of each sector.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillGallopingZeros(size_t startSector, size_t sectorCount, const ufs::TestPatternOptions& options)
 {
-	size_t startByte = 0;
-	size_t endByte = 0;
-	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
-
-	for (size_t i = startByte; i < startByte + GetBytesPerSector(); i++)
-	{
-		_dataStart[i] = startingValue++;
-	}
-
-	if (endByte > startByte + GetBytesPerSector())
-	{
-		FillPattern(startByte, GetBytesPerSector(), startByte + GetBytesPerSector(), endByte);
-	}
-
-	if (_usePatternMode)
-	{
-		FillCompressionInfo(eIncrementingPattern, 1, startByte, endByte);
-	}
-
-	return *this;
+	return FillTestPattern(ufs::PatternGallopingZeros, startSector, sectorCount, options);
 }
 
-
-
-
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillDecrementing(255)
+/// Equivalent:  dmx.Buffer.FillMarchingOnes(0)
 /// </summary>
-ufs::Buffer& ufs::Buffer::FillDecrementing()
+ufs::Buffer& ufs::Buffer::FillMarchingOnes()
 {
-	return FillDecrementing(255);
+	return FillMarchingOnes(0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillDecrementing(startingValue, 0)
+/// Equivalent:  dmx.Buffer.FillMarchingOnes(startSector, 0)
 /// </summary>
-/// <param name="startingValue">
-/// The byte value to start the pattern with.
+/// <param name = "startSector">
+/// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillDecrementing(UInt8 startingValue)
+ufs::Buffer& ufs::Buffer::FillMarchingOnes(size_t startSector)
 {
-	return FillDecrementing(startingValue, 0);
+	return FillMarchingOnes(startSector, 0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillDecrementing(startingValue, startSector, 0)
+/// Equivalent:  dmx.Buffer.FillMarchingOnes(startSector, sectorCount, TestPatternOptions())
 /// </summary>
-/// <param name="startingValue">
-/// The byte value to start the pattern with.
-/// </param>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillDecrementing(UInt8 startingValue, size_t startSector)
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillMarchingOnes(size_t startSector, size_t sectorCount)
 {
-	return FillDecrementing(startingValue, startSector, 0);
+	return FillMarchingOnes(startSector, sectorCount, ufs::TestPatternOptions());
 }
 
 /// <summary>
-/// Sets the bytes in the buffer to a sector size boundary, decrementing pattern
-/// (255 - 0), starting with "startingValue", starting at the sector specified
-/// by "startSector", for the number of sectors specified in "sectorCount".
+/// Equivalent:  dmx.Buffer.FillTestPattern(PatternMarchingOnes, startSector, sectorCount, options)
 /// </summary>
-/// <param name="startingValue">
-/// The byte value to start the pattern with.
-/// </param>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
 /// <param name = "sectorCount">
-/// The number of sectors to fill with the pattern.  If sectorCount is zero,
-/// fill all sectors.
+/// The number of sectors to fill.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillDecrementing(UInt8 startingValue, size_t startSector, size_t sectorCount)
+/// <param name = "options">
+/// The word width of the pattern and the phase of each sector.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillMarchingOnes(size_t startSector, size_t sectorCount, const ufs::TestPatternOptions& options)
 {
-	size_t startByte = 0;
-	size_t endByte = 0;
-	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
-
-	for (size_t i = startByte; i < startByte + GetBytesPerSector(); i++)
-	{
-		_dataStart[i] = startingValue--;
-	}
-
-	if (endByte > startByte + GetBytesPerSector())
-	{
-		FillPattern(startByte, GetBytesPerSector(), startByte + GetBytesPerSector(), endByte);
-	}
-
-	if (_usePatternMode)
-	{
-		FillCompressionInfo(eDecrementingPattern, 1, startByte, endByte);
-	}
-
-	return *this;
+	return FillTestPattern(ufs::PatternMarchingOnes, startSector, sectorCount, options);
 }
 
-
-
-
 /// <summary>
-///  Equivalent:  dmx.Buffer.FillRandom(0)
+/// Equivalent:  dmx.Buffer.FillMarchingZeros(0)
 /// </summary>
-ufs::Buffer& ufs::Buffer::FillRandom()
+ufs::Buffer& ufs::Buffer::FillMarchingZeros()
 {
-	return ufs::Buffer::FillRandom(0);
+	return FillMarchingZeros(0);
 }
 
 /// <summary>
-///  Equivalent:  dmx.Buffer.FillRandom(startSector, 0)
+/// Equivalent:  dmx.Buffer.FillMarchingZeros(startSector, 0)
 /// </summary>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer:: FillRandom(size_t startSector)
+ufs::Buffer& ufs::Buffer::FillMarchingZeros(size_t startSector)
 {
-	return ufs::Buffer::FillRandom(startSector, 0);
+	return FillMarchingZeros(startSector, 0);
 }
 
 /// <summary>
-/// Sets the bytes in the buffer to a pseudo-random sequence of values between
-/// 0 - 255, starting at the sector specified by "startSector", for the number
-/// of sectors specified in "sectorCount". Sequence is  seeded by time and
-/// thread id.
+/// Equivalent:  dmx.Buffer.FillMarchingZeros(startSector, sectorCount, TestPatternOptions())
 /// </summary>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
 /// <param name = "sectorCount">
-/// The number of sectors to fill with the pattern.
+/// The number of sectors to fill.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillRandom(size_t startSector, size_t sectorCount)
+ufs::Buffer& ufs::Buffer::FillMarchingZeros(size_t startSector, size_t sectorCount)
 {
-	return ufs::Buffer::FillRandomImpl(startSector, sectorCount, false);
+	return FillMarchingZeros(startSector, sectorCount, ufs::TestPatternOptions());
 }
 
-
+/// <summary>
+/// Equivalent:  dmx.Buffer.FillTestPattern(PatternMarchingZeros, startSector, sectorCount, options)
+/// </summary>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+/// <param name = "options">
+/// The word width of the pattern and the phase of each sector.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillMarchingZeros(size_t startSector, size_t sectorCount, const ufs::TestPatternOptions& options)
+{
+	return FillTestPattern(ufs::PatternMarchingZeros, startSector, sectorCount, options);
+}
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillRandomSeeded(seed, 0)
+/// Equivalent:  dmx.Buffer.FillPrbs(order, seed, 0)
 /// </summary>
+/// <param name = "order">
+/// The sequence to fill with.
+/// </param>
 /// <param name = "seed">
-/// The value to seed the random number generation with.
+/// The starting shift register of the sequence.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillRandomSeeded(UInt32 seed)
+ufs::Buffer& ufs::Buffer::FillPrbs(ufs::PrbsOrder order, UInt32 seed)
 {
-	return ufs::Buffer::FillRandomSeeded(seed, 0);
+	return FillPrbs(order, seed, 0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillRandomSeeded(seed, startSector, 0)
+/// Equivalent:  dmx.Buffer.FillPrbs(order, seed, startSector, 0)
 /// </summary>
+/// <param name = "order">
+/// The sequence to fill with.
+/// </param>
 /// <param name = "seed">
-/// The value to seed the random number generation with.
+/// The starting shift register of the sequence.
 /// </param>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillRandomSeeded(UInt32 seed, size_t startSector)
+ufs::Buffer& ufs::Buffer::FillPrbs(ufs::PrbsOrder order, UInt32 seed, size_t startSector)
 {
-	return ufs::Buffer::FillRandomSeeded(seed, startSector, 0);
+	return FillPrbs(order, seed, startSector, 0);
 }
 
 /// <summary>
-/// Sets the bytes in the buffer to a pseudo-random sequence of values between
-/// 0 - 255, starting at the sector specified by "startSector", for the number
-/// of sectors specified in "sectorCount". Sequence is  seeded by the value
-/// specified in "seed". Calling this method twice with the same "seed" value
-/// will produce the same pseudo-random sequence of values.
+/// Fills "sectorCount" sectors, starting at "startSector", with a
+/// pseudo-random binary sequence started from "seed". The sequence runs on
+/// across sector boundaries.
 /// </summary>
+/// <param name = "order">
+/// The sequence to fill with.
+/// </param>
 /// <param name = "seed">
-/// The value to seed the random number generation with.
+/// The starting shift register of the sequence.
 /// </param>
 /// <param name = "startSector">
 /// The sector to start filling from.
 /// </param>
 /// <param name = "sectorCount">
-/// The number of sectors to fill with the pattern.
+/// The number of sectors to fill.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillRandomSeeded(UInt32 seed, size_t startSector, size_t sectorCount)
+ufs::Buffer& ufs::Buffer::FillPrbs(ufs::PrbsOrder order, UInt32 seed, size_t startSector, size_t sectorCount)
 {
-	return ufs::Buffer::FillRandomImpl(startSector, sectorCount, true, seed);
+	ufs::PrbsGenerator generator(order, seed);
+	return FillPrbs(generator, startSector, sectorCount);
 }
 
+/// <summary>
+/// Fills "sectorCount" sectors, starting at "startSector", with the next
+/// bytes of "generator"'s sequence, and advances the generator past them.
+/// Consecutive fills from one generator continue one sequence.
+/// </summary>
+/// <param name = "generator">
+/// The sequence to continue.
+/// </param>
+/// <param name = "startSector">
+/// The sector to start filling from.
+/// </param>
+/// <param name = "sectorCount">
+/// The number of sectors to fill.
+/// </param>
+ufs::Buffer& ufs::Buffer::FillPrbs(ufs::PrbsGenerator& generator, size_t startSector, size_t sectorCount)
+{
+	size_t startByte = 0;
+	size_t endByte = 0;
+	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+	MarkModified();
+
+	// Each piece jumps its own copy of the generator to its first bit.
+	size_t length = endByte - startByte;
+	size_t blockLength = std::max<size_t>(STAGING_BYTES / _bytesPerSector, 1) * _bytesPerSector;
+	bool stream = UseStreamingStores(length);
+	SectorStamp stamp = { GetFusedOverlay(), _bytesPerSector, startSector };
+	size_t alignment = stamp.IsActive() ? std::lcm<size_t>(64, _bytesPerSector) : 64;
+	ufs::WorkerPool::GetInstance().ParallelForBytes(length, alignment, [&](size_t begin, size_t end)
+	{
+		ufs::PrbsGenerator piece(generator);
+		piece.Skip(static_cast<UInt64>(begin) * 8);
+		SectorStamp pieceStamp = { stamp.overlay, _bytesPerSector, startSector + begin / _bytesPerSector };
+		WriteGenerated(_dataStart + startByte + begin, end - begin, blockLength, [&piece](UInt8* data, size_t count)
+		{
+			piece.Fill(data, count);
+		}, pieceStamp, stream);
+	});
+	generator.Skip(static_cast<UInt64>(length) * 8);
 
+	ApplyPatternModeOverlay(startByte, endByte);
+	return *this;
+}
 
+/// <summary>
+/// Equivalent:  dmx.Buffer.VerifyPrbs(order, 0)
+/// </summary>
+/// <param name = "order">
+/// The sequence expected.
+/// </param>
+ufs::PrbsChecker ufs::Buffer::VerifyPrbs(ufs::PrbsOrder order) const
+{
+	return VerifyPrbs(order, 0);
+}
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillRandomSeededBySector(seed, 0)
+/// Equivalent:  dmx.Buffer.VerifyPrbs(order, startSector, 0)
 /// </summary>
-/// <param name = "seed">
-/// The value to seed the random number generation with for the first sector.
+/// <param name = "order">
+/// The sequence expected.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillRandomSeededBySector(UInt32 seed)
+/// <param name = "startSector">
+/// The sector to start checking from.
+/// </param>
+ufs::PrbsChecker ufs::Buffer::VerifyPrbs(ufs::PrbsOrder order, size_t startSector) const
 {
-	return ufs::Buffer::FillRandomSeededBySector(seed, 0);
+	return VerifyPrbs(order, startSector, 0);
 }
 
 /// <summary>
-/// Equivalent:  dmx.Buffer.FillRandomSeededBySector(seed, startSector, 0)
+/// Checks "sectorCount" sectors, starting at "startSector", against a
+/// pseudo-random binary sequence of "order". The checker locks on to the
+/// first bits of the range, so the seed need not be known, and returns the
+/// bit errors and sync losses it found.
 /// </summary>
-/// <param name = "seed">
-/// The value to seed the random number generation with for the first sector.
+/// <param name = "order">
+/// The sequence expected.
 /// </param>
 /// <param name = "startSector">
-/// The sector to start filling from.
+/// The sector to start checking from.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillRandomSeededBySector(UInt32 seed, size_t startSector)
+/// <param name = "sectorCount">
+/// The number of sectors to check.
+/// </param>
+ufs::PrbsChecker ufs::Buffer::VerifyPrbs(ufs::PrbsOrder order, size_t startSector, size_t sectorCount) const
 {
-	return ufs::Buffer::FillRandomSeededBySector(seed, startSector, 0);
+	ufs::PrbsChecker checker(order);
+	VerifyPrbs(checker, startSector, sectorCount);
+	return checker;
 }
 
 /// <summary>
-/// Sets the bytes in the buffer to a set of pseudo-random sequences of values
-/// between 0 - 255. Each sector is filled with a different sequence by seeding
-/// a random number generator with a different number for each sector. The
-/// first sector is seeded by the value specified in "seed". The seed value is
-/// incremented by one for each subsequent sector. Calling this method twice
-/// with the same "seed" value will produce the same set of pseudo-random
-/// sequences of values.
+/// Checks "sectorCount" sectors, starting at "startSector", with "checker",
+/// continuing from the data it has already checked.
 /// </summary>
-/// <param name = "seed">
-/// The value to seed the random number generation with for the first sector.
+/// <param name = "checker">
+/// The checker to continue.
 /// </param>
 /// <param name = "startSector">
-/// The sector to start filling from.
+/// The sector to start checking from.
 /// </param>
 /// <param name = "sectorCount">
-/// The number of sectors to fill.
+/// The number of sectors to check.
 /// </param>
-ufs::Buffer& ufs::Buffer::FillRandomSeededBySector(UInt32 seed, size_t startSector, size_t sectorCount)
+ufs::PrbsChecker& ufs::Buffer::VerifyPrbs(ufs::PrbsChecker& checker, size_t startSector, size_t sectorCount) const
+{
+	size_t startByte = 0;
+	size_t endByte = 0;
+	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+	checker.Check(_dataStart + startByte, endByte - startByte);
+	return checker;
+}
+
+ufs::Buffer& ufs::Buffer::FillRandomImpl(size_t startSector, size_t sectorCount, bool useSeed, UInt32 seed, RandomEngine engine)
 {
 	if(GetBytesPerSector() % 4 != 0)
 	{
-		throw ufs::RuntimeError("Filling random data is not supported for sector sizes that are not a mupltiple of 4.");
+		throw ufs::RuntimeError("Filling random data is not supported for sector sizes that are not a multiple of 4.");
 	}
 
-	sectorCount = ValidateSectorRangeAndGetSectorCount(startSector, sectorCount);
-
-	// HACK: In order to use OMP parallelization, we can't use an unsigned counter variable.
-	ValidateCounterMax(startSector + sectorCount);
-
-	// This cannot be a reference and be used in an OMP loop.
-	ufs::Random32 random = *GetRandom(true, seed);
-
-	// HACK: In order to use OMP parallelization, we can't use an unsigned counter variable.
-	ValidateCounterMax(startSector + sectorCount);
-
-	#pragma omp parallel for private (random) num_threads(NUM_OMP_THREADS)
-	for(Int64 i = (Int64)startSector; i < (Int64)(startSector + sectorCount); i++)
+	ufs::Random32& r = *(GetRandom(useSeed, seed));
+	if (engine == RandomCompatible || _usePatternMode)
 	{
-		random.Seed((UInt32)(seed + i - startSector));
-		ufs::Buffer::FillSectorsWithRandomData(random, (size_t)i, 1);
+		FillSectorsWithRandomData(r, startSector, sectorCount);
+		return *this;
 	}
 
+	// Unseeded fills draw the seed from the buffer's generator, so each one differs.
+	UInt64 fastSeed = useSeed ? seed : (static_cast<UInt64>(r.Next()) << 32) | r.Next();
+	ufs::kernels::XoshiroState state;
+	ufs::kernels::SeedXoshiro(state, fastSeed);
+	FillSectorsWithFastRandomData(state, startSector, sectorCount);
 	return *this;
 }
 
-ufs::Buffer& ufs::Buffer::FillRandomImpl(size_t startSector, size_t sectorCount, bool useSeed, UInt32 seed)
+void ufs::Buffer::FillSectorsWithFastRandomData(ufs::kernels::XoshiroState& state, size_t startSector, size_t sectorCount)
 {
-	if(GetBytesPerSector() % 4 != 0)
-	{
-		throw ufs::RuntimeError("Filling random data is not supported for sector sizes that are not a multiple of 4.");
-	}
+	size_t startByte = 0;
+	size_t endByte = 0;
+	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+	MarkModified();
 
-	ufs::Random32& r = *(GetRandom(useSeed, seed));
-	FillSectorsWithRandomData(r, startSector, sectorCount);
-	return *this;
+	// Blocks are whole rounds of the generators (32 bytes) and whole sectors.
+	size_t round = std::lcm<size_t>(32, _bytesPerSector);
+	size_t blockLength = std::max<size_t>(STAGING_BYTES / round, 1) * round;
+	SectorStamp stamp = { GetFusedOverlay(), _bytesPerSector, startSector };
+	WriteGenerated(_dataStart + startByte, endByte - startByte, blockLength, [&state](UInt8* data, size_t length)
+	{
+		ufs::kernels::FillXoshiro(reinterpret_cast<UInt32*>(data), length / 4, state);
+	}, stamp, UseStreamingStores(endByte - startByte));
 }
 
 void ufs::Buffer::FillSectorsWithRandomData(ufs::Random32& random, size_t startSector, size_t sectorCount)
@@ -1783,42 +4197,45 @@ void ufs::Buffer::FillSectorsWithRandomData(ufs::Random32& random, size_t startS
 	size_t startByte = 0;
 	size_t endByte = 0;
 	GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+	MarkModified();
 
-	UInt8 genBuffer[COMPRESSION_PATTERN_SIZE_IN_BYTE];
-	size_t sectorByteIndex;
+	UInt32 state[3];
+	random.GetState(state);
+	UInt32 * int32Ptr = (UInt32*)(_dataStart + startByte);
 
-	UInt32 * int32Ptr = (UInt32*)_dataStart;
-
-	// OMP loop won't work here.
-	for(size_t i = startByte/4; i < endByte/4; i++)
+	if (!_usePatternMode)
 	{
-		if (_usePatternMode)
+		size_t blockLength = std::max<size_t>(STAGING_BYTES / _bytesPerSector, 1) * _bytesPerSector;
+		SectorStamp stamp = { GetFusedOverlay(), _bytesPerSector, startSector };
+		WriteGenerated(_dataStart + startByte, endByte - startByte, blockLength, [&state](UInt8* data, size_t length)
 		{
-			/// Embed random data generator(size==12bytes) into buffer from 9th byte to 20th byte
-			/// in every sector. With the generator, we can recover every random data.
-			/// confluence page: https://confluence.micron.com/confluence/display/FE/Simulator+compression+mode
-			sectorByteIndex = i % (_bytesPerSector / 4);
-			if (sectorByteIndex == 0)
-			{
-						// Save the generator state (only copy what fits in buffer)
-		const size_t copySize = std::min(sizeof(boost::random::taus88), static_cast<size_t>(COMPRESSION_PATTERN_SIZE_IN_BYTE));
-		memcpy(genBuffer, &random.GetGen(), copySize);
-			}
-			else if (sectorByteIndex == 6)
-			{
-						// Overlap generator state in sector
-		const size_t copySize = std::min(static_cast<size_t>(COMPRESSION_PATTERN_SIZE_IN_BYTE), sizeof(UInt32) * 4);
-		memcpy(&int32Ptr[i - 4], genBuffer, copySize);
-			}
-		}
-
-		int32Ptr[i] = random.Next();
+			ufs::kernels::FillTaus88(reinterpret_cast<UInt32*>(data), length / 4, state);
+		}, stamp, UseStreamingStores(endByte - startByte));
+		random.SetState(state);
+		return;
 	}
 
-	if (_usePatternMode)
+	/// Embed random data generator(size==12bytes) into buffer from 9th byte to 20th byte
+	/// in every sector. With the generator, we can recover every random data.
+	/// confluence page: https://confluence.micron.com/confluence/display/FE/Simulator+compression+mode
+	const size_t wordsPerSector = _bytesPerSector / 4;
+	for (size_t sector = startByte / _bytesPerSector; sector < endByte / _bytesPerSector; sector++)
 	{
-		FillCompressionInfo(eRandomPattern, 0, startByte, endByte);
+		UInt32 sectorState[3] = { state[0], state[1], state[2] };
+		ufs::kernels::FillTaus88(int32Ptr, wordsPerSector, state);
+
+		// The generator state at the start of the sector overlays words 2-4,
+		// once the sector is long enough to reach word 6.
+		if (wordsPerSector > 6)
+		{
+			memcpy(&int32Ptr[2], sectorState, sizeof(sectorState));
+		}
+		int32Ptr += wordsPerSector;
 	}
+	random.SetState(state);
+
+	FillCompressionInfo(eRandomPattern, 0, startByte, endByte);
+	ApplyPatternModeOverlay(startByte, endByte);
 }
 
 
@@ -1891,30 +4308,6 @@ std::string ufs::Buffer::ToString(size_t startSector, size_t sectorCount, ufs::B
 
 
 
-void ufs::Buffer::FillPattern(size_t patterStart, size_t patternLen, size_t startByte, size_t endByte)
-{
-	// Loop, doubling the data we copy each time up to 4096 bytes at a time.
-	// Big memcpy's are actually slower.
-	while(startByte < endByte)
-	{
-		size_t lenToEndByte = endByte - startByte;
-		// Make sure we don't copy past the end byte.
-		size_t copyLen = std::min(patternLen, lenToEndByte);
-		::memcpy(_dataStart + startByte, _dataStart + patterStart, copyLen);
-		startByte += copyLen;
-		patternLen = patternLen >= 4096 ? patternLen : patternLen * 2;
-	}
-}
-
-void ufs::Buffer::ValidateCounterMax(size_t maxValue)
-{
-	// HACK: In order to use OMP parallelization, we can't use an unsigned counter variable.
-	if(maxValue > LLONG_MAX)
-	{
-		throw ufs::OutOfRangeError("Cannot handle 8 Exabytes of data because OMP loop counter must be signed");
-	}
-}
-
 ufs::Buffer& ufs::Buffer::CopyTo(Buffer& destinationBuffer) {
     return CopyTo(destinationBuffer, 0, 0, 0);
 }
@@ -1932,7 +4325,8 @@ ufs::Buffer& ufs::Buffer::CopyTo(Buffer& destinationBuffer, size_t startSector,
     GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
     size_t destStartByte = destStartSector * GetBytesPerSector();
     size_t bytesToCopy = endByte - startByte;
-    std::copy(_dataStart + startByte, _dataStart + startByte + bytesToCopy, destinationBuffer._dataStart + destStartByte);
+    destinationBuffer.MarkModified();
+    CopyBytes(destinationBuffer._dataStart + destStartByte, _dataStart + startByte, bytesToCopy);
     return destinationBuffer;
 }
 
@@ -1953,40 +4347,147 @@ ufs::Buffer& ufs::Buffer::CopyFrom(const Buffer& sourceBuffer, size_t startSecto
     sourceBuffer.GetStartAndStopBytesFromSectors(srcStartSector, sectorCount, srcStartByte, srcEndByte);
     size_t destStartByte = startSector * GetBytesPerSector();
     size_t bytesToCopy = srcEndByte - srcStartByte;
-    std::copy(sourceBuffer._dataStart + srcStartByte, sourceBuffer._dataStart + srcStartByte + bytesToCopy, _dataStart + destStartByte);
+    MarkModified();
+    CopyBytes(_dataStart + destStartByte, sourceBuffer._dataStart + srcStartByte, bytesToCopy);
     return *this;
 }
 
+/// <summary>
+/// Returns a view of the whole buffer. See BufferView.
+/// </summary>
+ufs::BufferView ufs::Buffer::GetView() {
+    return GetView(0);
+}
+
+/// <summary>
+/// Returns a view from "startSector" to the end of the buffer.
+/// </summary>
+ufs::BufferView ufs::Buffer::GetView(size_t startSector) {
+    return GetView(startSector, 0);
+}
+
+/// <summary>
+/// Returns a view of "sectorCount" sectors starting at "startSector", without
+/// copying any data. A sectorCount of 0 views up to the end of the buffer.
+/// </summary>
+ufs::BufferView ufs::Buffer::GetView(size_t startSector, size_t sectorCount) {
+    size_t startByte = 0, endByte = 0;
+    GetStartAndStopBytesFromSectors(startSector, sectorCount, startByte, endByte);
+    return ufs::BufferView(*this, startByte, endByte - startByte);
+}
+
+/// <summary>
+/// Returns a view of "length" bytes starting at byte "startingOffset",
+/// without copying any data. A length of 0 views up to the end of the buffer.
+/// </summary>
+ufs::BufferView ufs::Buffer::GetByteView(size_t startingOffset, size_t length) {
+    return ufs::BufferView(*this, startingOffset, length);
+}
+
 ufs::Buffer& ufs::Buffer::Resize(size_t sectorCount) {
     return Resize(sectorCount, GetBytesPerSector());
 }
 
+/// <summary>
+/// Changes the size of the buffer, keeping the data up to the smaller of the
+/// old and new sizes. Bytes past the old size read as zero. The current
+/// allocation is reused when the new size fits in it, plain mapped
+/// allocations are grown with mremap, and only otherwise is the data copied
+/// to a new allocation, huge page backed and NUMA placed like the old one.
+/// When that allocation fails, or the sector overlay does not fit in the new
+/// sector size, the buffer is left unchanged.
+/// </summary>
 ufs::Buffer& ufs::Buffer::Resize(size_t sectorCount, size_t bytesPerSector) {
-    // Save current data if we're expanding
+    if (sectorCount < 1) {
+        throw ufs::ArgumentError("sectorCount must be greater than zero.");
+    }
+
+    if (bytesPerSector < 1) {
+        throw ufs::ArgumentError("bytesPerSector must be greater than zero.");
+    }
+
+    // The overlay fields were checked against the old sector size.
+    if (_overlay) {
+        _overlay->Validate(bytesPerSector);
+    }
+
     size_t oldTotalBytes = GetTotalBytes();
     size_t newTotalBytes = sectorCount * bytesPerSector;
     size_t bytesToPreserve = std::min(oldTotalBytes, newTotalBytes);
-    
-    std::vector<UInt8> oldData;
-    if (bytesToPreserve > 0) {
-        oldData.resize(bytesToPreserve);
-        std::copy(_dataStart, _dataStart + bytesToPreserve, oldData.begin());
+
+    ufs::PageBlock oldBlock = { _data, _allocatedByteCount, _backing };
+    bool oldIsPooled = _isPooled;
+    UInt8* oldDataStart = _dataStart;
+
+    // Bytes available from the data start to the end of the current block.
+    size_t capacity = static_cast<size_t>((_data + _allocatedByteCount) - _dataStart);
+
+    // The sizes a new block would need. Nothing is changed until the block
+    // is in hand, so a failed grow leaves the buffer as it was.
+    size_t dataBufferSize = 0;
+    size_t requiredByteCount = 0;
+    CalculateAllocationSizes(newTotalBytes, dataBufferSize, requiredByteCount);
+
+    // Only bytes past the old end that were already part of the block may
+    // hold stale data. Fresh pages from the allocator are zero.
+    size_t staleEnd = std::min(newTotalBytes, capacity);
+
+    // Growing by remapping keeps neither the huge page alignment of the block
+    // nor the NUMA policy of its new pages, so only plain local mappings are
+    // grown that way.
+    bool canRemap = !_isPooled && _backing == ufs::MappedBacking && _numaPlacement.policy == ufs::NumaLocal
+        && _layout.alignment <= ufs::PageAllocator::GetPageSize();
+
+    // A read-only mapping can not hold the new tail, so it is always
+    // detached into an ordinary buffer.
+    if (dataBufferSize <= capacity && !IsReadOnly()) {
+        // Fits in the current block. Give the tail of a mostly unused mapping
+        // back to the system, remapping a shrinking block never moves it.
+        if (!_isPooled && requiredByteCount <= oldBlock.length / 2) {
+            ufs::PageBlock block = oldBlock;
+            if (ufs::PageAllocator::Reallocate(block, requiredByteCount)) {
+                _allocatedByteCount = block.length;
+            }
+        }
+        _dataBufferSize = dataBufferSize;
+    } else if (canRemap && ufs::PageAllocator::Reallocate(oldBlock, requiredByteCount)) {
+        // The kernel moved the mapping if needed, without copying the data.
+        // Mappings are page aligned so the data start offset stays aligned.
+        _dataStart = oldBlock.address + (_dataStart - _data);
+        _data = oldBlock.address;
+        _allocatedByteCount = oldBlock.length;
+        _dataBufferSize = dataBufferSize;
+    } else {
+        bool isPooled = false;
+        ufs::PageBlock block = AllocateBlock(requiredByteCount, isPooled);
+        _dataBufferSize = dataBufferSize;
+        SetDataBlock(block, isPooled);
+        staleEnd = 0;
+
+        // Untouched zero pages need no preserving, the new block is zero too.
+        if (!_isKnownZero) {
+            CopyBytes(_dataStart, oldDataStart, bytesToPreserve);
+        }
+
+        ReleaseBlock(oldBlock, oldIsPooled);
+    }
+
+    // Zero only the newly exposed tail.
+    if (!_isKnownZero && staleEnd > oldTotalBytes) {
+        ::memset(_dataStart + oldTotalBytes, 0, staleEnd - oldTotalBytes);
     }
-    
-    // Clean up old memory
-    delete [] _data;
+
+    // The block no longer matches its snapshot once the tail is exposed or
+    // zeroed in place, or the mapping has moved.
+    _isSnapshotCurrent = false;
+
+    _sectorCount = sectorCount;
+    _bytesPerSector = bytesPerSector;
+
     if (_random) {
         delete _random;
         _random = 0;
     }
-    
-    // Initialize with new size
-    Initialize(sectorCount, bytesPerSector);
-    
-    // Restore data if we had any
-    if (bytesToPreserve > 0) {
-        std::copy(oldData.begin(), oldData.end(), _dataStart);
-    }
-    
+
     return *this;
 }
@@ -17,13 +17,24 @@
 #include "Printable.h"
 #include "TypeDefs.h"
 #include "Utils.h"
+#include "BitErrorStats.h"
 #include "CompareResult.h"
+#include "PageAllocator.h"
+#include "BufferLayout.h"
+#include "BufferPool.h"
+#include "Numa.h"
+#include "Prbs.h"
+#include "SectorOverlay.h"
+#include "TestPatterns.h"
 
 #include <boost/thread/mutex.hpp>
 
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <string>
+#include <utility>
 
 #define COMPRESSION_SIZE_PER_SECTOR 21
 #define COMPRESSION_PATTERN_SIZE_IN_BYTE 12
@@ -64,8 +75,36 @@ namespace ufs
 		DWord = 8
 	};
 
+	/// <summary>
+	/// Where FillBytes starts its list. PatternContinuous runs the list on
+	/// across sectors from the start of the fill, PatternPerSector starts it
+	/// again at the first byte of every sector.
+	/// </summary>
+	enum PatternPhase
+	{
+		PatternContinuous,
+		PatternPerSector
+	};
+
 	const size_t DEFAULT_BYTES_PER_SECTOR = 512;
 
+	/// <summary>
+	/// Releases externally owned memory adopted by a Buffer, given the memory
+	/// and length passed when it was adopted. An empty deleter leaves the
+	/// memory with the caller.
+	/// </summary>
+	typedef std::function<void(UInt8* memory, size_t length)> ExternalDeleter;
+
+	/// <summary>
+	/// How Buffer::MapFile maps a file. A MapReadOnly buffer can be read,
+	/// compared and copied from, and throws RuntimeError on any write.
+	/// </summary>
+	enum MapAccess
+	{
+		MapReadWrite,
+		MapReadOnly
+	};
+
 	// Default sector count is the max value for the Count of sectors for the ATA commands. 0x10000 is the actual sector count
 	// when zero is passed in for sector count for a 48-bit command like WriteDmaExt.
 	const size_t DEFAULT_SECTOR_COUNT = 0x10000;
@@ -73,6 +112,13 @@ namespace ufs
 	class CompareResult;
 	class Messenger;
 	class Buffer;
+	class BufferView;
+	class PatternBuffer;
+
+	namespace kernels
+	{
+		struct XoshiroState;
+	}
 
 	/// <summary>
 	/// Provides a block of memory stored internally as an array of bytes. The
@@ -114,11 +160,14 @@ namespace ufs
 	/// </summary>
 	class Buffer : public Printable
 	{
-	private: //Member variables
-		//not implemented /////////////////////////////////////
-		Buffer& operator=(const Buffer&); // not implemented //
-		//not implemented /////////////////////////////////////
+		// Views read and write the data directly and mark it modified.
+		friend class BufferView;
 
+		// Pattern buffers fill a range with their own overlay in place of
+		// the buffer's.
+		friend class PatternBuffer;
+
+	private: //Member variables
 		std::string _name;
 		UInt8* _data;
 		UInt8* _dataStart;
@@ -128,6 +177,29 @@ namespace ufs
 		size_t _allocatedByteCount;
 		size_t _dataBufferSize;
 		bool _usePatternMode;
+		ufs::AllocationMode _allocationMode;
+		ufs::PageBacking _backing;
+		bool _isPooled;
+		ufs::NumaPlacement _numaPlacement;
+		ufs::BufferLayout _layout;
+
+		// Set while the data block is a copy-on-write view of a snapshot.
+		std::shared_ptr<ufs::PageSnapshot> _snapshot;
+
+		// Releases the data block when it is adopted external memory.
+		ufs::ExternalDeleter _deleter;
+
+		// Stamped into every sector the fills write, see SetSectorOverlay.
+		std::shared_ptr<const ufs::SectorOverlay> _overlay;
+
+		// True while the data is known to still be the zero pages handed out
+		// by the allocator. Mutable because handing out a raw data pointer
+		// from a const accessor has to clear it too.
+		mutable bool _isKnownZero;
+
+		// True while the data still matches _snapshot exactly, so new clones
+		// can share it.
+		mutable bool _isSnapshotCurrent;
 
 	private: // Private methods
 		//inline size_t ValidateSectorRangeAndGetSectorCount(size_t startSector, size_t sectorCount) const;
@@ -209,9 +281,18 @@ namespace ufs
 			return _random;
 		}
 
-		Buffer& FillRandomImpl(size_t startSector, size_t sectorCount, bool useSeed, UInt32 seed = 0);
+		Buffer& FillRandomImpl(size_t startSector, size_t sectorCount, bool useSeed, UInt32 seed, RandomEngine engine);
 		void FillSectorsWithRandomData(Random32& random, size_t startSector, size_t sectorCount);
-		void FillPattern(size_t patternStart, size_t patternLen, size_t startByte, size_t endByte);
+		void FillSectorsWithFastRandomData(ufs::kernels::XoshiroState& state, size_t startSector, size_t sectorCount);
+
+		// The overlay fills stamp as they write. In pattern mode it goes on
+		// after the compression info instead, see ApplyPatternModeOverlay.
+		inline const ufs::SectorOverlay* GetFusedOverlay() const
+		{
+			return _usePatternMode ? NULL : _overlay.get();
+		}
+
+		void ApplyPatternModeOverlay(size_t startByte, size_t endByte);
 		//inline void ValidateIndex(size_t index) const;
 
 		inline void ValidateIndex(size_t index) const
@@ -226,8 +307,6 @@ namespace ufs
 			}
 		}
 
-		void ValidateCounterMax(size_t maxValue);
-
 		void Copy(UInt8* srcData, size_t startByte, size_t bytesToCopy);
 		size_t ValidateCopyParameters(const Buffer& otherBuffer, size_t otherStartSector,
 													 size_t startSector, size_t sectorCount);
@@ -237,10 +316,35 @@ namespace ufs
 		int inf(FILE *sourceFile, FILE *destFile);
 		void zerr(int result);
 
+		// Called by every method that writes data, or exposes a pointer to it.
+		// Only stores when a flag changes, so worker pool pieces can call it
+		// once the caller has.
+		inline void MarkModified() const
+		{
+			if (_backing == ufs::ReadOnlyFileBacking) ThrowReadOnly();
+			if (_isKnownZero) _isKnownZero = false;
+			if (_isSnapshotCurrent) _isSnapshotCurrent = false;
+		}
+
+		void ThrowReadOnly() const;
+
 		void Initialize(size_t sectorCount, size_t bytesPerSector, bool bMakeAvailableToGui=true);
+		void Adopt(const ufs::PageBlock& block, size_t sectorCount, size_t bytesPerSector);
+		void AllocateData();
+		ufs::PageBlock AllocateBlock(size_t byteCount, bool& isPooled) const;
+		void SetDataBlock(const ufs::PageBlock& block, bool isPooled);
+		void ReleaseData();
+		void ReleaseBlock(ufs::PageBlock& block, bool isPooled);
+		bool TakeSnapshot();
+		void PlaceView(const ufs::PageBlock& view) const;
+		void SkipSharedPages(const Buffer& buffer, size_t startByte, size_t startByte2, size_t bytesToCompare,
+							 std::vector<std::pair<size_t, size_t>>& ranges) const;
+
+		Buffer(const Buffer& buffer, const ufs::PageBlock& view);
 
 		UInt8* CalculateDataStart(UInt8* data, size_t dataByteCount);
 		void CalculateTotalBytesToAllocate(size_t dataByteCount);
+		void CalculateAllocationSizes(size_t dataByteCount, size_t& dataBufferSize, size_t& allocatedByteCount) const;
 		void FillCompressionInfo(UInt8 type, UInt8 pattenLen, size_t startByte, size_t endByte);
 
 	public: //(Con|De)structors
@@ -248,11 +352,25 @@ namespace ufs
 		explicit Buffer(size_t sectorCount);
 		Buffer(size_t sectorCount, size_t bytesPerSector);
 		Buffer(size_t sectorCount, size_t bytesPerSector, bool bMakeAvailableToGui);
+		Buffer(size_t sectorCount, size_t bytesPerSector, ufs::AllocationMode allocationMode);
+		Buffer(size_t sectorCount, size_t bytesPerSector, const ufs::NumaPlacement& numaPlacement);
+		Buffer(size_t sectorCount, size_t bytesPerSector, const ufs::BufferLayout& layout);
+		Buffer(UInt8* memory, size_t length, size_t bytesPerSector, const ufs::ExternalDeleter& deleter);
+		Buffer(UInt8* memory, size_t length, size_t sectorCount, size_t bytesPerSector,
+			   const ufs::ExternalDeleter& deleter, const ufs::BufferLayout& layout);
+		static Buffer MapFile(const std::string& fileName, size_t bytesPerSector);
+		static Buffer MapFile(const std::string& fileName, size_t bytesPerSector, ufs::MapAccess access);
 
 
 		Buffer(const Buffer& buffer);
+		Buffer(Buffer&& buffer) noexcept;
 		virtual ~Buffer();
 
+		Buffer& operator=(const Buffer& buffer);
+		Buffer& operator=(Buffer&& buffer) noexcept;
+		void Swap(Buffer& buffer) noexcept;
+		Buffer CloneCopyOnWrite();
+
 	public: // Static members
 
 		//prototype for python list -> vector conversion
@@ -262,6 +380,14 @@ namespace ufs
 	public: // C++ only methods
 		bool IsAllZeros();
 		inline size_t GetDataBufferSize() const { return _dataBufferSize; }
+		inline ufs::AllocationMode GetAllocationMode() const { return _allocationMode; }
+		inline ufs::PageBacking GetPageBacking() const { return _backing; }
+		inline bool IsReadOnly() const { return _backing == ufs::ReadOnlyFileBacking; }
+		inline bool GetIsPooled() const { return _isPooled; }
+		inline const ufs::NumaPlacement& GetNumaPlacement() const { return _numaPlacement; }
+		inline const ufs::BufferLayout& GetLayout() const { return _layout; }
+		std::vector<size_t> GetNumaNodePageCounts() const;
+		size_t GetSharedPageCount() const;
 
 	public: //Python exposed properties
 		//size_t GetBytesPerSector() const;
@@ -298,6 +424,30 @@ namespace ufs
 		CompareResult CompareTo(Buffer& buffer, size_t startSector);
 		CompareResult CompareTo(Buffer& buffer, size_t startSector, size_t sectorCount);
 		CompareResult CompareTo(Buffer& buffer, size_t startSector, size_t startSector2, size_t sectorCount);
+		CompareResult CompareTo(Buffer& buffer, const CompareOptions& options);
+		CompareResult CompareTo(Buffer& buffer, size_t startSector, size_t startSector2, size_t sectorCount, const CompareOptions& options);
+
+		CompareResult CompareTo(const PatternBuffer& pattern);
+		CompareResult CompareTo(const PatternBuffer& pattern, size_t startSector);
+		CompareResult CompareTo(const PatternBuffer& pattern, size_t startSector, size_t sectorCount);
+		CompareResult CompareTo(const PatternBuffer& pattern, size_t startSector, size_t patternStartSector, size_t sectorCount);
+		CompareResult CompareTo(const PatternBuffer& pattern, const CompareOptions& options);
+		CompareResult CompareTo(const PatternBuffer& pattern, size_t startSector, size_t patternStartSector, size_t sectorCount, const CompareOptions& options);
+
+		CompareResult VerifyPattern(const PatternBuffer& pattern);
+		CompareResult VerifyPattern(const PatternBuffer& pattern, size_t startSector);
+		CompareResult VerifyPattern(const PatternBuffer& pattern, size_t startSector, size_t sectorCount);
+		CompareResult VerifyPattern(const PatternBuffer& pattern, size_t startSector, size_t sectorCount, size_t detailLimit);
+
+		BitErrorStats CompareBits(Buffer& buffer);
+		BitErrorStats CompareBits(Buffer& buffer, size_t startSector);
+		BitErrorStats CompareBits(Buffer& buffer, size_t startSector, size_t sectorCount);
+		BitErrorStats CompareBits(Buffer& buffer, size_t startSector, size_t startSector2, size_t sectorCount);
+
+		BitErrorStats CompareBits(const PatternBuffer& pattern);
+		BitErrorStats CompareBits(const PatternBuffer& pattern, size_t startSector);
+		BitErrorStats CompareBits(const PatternBuffer& pattern, size_t startSector, size_t sectorCount);
+		BitErrorStats CompareBits(const PatternBuffer& pattern, size_t startSector, size_t patternStartSector, size_t sectorCount);
 
 		// Individual byte level access
 		UInt8 GetByte(size_t index) const;
@@ -343,7 +493,8 @@ namespace ufs
 		std::string GetString(size_t startingOffset, size_t length) const;
 		Buffer& SetString(size_t startingOffset, const std::string& value);
 
-		// Gets pointer needed by low level calls
+		// Gets pointer needed by low level calls. The data of a read-only
+		// buffer must only be read through it.
 		UInt8* GetDataStart() const;
 		UInt8* GetAllocationStart() const;
 
@@ -357,6 +508,15 @@ namespace ufs
 		Buffer& FillAddressOverlay(UInt64 startingValue, size_t startSector);
 		Buffer& FillAddressOverlay(UInt64 startingValue, size_t startSector, size_t sectorCount);
 
+		// Sector overlay stamped by the fills, see SectorOverlay
+		Buffer& SetSectorOverlay(const SectorOverlay& overlay);
+		Buffer& ClearSectorOverlay();
+		const SectorOverlay* GetSectorOverlay() const;
+
+		Buffer& ApplySectorOverlay();
+		Buffer& ApplySectorOverlay(size_t startSector);
+		Buffer& ApplySectorOverlay(size_t startSector, size_t sectorCount);
+
 		Buffer& FillDecrementing();
 		Buffer& FillDecrementing(UInt8 startingValue);
 		Buffer& FillDecrementing(UInt8 startingValue, size_t startSector);
@@ -374,15 +534,84 @@ namespace ufs
 		Buffer& FillRandom();
 		Buffer& FillRandom(size_t startSector);
 		Buffer& FillRandom(size_t startSector, size_t sectorCount);
+		Buffer& FillRandom(size_t startSector, size_t sectorCount, RandomEngine engine);
 
 		Buffer& FillRandomSeeded(UInt32 seed);
 		Buffer& FillRandomSeeded(UInt32 seed, size_t startSector);
 		Buffer& FillRandomSeeded(UInt32 seed, size_t startSector, size_t sectorCount);
+		Buffer& FillRandomSeeded(UInt32 seed, size_t startSector, size_t sectorCount, RandomEngine engine);
 
 		Buffer& FillRandomSeededBySector(UInt32 seed);
 		Buffer& FillRandomSeededBySector(UInt32 seed, size_t startSector);
 		Buffer& FillRandomSeededBySector(UInt32 seed, size_t startSector, size_t sectorCount);
 
+		Buffer& FillRandomCounter(UInt64 seed);
+		Buffer& FillRandomCounter(UInt64 seed, size_t startSector);
+		Buffer& FillRandomCounter(UInt64 seed, size_t startSector, size_t sectorCount);
+		Buffer& FillRandomCounter(UInt64 seed, size_t startSector, size_t sectorCount, UInt64 firstKeySector);
+
+		// Storage test patterns, see TestPattern
+		Buffer& FillTestPattern(TestPattern pattern);
+		Buffer& FillTestPattern(TestPattern pattern, size_t startSector);
+		Buffer& FillTestPattern(TestPattern pattern, size_t startSector, size_t sectorCount);
+		Buffer& FillTestPattern(TestPattern pattern, size_t startSector, size_t sectorCount, const TestPatternOptions& options);
+
+		Buffer& FillWalkingOnes();
+		Buffer& FillWalkingOnes(size_t startSector);
+		Buffer& FillWalkingOnes(size_t startSector, size_t sectorCount);
+		Buffer& FillWalkingOnes(size_t startSector, size_t sectorCount, const TestPatternOptions& options);
+
+		Buffer& FillWalkingZeros();
+		Buffer& FillWalkingZeros(size_t startSector);
+		Buffer& FillWalkingZeros(size_t startSector, size_t sectorCount);
+		Buffer& FillWalkingZeros(size_t startSector, size_t sectorCount, const TestPatternOptions& options);
+
+		Buffer& FillCheckerboard();
+		Buffer& FillCheckerboard(size_t startSector);
+		Buffer& FillCheckerboard(size_t startSector, size_t sectorCount);
+		Buffer& FillCheckerboard(size_t startSector, size_t sectorCount, const TestPatternOptions& options);
+
+		Buffer& FillInverseCheckerboard();
+		Buffer& FillInverseCheckerboard(size_t startSector);
+		Buffer& FillInverseCheckerboard(size_t startSector, size_t sectorCount);
+		Buffer& FillInverseCheckerboard(size_t startSector, size_t sectorCount, const TestPatternOptions& options);
+
+		Buffer& FillButterfly();
+		Buffer& FillButterfly(size_t startSector);
+		Buffer& FillButterfly(size_t startSector, size_t sectorCount);
+		Buffer& FillButterfly(size_t startSector, size_t sectorCount, const TestPatternOptions& options);
+
+		Buffer& FillGallopingOnes();
+		Buffer& FillGallopingOnes(size_t startSector);
+		Buffer& FillGallopingOnes(size_t startSector, size_t sectorCount);
+		Buffer& FillGallopingOnes(size_t startSector, size_t sectorCount, const TestPatternOptions& options);
+
+		Buffer& FillGallopingZeros();
+		Buffer& FillGallopingZeros(size_t startSector);
+		Buffer& FillGallopingZeros(size_t startSector, size_t sectorCount);
+		Buffer& FillGallopingZeros(size_t startSector, size_t sectorCount, const TestPatternOptions& options);
+
+		Buffer& FillMarchingOnes();
+		Buffer& FillMarchingOnes(size_t startSector);
+		Buffer& FillMarchingOnes(size_t startSector, size_t sectorCount);
+		Buffer& FillMarchingOnes(size_t startSector, size_t sectorCount, const TestPatternOptions& options);
+
+		Buffer& FillMarchingZeros();
+		Buffer& FillMarchingZeros(size_t startSector);
+		Buffer& FillMarchingZeros(size_t startSector, size_t sectorCount);
+		Buffer& FillMarchingZeros(size_t startSector, size_t sectorCount, const TestPatternOptions& options);
+
+		// Pseudo-random binary sequences, see PrbsOrder
+		Buffer& FillPrbs(PrbsOrder order, UInt32 seed);
+		Buffer& FillPrbs(PrbsOrder order, UInt32 seed, size_t startSector);
+		Buffer& FillPrbs(PrbsOrder order, UInt32 seed, size_t startSector, size_t sectorCount);
+		Buffer& FillPrbs(PrbsGenerator& generator, size_t startSector, size_t sectorCount);
+
+		PrbsChecker VerifyPrbs(PrbsOrder order) const;
+		PrbsChecker VerifyPrbs(PrbsOrder order, size_t startSector) const;
+		PrbsChecker VerifyPrbs(PrbsOrder order, size_t startSector, size_t sectorCount) const;
+		PrbsChecker& VerifyPrbs(PrbsChecker& checker, size_t startSector, size_t sectorCount) const;
+
 
 		// PATRLBAFAST???
 
@@ -393,6 +622,7 @@ namespace ufs
 		Buffer& FillBytes(const std::vector<UInt8>& list);
 		Buffer& FillBytes(const std::vector<UInt8>& list, size_t startSector);
 		Buffer& FillBytes(const std::vector<UInt8>& list, size_t startSector, size_t sectorCount);
+		Buffer& FillBytes(const std::vector<UInt8>& list, size_t startSector, size_t sectorCount, PatternPhase phase);
 
 		// File IO methods. The Load methods' parameters are bytes, not sectors!!!
 		Buffer& LoadFromFileCompressedBinary(const std::string& fileName);
@@ -419,7 +649,13 @@ namespace ufs
 		Buffer& SaveToFileAscii(const std::string& fileName, size_t startSector);
 		Buffer& SaveToFileAscii(const std::string& fileName, size_t startSector, size_t sectorCount);
 
-		// Clears any existing data
+		// Non-owning views of a range, see BufferView
+		BufferView GetView();
+		BufferView GetView(size_t startSector);
+		BufferView GetView(size_t startSector, size_t sectorCount);
+		BufferView GetByteView(size_t startingOffset, size_t length);
+
+		// Keeps existing data up to the smaller of the two sizes
 		Buffer& Resize(size_t sectorCount);
 		Buffer& Resize(size_t sectorCount, size_t bytesPerSector);
 
@@ -440,5 +676,35 @@ namespace ufs
 
 		size_t GetLastReadSectorCount() const;
 	};
+
+	/// <summary>
+	/// A Buffer whose layout is fixed at compile time by a LayoutPolicy, e.g.
+	/// LayoutBuffer<CompactLayout> or LayoutBuffer<LayoutPolicy<512, 0>>.
+	/// </summary>
+	template <class Policy>
+	class LayoutBuffer : public Buffer
+	{
+	public:
+		explicit LayoutBuffer(size_t sectorCount, size_t bytesPerSector = DEFAULT_BYTES_PER_SECTOR)
+			: Buffer(sectorCount, bytesPerSector, ufs::BufferLayout::FromPolicy<Policy>())
+		{
+		}
+	};
+
+	/// <summary>
+	/// Small buffer without the UFS header slot. See CompactLayout.
+	/// </summary>
+	typedef LayoutBuffer<CompactLayout> CompactBuffer;
+
+	/// <summary>
+	/// Exchanges the contents of two buffers without copying any data.
+	/// </summary>
+	inline void swap(Buffer& left, Buffer& right) noexcept
+	{
+		left.Swap(right);
+	}
 }
+
+#include "BufferView.h"
+
 #endif
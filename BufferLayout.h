@@ -0,0 +1,79 @@
+#pragma once
+#ifndef _BUFFERLAYOUT_H_
+#define _BUFFERLAYOUT_H_
+
+#include <cstddef>
+
+namespace ufs {
+
+/// <summary>
+/// Compile-time layout policy for the data block of a Buffer.
+/// #FORMAT
+///      Alignment = alignment of the data start in bytes (a power of two), and
+/// HeaderReserve = bytes kept free in front of the data start.
+/// #ENDFORMAT
+/// The data buffer size is rounded up to a multiple of the alignment.
+/// </summary>
+template <size_t Alignment, size_t HeaderReserve>
+struct LayoutPolicy
+{
+    static_assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two.");
+
+    static constexpr size_t alignment = Alignment;
+    static constexpr size_t headerReserve = HeaderReserve;
+};
+
+/// <summary>
+/// 4K aligned data with a 4K slot in front of it for UFS structures (used by
+/// simulator drivers). This is the layout of every Buffer unless another one
+/// is requested.
+/// </summary>
+typedef LayoutPolicy<4096, 4096> DefaultLayout;
+
+/// <summary>
+/// Cache line aligned data with no header slot, for small buffers that are
+/// never handed to a driver.
+/// </summary>
+typedef LayoutPolicy<64, 0> CompactLayout;
+
+/// <summary>
+/// 2MB aligned data with no header slot, so that the data starts on a huge
+/// page boundary.
+/// </summary>
+typedef LayoutPolicy<2 * 1024 * 1024, 0> HugePageLayout;
+
+/// <summary>
+/// The layout of a Buffer chosen at run time. See LayoutPolicy.
+/// </summary>
+struct BufferLayout
+{
+    size_t alignment;
+    size_t headerReserve;
+
+    static BufferLayout Create(size_t alignment, size_t headerReserve)
+    {
+        BufferLayout layout = { alignment, headerReserve };
+        return layout;
+    }
+
+    template <class Policy>
+    static BufferLayout FromPolicy()
+    {
+        return Create(Policy::alignment, Policy::headerReserve);
+    }
+
+    static BufferLayout Default() { return FromPolicy<DefaultLayout>(); }
+
+    bool IsValid() const { return alignment > 0 && (alignment & (alignment - 1)) == 0; }
+
+    bool operator==(const BufferLayout& other) const
+    {
+        return alignment == other.alignment && headerReserve == other.headerReserve;
+    }
+
+    bool operator!=(const BufferLayout& other) const { return !(*this == other); }
+};
+
+} // namespace ufs
+
+#endif // _BUFFERLAYOUT_H_
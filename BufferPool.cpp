@@ -0,0 +1,183 @@
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ufs {
+
+namespace {
+
+const size_t MIN_SIZE_CLASS = 4096;
+const size_t DEFAULT_MEMORY_CAP = 1UL << 30;
+
+// Blocks of one size class kept by a thread before overflowing to the depot.
+const size_t THREAD_CACHE_BLOCKS_PER_CLASS = 4;
+
+} // namespace
+
+BufferPool::ThreadCache::ThreadCache() {
+    BufferPool& pool = BufferPool::GetInstance();
+    std::lock_guard<std::mutex> depotLock(pool._depotMutex);
+    pool._threadCaches.push_back(this);
+}
+
+BufferPool::ThreadCache::~ThreadCache() {
+    // Hand everything still cached by the exiting thread to the depot.
+    BufferPool& pool = BufferPool::GetInstance();
+    std::lock_guard<std::mutex> depotLock(pool._depotMutex);
+    std::lock_guard<std::mutex> lock(mutex);
+    for (BlockMap::iterator it = blocks.begin(); it != blocks.end(); ++it) {
+        std::vector<CachedBlock>& depotBlocks = pool._depot[it->first];
+        depotBlocks.insert(depotBlocks.end(), it->second.begin(), it->second.end());
+    }
+    blocks.clear();
+    pool._threadCaches.erase(std::remove(pool._threadCaches.begin(), pool._threadCaches.end(), this),
+                             pool._threadCaches.end());
+}
+
+BufferPool::BufferPool()
+    : _enabled(false), _memoryCap(DEFAULT_MEMORY_CAP), _cachedBytes(0), _hits(0), _misses(0) {
+}
+
+BufferPool& BufferPool::GetInstance() {
+    // Never destroyed, so buffers living in static storage can still return
+    // their blocks during process shutdown.
+    static BufferPool* instance = new BufferPool();
+    return *instance;
+}
+
+BufferPool::ThreadCache& BufferPool::GetThreadCache() {
+    static thread_local ThreadCache cache;
+    return cache;
+}
+
+size_t BufferPool::GetSizeClass(size_t length) {
+    if (length <= MIN_SIZE_CLASS) {
+        return MIN_SIZE_CLASS;
+    }
+
+    // Four classes between each power of two: 1.25, 1.5, 1.75 and 2 times.
+    size_t highBit = 0;
+    for (size_t value = length - 1; value > 1; value >>= 1) {
+        highBit++;
+    }
+    size_t step = static_cast<size_t>(1) << (highBit - 2);
+    return ((length + step - 1) / step) * step;
+}
+
+bool BufferPool::TakeBlock(BlockMap& blocks, size_t sizeClass, CachedBlock& cached) {
+    BlockMap::iterator it = blocks.find(sizeClass);
+    if (it == blocks.end() || it->second.empty()) {
+        return false;
+    }
+
+    // Prefer a block that is still zero so it does not need clearing.
+    std::vector<CachedBlock>& list = it->second;
+    std::vector<CachedBlock>::iterator pick = list.end() - 1;
+    for (std::vector<CachedBlock>::iterator candidate = list.begin(); candidate != list.end(); ++candidate) {
+        if (candidate->isZero) {
+            pick = candidate;
+            break;
+        }
+    }
+    cached = *pick;
+    list.erase(pick);
+    return true;
+}
+
+PageBlock BufferPool::Acquire(size_t length) {
+    size_t sizeClass = GetSizeClass(length);
+    CachedBlock cached;
+    bool found = false;
+
+    ThreadCache& threadCache = GetThreadCache();
+    {
+        std::lock_guard<std::mutex> lock(threadCache.mutex);
+        found = TakeBlock(threadCache.blocks, sizeClass, cached);
+    }
+    if (!found) {
+        std::lock_guard<std::mutex> depotLock(_depotMutex);
+        found = TakeBlock(_depot, sizeClass, cached);
+    }
+
+    if (!found) {
+        _misses++;
+        return PageAllocator::Allocate(sizeClass, StandardPages);
+    }
+
+    _hits++;
+    _cachedBytes -= cached.block.length;
+    if (!cached.isZero) {
+        ::memset(cached.block.address, 0, cached.block.length);
+    }
+    return cached.block;
+}
+
+bool BufferPool::Release(const PageBlock& block, bool isZero) {
+    if (!_enabled || block.length != GetSizeClass(block.length)
+        || (block.backing != HeapBacking && block.backing != MappedBacking)) {
+        return false;
+    }
+
+    // Reserve room under the cap before caching the block.
+    size_t cached = _cachedBytes;
+    do {
+        if (cached + block.length > _memoryCap) {
+            return false;
+        }
+    } while (!_cachedBytes.compare_exchange_weak(cached, cached + block.length));
+
+    CachedBlock entry = { block, isZero };
+    ThreadCache& threadCache = GetThreadCache();
+    {
+        std::lock_guard<std::mutex> lock(threadCache.mutex);
+        std::vector<CachedBlock>& list = threadCache.blocks[block.length];
+        if (list.size() < THREAD_CACHE_BLOCKS_PER_CLASS) {
+            list.push_back(entry);
+            return true;
+        }
+    }
+
+    std::lock_guard<std::mutex> depotLock(_depotMutex);
+    _depot[block.length].push_back(entry);
+    return true;
+}
+
+size_t BufferPool::TrimMap(BlockMap& blocks, size_t targetBytes) {
+    size_t released = 0;
+    for (BlockMap::reverse_iterator it = blocks.rbegin(); it != blocks.rend(); ++it) {
+        while (!it->second.empty() && _cachedBytes > targetBytes) {
+            PageBlock block = it->second.back().block;
+            it->second.pop_back();
+            _cachedBytes -= block.length;
+            released += block.length;
+            PageAllocator::Release(block);
+        }
+    }
+    return released;
+}
+
+size_t BufferPool::Trim(size_t targetBytes) {
+    // Depot first, then the per-thread caches, largest classes first.
+    std::lock_guard<std::mutex> depotLock(_depotMutex);
+    size_t released = TrimMap(_depot, targetBytes);
+    for (size_t i = 0; i < _threadCaches.size() && _cachedBytes > targetBytes; i++) {
+        std::lock_guard<std::mutex> lock(_threadCaches[i]->mutex);
+        released += TrimMap(_threadCaches[i]->blocks, targetBytes);
+    }
+    return released;
+}
+
+void BufferPool::SetMemoryCap(size_t bytes) {
+    _memoryCap = bytes;
+    if (_cachedBytes > bytes) {
+        Trim(bytes);
+    }
+}
+
+void BufferPool::ResetCounters() {
+    _hits = 0;
+    _misses = 0;
+}
+
+} // namespace ufs
@@ -0,0 +1,119 @@
+#pragma once
+#ifndef _BUFFERPOOL_H_
+#define _BUFFERPOOL_H_
+
+#include "TypeDefs.h"
+#include "PageAllocator.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace ufs {
+
+/// <summary>
+/// Recycles the standard page data blocks behind Buffer objects so that
+/// building and dropping buffers of the same few sizes does not go back to
+/// the operating system every time.
+///
+/// Blocks are grouped in size classes (four classes per power of two, so at
+/// most 25% of a block is unused). Released blocks go to a small cache
+/// owned by the releasing thread first and overflow to a shared depot. The
+/// total number of cached bytes never exceeds the memory cap; blocks that
+/// do not fit are returned to the operating system.
+///
+/// The pool is disabled by default. Once enabled with SetEnabled(true),
+/// the Buffer constructors, Resize and the destructor draw from and return
+/// to it.
+/// </summary>
+class BufferPool {
+public:
+    /// <summary>
+    /// Get the process wide pool used by Buffer.
+    /// </summary>
+    static BufferPool& GetInstance();
+
+    /// <summary>
+    /// Get the size class (block length) used for a request of length bytes.
+    /// </summary>
+    static size_t GetSizeClass(size_t length);
+
+    /// <summary>
+    /// Enable or disable pooling for new allocations.
+    /// </summary>
+    void SetEnabled(bool enabled) { _enabled = enabled; }
+    bool GetEnabled() const { return _enabled; }
+
+    /// <summary>
+    /// Set the maximum number of bytes kept cached. Lowering the cap trims
+    /// the cache down to it.
+    /// </summary>
+    void SetMemoryCap(size_t bytes);
+    size_t GetMemoryCap() const { return _memoryCap; }
+
+    /// <summary>
+    /// Acquire a zero-filled block of at least length bytes.
+    /// </summary>
+    PageBlock Acquire(size_t length);
+
+    /// <summary>
+    /// Offer a block back to the pool. isZero tells whether the whole block
+    /// still holds zeros. Returns false when the block was not taken (pool
+    /// disabled or over the cap), in which case the caller must release it.
+    /// </summary>
+    bool Release(const PageBlock& block, bool isZero);
+
+    /// <summary>
+    /// Return cached blocks to the operating system until at most
+    /// targetBytes remain cached. Returns the number of bytes released.
+    /// </summary>
+    size_t Trim(size_t targetBytes = 0);
+
+    UInt64 GetHitCount() const { return _hits; }
+    UInt64 GetMissCount() const { return _misses; }
+    size_t GetCachedBytes() const { return _cachedBytes; }
+
+    /// <summary>
+    /// Reset the hit and miss counters.
+    /// </summary>
+    void ResetCounters();
+
+    struct CachedBlock
+    {
+        PageBlock block;
+        bool isZero;
+    };
+    typedef std::map<size_t, std::vector<CachedBlock>> BlockMap;
+
+    struct ThreadCache
+    {
+        std::mutex mutex;
+        BlockMap blocks;
+        ThreadCache();
+        ~ThreadCache();
+    };
+
+private:
+    BufferPool();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    static ThreadCache& GetThreadCache();
+    static bool TakeBlock(BlockMap& blocks, size_t sizeClass, CachedBlock& cached);
+    size_t TrimMap(BlockMap& blocks, size_t targetBytes);
+
+    std::atomic<bool> _enabled;
+    std::atomic<size_t> _memoryCap;
+    std::atomic<size_t> _cachedBytes;
+    std::atomic<UInt64> _hits;
+    std::atomic<UInt64> _misses;
+
+    std::mutex _depotMutex;
+    BlockMap _depot;
+    std::vector<ThreadCache*> _threadCaches;
+};
+
+} // namespace ufs
+
+#endif // _BUFFERPOOL_H_
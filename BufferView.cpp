@@ -0,0 +1,302 @@
+#include "BufferView.h"
+#include "Buffer.h"
+#include "DataKernels.h"
+#include "Errors.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace ufs {
+
+BufferView::BufferView()
+    : _buffer(NULL), _data(NULL), _offset(0), _byteCount(0), _bytesPerSector(DEFAULT_BYTES_PER_SECTOR) {
+}
+
+BufferView::BufferView(Buffer& buffer, size_t offset, size_t byteCount)
+    : _buffer(&buffer), _offset(offset), _bytesPerSector(buffer.GetBytesPerSector()) {
+    size_t totalBytes = buffer.GetTotalBytes();
+    if (offset >= totalBytes) {
+        throw OutOfRangeError("offset (" + std::to_string(offset)
+            + ") must be less than the total number of bytes in the buffer ("
+            + std::to_string(totalBytes) + ").");
+    }
+
+    _byteCount = byteCount == 0 ? totalBytes - offset : byteCount;
+    if (_byteCount > totalBytes - offset) {
+        throw OutOfRangeError("offset plus byteCount must be less than the number of bytes in the buffer.");
+    }
+
+    // Read directly, GetDataStart would count as a write.
+    _data = buffer._dataStart + offset;
+}
+
+UInt8* BufferView::GetMutableData() {
+    MarkModified();
+    return _data;
+}
+
+BufferView BufferView::Slice(size_t startSector, size_t sectorCount) const {
+    return SliceBytes(startSector * _bytesPerSector, sectorCount * _bytesPerSector);
+}
+
+BufferView BufferView::SliceBytes(size_t startingOffset, size_t length) const {
+    if (startingOffset >= _byteCount) {
+        throw OutOfRangeError("startingOffset (" + std::to_string(startingOffset)
+            + ") must be less than the number of bytes in the view ("
+            + std::to_string(_byteCount) + ").");
+    }
+
+    length = length == 0 ? _byteCount - startingOffset : length;
+    if (length > _byteCount - startingOffset) {
+        throw OutOfRangeError("startingOffset plus length must be less than the number of bytes in the view.");
+    }
+
+    BufferView view(*this);
+    view._data += startingOffset;
+    view._offset += startingOffset;
+    view._byteCount = length;
+    return view;
+}
+
+UInt8 BufferView::GetByte(size_t index) const {
+    ValidateIndex(index, 1);
+    return _data[index];
+}
+
+BufferView& BufferView::SetByte(size_t index, UInt8 value) {
+    ValidateIndex(index, 1);
+    MarkModified();
+    _data[index] = value;
+    return *this;
+}
+
+UInt16 BufferView::GetWord(size_t index) const {
+    ValidateIndex(index, 2);
+    return static_cast<UInt16>(_data[index] | (_data[index + 1] << 8));
+}
+
+BufferView& BufferView::SetWord(size_t index, UInt16 value) {
+    ValidateIndex(index, 2);
+    MarkModified();
+    _data[index] = static_cast<UInt8>(value);
+    _data[index + 1] = static_cast<UInt8>(value >> 8);
+    return *this;
+}
+
+UInt32 BufferView::GetDWord(size_t index) const {
+    ValidateIndex(index, 4);
+    UInt32 value = 0;
+    for (size_t i = 4; i > 0; i--) {
+        value = (value << 8) | _data[index + i - 1];
+    }
+    return value;
+}
+
+BufferView& BufferView::SetDWord(size_t index, UInt32 value) {
+    ValidateIndex(index, 4);
+    MarkModified();
+    for (size_t i = 0; i < 4; i++) {
+        _data[index + i] = static_cast<UInt8>(value >> (8 * i));
+    }
+    return *this;
+}
+
+UInt64 BufferView::GetQWord(size_t index) const {
+    ValidateIndex(index, 8);
+    UInt64 value = 0;
+    for (size_t i = 8; i > 0; i--) {
+        value = (value << 8) | _data[index + i - 1];
+    }
+    return value;
+}
+
+BufferView& BufferView::SetQWord(size_t index, UInt64 value) {
+    ValidateIndex(index, 8);
+    MarkModified();
+    for (size_t i = 0; i < 8; i++) {
+        _data[index + i] = static_cast<UInt8>(value >> (8 * i));
+    }
+    return *this;
+}
+
+BufferView& BufferView::Fill(UInt8 value) {
+    if (IsEmpty()) {
+        return *this;
+    }
+
+    if (IsWholeSectors()) {
+        _buffer->Fill(value, GetStartSector(), GetSectorCount());
+        return *this;
+    }
+
+    // Zero filling untouched zero pages would only fault them in.
+    if (value != 0 || !_buffer->_isKnownZero) {
+        MarkModified();
+        ::memset(_data, value, _byteCount);
+    }
+    return *this;
+}
+
+BufferView& BufferView::FillZeros() {
+    return Fill(0x00);
+}
+
+BufferView& BufferView::FillOnes() {
+    return Fill(0xFF);
+}
+
+BufferView& BufferView::FillIncrementing(UInt8 startingValue) {
+    if (IsEmpty()) {
+        return *this;
+    }
+
+    if (IsWholeSectors()) {
+        _buffer->FillIncrementing(startingValue, GetStartSector(), GetSectorCount());
+        return *this;
+    }
+
+    // The count runs on from where the view starts in its first sector.
+    MarkModified();
+    size_t phase = _offset % _bytesPerSector;
+    size_t head = phase == 0 ? 0 : std::min(_byteCount, _bytesPerSector - phase);
+    kernels::FillIncrementing(_data, head, _bytesPerSector, static_cast<UInt8>(startingValue + phase));
+    kernels::FillIncrementing(_data + head, _byteCount - head, _bytesPerSector, startingValue);
+    return *this;
+}
+
+BufferView& BufferView::FillDecrementing(UInt8 startingValue) {
+    if (IsEmpty()) {
+        return *this;
+    }
+
+    if (IsWholeSectors()) {
+        _buffer->FillDecrementing(startingValue, GetStartSector(), GetSectorCount());
+        return *this;
+    }
+
+    MarkModified();
+    size_t phase = _offset % _bytesPerSector;
+    size_t head = phase == 0 ? 0 : std::min(_byteCount, _bytesPerSector - phase);
+    kernels::FillDecrementing(_data, head, _bytesPerSector, static_cast<UInt8>(startingValue - phase));
+    kernels::FillDecrementing(_data + head, _byteCount - head, _bytesPerSector, startingValue);
+    return *this;
+}
+
+BufferView& BufferView::FillBytes(const std::vector<UInt8>& list) {
+    if (IsEmpty() || list.empty()) {
+        return *this;
+    }
+
+    if (IsWholeSectors()) {
+        _buffer->FillBytes(list, GetStartSector(), GetSectorCount(), PatternContinuous);
+        return *this;
+    }
+
+    MarkModified();
+    kernels::FillBytes(_data, _byteCount, list.data(), list.size());
+    return *this;
+}
+
+BufferView& BufferView::FillRandomSeeded(UInt32 seed, RandomEngine engine) {
+    ValidateWholeSectors();
+    _buffer->FillRandomSeeded(seed, GetStartSector(), GetSectorCount(), engine);
+    return *this;
+}
+
+BufferView& BufferView::FillRandomSeededBySector(UInt32 seed) {
+    ValidateWholeSectors();
+    _buffer->FillRandomSeededBySector(seed, GetStartSector(), GetSectorCount());
+    return *this;
+}
+
+BufferView& BufferView::FillRandomCounter(UInt64 seed) {
+    ValidateWholeSectors();
+    _buffer->FillRandomCounter(seed, GetStartSector(), GetSectorCount());
+    return *this;
+}
+
+BufferView& BufferView::FillTestPattern(TestPattern pattern, const TestPatternOptions& options) {
+    ValidateWholeSectors();
+    _buffer->FillTestPattern(pattern, GetStartSector(), GetSectorCount(), options);
+    return *this;
+}
+
+BufferView& BufferView::FillPrbs(PrbsOrder order, UInt32 seed) {
+    ValidateWholeSectors();
+    _buffer->FillPrbs(order, seed, GetStartSector(), GetSectorCount());
+    return *this;
+}
+
+BufferView& BufferView::FillAddressOverlay(UInt64 startingValue) {
+    ValidateWholeSectors();
+    _buffer->FillAddressOverlay(startingValue, GetStartSector(), GetSectorCount());
+    return *this;
+}
+
+BufferView& BufferView::ApplySectorOverlay() {
+    ValidateWholeSectors();
+    _buffer->ApplySectorOverlay(GetStartSector(), GetSectorCount());
+    return *this;
+}
+
+BufferView& BufferView::CopyFrom(const BufferView& source) {
+    if (source._byteCount != _byteCount) {
+        throw ArgumentError("source view size (" + std::to_string(source._byteCount)
+            + ") must match the view size (" + std::to_string(_byteCount) + ").");
+    }
+
+    if (!IsEmpty() && !(source._buffer->_isKnownZero && _buffer->_isKnownZero)) {
+        MarkModified();
+        ::memmove(_data, source._data, _byteCount);
+    }
+    return *this;
+}
+
+CompareResult BufferView::CompareTo(const BufferView& view) const {
+    if (view._byteCount != _byteCount) {
+        throw ArgumentError("view size (" + std::to_string(view._byteCount)
+            + ") must match the view size (" + std::to_string(_byteCount) + ").");
+    }
+
+    size_t offset = 0;
+    if (!kernels::FindFirstMismatch(_data, view._data, _byteCount, offset)) {
+        return CompareResult();
+    }
+    return CompareResult(offset, _data[offset], view._data[offset]);
+}
+
+UInt8 BufferView::CalculateChecksumByte() const {
+    return kernels::ChecksumByte(_data, _byteCount);
+}
+
+UInt64 BufferView::GetBitCount(UInt8 value) const {
+    return kernels::CountBits(_data, _byteCount, value);
+}
+
+bool BufferView::IsAllZeros() const {
+    return IsEmpty() || _buffer->_isKnownZero || kernels::IsAllZeros(_data, _byteCount);
+}
+
+void BufferView::ValidateIndex(size_t index, size_t size) const {
+    if (index >= _byteCount || size > _byteCount - index) {
+        throw OutOfRangeError("Index (" + utils::Hex(index) + ") plus " + std::to_string(size)
+            + " bytes is beyond the end of the view (" + utils::Hex(_byteCount) + ").");
+    }
+}
+
+void BufferView::MarkModified() const {
+    _buffer->MarkModified();
+}
+
+bool BufferView::IsWholeSectors() const {
+    return _offset % _bytesPerSector == 0 && _byteCount % _bytesPerSector == 0;
+}
+
+void BufferView::ValidateWholeSectors() const {
+    if (IsEmpty() || !IsWholeSectors()) {
+        throw ArgumentError("The view must cover whole sectors for a fill defined per sector.");
+    }
+}
+
+} // namespace ufs
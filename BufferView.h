@@ -0,0 +1,152 @@
+#pragma once
+#ifndef _BUFFERVIEW_H_
+#define _BUFFERVIEW_H_
+
+#include "TypeDefs.h"
+#include "CompareResult.h"
+#include "Prbs.h"
+#include "Random32.h"
+#include "TestPatterns.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace ufs {
+
+class Buffer;
+
+/// <summary>
+/// A non-owning window onto a byte or sector range of a Buffer. Creating,
+/// copying and slicing a view never allocates or copies data, so a range
+/// such as "sectors 100-200 of this buffer" can be handed to other code and
+/// worked on at memory speed. Ranges are validated once, when the view is
+/// made; the methods of a view take offsets relative to its start.
+///
+/// A view is invalidated, like an iterator, when its buffer is resized,
+/// moved from or destroyed.
+/// </summary>
+class BufferView {
+public:
+    /// <summary>
+    /// An empty view.
+    /// </summary>
+    BufferView();
+
+    /// <summary>
+    /// View byteCount bytes of buffer starting at byte offset. A byteCount
+    /// of 0 views up to the end of the buffer.
+    /// </summary>
+    BufferView(Buffer& buffer, size_t offset, size_t byteCount);
+
+    size_t GetTotalBytes() const { return _byteCount; }
+    size_t GetBytesPerSector() const { return _bytesPerSector; }
+
+    /// <summary>
+    /// Get the number of whole sectors in the view.
+    /// </summary>
+    size_t GetSectorCount() const { return _byteCount / _bytesPerSector; }
+
+    /// <summary>
+    /// Get the byte offset of the view in its buffer.
+    /// </summary>
+    size_t GetOffset() const { return _offset; }
+
+    bool IsEmpty() const { return _byteCount == 0; }
+    Buffer& GetBuffer() const { return *_buffer; }
+
+    /// <summary>
+    /// Get a read-only pointer to the first byte of the view.
+    /// </summary>
+    const UInt8* GetData() const { return _data; }
+
+    /// <summary>
+    /// Get a writable pointer to the first byte of the view. The buffer is
+    /// considered modified.
+    /// </summary>
+    UInt8* GetMutableData();
+
+    /// <summary>
+    /// Get a view of sectorCount sectors starting at startSector of this
+    /// view. A sectorCount of 0 views up to the end.
+    /// </summary>
+    BufferView Slice(size_t startSector, size_t sectorCount = 0) const;
+
+    /// <summary>
+    /// Get a view of length bytes starting at startingOffset of this view.
+    /// A length of 0 views up to the end.
+    /// </summary>
+    BufferView SliceBytes(size_t startingOffset, size_t length = 0) const;
+
+    // Individual value access, least significant byte at the lower index.
+    UInt8 GetByte(size_t index) const;
+    BufferView& SetByte(size_t index, UInt8 value);
+    UInt16 GetWord(size_t index) const;
+    BufferView& SetWord(size_t index, UInt16 value);
+    UInt32 GetDWord(size_t index) const;
+    BufferView& SetDWord(size_t index, UInt32 value);
+    UInt64 GetQWord(size_t index) const;
+    BufferView& SetQWord(size_t index, UInt64 value);
+
+    // Fills, with the same patterns as the Buffer fills of the same range.
+    // A view of whole sectors is filled by those Buffer fills, so the sector
+    // overlay is stamped, large views are split across the worker pool and
+    // streamed, and the simulator compression info is kept. A view that
+    // starts or ends inside a sector is written with plain stores and gets
+    // no overlay, which is defined per whole sector.
+    BufferView& Fill(UInt8 value);
+    BufferView& FillZeros();
+    BufferView& FillOnes();
+    BufferView& FillIncrementing(UInt8 startingValue = 0);
+    BufferView& FillDecrementing(UInt8 startingValue = 255);
+    BufferView& FillBytes(const std::vector<UInt8>& list);
+
+    // Fills defined per sector, for views of whole sectors only. They throw
+    // ArgumentError on any other view.
+    BufferView& FillRandomSeeded(UInt32 seed, RandomEngine engine = RandomCompatible);
+    BufferView& FillRandomSeededBySector(UInt32 seed);
+    BufferView& FillRandomCounter(UInt64 seed);
+    BufferView& FillTestPattern(TestPattern pattern, const TestPatternOptions& options = TestPatternOptions());
+    BufferView& FillPrbs(PrbsOrder order, UInt32 seed);
+    BufferView& FillAddressOverlay(UInt64 startingValue);
+    BufferView& ApplySectorOverlay();
+
+    /// <summary>
+    /// Copy the bytes of source into this view. Both must be the same size.
+    /// </summary>
+    BufferView& CopyFrom(const BufferView& source);
+
+    /// <summary>
+    /// Compare this view with view, which must be the same size. The offset
+    /// in the result is relative to the start of this view.
+    /// </summary>
+    CompareResult CompareTo(const BufferView& view) const;
+
+    /// <summary>
+    /// Get the checksum byte of the view. See Buffer::CalculateChecksumByte.
+    /// </summary>
+    UInt8 CalculateChecksumByte() const;
+
+    /// <summary>
+    /// Count the 1 bits (value 1) or 0 bits (value 0) in the view.
+    /// </summary>
+    UInt64 GetBitCount(UInt8 value = 1) const;
+
+    bool IsAllZeros() const;
+
+private:
+    void ValidateIndex(size_t index, size_t size) const;
+    void MarkModified() const;
+    bool IsWholeSectors() const;
+    size_t GetStartSector() const { return _offset / _bytesPerSector; }
+    void ValidateWholeSectors() const;
+
+    Buffer* _buffer;
+    UInt8* _data;
+    size_t _offset;
+    size_t _byteCount;
+    size_t _bytesPerSector;
+};
+
+} // namespace ufs
+
+#endif // _BUFFERVIEW_H_
@@ -1,27 +1,168 @@
 #include "CompareResult.h"
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 
 namespace ufs {
 
 CompareResult::CompareResult() 
-    : _areEqual(true), _firstDifferenceOffset(0), _expectedValue(0), _actualValue(0), _differenceCount(0) {
+    : _areEqual(true), _firstDifferenceOffset(0), _expectedValue(0), _actualValue(0), _differenceCount(0),
+      _firstSector(0), _sectorCount(0), _bytesPerSector(0), _detailLimit(DEFAULT_COMPARE_DETAIL_LIMIT),
+      _differentSectorCount(0), _lastSector(0), _isTruncated(false) {
 }
 
 CompareResult::CompareResult(size_t firstDifferenceOffset, UInt8 expectedValue, UInt8 actualValue)
     : _areEqual(false), _firstDifferenceOffset(firstDifferenceOffset), 
-      _expectedValue(expectedValue), _actualValue(actualValue), _differenceCount(1) {
+      _expectedValue(expectedValue), _actualValue(actualValue), _differenceCount(1),
+      _firstSector(0), _sectorCount(0), _bytesPerSector(0), _detailLimit(DEFAULT_COMPARE_DETAIL_LIMIT),
+      _differentSectorCount(0), _lastSector(0), _isTruncated(false) {
+    DifferenceRange range = { firstDifferenceOffset, 1 };
+    _ranges.push_back(range);
+}
+
+CompareResult::CompareResult(size_t firstSector, size_t sectorCount, size_t bytesPerSector, size_t detailLimit)
+    : _areEqual(true), _firstDifferenceOffset(0), _expectedValue(0), _actualValue(0), _differenceCount(0),
+      _firstSector(firstSector), _sectorCount(sectorCount), _bytesPerSector(bytesPerSector), _detailLimit(detailLimit),
+      _differentSectorCount(0), _lastSector(0), _isTruncated(false), _sectorBitmap((sectorCount + 63) / 64, 0) {
 }
 
 void CompareResult::AddDifference(size_t offset, UInt8 expectedValue, UInt8 actualValue) {
+    AddDifferenceRange(offset, 1, expectedValue, actualValue);
+}
+
+void CompareResult::AddDifferenceRange(size_t offset, size_t length, UInt8 expectedValue, UInt8 actualValue) {
+    if (length == 0) {
+        return;
+    }
+
     if (_areEqual) {
         _areEqual = false;
         _firstDifferenceOffset = offset;
         _expectedValue = expectedValue;
         _actualValue = actualValue;
-        _differenceCount = 1;
+    }
+    _differenceCount += length;
+
+    if (!_ranges.empty() && _ranges.back().offset + _ranges.back().length == offset) {
+        _ranges.back().length += length;
+    } else if (_ranges.size() < _detailLimit) {
+        DifferenceRange range = { offset, length };
+        _ranges.push_back(range);
+    } else {
+        _isTruncated = true;
+    }
+
+    // Split the run over the sectors it covers.
+    if (_bytesPerSector != 0) {
+        size_t end = offset + length;
+        while (offset < end) {
+            size_t sector = offset / _bytesPerSector;
+            size_t count = std::min(end, (sector + 1) * _bytesPerSector) - offset;
+            MarkSector(sector, count);
+            offset += count;
+        }
+    }
+}
+
+void CompareResult::AddSectorDifferences(size_t sector, size_t count, size_t firstOffset, UInt8 expectedValue, UInt8 actualValue) {
+    if (count == 0) {
+        return;
+    }
+
+    if (_areEqual) {
+        _areEqual = false;
+        _firstDifferenceOffset = firstOffset;
+        _expectedValue = expectedValue;
+        _actualValue = actualValue;
+    }
+    _differenceCount += count;
+    _isTruncated = true;
+    MarkSector(sector, count);
+}
+
+void CompareResult::Append(const CompareResult& next) {
+    if (next._areEqual) {
+        return;
+    }
+
+    if (_areEqual) {
+        _areEqual = false;
+        _firstDifferenceOffset = next._firstDifferenceOffset;
+        _expectedValue = next._expectedValue;
+        _actualValue = next._actualValue;
+    }
+    _differenceCount += next._differenceCount;
+    _differentSectorCount += next._differentSectorCount;
+    _isTruncated = _isTruncated || next._isTruncated;
+    _lastSector = next._lastSector;
+
+    for (size_t i = 0; i < next._ranges.size(); i++) {
+        const DifferenceRange& range = next._ranges[i];
+        if (i == 0 && !_ranges.empty() && _ranges.back().offset + _ranges.back().length == range.offset) {
+            _ranges.back().length += range.length;
+        } else if (_ranges.size() < _detailLimit) {
+            _ranges.push_back(range);
+        } else {
+            _isTruncated = true;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < next._sectors.size(); i++) {
+        if (_sectors.size() < _detailLimit) {
+            _sectors.push_back(next._sectors[i]);
+        } else {
+            _isTruncated = true;
+            break;
+        }
+    }
+
+    // The bitmap of next continues this one, from bit _sectorCount.
+    size_t shift = _sectorCount % 64;
+    _sectorBitmap.resize((_sectorCount + next._sectorCount + 63) / 64, 0);
+    for (size_t word = 0; word < next._sectorBitmap.size(); word++) {
+        UInt64 bits = next._sectorBitmap[word];
+        if (bits == 0) {
+            continue;
+        }
+        size_t index = _sectorCount / 64 + word;
+        _sectorBitmap[index] |= bits << shift;
+        if (shift != 0 && index + 1 < _sectorBitmap.size()) {
+            _sectorBitmap[index + 1] |= bits >> (64 - shift);
+        }
+    }
+    _sectorCount += next._sectorCount;
+}
+
+bool CompareResult::IsSectorDifferent(size_t sector) const {
+    if (sector < _firstSector || sector - _firstSector >= _sectorCount) {
+        return false;
+    }
+
+    size_t bit = sector - _firstSector;
+    return (_sectorBitmap[bit / 64] >> (bit % 64)) & 1;
+}
+
+void CompareResult::MarkSector(size_t sector, size_t count) {
+    if (_differentSectorCount != 0 && _lastSector == sector) {
+        if (!_sectors.empty() && _sectors.back().sector == sector) {
+            _sectors.back().count += count;
+        }
+        return;
+    }
+    _lastSector = sector;
+
+    size_t bit = sector - _firstSector;
+    if (bit < _sectorCount) {
+        _sectorBitmap[bit / 64] |= 1ULL << (bit % 64);
+    }
+    _differentSectorCount++;
+
+    if (_sectors.size() < _detailLimit) {
+        SectorDifferences differences = { sector, count };
+        _sectors.push_back(differences);
     } else {
-        _differenceCount++;
+        _isTruncated = true;
     }
 }
 
@@ -37,9 +178,12 @@ std::string CompareResult::ToString() const {
            << ", actual 0x" << std::setw(2) << std::setfill('0') 
            << static_cast<int>(_actualValue)
            << ". Total differences: " << std::dec << _differenceCount;
+        if (_differentSectorCount != 0) {
+            ss << " in " << _differentSectorCount << " sectors";
+        }
     }
     
     return ss.str();
 }
 
-} // namespace ufs 
\ No newline at end of file
+} // namespace ufs
@@ -9,6 +9,54 @@
 
 namespace ufs {
 
+/// <summary>
+/// Most difference ranges, and most per-sector counts, a compare keeps by
+/// default.
+/// </summary>
+const size_t DEFAULT_COMPARE_DETAIL_LIMIT = 4096;
+
+/// <summary>
+/// Whether a compare stops at the first difference or finds them all.
+/// </summary>
+enum CompareMode
+{
+    CompareFirstDifference,
+    CompareAllDifferences
+};
+
+/// <summary>
+/// How a compare runs. With CompareAllDifferences every differing byte is
+/// counted and every differing sector marked, but only the first
+/// detailLimit ranges and the first detailLimit sector counts are kept, so
+/// a result stays small however much of the data differs.
+/// </summary>
+struct CompareOptions
+{
+    CompareOptions(CompareMode mode = CompareFirstDifference, size_t detailLimit = DEFAULT_COMPARE_DETAIL_LIMIT)
+        : mode(mode), detailLimit(detailLimit) {}
+
+    CompareMode mode;
+    size_t detailLimit;
+};
+
+/// <summary>
+/// A run of differing bytes, by offset in the buffer compared.
+/// </summary>
+struct DifferenceRange
+{
+    size_t offset;
+    size_t length;
+};
+
+/// <summary>
+/// The number of differing bytes in one sector.
+/// </summary>
+struct SectorDifferences
+{
+    size_t sector;
+    size_t count;
+};
+
 /// <summary>
 /// Represents the result of comparing two buffers
 /// </summary>
@@ -23,6 +71,13 @@ public:
     /// Constructor for unequal buffers
     /// </summary>
     CompareResult(size_t firstDifferenceOffset, UInt8 expectedValue, UInt8 actualValue);
+
+    /// <summary>
+    /// Constructor for a result that collects every difference in sectorCount
+    /// sectors from firstSector, keeping at most detailLimit ranges and
+    /// detailLimit sector counts. Differences are added in offset order.
+    /// </summary>
+    CompareResult(size_t firstSector, size_t sectorCount, size_t bytesPerSector, size_t detailLimit);
     
     /// <summary>
     /// Destructor
@@ -58,6 +113,72 @@ public:
     /// Add a difference to the result
     /// </summary>
     void AddDifference(size_t offset, UInt8 expectedValue, UInt8 actualValue);
+
+    /// <summary>
+    /// Add a run of length differing bytes. The values are those of its
+    /// first byte. A run continuing the last one is joined to it.
+    /// </summary>
+    void AddDifferenceRange(size_t offset, size_t length, UInt8 expectedValue, UInt8 actualValue);
+
+    /// <summary>
+    /// Add count differing bytes of one sector without their ranges, the
+    /// first of them at firstOffset. Used once no more ranges are kept.
+    /// </summary>
+    void AddSectorDifferences(size_t sector, size_t count, size_t firstOffset, UInt8 expectedValue, UInt8 actualValue);
+
+    /// <summary>
+    /// Add the differences of a result over the whole sectors right after
+    /// this one's, keeping the detail limit of this one.
+    /// </summary>
+    void Append(const CompareResult& next);
+
+    /// <summary>
+    /// Get the runs of differing bytes kept, in offset order.
+    /// </summary>
+    const std::vector<DifferenceRange>& GetDifferenceRanges() const { return _ranges; }
+
+    /// <summary>
+    /// Get the differing byte counts kept for differing sectors, in sector
+    /// order.
+    /// </summary>
+    const std::vector<SectorDifferences>& GetSectorDifferences() const { return _sectors; }
+
+    /// <summary>
+    /// Get the number of sectors with a difference, kept or not.
+    /// </summary>
+    size_t GetDifferentSectorCount() const { return _differentSectorCount; }
+
+    /// <summary>
+    /// Check whether a sector compared had a difference. The bitmap has a
+    /// bit for each of the sectors compared, from GetFirstSector.
+    /// </summary>
+    bool IsSectorDifferent(size_t sector) const;
+    const std::vector<UInt64>& GetSectorBitmap() const { return _sectorBitmap; }
+    size_t GetFirstSector() const { return _firstSector; }
+    size_t GetSectorCount() const { return _sectorCount; }
+
+    /// <summary>
+    /// Check whether more than the detail limit of coalesced ranges or of
+    /// differing sectors were found, so some were dropped. A range is
+    /// counted once however many sectors or pieces of a parallel compare it
+    /// spans, so the answer does not depend on the thread count. The counts
+    /// and the bitmap are complete either way.
+    /// </summary>
+    bool IsTruncated() const { return _isTruncated; }
+
+    /// <summary>
+    /// Check whether no more ranges are kept, so the caller can count the
+    /// rest of the differences by sector.
+    /// </summary>
+    bool IsRangeDetailFull() const { return _ranges.size() >= _detailLimit; }
+
+    /// <summary>
+    /// Check whether a difference at offset continues the last range kept,
+    /// so it is joined to it even once no more ranges are kept.
+    /// </summary>
+    bool ContinuesLastRange(size_t offset) const {
+        return !_ranges.empty() && _ranges.back().offset + _ranges.back().length == offset;
+    }
     
     /// <summary>
     /// Convert to string representation
@@ -65,11 +186,24 @@ public:
     virtual std::string ToString() const override;
 
 private:
+    void MarkSector(size_t sector, size_t count);
+
     bool _areEqual;
     size_t _firstDifferenceOffset;
     UInt8 _expectedValue;
     UInt8 _actualValue;
     size_t _differenceCount;
+
+    size_t _firstSector;
+    size_t _sectorCount;
+    size_t _bytesPerSector;
+    size_t _detailLimit;
+    size_t _differentSectorCount;
+    size_t _lastSector;
+    bool _isTruncated;
+    std::vector<DifferenceRange> _ranges;
+    std::vector<SectorDifferences> _sectors;
+    std::vector<UInt64> _sectorBitmap;
 };
 
 } // namespace ufs
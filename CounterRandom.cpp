@@ -0,0 +1,37 @@
+#include "CounterRandom.h"
+#include "DataKernels.h"
+#include "Errors.h"
+
+namespace ufs {
+
+UInt32 CounterRandom::GetWord(UInt64 sector, size_t wordIndex) const {
+    UInt32 counter[4] = {
+        static_cast<UInt32>(wordIndex / 4),
+        static_cast<UInt32>(sector),
+        static_cast<UInt32>(sector >> 32),
+        0
+    };
+    UInt32 key[2] = { static_cast<UInt32>(_seed), static_cast<UInt32>(_seed >> 32) };
+    UInt32 block[4];
+    kernels::Philox4x32(counter, key, block);
+    return block[wordIndex % 4];
+}
+
+void CounterRandom::FillSectors(UInt8* data, size_t bytesPerSector, UInt64 firstSector, size_t sectorCount) const {
+    ValidateBytesPerSector(bytesPerSector);
+    kernels::FillPhilox(reinterpret_cast<UInt32*>(data), bytesPerSector / 4, firstSector, sectorCount, _seed);
+}
+
+std::vector<UInt8> CounterRandom::GetSector(UInt64 sector, size_t bytesPerSector) const {
+    std::vector<UInt8> data(bytesPerSector);
+    FillSectors(data.data(), bytesPerSector, sector, 1);
+    return data;
+}
+
+void CounterRandom::ValidateBytesPerSector(size_t bytesPerSector) {
+    if (bytesPerSector == 0 || bytesPerSector % 4 != 0) {
+        throw RuntimeError("Filling random data is not supported for sector sizes that are not a multiple of 4.");
+    }
+}
+
+} // namespace ufs
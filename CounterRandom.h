@@ -0,0 +1,51 @@
+#pragma once
+#ifndef _COUNTERRANDOM_H_
+#define _COUNTERRANDOM_H_
+
+#include "TypeDefs.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace ufs {
+
+/// <summary>
+/// Counter-based random data (Philox4x32-10). Unlike Random32, whose words
+/// each depend on all the words before them, the words of a sector depend
+/// only on (seed, sector, word index). Any sector range can be generated on
+/// its own, on any number of threads, and always comes out the same; the
+/// expected data of sector 1,000,000 is one call away.
+///
+/// Used by Buffer::FillRandomCounter. Sectors must be a multiple of 4 bytes.
+/// </summary>
+class CounterRandom {
+public:
+    explicit CounterRandom(UInt64 seed) : _seed(seed) {}
+
+    UInt64 GetSeed() const { return _seed; }
+
+    /// <summary>
+    /// Get word wordIndex of sector.
+    /// </summary>
+    UInt32 GetWord(UInt64 sector, size_t wordIndex) const;
+
+    /// <summary>
+    /// Write sectorCount sectors of bytesPerSector bytes to data, for sectors
+    /// firstSector onwards.
+    /// </summary>
+    void FillSectors(UInt8* data, size_t bytesPerSector, UInt64 firstSector, size_t sectorCount) const;
+
+    /// <summary>
+    /// Get the bytes of one sector.
+    /// </summary>
+    std::vector<UInt8> GetSector(UInt64 sector, size_t bytesPerSector) const;
+
+private:
+    static void ValidateBytesPerSector(size_t bytesPerSector);
+
+    UInt64 _seed;
+};
+
+} // namespace ufs
+
+#endif // _COUNTERRANDOM_H_
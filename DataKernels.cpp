@@ -0,0 +1,1262 @@
+#include "DataKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define UFS_HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace ufs {
+namespace kernels {
+
+namespace {
+
+// Largest block copied at once when repeating a pattern. Big memcpy's are
+// actually slower than doubling up to this size.
+const size_t MAX_REPEAT_COPY = 4096;
+
+// Periods shorter than this are generated once and repeated instead.
+const size_t MIN_VECTOR_PERIOD = 64;
+
+// Largest tile FillBytes builds; longer patterns are copied whole instead.
+const size_t MAX_TILE_LENGTH = 64 * 1024;
+
+std::atomic<int> activeSimdLevel(-1);
+
+// About the size of a server's last level cache.
+const size_t DEFAULT_STREAMING_THRESHOLD = 32 * 1024 * 1024;
+
+std::atomic<size_t> streamingThreshold(DEFAULT_STREAMING_THRESHOLD);
+
+// Non-temporal stores only combine into whole line writes when each line
+// is written completely, so they run a line at a time from aligned starts.
+const size_t CACHE_LINE = 64;
+
+// The byte at offset j of a counting pattern, modulo 256.
+inline UInt8 CountingValue(UInt8 startingValue, int direction, size_t j) {
+    return static_cast<UInt8>(direction > 0 ? startingValue + j : startingValue - j);
+}
+
+void FillCountingScalar(UInt8* data, size_t length, size_t period, UInt8 startingValue, int direction) {
+    size_t first = std::min(period, length);
+    for (size_t i = 0; i < first; i++) {
+        data[i] = CountingValue(startingValue, direction, i);
+    }
+    FillRepeating(data, period, length);
+}
+
+#ifdef UFS_HAVE_X86_SIMD
+// Each kernel keeps the next vector of the pattern in a register and steps
+// every lane by the vector width, restarting at each period boundary.
+
+__attribute__((target("sse2")))
+void FillCountingSse2(UInt8* data, size_t length, size_t period, UInt8 startingValue, int direction) {
+    alignas(16) UInt8 lanes[16];
+    for (size_t i = 0; i < 16; i++) {
+        lanes[i] = CountingValue(startingValue, direction, i);
+    }
+    const __m128i first = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+    const __m128i step = _mm_set1_epi8(static_cast<char>(direction * 16));
+    const __m128i lineStep = _mm_set1_epi8(static_cast<char>(direction * 64));
+
+    for (size_t periodStart = 0; periodStart < length; periodStart += period) {
+        UInt8* out = data + periodStart;
+        size_t count = std::min(period, length - periodStart);
+        __m128i value = first;
+        size_t j = 0;
+        // A cache line per iteration, from four independent registers.
+        __m128i v1 = _mm_add_epi8(value, step);
+        __m128i v2 = _mm_add_epi8(v1, step);
+        __m128i v3 = _mm_add_epi8(v2, step);
+        for (; j + 64 <= count; j += 64) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), value);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j + 16), v1);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j + 32), v2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j + 48), v3);
+            value = _mm_add_epi8(value, lineStep);
+            v1 = _mm_add_epi8(v1, lineStep);
+            v2 = _mm_add_epi8(v2, lineStep);
+            v3 = _mm_add_epi8(v3, lineStep);
+        }
+        for (; j + 16 <= count; j += 16) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), value);
+            value = _mm_add_epi8(value, step);
+        }
+        for (; j < count; j++) {
+            out[j] = CountingValue(startingValue, direction, j);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+void FillCountingAvx2(UInt8* data, size_t length, size_t period, UInt8 startingValue, int direction) {
+    alignas(32) UInt8 lanes[32];
+    for (size_t i = 0; i < 32; i++) {
+        lanes[i] = CountingValue(startingValue, direction, i);
+    }
+    const __m256i first = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes));
+    const __m256i step = _mm256_set1_epi8(static_cast<char>(direction * 32));
+    const __m256i lineStep = _mm256_set1_epi8(static_cast<char>(direction * 64));
+
+    for (size_t periodStart = 0; periodStart < length; periodStart += period) {
+        UInt8* out = data + periodStart;
+        size_t count = std::min(period, length - periodStart);
+        __m256i value = first;
+        size_t j = 0;
+        __m256i v1 = _mm256_add_epi8(value, step);
+        for (; j + 64 <= count; j += 64) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j), value);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j + 32), v1);
+            value = _mm256_add_epi8(value, lineStep);
+            v1 = _mm256_add_epi8(v1, lineStep);
+        }
+        for (; j + 32 <= count; j += 32) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j), value);
+            value = _mm256_add_epi8(value, step);
+        }
+        for (; j < count; j++) {
+            out[j] = CountingValue(startingValue, direction, j);
+        }
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void FillCountingAvx512(UInt8* data, size_t length, size_t period, UInt8 startingValue, int direction) {
+    alignas(64) UInt8 lanes[64];
+    for (size_t i = 0; i < 64; i++) {
+        lanes[i] = CountingValue(startingValue, direction, i);
+    }
+    const __m512i first = _mm512_load_si512(lanes);
+    const __m512i step = _mm512_set1_epi8(static_cast<char>(direction * 64));
+
+    for (size_t periodStart = 0; periodStart < length; periodStart += period) {
+        UInt8* out = data + periodStart;
+        size_t count = std::min(period, length - periodStart);
+        __m512i value = first;
+        size_t j = 0;
+        for (; j + 64 <= count; j += 64) {
+            _mm512_storeu_si512(out + j, value);
+            value = _mm512_add_epi8(value, step);
+        }
+        if (j < count) {
+            // The tail of the period is a masked store of the next vector.
+            _mm512_mask_storeu_epi8(out + j, static_cast<__mmask64>((1ULL << (count - j)) - 1), value);
+        }
+    }
+}
+#endif
+
+#ifdef UFS_HAVE_X86_SIMD
+// Stream lines cache lines to destination, which is line aligned. Source
+// may be unaligned.
+__attribute__((target("sse2")))
+void StreamLines(UInt8* destination, const UInt8* source, size_t lines) {
+    for (size_t i = 0; i < lines; i++) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(source + i * CACHE_LINE);
+        __m128i* out = reinterpret_cast<__m128i*>(destination + i * CACHE_LINE);
+        __m128i a = _mm_loadu_si128(in);
+        __m128i b = _mm_loadu_si128(in + 1);
+        __m128i c = _mm_loadu_si128(in + 2);
+        __m128i d = _mm_loadu_si128(in + 3);
+        _mm_stream_si128(out, a);
+        _mm_stream_si128(out + 1, b);
+        _mm_stream_si128(out + 2, c);
+        _mm_stream_si128(out + 3, d);
+    }
+}
+
+// StreamLines from a repeating tile. tile holds tileLength bytes followed
+// by its first CACHE_LINE bytes again, so a line starting anywhere in the
+// tile is one contiguous read. Returns the phase after the last line.
+__attribute__((target("sse2")))
+size_t StreamTileLines(UInt8* destination, size_t lines, const UInt8* tile, size_t tileLength, size_t phase) {
+    for (size_t i = 0; i < lines; i++) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(tile + phase);
+        __m128i* out = reinterpret_cast<__m128i*>(destination + i * CACHE_LINE);
+        __m128i a = _mm_loadu_si128(in);
+        __m128i b = _mm_loadu_si128(in + 1);
+        __m128i c = _mm_loadu_si128(in + 2);
+        __m128i d = _mm_loadu_si128(in + 3);
+        _mm_stream_si128(out, a);
+        _mm_stream_si128(out + 1, b);
+        _mm_stream_si128(out + 2, c);
+        _mm_stream_si128(out + 3, d);
+        phase += CACHE_LINE;
+        while (phase >= tileLength) {
+            phase -= tileLength;
+        }
+    }
+    return phase;
+}
+
+// The offset of the first byte that differs (or, with Equal, the first
+// that is the same), or length. Each 64 bytes are compared with wide loads,
+// and the byte is only looked for once a block's combined mask shows one,
+// so the data is read once.
+template<bool Equal>
+__attribute__((target("sse2")))
+size_t MismatchSse2(const UInt8* left, const UInt8* right, size_t length) {
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64) {
+        const __m128i* l = reinterpret_cast<const __m128i*>(left + i);
+        const __m128i* r = reinterpret_cast<const __m128i*>(right + i);
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(l), _mm_loadu_si128(r));
+        __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128(l + 1), _mm_loadu_si128(r + 1));
+        __m128i c = _mm_cmpeq_epi8(_mm_loadu_si128(l + 2), _mm_loadu_si128(r + 2));
+        __m128i d = _mm_cmpeq_epi8(_mm_loadu_si128(l + 3), _mm_loadu_si128(r + 3));
+        bool found = Equal
+            ? _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0
+            : _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(a, b), _mm_and_si128(c, d))) != 0xFFFF;
+        if (found) {
+            UInt64 equal = static_cast<UInt64>(_mm_movemask_epi8(a))
+                | (static_cast<UInt64>(_mm_movemask_epi8(b)) << 16)
+                | (static_cast<UInt64>(_mm_movemask_epi8(c)) << 32)
+                | (static_cast<UInt64>(_mm_movemask_epi8(d)) << 48);
+            return i + __builtin_ctzll(Equal ? equal : ~equal);
+        }
+    }
+    for (; i + 16 <= length; i += 16) {
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i)));
+        unsigned equal = static_cast<unsigned>(_mm_movemask_epi8(a));
+        unsigned wanted = Equal ? equal : ~equal & 0xFFFF;
+        if (wanted != 0) {
+            return i + __builtin_ctz(wanted);
+        }
+    }
+    for (; i < length && (left[i] == right[i]) != Equal; i++) {
+    }
+    return i;
+}
+
+template<bool Equal>
+__attribute__((target("avx2")))
+size_t MismatchAvx2(const UInt8* left, const UInt8* right, size_t length) {
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64) {
+        const __m256i* l = reinterpret_cast<const __m256i*>(left + i);
+        const __m256i* r = reinterpret_cast<const __m256i*>(right + i);
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(l), _mm256_loadu_si256(r));
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256(l + 1), _mm256_loadu_si256(r + 1));
+        bool found = Equal
+            ? _mm256_movemask_epi8(_mm256_or_si256(a, b)) != 0
+            : static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(a, b))) != 0xFFFFFFFFU;
+        if (found) {
+            UInt64 equal = static_cast<UInt64>(static_cast<UInt32>(_mm256_movemask_epi8(a)))
+                | (static_cast<UInt64>(static_cast<UInt32>(_mm256_movemask_epi8(b))) << 32);
+            return i + __builtin_ctzll(Equal ? equal : ~equal);
+        }
+    }
+    return i + MismatchSse2<Equal>(left + i, right + i, length - i);
+}
+
+template<bool Equal>
+__attribute__((target("avx512f,avx512bw")))
+size_t MismatchAvx512(const UInt8* left, const UInt8* right, size_t length) {
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64) {
+        __m512i l = _mm512_loadu_si512(left + i);
+        __m512i r = _mm512_loadu_si512(right + i);
+        __mmask64 wanted = Equal ? _mm512_cmpeq_epi8_mask(l, r) : _mm512_cmpneq_epi8_mask(l, r);
+        if (wanted != 0) {
+            return i + __builtin_ctzll(wanted);
+        }
+    }
+    if (i < length) {
+        // The tail is a masked load of both ranges.
+        __mmask64 tail = static_cast<__mmask64>((1ULL << (length - i)) - 1);
+        __m512i l = _mm512_maskz_loadu_epi8(tail, left + i);
+        __m512i r = _mm512_maskz_loadu_epi8(tail, right + i);
+        __mmask64 wanted = Equal ? _mm512_mask_cmpeq_epi8_mask(tail, l, r) : _mm512_mask_cmpneq_epi8_mask(tail, l, r);
+        if (wanted != 0) {
+            return i + __builtin_ctzll(wanted);
+        }
+    }
+    return length;
+}
+
+// The number of bytes that differ: the bits of each block's compare mask
+// are counted instead of looked for.
+__attribute__((target("sse2")))
+size_t CountMismatchesSse2(const UInt8* left, const UInt8* right, size_t length) {
+    size_t equal = 0;
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64) {
+        const __m128i* l = reinterpret_cast<const __m128i*>(left + i);
+        const __m128i* r = reinterpret_cast<const __m128i*>(right + i);
+        UInt64 mask = static_cast<UInt64>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(l), _mm_loadu_si128(r))))
+            | (static_cast<UInt64>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(l + 1), _mm_loadu_si128(r + 1)))) << 16)
+            | (static_cast<UInt64>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(l + 2), _mm_loadu_si128(r + 2)))) << 32)
+            | (static_cast<UInt64>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(l + 3), _mm_loadu_si128(r + 3)))) << 48);
+        equal += static_cast<size_t>(__builtin_popcountll(mask));
+    }
+    for (; i < length; i++) {
+        equal += left[i] == right[i];
+    }
+    return length - equal;
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+size_t CountMismatchesAvx512(const UInt8* left, const UInt8* right, size_t length) {
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64) {
+        count += static_cast<size_t>(_mm_popcnt_u64(_mm512_cmpneq_epi8_mask(_mm512_loadu_si512(left + i), _mm512_loadu_si512(right + i))));
+    }
+    if (i < length) {
+        __mmask64 tail = static_cast<__mmask64>((1ULL << (length - i)) - 1);
+        count += static_cast<size_t>(_mm_popcnt_u64(_mm512_mask_cmpneq_epi8_mask(tail, _mm512_maskz_loadu_epi8(tail, left + i), _mm512_maskz_loadu_epi8(tail, right + i))));
+    }
+    return count;
+}
+
+// The bits set in each byte of v, from a table of the bits in each nibble.
+__attribute__((target("avx2")))
+inline __m256i PopCountBytesAvx2(__m256i v) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble));
+    __m256i high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    return _mm256_add_epi8(low, high);
+}
+
+// Bits set in actual but not expected, and the other way round, summed into
+// 64 bit lanes a vector at a time.
+__attribute__((target("avx2")))
+size_t CountBitFlipsAvx2(const UInt8* expected, const UInt8* actual, size_t length, UInt64& zeroToOne, UInt64& oneToZero) {
+    __m256i up = _mm256_setzero_si256();
+    __m256i down = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(expected + i));
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(actual + i));
+        up = _mm256_add_epi64(up, _mm256_sad_epu8(PopCountBytesAvx2(_mm256_andnot_si256(e, a)), _mm256_setzero_si256()));
+        down = _mm256_add_epi64(down, _mm256_sad_epu8(PopCountBytesAvx2(_mm256_andnot_si256(a, e)), _mm256_setzero_si256()));
+    }
+    alignas(32) UInt64 lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), up);
+    zeroToOne += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), down);
+    oneToZero += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+size_t CountBitFlipsAvx512(const UInt8* expected, const UInt8* actual, size_t length, UInt64& zeroToOne, UInt64& oneToZero) {
+    // The bits in each nibble, in every 16 byte lane. A loaded constant and
+    // and/xor instead of andnot keep clear of the intrinsics that start from
+    // an undefined register.
+    alignas(64) static const UInt8 nibbleBits[64] = {
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+    };
+    const __m512i table = _mm512_load_si512(nibbleBits);
+    const __m512i nibble = _mm512_set1_epi8(0x0F);
+    __m512i up = _mm512_setzero_si512();
+    __m512i down = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64) {
+        __m512i e = _mm512_loadu_si512(expected + i);
+        __m512i a = _mm512_loadu_si512(actual + i);
+        __m512i flipped = _mm512_xor_si512(e, a);
+        __m512i set = _mm512_and_si512(flipped, a);
+        __m512i cleared = _mm512_and_si512(flipped, e);
+        __m512i setBits = _mm512_add_epi8(_mm512_shuffle_epi8(table, _mm512_and_si512(set, nibble)),
+                                          _mm512_shuffle_epi8(table, _mm512_and_si512(_mm512_srli_epi16(set, 4), nibble)));
+        __m512i clearedBits = _mm512_add_epi8(_mm512_shuffle_epi8(table, _mm512_and_si512(cleared, nibble)),
+                                              _mm512_shuffle_epi8(table, _mm512_and_si512(_mm512_srli_epi16(cleared, 4), nibble)));
+        up = _mm512_add_epi64(up, _mm512_sad_epu8(setBits, _mm512_setzero_si512()));
+        down = _mm512_add_epi64(down, _mm512_sad_epu8(clearedBits, _mm512_setzero_si512()));
+    }
+    alignas(64) UInt64 lanes[8];
+    _mm512_store_si512(lanes, up);
+    for (int lane = 0; lane < 8; lane++) {
+        zeroToOne += lanes[lane];
+    }
+    _mm512_store_si512(lanes, down);
+    for (int lane = 0; lane < 8; lane++) {
+        oneToZero += lanes[lane];
+    }
+    return i;
+}
+
+// Lines from a tile laid out as for StreamTileLines, through the cache with
+// aligned stores. tileLength is a whole number of lines, so the phase wraps
+// at most once a line.
+__attribute__((target("sse2")))
+size_t StoreTileLinesSse2(UInt8* destination, size_t lines, const UInt8* tile, size_t tileLength, size_t phase) {
+    for (size_t i = 0; i < lines; i++) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(tile + phase);
+        __m128i* out = reinterpret_cast<__m128i*>(destination + i * CACHE_LINE);
+        __m128i a = _mm_loadu_si128(in);
+        __m128i b = _mm_loadu_si128(in + 1);
+        __m128i c = _mm_loadu_si128(in + 2);
+        __m128i d = _mm_loadu_si128(in + 3);
+        _mm_store_si128(out, a);
+        _mm_store_si128(out + 1, b);
+        _mm_store_si128(out + 2, c);
+        _mm_store_si128(out + 3, d);
+        phase += CACHE_LINE;
+        if (phase >= tileLength) {
+            phase -= tileLength;
+        }
+    }
+    return phase;
+}
+
+__attribute__((target("avx2")))
+size_t StoreTileLinesAvx2(UInt8* destination, size_t lines, const UInt8* tile, size_t tileLength, size_t phase) {
+    for (size_t i = 0; i < lines; i++) {
+        const __m256i* in = reinterpret_cast<const __m256i*>(tile + phase);
+        __m256i* out = reinterpret_cast<__m256i*>(destination + i * CACHE_LINE);
+        __m256i a = _mm256_loadu_si256(in);
+        __m256i b = _mm256_loadu_si256(in + 1);
+        _mm256_store_si256(out, a);
+        _mm256_store_si256(out + 1, b);
+        phase += CACHE_LINE;
+        if (phase >= tileLength) {
+            phase -= tileLength;
+        }
+    }
+    return phase;
+}
+#endif
+
+#ifdef UFS_HAVE_X86_SIMD
+__attribute__((target("sse4.2")))
+UInt32 Crc32cHardware(const UInt8* data, size_t length, UInt32 crc) {
+    size_t i = 0;
+#ifdef __x86_64__
+    UInt64 wide = crc;
+    for (; i + 8 <= length; i += 8) {
+        UInt64 word;
+        ::memcpy(&word, data + i, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+    }
+    crc = static_cast<UInt32>(wide);
+#endif
+    for (; i < length; i++) {
+        crc = _mm_crc32_u8(crc, data[i]);
+    }
+    return crc;
+}
+#endif
+
+UInt32 Crc32cTable(const UInt8* data, size_t length, UInt32 crc) {
+    static const struct Crc32cLookup {
+        UInt32 entries[256];
+        Crc32cLookup() {
+            for (UInt32 i = 0; i < 256; i++) {
+                UInt32 value = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    value = (value >> 1) ^ ((value & 1) ? 0x82F63B78 : 0);
+                }
+                entries[i] = value;
+            }
+        }
+    } table;
+
+    for (size_t i = 0; i < length; i++) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+inline unsigned PopCount64(UInt64 value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_popcountll(value));
+#else
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<unsigned>((value * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// 64 bits of an MSB first bit stream starting at bit, reading at most the
+// bytes holding bits [bit, bit + 64).
+inline UInt64 LoadBits(const UInt8* data, UInt64 bit) {
+    const UInt8* in = data + bit / 8;
+    UInt64 word = 0;
+    for (int i = 0; i < 8; i++) {
+        word = (word << 8) | in[i];
+    }
+    unsigned shift = static_cast<unsigned>(bit % 8);
+    return shift == 0 ? word : (word << shift) | (in[8] >> (8 - shift));
+}
+
+inline void StoreBigEndian(UInt8* out, UInt64 word, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = static_cast<UInt8>(word >> (56 - 8 * i));
+    }
+}
+
+// Bytes before the first cache line boundary at or after data.
+inline size_t BytesToLine(const UInt8* data, size_t length) {
+    size_t misalignment = reinterpret_cast<uintptr_t>(data) % CACHE_LINE;
+    return std::min(length, misalignment == 0 ? 0 : CACHE_LINE - misalignment);
+}
+
+void FillCounting(UInt8* data, size_t length, size_t period, UInt8 startingValue, int direction) {
+    if (period < MIN_VECTOR_PERIOD) {
+        FillCountingScalar(data, length, period, startingValue, direction);
+        return;
+    }
+
+    switch (GetSimdLevel()) {
+#ifdef UFS_HAVE_X86_SIMD
+    case SimdAvx512:
+        FillCountingAvx512(data, length, period, startingValue, direction);
+        break;
+    case SimdAvx2:
+        FillCountingAvx2(data, length, period, startingValue, direction);
+        break;
+    case SimdSse2:
+        FillCountingSse2(data, length, period, startingValue, direction);
+        break;
+#endif
+    default:
+        FillCountingScalar(data, length, period, startingValue, direction);
+        break;
+    }
+}
+
+// taus88 is three Tausworthe generators xor'ed together. Each step is
+// linear over GF(2), so a jump of n steps is a 32x32 bit matrix, kept as
+// one column word per input bit.
+const size_t RANDOM_LANES = 8;
+
+// Runs shorter than this (in words) aren't worth the jump ahead.
+const size_t MIN_TAUS88_LANE_RUN = 64;
+
+inline UInt32 Taus88Step1(UInt32 z) { return ((z & 0xFFFFFFFEU) << 12) ^ (((z << 13) ^ z) >> 19); }
+inline UInt32 Taus88Step2(UInt32 z) { return ((z & 0xFFFFFFF8U) << 4) ^ (((z << 2) ^ z) >> 25); }
+inline UInt32 Taus88Step3(UInt32 z) { return ((z & 0xFFFFFFF0U) << 17) ^ (((z << 3) ^ z) >> 11); }
+
+struct JumpTable {
+    // powers[c][p] is component c advanced 2^p steps.
+    UInt32 powers[3][64][32];
+
+    JumpTable() {
+        for (int bit = 0; bit < 32; bit++) {
+            powers[0][0][bit] = Taus88Step1(1U << bit);
+            powers[1][0][bit] = Taus88Step2(1U << bit);
+            powers[2][0][bit] = Taus88Step3(1U << bit);
+        }
+        for (int c = 0; c < 3; c++) {
+            for (int p = 1; p < 64; p++) {
+                for (int bit = 0; bit < 32; bit++) {
+                    powers[c][p][bit] = Apply(powers[c][p - 1], powers[c][p - 1][bit]);
+                }
+            }
+        }
+    }
+
+    static UInt32 Apply(const UInt32 (&matrix)[32], UInt32 value) {
+        UInt32 result = 0;
+        for (int bit = 0; value != 0; bit++, value >>= 1) {
+            if (value & 1) {
+                result ^= matrix[bit];
+            }
+        }
+        return result;
+    }
+
+    void Jump(UInt32 state[3], UInt64 steps) const {
+        for (int p = 0; steps != 0; p++, steps >>= 1) {
+            if (steps & 1) {
+                for (int c = 0; c < 3; c++) {
+                    state[c] = Apply(powers[c][p], state[c]);
+                }
+            }
+        }
+    }
+};
+
+void FillTaus88Scalar(UInt32* words, size_t count, UInt32 state[3]) {
+    UInt32 z1 = state[0];
+    UInt32 z2 = state[1];
+    UInt32 z3 = state[2];
+    for (size_t i = 0; i < count; i++) {
+        z1 = Taus88Step1(z1);
+        z2 = Taus88Step2(z2);
+        z3 = Taus88Step3(z3);
+        words[i] = z1 ^ z2 ^ z3;
+    }
+    state[0] = z1;
+    state[1] = z2;
+    state[2] = z3;
+}
+
+// Lane l writes words [l * run, (l + 1) * run). The lanes step together, so
+// the compiler keeps each component of all lanes in one vector; blocks of
+// RANDOM_LANES steps are transposed through a small array on the way out.
+inline void FillTaus88LanesBody(UInt32* words, size_t run, UInt32 (&z)[3][RANDOM_LANES]) {
+    UInt32 block[RANDOM_LANES][RANDOM_LANES];
+    for (size_t done = 0; done < run; done += RANDOM_LANES) {
+        size_t steps = std::min(RANDOM_LANES, run - done);
+        for (size_t t = 0; t < steps; t++) {
+            for (size_t l = 0; l < RANDOM_LANES; l++) {
+                z[0][l] = Taus88Step1(z[0][l]);
+                z[1][l] = Taus88Step2(z[1][l]);
+                z[2][l] = Taus88Step3(z[2][l]);
+                block[t][l] = z[0][l] ^ z[1][l] ^ z[2][l];
+            }
+        }
+        for (size_t l = 0; l < RANDOM_LANES; l++) {
+            UInt32* out = words + l * run + done;
+            for (size_t t = 0; t < steps; t++) {
+                out[t] = block[t][l];
+            }
+        }
+    }
+}
+
+void FillTaus88Lanes(UInt32* words, size_t run, UInt32 (&z)[3][RANDOM_LANES]) {
+    FillTaus88LanesBody(words, run, z);
+}
+
+#ifdef UFS_HAVE_X86_SIMD
+__attribute__((target("avx2")))
+void FillTaus88LanesAvx2(UInt32* words, size_t run, UInt32 (&z)[3][RANDOM_LANES]) {
+    FillTaus88LanesBody(words, run, z);
+}
+#endif
+
+inline UInt32 RotateLeft(UInt32 value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+inline UInt64 SplitMix64(UInt64& x) {
+    UInt64 z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Word i of the output is lane i % RANDOM_LANES, so a round of the lanes is
+// one contiguous store. The tail is a partial round.
+inline void FillXoshiroBody(UInt32* words, size_t count, UInt32 (&s)[4][RANDOM_LANES]) {
+    UInt32 round[RANDOM_LANES];
+    for (size_t done = 0; done < count; done += RANDOM_LANES) {
+        for (size_t l = 0; l < RANDOM_LANES; l++) {
+            round[l] = RotateLeft(s[0][l] + s[3][l], 7) + s[0][l];
+            UInt32 t = s[1][l] << 9;
+            s[2][l] ^= s[0][l];
+            s[3][l] ^= s[1][l];
+            s[1][l] ^= s[2][l];
+            s[0][l] ^= s[3][l];
+            s[2][l] ^= t;
+            s[3][l] = RotateLeft(s[3][l], 11);
+        }
+        size_t n = std::min(RANDOM_LANES, count - done);
+        for (size_t l = 0; l < n; l++) {
+            words[done + l] = round[l];
+        }
+    }
+}
+
+void FillXoshiroLanes(UInt32* words, size_t count, UInt32 (&s)[4][RANDOM_LANES]) {
+    FillXoshiroBody(words, count, s);
+}
+
+#ifdef UFS_HAVE_X86_SIMD
+__attribute__((target("avx2")))
+void FillXoshiroLanesAvx2(UInt32* words, size_t count, UInt32 (&s)[4][RANDOM_LANES]) {
+    FillXoshiroBody(words, count, s);
+}
+#endif
+
+// Philox4x32-10 constants (Salmon et al., "Parallel random numbers: as
+// easy as 1, 2, 3").
+const UInt32 PHILOX_M0 = 0xD2511F53;
+const UInt32 PHILOX_M1 = 0xCD9E8D57;
+const UInt32 PHILOX_W0 = 0x9E3779B9;
+const UInt32 PHILOX_W1 = 0xBB67AE85;
+const int PHILOX_ROUNDS = 10;
+
+// Ten rounds over RANDOM_LANES counters at once; the 32x32 bit multiplies
+// vectorize as widening multiplies.
+inline void PhiloxRounds(UInt32 (&c)[4][RANDOM_LANES], UInt32 k0, UInt32 k1) {
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        for (size_t l = 0; l < RANDOM_LANES; l++) {
+            UInt64 p0 = static_cast<UInt64>(PHILOX_M0) * c[0][l];
+            UInt64 p1 = static_cast<UInt64>(PHILOX_M1) * c[2][l];
+            UInt32 n0 = static_cast<UInt32>(p1 >> 32) ^ c[1][l] ^ k0;
+            UInt32 n2 = static_cast<UInt32>(p0 >> 32) ^ c[3][l] ^ k1;
+            c[0][l] = n0;
+            c[1][l] = static_cast<UInt32>(p1);
+            c[2][l] = n2;
+            c[3][l] = static_cast<UInt32>(p0);
+        }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+inline void FillPhiloxBody(UInt32* words, size_t wordsPerSector, UInt64 firstSector, size_t sectorCount, UInt32 k0, UInt32 k1) {
+    size_t blocks = (wordsPerSector + 3) / 4;
+    for (size_t s = 0; s < sectorCount; s++) {
+        UInt64 sector = firstSector + s;
+        UInt32* out = words + s * wordsPerSector;
+        for (size_t block = 0; block < blocks; block += RANDOM_LANES) {
+            UInt32 c[4][RANDOM_LANES];
+            for (size_t l = 0; l < RANDOM_LANES; l++) {
+                c[0][l] = static_cast<UInt32>(block + l);
+                c[1][l] = static_cast<UInt32>(sector);
+                c[2][l] = static_cast<UInt32>(sector >> 32);
+                c[3][l] = 0;
+            }
+            PhiloxRounds(c, k0, k1);
+
+            size_t first = block * 4;
+            if (first + RANDOM_LANES * 4 <= wordsPerSector) {
+                for (size_t l = 0; l < RANDOM_LANES; l++) {
+                    for (size_t j = 0; j < 4; j++) {
+                        out[first + l * 4 + j] = c[j][l];
+                    }
+                }
+            } else {
+                for (size_t i = first; i < wordsPerSector; i++) {
+                    out[i] = c[(i - first) % 4][(i - first) / 4];
+                }
+            }
+        }
+    }
+}
+
+void FillPhiloxLanes(UInt32* words, size_t wordsPerSector, UInt64 firstSector, size_t sectorCount, UInt32 k0, UInt32 k1) {
+    FillPhiloxBody(words, wordsPerSector, firstSector, sectorCount, k0, k1);
+}
+
+#ifdef UFS_HAVE_X86_SIMD
+// The high and low words of the 32x32 bit products of all eight lanes.
+__attribute__((target("avx2")))
+inline void MultiplyHighLow(__m256i a, __m256i m, __m256i& high, __m256i& low) {
+    __m256i even = _mm256_mul_epu32(a, m);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    high = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+    low = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+}
+
+// The compiler doesn't vectorize the widening multiplies of PhiloxRounds,
+// so the AVX2 version is written out.
+__attribute__((target("avx2")))
+void FillPhiloxLanesAvx2(UInt32* words, size_t wordsPerSector, UInt64 firstSector, size_t sectorCount, UInt32 k0, UInt32 k1) {
+    const __m256i m0 = _mm256_set1_epi32(static_cast<int>(PHILOX_M0));
+    const __m256i m1 = _mm256_set1_epi32(static_cast<int>(PHILOX_M1));
+    const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t blocks = (wordsPerSector + 3) / 4;
+
+    for (size_t s = 0; s < sectorCount; s++) {
+        UInt64 sector = firstSector + s;
+        UInt32* out = words + s * wordsPerSector;
+        const __m256i sectorLow = _mm256_set1_epi32(static_cast<int>(static_cast<UInt32>(sector)));
+        const __m256i sectorHigh = _mm256_set1_epi32(static_cast<int>(static_cast<UInt32>(sector >> 32)));
+
+        for (size_t block = 0; block < blocks; block += RANDOM_LANES) {
+            __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(block)), laneIndex);
+            __m256i c1 = sectorLow;
+            __m256i c2 = sectorHigh;
+            __m256i c3 = _mm256_setzero_si256();
+            UInt32 key0 = k0;
+            UInt32 key1 = k1;
+            for (int round = 0; round < PHILOX_ROUNDS; round++) {
+                __m256i high0, low0, high1, low1;
+                MultiplyHighLow(c0, m0, high0, low0);
+                MultiplyHighLow(c2, m1, high1, low1);
+                c0 = _mm256_xor_si256(_mm256_xor_si256(high1, c1), _mm256_set1_epi32(static_cast<int>(key0)));
+                c1 = low1;
+                c2 = _mm256_xor_si256(_mm256_xor_si256(high0, c3), _mm256_set1_epi32(static_cast<int>(key1)));
+                c3 = low0;
+                key0 += PHILOX_W0;
+                key1 += PHILOX_W1;
+            }
+
+            // Transpose so each lane's four words are consecutive.
+            __m256i t01Low = _mm256_unpacklo_epi32(c0, c1);
+            __m256i t01High = _mm256_unpackhi_epi32(c0, c1);
+            __m256i t23Low = _mm256_unpacklo_epi32(c2, c3);
+            __m256i t23High = _mm256_unpackhi_epi32(c2, c3);
+            __m256i lanes04 = _mm256_unpacklo_epi64(t01Low, t23Low);
+            __m256i lanes15 = _mm256_unpackhi_epi64(t01Low, t23Low);
+            __m256i lanes26 = _mm256_unpacklo_epi64(t01High, t23High);
+            __m256i lanes37 = _mm256_unpackhi_epi64(t01High, t23High);
+            __m256i result[4] = {
+                _mm256_permute2x128_si256(lanes04, lanes15, 0x20),
+                _mm256_permute2x128_si256(lanes26, lanes37, 0x20),
+                _mm256_permute2x128_si256(lanes04, lanes15, 0x31),
+                _mm256_permute2x128_si256(lanes26, lanes37, 0x31) };
+
+            size_t first = block * 4;
+            if (first + RANDOM_LANES * 4 <= wordsPerSector) {
+                for (int i = 0; i < 4; i++) {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + first + i * 8), result[i]);
+                }
+            } else {
+                ::memcpy(out + first, result, (wordsPerSector - first) * sizeof(UInt32));
+            }
+        }
+    }
+}
+#endif
+
+} // namespace
+
+SimdLevel GetSupportedSimdLevel() {
+    static const SimdLevel supported = []() {
+#ifdef UFS_HAVE_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+            return SimdAvx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdAvx2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return SimdSse2;
+        }
+#endif
+        return SimdScalar;
+    }();
+    return supported;
+}
+
+SimdLevel GetSimdLevel() {
+    int level = activeSimdLevel.load(std::memory_order_relaxed);
+    if (level < 0) {
+        level = GetSupportedSimdLevel();
+        activeSimdLevel.store(level, std::memory_order_relaxed);
+    }
+    return static_cast<SimdLevel>(level);
+}
+
+void SetSimdLevel(SimdLevel level) {
+    activeSimdLevel.store(std::min(level, GetSupportedSimdLevel()), std::memory_order_relaxed);
+}
+
+size_t GetStreamingThreshold() {
+    return streamingThreshold.load(std::memory_order_relaxed);
+}
+
+void SetStreamingThreshold(size_t bytes) {
+    streamingThreshold.store(bytes, std::memory_order_relaxed);
+}
+
+void StreamCopy(UInt8* destination, const UInt8* source, size_t length) {
+#ifdef UFS_HAVE_X86_SIMD
+    if (GetSimdLevel() >= SimdSse2) {
+        size_t head = BytesToLine(destination, length);
+        ::memcpy(destination, source, head);
+        size_t lines = (length - head) / CACHE_LINE;
+        StreamLines(destination + head, source + head, lines);
+        size_t done = head + lines * CACHE_LINE;
+        ::memcpy(destination + done, source + done, length - done);
+        _mm_sfence();
+        return;
+    }
+#endif
+    ::memcpy(destination, source, length);
+}
+
+void StreamRepeat(UInt8* data, size_t length, const UInt8* tile, size_t tileLength) {
+    if (length == 0 || tileLength == 0) {
+        return;
+    }
+
+#ifdef UFS_HAVE_X86_SIMD
+    if (GetSimdLevel() >= SimdSse2) {
+        std::vector<UInt8> wrapped(tile, tile + tileLength);
+        for (size_t i = 0; i < CACHE_LINE; i++) {
+            wrapped.push_back(tile[i % tileLength]);
+        }
+
+        size_t head = BytesToLine(data, length);
+        ::memcpy(data, wrapped.data(), head);
+        size_t phase = head % tileLength;
+        size_t lines = (length - head) / CACHE_LINE;
+        phase = StreamTileLines(data + head, lines, wrapped.data(), tileLength, phase);
+        size_t done = head + lines * CACHE_LINE;
+        ::memcpy(data + done, wrapped.data() + phase, length - done);
+        _mm_sfence();
+        return;
+    }
+#endif
+    for (size_t done = 0; done < length; done += tileLength) {
+        ::memcpy(data + done, tile, std::min(tileLength, length - done));
+    }
+}
+
+void FillRepeating(UInt8* data, size_t patternLength, size_t length) {
+    // Loop, doubling the data we copy each time.
+    size_t filled = std::min(patternLength, length);
+    while (filled < length) {
+        size_t copyLength = std::min(patternLength, length - filled);
+        ::memcpy(data + filled, data, copyLength);
+        filled += copyLength;
+        patternLength = patternLength >= MAX_REPEAT_COPY ? patternLength : patternLength * 2;
+    }
+}
+
+void FillBytes(UInt8* data, size_t length, const UInt8* pattern, size_t patternLength, size_t restartPeriod) {
+    if (length == 0 || patternLength == 0) {
+        return;
+    }
+
+    size_t period = restartPeriod == 0 ? length : std::min(restartPeriod, length);
+    size_t tileLength = std::lcm(patternLength, CACHE_LINE);
+#ifdef UFS_HAVE_X86_SIMD
+    if (tileLength <= MAX_TILE_LENGTH && GetSimdLevel() >= SimdSse2) {
+        // Whole patterns and whole lines, then the first line again, so
+        // every line of every period is one load from the tile.
+        std::vector<UInt8> tile(tileLength + CACHE_LINE);
+        ::memcpy(tile.data(), pattern, patternLength);
+        FillRepeating(tile.data(), patternLength, tile.size());
+
+        bool avx2 = GetSimdLevel() >= SimdAvx2;
+        for (size_t start = 0; start < length; start += period) {
+            UInt8* out = data + start;
+            size_t count = std::min(period, length - start);
+            size_t head = BytesToLine(out, count);
+            ::memcpy(out, tile.data(), head);
+            size_t lines = (count - head) / CACHE_LINE;
+            size_t phase = avx2
+                ? StoreTileLinesAvx2(out + head, lines, tile.data(), tileLength, head)
+                : StoreTileLinesSse2(out + head, lines, tile.data(), tileLength, head);
+            size_t done = head + lines * CACHE_LINE;
+            ::memcpy(out + done, tile.data() + phase, count - done);
+        }
+        return;
+    }
+#endif
+    ::memcpy(data, pattern, std::min(patternLength, period));
+    FillRepeating(data, patternLength, period);
+    FillRepeating(data, period, length);
+}
+
+void FillIncrementing(UInt8* data, size_t length, size_t period, UInt8 startingValue) {
+    FillCounting(data, length, period, startingValue, 1);
+}
+
+void FillDecrementing(UInt8* data, size_t length, size_t period, UInt8 startingValue) {
+    FillCounting(data, length, period, startingValue, -1);
+}
+
+void FillTaus88(UInt32* words, size_t count, UInt32 state[3]) {
+    size_t run = count / RANDOM_LANES;
+    if (run < MIN_TAUS88_LANE_RUN) {
+        FillTaus88Scalar(words, count, state);
+        return;
+    }
+
+    static const JumpTable table;
+    UInt32 z[3][RANDOM_LANES];
+    UInt32 lane[3] = { state[0], state[1], state[2] };
+    for (size_t l = 0; l < RANDOM_LANES; l++) {
+        for (int c = 0; c < 3; c++) {
+            z[c][l] = lane[c];
+        }
+        table.Jump(lane, run);
+    }
+
+#ifdef UFS_HAVE_X86_SIMD
+    if (GetSimdLevel() >= SimdAvx2) {
+        FillTaus88LanesAvx2(words, run, z);
+    } else
+#endif
+    {
+        FillTaus88Lanes(words, run, z);
+    }
+
+    // The last lane ends where the sequence continues.
+    for (int c = 0; c < 3; c++) {
+        state[c] = z[c][RANDOM_LANES - 1];
+    }
+    size_t done = run * RANDOM_LANES;
+    FillTaus88Scalar(words + done, count - done, state);
+}
+
+void FillXoshiro(UInt32* words, size_t count, UInt64 seed) {
+    XoshiroState state;
+    SeedXoshiro(state, seed);
+    FillXoshiro(words, count, state);
+}
+
+void SeedXoshiro(XoshiroState& state, UInt64 seed) {
+    static_assert(sizeof(state.s[0]) / sizeof(state.s[0][0]) == RANDOM_LANES, "XoshiroState has a word per lane");
+    for (size_t l = 0; l < RANDOM_LANES; l++) {
+        UInt64 low = SplitMix64(seed);
+        UInt64 high = SplitMix64(seed);
+        state.s[0][l] = static_cast<UInt32>(low);
+        state.s[1][l] = static_cast<UInt32>(low >> 32);
+        state.s[2][l] = static_cast<UInt32>(high);
+        state.s[3][l] = static_cast<UInt32>(high >> 32);
+    }
+}
+
+void FillXoshiro(UInt32* words, size_t count, XoshiroState& state) {
+#ifdef UFS_HAVE_X86_SIMD
+    if (GetSimdLevel() >= SimdAvx2) {
+        FillXoshiroLanesAvx2(words, count, state.s);
+        return;
+    }
+#endif
+    FillXoshiroLanes(words, count, state.s);
+}
+
+void Philox4x32(const UInt32 counter[4], const UInt32 key[2], UInt32 result[4]) {
+    UInt32 c[4][RANDOM_LANES] = {};
+    for (size_t j = 0; j < 4; j++) {
+        c[j][0] = counter[j];
+    }
+    PhiloxRounds(c, key[0], key[1]);
+    for (size_t j = 0; j < 4; j++) {
+        result[j] = c[j][0];
+    }
+}
+
+void FillPhilox(UInt32* words, size_t wordsPerSector, UInt64 firstSector, size_t sectorCount, UInt64 seed) {
+    UInt32 k0 = static_cast<UInt32>(seed);
+    UInt32 k1 = static_cast<UInt32>(seed >> 32);
+#ifdef UFS_HAVE_X86_SIMD
+    if (GetSimdLevel() >= SimdAvx2) {
+        FillPhiloxLanesAvx2(words, wordsPerSector, firstSector, sectorCount, k0, k1);
+        return;
+    }
+#endif
+    FillPhiloxLanes(words, wordsPerSector, firstSector, sectorCount, k0, k1);
+}
+
+void FillPrbs(UInt8* data, size_t length, unsigned order, unsigned tap, UInt32& state) {
+    const UInt32 mask = order >= 32 ? 0xFFFFFFFF : (1U << order) - 1;
+
+    // Squaring the feedback polynomial doubles both distances:
+    // b[n] = b[n - 2 * order] ^ b[n - 2 * tap], and so on.
+    UInt64 far = order;
+    UInt64 near = tap;
+    while (near < 64) {
+        far *= 2;
+        near *= 2;
+    }
+
+    // Bit serial until there are far bits to read back from, rounded up to
+    // whole words.
+    size_t serialBytes = std::min<size_t>(length, (far + 63) / 64 * 8);
+    UInt32 r = state & mask;
+    for (size_t i = 0; i < serialBytes; i++) {
+        UInt32 byte = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            UInt32 next = ((r >> (order - 1)) ^ (r >> (tap - 1))) & 1;
+            r = ((r << 1) | next) & mask;
+            byte = (byte << 1) | next;
+        }
+        data[i] = static_cast<UInt8>(byte);
+    }
+
+    for (size_t pos = serialBytes; pos < length; pos += 8) {
+        UInt64 n = static_cast<UInt64>(pos) * 8;
+        UInt64 word = LoadBits(data, n - far) ^ LoadBits(data, n - near);
+        StoreBigEndian(data + pos, word, std::min<size_t>(8, length - pos));
+    }
+
+    if (length > serialBytes) {
+        r = static_cast<UInt32>(LoadBits(data, static_cast<UInt64>(length) * 8 - 64)) & mask;
+    }
+    state = r;
+}
+
+UInt64 CountBitDifferences(const UInt8* left, const UInt8* right, size_t length) {
+    UInt64 count = 0;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        UInt64 a;
+        UInt64 b;
+        ::memcpy(&a, left + i, sizeof(a));
+        ::memcpy(&b, right + i, sizeof(b));
+        count += PopCount64(a ^ b);
+    }
+    for (; i < length; i++) {
+        count += PopCount64(static_cast<UInt64>(left[i] ^ right[i]));
+    }
+    return count;
+}
+
+void CountBitFlips(const UInt8* expected, const UInt8* actual, size_t length, UInt64& zeroToOne, UInt64& oneToZero) {
+    zeroToOne = 0;
+    oneToZero = 0;
+    size_t i = 0;
+    switch (GetSimdLevel()) {
+#ifdef UFS_HAVE_X86_SIMD
+    case SimdAvx512:
+        i = CountBitFlipsAvx512(expected, actual, length, zeroToOne, oneToZero);
+        break;
+    case SimdAvx2:
+        i = CountBitFlipsAvx2(expected, actual, length, zeroToOne, oneToZero);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    for (; i + 8 <= length; i += 8) {
+        UInt64 e;
+        UInt64 a;
+        ::memcpy(&e, expected + i, sizeof(e));
+        ::memcpy(&a, actual + i, sizeof(a));
+        zeroToOne += PopCount64(~e & a);
+        oneToZero += PopCount64(e & ~a);
+    }
+    for (; i < length; i++) {
+        zeroToOne += PopCount64(static_cast<UInt8>(~expected[i] & actual[i]));
+        oneToZero += PopCount64(static_cast<UInt8>(expected[i] & ~actual[i]));
+    }
+}
+
+UInt8 ChecksumByte(const UInt8* data, size_t length) {
+    UInt8 result = 0;
+    for (size_t i = 0; i < length; i++) {
+        result = static_cast<UInt8>(result + data[i]);
+    }
+
+    // 2's complement calculation is the complement of the sum of the values, plus 1;
+    return static_cast<UInt8>((~result) + 1);
+}
+
+UInt32 Crc32c(const UInt8* data, size_t length, UInt32 crc) {
+    crc = ~crc;
+#ifdef UFS_HAVE_X86_SIMD
+    static const bool hasCrc32 = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2") != 0;
+    }();
+    if (hasCrc32 && GetSimdLevel() > SimdScalar) {
+        return ~Crc32cHardware(data, length, crc);
+    }
+#endif
+    return ~Crc32cTable(data, length, crc);
+}
+
+UInt64 CountBits(const UInt8* data, size_t length, UInt8 value) {
+    // To count 0 bits, invert the bits and count the 1 bits.
+    UInt8 invertMask = value == 0 ? 0xFF : 0x00;
+
+    // For performance, use a lookup table of the count of 1s in each byte.
+    static const struct BitCountTable {
+        UInt8 counts[256];
+        BitCountTable() {
+            for (int i = 0; i < 256; ++i) {
+                UInt8 count = 0;
+                for (int bit = 0; bit < 8; ++bit) {
+                    count = static_cast<UInt8>(count + ((i >> bit) & 0x1));
+                }
+                counts[i] = count;
+            }
+        }
+    } table;
+
+    UInt64 bitCount = 0;
+    for (size_t i = 0; i < length; ++i) {
+        bitCount += table.counts[data[i] ^ invertMask];
+    }
+    return bitCount;
+}
+
+bool IsAllZeros(const UInt8* data, size_t length) {
+    if (length == 0) {
+        return true;
+    }
+
+    // Compare data[0, length-1] to data[1, length]; equal and data[0] == 0
+    // means every byte is zero.
+    return data[0] == 0 && ::memcmp(data, data + 1, length - 1) == 0;
+}
+
+bool FindFirstMismatch(const UInt8* left, const UInt8* right, size_t length, size_t& offset) {
+    size_t found = length;
+    switch (GetSimdLevel()) {
+#ifdef UFS_HAVE_X86_SIMD
+    case SimdAvx512:
+        found = MismatchAvx512<false>(left, right, length);
+        break;
+    case SimdAvx2:
+        found = MismatchAvx2<false>(left, right, length);
+        break;
+    case SimdSse2:
+        found = MismatchSse2<false>(left, right, length);
+        break;
+#endif
+    default:
+        // memcmp only says whether the ranges differ, so a difference is
+        // looked for again a byte at a time.
+        if (::memcmp(left, right, length) != 0) {
+            for (found = 0; left[found] == right[found]; found++) {
+            }
+        }
+        break;
+    }
+
+    if (found == length) {
+        return false;
+    }
+    offset = found;
+    return true;
+}
+
+bool FindFirstMatch(const UInt8* left, const UInt8* right, size_t length, size_t& offset) {
+    size_t found = length;
+    switch (GetSimdLevel()) {
+#ifdef UFS_HAVE_X86_SIMD
+    case SimdAvx512:
+        found = MismatchAvx512<true>(left, right, length);
+        break;
+    case SimdAvx2:
+        found = MismatchAvx2<true>(left, right, length);
+        break;
+    case SimdSse2:
+        found = MismatchSse2<true>(left, right, length);
+        break;
+#endif
+    default:
+        for (found = 0; found < length && left[found] != right[found]; found++) {
+        }
+        break;
+    }
+
+    if (found == length) {
+        return false;
+    }
+    offset = found;
+    return true;
+}
+
+size_t CountMismatches(const UInt8* left, const UInt8* right, size_t length) {
+    switch (GetSimdLevel()) {
+#ifdef UFS_HAVE_X86_SIMD
+    case SimdAvx512:
+        return CountMismatchesAvx512(left, right, length);
+    case SimdAvx2:
+    case SimdSse2:
+        return CountMismatchesSse2(left, right, length);
+#endif
+    default:
+        break;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        count += left[i] != right[i];
+    }
+    return count;
+}
+
+} // namespace kernels
+} // namespace ufs
@@ -0,0 +1,200 @@
+#pragma once
+#ifndef _DATAKERNELS_H_
+#define _DATAKERNELS_H_
+
+#include "TypeDefs.h"
+#include <cstddef>
+
+namespace ufs {
+namespace kernels {
+
+/// <summary>
+/// Instruction sets the kernels can use. The best one the CPU supports is
+/// picked at run time.
+/// </summary>
+enum SimdLevel
+{
+    SimdScalar = 0,
+    SimdSse2 = 1,
+    SimdAvx2 = 2,
+    SimdAvx512 = 3
+};
+
+/// <summary>
+/// Get the best instruction set supported by this CPU and build.
+/// </summary>
+SimdLevel GetSupportedSimdLevel();
+
+/// <summary>
+/// Get or set the instruction set the kernels use. Requests above the
+/// supported level are lowered to it. Meant for tests and benchmarks
+/// comparing the kernels against each other.
+/// </summary>
+SimdLevel GetSimdLevel();
+void SetSimdLevel(SimdLevel level);
+
+/// <summary>
+/// Get or set the smallest write, in bytes, that Buffer makes with
+/// non-temporal (streaming) stores. These go straight to memory instead of
+/// through the cache, which saves reading each line in before it is
+/// overwritten and keeps writes bigger than the cache from evicting
+/// everything else. Defaults to 32MB; SIZE_MAX turns streaming off.
+/// </summary>
+size_t GetStreamingThreshold();
+void SetStreamingThreshold(size_t bytes);
+
+/// <summary>
+/// Copy length bytes between ranges that don't overlap, with non-temporal
+/// stores. Ends with a store fence, so the data is visible to other threads
+/// once this returns.
+/// </summary>
+void StreamCopy(UInt8* destination, const UInt8* source, size_t length);
+
+/// <summary>
+/// Write length bytes of tile (tileLength bytes, repeated from its start)
+/// with non-temporal stores. Ends with a store fence.
+/// </summary>
+void StreamRepeat(UInt8* data, size_t length, const UInt8* tile, size_t tileLength);
+
+/// <summary>
+/// Repeat the first patternLength bytes of data over the rest of the
+/// length bytes.
+/// </summary>
+void FillRepeating(UInt8* data, size_t patternLength, size_t length);
+
+/// <summary>
+/// Fill length bytes with a pattern of patternLength bytes, repeated, and
+/// started again every restartPeriod bytes (0 runs it on to the end). A tile
+/// of the pattern a whole number of cache lines long is built once and
+/// stored a line at a time, so odd lengths fill as fast as even ones.
+/// </summary>
+void FillBytes(UInt8* data, size_t length, const UInt8* pattern, size_t patternLength, size_t restartPeriod = 0);
+
+/// <summary>
+/// Fill length bytes with bytes counting up from startingValue, restarting
+/// every period bytes (the sector size for the Buffer fills). Each vector is
+/// generated in registers and stored, nothing is read back.
+/// </summary>
+void FillIncrementing(UInt8* data, size_t length, size_t period, UInt8 startingValue);
+
+/// <summary>
+/// Fill length bytes with bytes counting down from startingValue, restarting
+/// every period bytes.
+/// </summary>
+void FillDecrementing(UInt8* data, size_t length, size_t period, UInt8 startingValue);
+
+/// <summary>
+/// Fill count words with the taus88 sequence continuing from state (z1, z2,
+/// z3), word for word what boost::random::taus88 returns. Long runs are
+/// split between eight generators jumped ahead to their part of the
+/// sequence. state is advanced past the words written.
+/// </summary>
+void FillTaus88(UInt32* words, size_t count, UInt32 state[3]);
+
+/// <summary>
+/// Fill count words from eight interleaved xoshiro128++ generators seeded
+/// from seed. Several times faster than FillTaus88, but a different sequence;
+/// the same seed always gives the same words on every CPU.
+/// </summary>
+void FillXoshiro(UInt32* words, size_t count, UInt64 seed);
+
+/// <summary>
+/// The eight xoshiro128++ generators behind FillXoshiro, for filling a run
+/// in several calls.
+/// </summary>
+struct XoshiroState
+{
+    UInt32 s[4][8];
+};
+
+/// <summary>
+/// Seed state the way FillXoshiro seeds its generators.
+/// </summary>
+void SeedXoshiro(XoshiroState& state, UInt64 seed);
+
+/// <summary>
+/// Fill count words continuing from state. Calls with counts that are
+/// multiples of 8 give the same words as one call for the whole run.
+/// </summary>
+void FillXoshiro(UInt32* words, size_t count, XoshiroState& state);
+
+/// <summary>
+/// One Philox4x32-10 block: the four words for counter under key.
+/// </summary>
+void Philox4x32(const UInt32 counter[4], const UInt32 key[2], UInt32 result[4]);
+
+/// <summary>
+/// Fill sectorCount sectors of wordsPerSector words with the Philox words
+/// keyed by seed. Word i of sector s is word i % 4 of the block for counter
+/// (i / 4, low and high halves of firstSector + s, 0), so any sector can be
+/// generated on its own.
+/// </summary>
+void FillPhilox(UInt32* words, size_t wordsPerSector, UInt64 firstSector, size_t sectorCount, UInt64 seed);
+
+/// <summary>
+/// Fill length bytes with the bit sequence of a Fibonacci LFSR with taps at
+/// order and tap (b[n] = b[n - order] ^ b[n - tap]), first bit in the high
+/// bit of the first byte. state holds the last order bits, the newest in bit
+/// 0, and is advanced past the bytes written. After the first 16 bytes each
+/// 64 bit word is two shifted reads of bits already written, using the
+/// recurrence squared until its nearest tap is a word or more back.
+/// </summary>
+void FillPrbs(UInt8* data, size_t length, unsigned order, unsigned tap, UInt32& state);
+
+/// <summary>
+/// Count the bits that differ between left and right.
+/// </summary>
+UInt64 CountBitDifferences(const UInt8* left, const UInt8* right, size_t length);
+
+/// <summary>
+/// Count the bits set in actual but clear in expected (zeroToOne) and those
+/// clear in actual but set in expected (oneToZero). Their sum is
+/// CountBitDifferences. AVX2 and AVX-512 count the bits of each byte from a
+/// nibble table.
+/// </summary>
+void CountBitFlips(const UInt8* expected, const UInt8* actual, size_t length, UInt64& zeroToOne, UInt64& oneToZero);
+
+/// <summary>
+/// Get the two's complement of the sum of length bytes.
+/// </summary>
+UInt8 ChecksumByte(const UInt8* data, size_t length);
+
+/// <summary>
+/// Get the CRC-32C (Castagnoli) of length bytes, continuing from crc (0 to
+/// start). Uses the SSE4.2 crc32 instruction unless the level is SimdScalar.
+/// </summary>
+UInt32 Crc32c(const UInt8* data, size_t length, UInt32 crc = 0);
+
+/// <summary>
+/// Count the 1 bits (value 1) or 0 bits (value 0) in length bytes.
+/// </summary>
+UInt64 CountBits(const UInt8* data, size_t length, UInt8 value);
+
+/// <summary>
+/// Check whether length bytes are all zero.
+/// </summary>
+bool IsAllZeros(const UInt8* data, size_t length);
+
+/// <summary>
+/// Find the first byte that differs between left and right. Returns false
+/// when the ranges are equal, otherwise sets offset to the first difference.
+/// The vector levels find it in the same pass that compares; the scalar
+/// level compares with memcmp and then looks for the byte.
+/// </summary>
+bool FindFirstMismatch(const UInt8* left, const UInt8* right, size_t length, size_t& offset);
+
+/// <summary>
+/// Find the first byte that is the same in left and right, the end of a run
+/// of differences. Returns false when every byte differs.
+/// </summary>
+bool FindFirstMatch(const UInt8* left, const UInt8* right, size_t length, size_t& offset);
+
+/// <summary>
+/// Count the bytes that differ between left and right.
+/// </summary>
+size_t CountMismatches(const UInt8* left, const UInt8* right, size_t length);
+
+} // namespace kernels
+} // namespace ufs
+
+#endif // _DATAKERNELS_H_
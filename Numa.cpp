@@ -0,0 +1,208 @@
+// pthread_setaffinity_np and cpu_set_t are GNU extensions.
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "Numa.h"
+#include "PageAllocator.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#define UFS_HAVE_NUMA 1
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ufs {
+
+namespace {
+
+// Memory policy modes from <linux/mempolicy.h>, kept here so that the
+// libnuma headers are not needed.
+const int MPOL_BIND_MODE = 2;
+const int MPOL_INTERLEAVE_MODE = 3;
+
+const size_t BITS_PER_MASK_WORD = sizeof(unsigned long) * 8;
+
+// Each first-touch worker faults in at least this much memory; smaller
+// ranges are not worth starting a thread for.
+const size_t MIN_TOUCH_BYTES_PER_THREAD = 16 * 1024 * 1024;
+const size_t MAX_TOUCH_THREADS = 16;
+
+// Pages passed to move_pages per call.
+const size_t QUERY_BATCH_PAGES = 4096;
+
+// Parse a kernel list such as "0-3,8-11" into its members.
+std::vector<int> ParseList(const std::string& text) {
+    std::vector<int> values;
+    std::stringstream ss(text);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int value = first; value <= last; value++) {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+std::vector<int> ReadList(const std::string& path) {
+    std::ifstream file(path.c_str());
+    std::string text;
+    if (!std::getline(file, text)) {
+        return std::vector<int>();
+    }
+    return ParseList(text);
+}
+
+void TouchPages(UInt8* start, UInt8* end, size_t pageSize) {
+    // Writing is what faults in a private page; a read would only map the
+    // shared zero page.
+    for (volatile UInt8* page = start; page < end; page += pageSize) {
+        *page = 0;
+    }
+}
+
+#ifdef UFS_HAVE_NUMA
+void PinToCpu(int cpu) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    ::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus);
+}
+#endif
+
+} // namespace
+
+int Numa::GetNodeCount() {
+    static const int nodeCount = []() {
+        std::vector<int> nodes = ReadList("/sys/devices/system/node/online");
+        return nodes.empty() ? 1 : *std::max_element(nodes.begin(), nodes.end()) + 1;
+    }();
+    return nodeCount;
+}
+
+std::vector<int> Numa::GetNodeCpus(int node) {
+    return ReadList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+}
+
+bool Numa::Place(UInt8* address, size_t length, const NumaPlacement& placement) {
+#ifdef UFS_HAVE_NUMA
+    if (placement.policy == NumaLocal) {
+        return true;
+    }
+
+    int nodeCount = GetNodeCount();
+    std::vector<unsigned long> mask((nodeCount + BITS_PER_MASK_WORD - 1) / BITS_PER_MASK_WORD, 0);
+    if (placement.policy == NumaBind) {
+        if (placement.node < 0 || placement.node >= nodeCount) {
+            return false;
+        }
+        mask[placement.node / BITS_PER_MASK_WORD] |= 1UL << (placement.node % BITS_PER_MASK_WORD);
+    } else {
+        for (int node = 0; node < nodeCount; node++) {
+            mask[node / BITS_PER_MASK_WORD] |= 1UL << (node % BITS_PER_MASK_WORD);
+        }
+    }
+
+    int mode = placement.policy == NumaBind ? MPOL_BIND_MODE : MPOL_INTERLEAVE_MODE;
+    // The kernel takes one more than the number of mask bits.
+    unsigned long maxNode = mask.size() * BITS_PER_MASK_WORD + 1;
+    return ::syscall(SYS_mbind, address, length, mode, mask.data(), maxNode, 0) == 0;
+#else
+    (void)address;
+    (void)length;
+    return placement.policy == NumaLocal;
+#endif
+}
+
+void Numa::FirstTouch(UInt8* address, size_t length, const NumaPlacement& placement) {
+    size_t pageSize = PageAllocator::GetPageSize();
+
+    // CPUs next to where the pages will live, so that zeroing each page
+    // happens on its own node.
+    std::vector<int> cpus;
+    if (placement.policy == NumaBind) {
+        cpus = GetNodeCpus(placement.node);
+    } else {
+        for (int node = 0; node < GetNodeCount(); node++) {
+            std::vector<int> nodeCpus = GetNodeCpus(node);
+            cpus.insert(cpus.end(), nodeCpus.begin(), nodeCpus.end());
+        }
+    }
+
+    size_t threadCount = std::min(std::max<size_t>(cpus.size(), 1), MAX_TOUCH_THREADS);
+    threadCount = std::max<size_t>(std::min(threadCount, length / MIN_TOUCH_BYTES_PER_THREAD), 1);
+    if (threadCount == 1) {
+        TouchPages(address, address + length, pageSize);
+        return;
+    }
+
+    size_t pagesPerThread = (length / pageSize + threadCount - 1) / threadCount;
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threadCount; i++) {
+        UInt8* start = address + std::min(length, i * pagesPerThread * pageSize);
+        UInt8* end = address + std::min(length, (i + 1) * pagesPerThread * pageSize);
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        workers.push_back(std::thread([start, end, pageSize, cpu]() {
+#ifdef UFS_HAVE_NUMA
+            if (cpu >= 0) {
+                PinToCpu(cpu);
+            }
+#else
+            (void)cpu;
+#endif
+            TouchPages(start, end, pageSize);
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+std::vector<size_t> Numa::GetPageCountsByNode(const UInt8* address, size_t length) {
+    std::vector<size_t> counts(GetNodeCount(), 0);
+#ifdef UFS_HAVE_NUMA
+    size_t pageSize = PageAllocator::GetPageSize();
+    size_t pageCount = (length + pageSize - 1) / pageSize;
+
+    std::vector<void*> pages;
+    std::vector<int> status;
+    for (size_t first = 0; first < pageCount; first += QUERY_BATCH_PAGES) {
+        size_t batch = std::min(QUERY_BATCH_PAGES, pageCount - first);
+        pages.resize(batch);
+        status.assign(batch, -1);
+        for (size_t i = 0; i < batch; i++) {
+            pages[i] = const_cast<UInt8*>(address) + (first + i) * pageSize;
+        }
+
+        // With no target nodes move_pages only reports where each page is.
+        if (::syscall(SYS_move_pages, 0, batch, pages.data(), NULL, status.data(), 0) != 0) {
+            break;
+        }
+        for (size_t i = 0; i < batch; i++) {
+            if (status[i] >= 0 && static_cast<size_t>(status[i]) < counts.size()) {
+                counts[status[i]]++;
+            }
+        }
+    }
+#else
+    (void)address;
+    (void)length;
+#endif
+    return counts;
+}
+
+} // namespace ufs
@@ -0,0 +1,78 @@
+#pragma once
+#ifndef _NUMA_H_
+#define _NUMA_H_
+
+#include "TypeDefs.h"
+#include <cstddef>
+#include <vector>
+
+namespace ufs {
+
+/// <summary>
+/// Selects where the pages of a Buffer are placed on a NUMA system.
+/// #FORMAT
+///     NumaLocal = the pages follow the thread that first touches them (default),
+///      NumaBind = all pages are placed on one node, and
+/// NumaInterleave = pages are spread round robin over all nodes.
+/// #ENDFORMAT
+/// </summary>
+enum NumaPolicy
+{
+    NumaLocal = 0,
+    NumaBind = 1,
+    NumaInterleave = 2
+};
+
+/// <summary>
+/// A NUMA policy and, for NumaBind, the node to bind to.
+/// </summary>
+struct NumaPlacement
+{
+    NumaPolicy policy;
+    int node;
+
+    static NumaPlacement Local() { NumaPlacement placement = { NumaLocal, -1 }; return placement; }
+    static NumaPlacement OnNode(int node) { NumaPlacement placement = { NumaBind, node }; return placement; }
+    static NumaPlacement Interleaved() { NumaPlacement placement = { NumaInterleave, -1 }; return placement; }
+};
+
+/// <summary>
+/// NUMA topology queries and page placement. Uses the Linux memory policy
+/// system calls directly so no libnuma is needed. On other systems there is
+/// a single node and placement requests are ignored.
+/// </summary>
+class Numa {
+public:
+    /// <summary>
+    /// Get the number of NUMA nodes (at least 1).
+    /// </summary>
+    static int GetNodeCount();
+
+    /// <summary>
+    /// Get the CPUs that belong to a node.
+    /// </summary>
+    static std::vector<int> GetNodeCpus(int node);
+
+    /// <summary>
+    /// Apply the placement policy to a page aligned range before it is first
+    /// touched. Returns false when the policy could not be applied.
+    /// </summary>
+    static bool Place(UInt8* address, size_t length, const NumaPlacement& placement);
+
+    /// <summary>
+    /// Fault in every page of a page aligned range, using worker threads
+    /// pinned to the CPUs of the nodes the placement puts the pages on.
+    /// The contents (zero) are not changed.
+    /// </summary>
+    static void FirstTouch(UInt8* address, size_t length, const NumaPlacement& placement);
+
+    /// <summary>
+    /// Count the resident pages of a page aligned range on each node. The
+    /// result is indexed by node; pages not faulted in yet are not counted.
+    /// </summary>
+    static std::vector<size_t> GetPageCountsByNode(const UInt8* address, size_t length);
+};
+
+} // namespace ufs
+
+#endif // _NUMA_H_
@@ -0,0 +1,358 @@
+// mremap, memfd_create and MAP_HUGETLB are GNU extensions.
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "PageAllocator.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <new>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define UFS_HAVE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(MFD_CLOEXEC) && defined(MREMAP_FIXED)
+#define UFS_HAVE_SNAPSHOTS 1
+#endif
+
+#if defined(UFS_HAVE_MMAP) && defined(MAP_HUGETLB)
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+#endif
+
+namespace ufs {
+
+namespace {
+
+const size_t GIGANTIC_PAGE_SIZE = 1UL << 30;
+
+// Standard allocations at least this large are mapped directly so that their
+// zero pages are only faulted in when first touched.
+const size_t MAPPED_ALLOCATION_THRESHOLD = 16 * 1024;
+
+// /proc/self/pagemap entry bits.
+const UInt64 PAGEMAP_PRESENT = 1ULL << 63;
+const UInt64 PAGEMAP_SWAPPED = 1ULL << 62;
+const UInt64 PAGEMAP_FILE_OR_SHARED = 1ULL << 61;
+
+// Pagemap entries read per call.
+const size_t PAGEMAP_BATCH_PAGES = 4096;
+
+size_t RoundUp(size_t value, size_t multiple) {
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+#ifdef UFS_HAVE_MMAP
+UInt8* MapAnonymous(size_t length, int extraFlags) {
+    void* address = ::mmap(NULL, length, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+    return address == MAP_FAILED ? NULL : static_cast<UInt8*>(address);
+}
+
+#ifdef MAP_HUGETLB
+bool TryHugeTlb(size_t length, size_t pageSize, int sizeFlag, PageBlock& block) {
+    size_t mapLength = RoundUp(length, pageSize);
+    UInt8* address = MapAnonymous(mapLength, MAP_HUGETLB | sizeFlag);
+    if (address == NULL) {
+        return false;
+    }
+    block.address = address;
+    block.length = mapLength;
+    block.backing = HugeTlbBacking;
+    return true;
+}
+#endif
+
+// Map an anonymous region aligned to the huge page size so that transparent
+// huge pages can back it, trimming the unaligned head and tail of an
+// oversized mapping.
+bool TryTransparentHuge(size_t length, PageBlock& block) {
+    size_t hugePageSize = PageAllocator::GetHugePageSize();
+    size_t mapLength = RoundUp(length, hugePageSize);
+    size_t overLength = mapLength + hugePageSize;
+
+    UInt8* raw = MapAnonymous(overLength, 0);
+    if (raw == NULL) {
+        return false;
+    }
+
+    UInt8* aligned = reinterpret_cast<UInt8*>(RoundUp(reinterpret_cast<size_t>(raw), hugePageSize));
+    size_t head = static_cast<size_t>(aligned - raw);
+    size_t tail = overLength - head - mapLength;
+    if (head > 0) {
+        ::munmap(raw, head);
+    }
+    if (tail > 0) {
+        ::munmap(aligned + mapLength, tail);
+    }
+
+    block.address = aligned;
+    block.length = mapLength;
+    block.backing = MappedBacking;
+#ifdef MADV_HUGEPAGE
+    if (::madvise(aligned, mapLength, MADV_HUGEPAGE) == 0) {
+        block.backing = TransparentHugeBacking;
+    }
+#endif
+    return true;
+}
+#endif
+
+} // namespace
+
+PageBlock PageAllocator::Allocate(size_t length, AllocationMode mode, bool requireMapping) {
+    PageBlock block;
+
+#ifdef UFS_HAVE_MMAP
+#ifdef MAP_HUGETLB
+    if (mode == GiganticPages && TryHugeTlb(length, GIGANTIC_PAGE_SIZE, MAP_HUGE_1GB, block)) {
+        return block;
+    }
+    if ((mode == HugePages || mode == GiganticPages) && TryHugeTlb(length, GetHugePageSize(), 0, block)) {
+        return block;
+    }
+#endif
+    if ((mode == HugePages || mode == GiganticPages) && TryTransparentHuge(length, block)) {
+        return block;
+    }
+    if (length >= MAPPED_ALLOCATION_THRESHOLD || requireMapping) {
+        size_t mapLength = RoundUp(length, GetPageSize());
+        UInt8* address = MapAnonymous(mapLength, 0);
+        if (address != NULL) {
+            block.address = address;
+            block.length = mapLength;
+            block.backing = MappedBacking;
+            return block;
+        }
+    }
+#endif
+
+    (void)mode;
+    (void)requireMapping;
+    block.address = static_cast<UInt8*>(::operator new(length, std::align_val_t(GetPageSize())));
+    ::memset(block.address, 0, length);
+    block.length = length;
+    block.backing = HeapBacking;
+    return block;
+}
+
+bool PageAllocator::Reallocate(PageBlock& block, size_t length) {
+#if defined(UFS_HAVE_MMAP) && defined(MREMAP_MAYMOVE)
+    if (block.backing != MappedBacking && block.backing != TransparentHugeBacking) {
+        return false;
+    }
+
+    size_t pageSize = block.backing == TransparentHugeBacking ? GetHugePageSize() : GetPageSize();
+    size_t mapLength = RoundUp(length, pageSize);
+    if (mapLength == block.length) {
+        return true;
+    }
+
+    void* address = ::mremap(block.address, block.length, mapLength, MREMAP_MAYMOVE);
+    if (address == MAP_FAILED) {
+        return false;
+    }
+
+    block.address = static_cast<UInt8*>(address);
+    block.length = mapLength;
+    return true;
+#else
+    (void)block;
+    (void)length;
+    return false;
+#endif
+}
+
+PageBlock PageAllocator::MapFile(const std::string& fileName, bool writable) {
+    PageBlock block = { NULL, 0, writable ? FileBacking : ReadOnlyFileBacking };
+#ifdef UFS_HAVE_MMAP
+    int fd = ::open(fileName.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0) {
+        return block;
+    }
+
+    struct stat status;
+    if (::fstat(fd, &status) == 0 && status.st_size > 0) {
+        size_t length = static_cast<size_t>(status.st_size);
+        int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        void* address = ::mmap(NULL, length, protection, MAP_SHARED, fd, 0);
+        if (address != MAP_FAILED) {
+            block.address = static_cast<UInt8*>(address);
+            block.length = length;
+        }
+    }
+
+    // The mapping keeps the file open.
+    int error = errno;
+    ::close(fd);
+    errno = error;
+#else
+    (void)fileName;
+    (void)writable;
+#endif
+    return block;
+}
+
+void PageAllocator::Release(PageBlock& block) {
+    if (block.address == NULL || block.backing == ExternalBacking) {
+        block.address = NULL;
+        block.length = 0;
+        return;
+    }
+
+    if (block.backing == HeapBacking) {
+        ::operator delete(block.address, std::align_val_t(GetPageSize()));
+    }
+#ifdef UFS_HAVE_MMAP
+    else {
+        ::munmap(block.address, block.length);
+    }
+#endif
+
+    block.address = NULL;
+    block.length = 0;
+}
+
+size_t PageAllocator::GetPageSize() {
+#ifdef UFS_HAVE_MMAP
+    static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return pageSize;
+#else
+    return 4096;
+#endif
+}
+
+size_t PageAllocator::GetHugePageSize() {
+    static const size_t hugePageSize = []() {
+        size_t size = 2UL << 20;
+        std::ifstream meminfo("/proc/meminfo");
+        std::string key;
+        while (meminfo >> key) {
+            if (key == "Hugepagesize:") {
+                size_t kiloBytes = 0;
+                if (meminfo >> kiloBytes && kiloBytes > 0) {
+                    size = kiloBytes * 1024;
+                }
+                break;
+            }
+            meminfo.ignore(256, '\n');
+        }
+        return size;
+    }();
+    return hugePageSize;
+}
+
+std::shared_ptr<PageSnapshot> PageSnapshot::Create(const UInt8* address, size_t length, bool isZero) {
+#ifdef UFS_HAVE_SNAPSHOTS
+    size_t snapshotLength = RoundUp(length, PageAllocator::GetPageSize());
+    int fd = ::memfd_create("ufs-buffer-snapshot", MFD_CLOEXEC);
+    if (fd < 0) {
+        return std::shared_ptr<PageSnapshot>();
+    }
+    std::shared_ptr<PageSnapshot> snapshot(new PageSnapshot(fd, snapshotLength));
+
+    // A fresh file reads as zeros, so zero memory needs no writing.
+    if (::ftruncate(fd, static_cast<off_t>(snapshotLength)) != 0) {
+        return std::shared_ptr<PageSnapshot>();
+    }
+    for (size_t written = 0; !isZero && written < length;) {
+        ssize_t result = ::pwrite(fd, address + written, length - written, static_cast<off_t>(written));
+        if (result <= 0) {
+            return std::shared_ptr<PageSnapshot>();
+        }
+        written += static_cast<size_t>(result);
+    }
+    return snapshot;
+#else
+    (void)address;
+    (void)length;
+    (void)isZero;
+    return std::shared_ptr<PageSnapshot>();
+#endif
+}
+
+PageSnapshot::~PageSnapshot() {
+#ifdef UFS_HAVE_SNAPSHOTS
+    // Views keep the file alive on their own.
+    ::close(_fd);
+#endif
+}
+
+bool PageSnapshot::Map(PageBlock& block, const PageBlock* replace) const {
+#ifdef UFS_HAVE_SNAPSHOTS
+    void* address = ::mmap(NULL, _length, PROT_READ | PROT_WRITE, MAP_PRIVATE, _fd, 0);
+    if (address == MAP_FAILED) {
+        return false;
+    }
+
+    if (replace != NULL) {
+        if (replace->length != _length
+            || ::mremap(address, _length, _length, MREMAP_MAYMOVE | MREMAP_FIXED, replace->address) == MAP_FAILED) {
+            ::munmap(address, _length);
+            return false;
+        }
+        address = replace->address;
+    }
+
+    block.address = static_cast<UInt8*>(address);
+    block.length = _length;
+    block.backing = SnapshotBacking;
+    return true;
+#else
+    (void)block;
+    (void)replace;
+    return false;
+#endif
+}
+
+bool PageSnapshot::GetSharedPages(const UInt8* address, size_t length, std::vector<bool>& shared) {
+#ifdef UFS_HAVE_SNAPSHOTS
+    size_t pageSize = PageAllocator::GetPageSize();
+    size_t firstPage = reinterpret_cast<size_t>(address) / pageSize;
+    size_t pageCount = RoundUp(length, pageSize) / pageSize;
+    shared.assign(pageCount, false);
+
+    int fd = ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    // A written page is a present (or swapped out) anonymous page. Pages
+    // that were never touched, or only read, still come from the snapshot.
+    std::vector<UInt64> entries(std::min(pageCount, PAGEMAP_BATCH_PAGES));
+    bool ok = true;
+    for (size_t first = 0; ok && first < pageCount; first += PAGEMAP_BATCH_PAGES) {
+        size_t batch = std::min(PAGEMAP_BATCH_PAGES, pageCount - first);
+        size_t bytes = batch * sizeof(UInt64);
+        ok = ::pread(fd, entries.data(), bytes, static_cast<off_t>((firstPage + first) * sizeof(UInt64)))
+            == static_cast<ssize_t>(bytes);
+        for (size_t i = 0; ok && i < batch; i++) {
+            UInt64 entry = entries[i];
+            bool isPrivate = (entry & PAGEMAP_SWAPPED) != 0
+                || ((entry & PAGEMAP_PRESENT) != 0 && (entry & PAGEMAP_FILE_OR_SHARED) == 0);
+            shared[first + i] = !isPrivate;
+        }
+    }
+    ::close(fd);
+    return ok;
+#else
+    (void)address;
+    (void)length;
+    shared.clear();
+    return false;
+#endif
+}
+
+} // namespace ufs
@@ -0,0 +1,156 @@
+#pragma once
+#ifndef _PAGEALLOCATOR_H_
+#define _PAGEALLOCATOR_H_
+
+#include "TypeDefs.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ufs {
+
+/// <summary>
+/// Selects the kind of pages requested for the memory behind a Buffer.
+/// #FORMAT
+///     StandardPages = base pages (default): an anonymous mapping from 16KB,
+///                     or when a mapping is required, and page aligned
+///                     operator new below that,
+///         HugePages = 2MB (default huge page size) pages, and
+///     GiganticPages = 1GB pages.
+/// #ENDFORMAT
+/// Huge and gigantic page requests fall back to smaller pages, and finally
+/// to standard pages, when the system cannot satisfy them. The PageBacking
+/// of the block says which path served it, and Release frees it by that.
+/// </summary>
+enum AllocationMode
+{
+    StandardPages = 0,
+    HugePages = 1,
+    GiganticPages = 2
+};
+
+/// <summary>
+/// Describes what actually backs an allocation after any fallback.
+/// </summary>
+enum PageBacking
+{
+    HeapBacking = 0,            // page aligned operator new
+    MappedBacking = 1,          // anonymous mapping with base pages
+    TransparentHugeBacking = 2, // huge page aligned anonymous mapping + MADV_HUGEPAGE
+    HugeTlbBacking = 3,         // explicit MAP_HUGETLB mapping
+    SnapshotBacking = 4,        // private copy-on-write mapping of a PageSnapshot
+    ExternalBacking = 5,        // memory owned by the caller, never released here
+    FileBacking = 6,            // shared mapping of a file
+    ReadOnlyFileBacking = 7     // shared read-only mapping of a file
+};
+
+/// <summary>
+/// A block of memory returned by the PageAllocator. Length may be larger
+/// than requested when it has been rounded up to a page multiple.
+/// </summary>
+struct PageBlock
+{
+    UInt8* address;
+    size_t length;
+    PageBacking backing;
+};
+
+/// <summary>
+/// Obtains and releases the raw memory blocks used as Buffer storage. Every
+/// block starts on a page boundary, whatever backs it.
+/// </summary>
+class PageAllocator {
+public:
+    /// <summary>
+    /// Allocate at least length zero-filled bytes using the requested mode.
+    /// Large standard allocations are anonymous mappings whose zero pages
+    /// are not touched until first use; requireMapping maps small standard
+    /// allocations too, so that page level policies can be applied to them.
+    /// Throws std::bad_alloc when no backing at all can be obtained.
+    /// </summary>
+    static PageBlock Allocate(size_t length, AllocationMode mode, bool requireMapping = false);
+
+    /// <summary>
+    /// Grow or shrink a mapped block to at least length bytes by remapping
+    /// it, moving it if needed. Contents up to the smaller of the two lengths
+    /// are kept and grown pages are zero. Returns false, leaving the block
+    /// untouched, when the block cannot be remapped (heap or hugetlb backed
+    /// blocks, or systems without mremap).
+    /// </summary>
+    static bool Reallocate(PageBlock& block, size_t length);
+
+    /// <summary>
+    /// Map a whole file shared, so that writes to the block reach the file.
+    /// Without writable the file is opened and mapped read-only, and the
+    /// block is ReadOnlyFileBacking. Returns a block with a NULL address (and
+    /// errno set) when the file cannot be opened or mapped, or is empty.
+    /// </summary>
+    static PageBlock MapFile(const std::string& fileName, bool writable);
+
+    /// <summary>
+    /// Release a block previously returned by Allocate or MapFile. Externally
+    /// owned blocks are left alone.
+    /// </summary>
+    static void Release(PageBlock& block);
+
+    /// <summary>
+    /// Get the base page size of the system.
+    /// </summary>
+    static size_t GetPageSize();
+
+    /// <summary>
+    /// Get the default huge page size of the system (2MB when unknown).
+    /// </summary>
+    static size_t GetHugePageSize();
+};
+
+/// <summary>
+/// A read-only copy of a block of memory that any number of blocks can map
+/// copy-on-write. Pages of such a mapping stay shared with the snapshot until
+/// they are written, at which point the kernel gives the writer a private
+/// copy of just that page. Only available on Linux; Create returns an empty
+/// pointer elsewhere.
+/// </summary>
+class PageSnapshot {
+public:
+    /// <summary>
+    /// Copy length bytes starting at address into a new snapshot. isZero
+    /// skips the copy when the memory is known to hold only zeros.
+    /// </summary>
+    static std::shared_ptr<PageSnapshot> Create(const UInt8* address, size_t length, bool isZero);
+
+    ~PageSnapshot();
+
+    /// <summary>
+    /// Map a new copy-on-write view of the snapshot. When replace is given,
+    /// the view atomically takes the place of that mapping, which must be a
+    /// mapping of exactly GetLength() bytes. Returns false when the mapping
+    /// fails, leaving replace untouched.
+    /// </summary>
+    bool Map(PageBlock& block, const PageBlock* replace = NULL) const;
+
+    /// <summary>
+    /// Get the length of the snapshot, a multiple of the page size.
+    /// </summary>
+    size_t GetLength() const { return _length; }
+
+    /// <summary>
+    /// For each page of a page aligned range of a view, find out whether it
+    /// is still shared with its snapshot (never written). Returns false when
+    /// the page table cannot be queried, in which case nothing is known.
+    /// </summary>
+    static bool GetSharedPages(const UInt8* address, size_t length, std::vector<bool>& shared);
+
+private:
+    PageSnapshot(int fd, size_t length) : _fd(fd), _length(length) {}
+    PageSnapshot(const PageSnapshot&) = delete;
+    PageSnapshot& operator=(const PageSnapshot&) = delete;
+
+    int _fd;
+    size_t _length;
+};
+
+} // namespace ufs
+
+#endif // _PAGEALLOCATOR_H_
@@ -0,0 +1,362 @@
+#include "PatternBuffer.h"
+#include "DataKernels.h"
+#include "Errors.h"
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <utility>
+
+namespace ufs {
+
+namespace {
+
+// Bytes generated at a time when comparing or saving: small enough to stay
+// in L2 while they are used.
+const size_t BLOCK_BYTES = 64 * 1024;
+
+} // namespace
+
+// The generators of a FillRandomSeeded pattern, at the start of sector.
+struct PatternBuffer::RandomStream
+{
+    explicit RandomStream(UInt32 seed)
+        : seed(seed), sector(0), random(seed) {
+        kernels::SeedXoshiro(fast, seed);
+    }
+
+    // Run the generators on to sector target, starting again from the seed
+    // if they are already past it.
+    void MoveTo(size_t target, size_t bytesPerSector, RandomEngine engine) {
+        if (target < sector) {
+            random.Seed(seed);
+            kernels::SeedXoshiro(fast, seed);
+            sector = 0;
+        }
+
+        UInt64 words = static_cast<UInt64>(target - sector) * (bytesPerSector / 4);
+        if (words == 0) {
+            return;
+        }
+
+        std::vector<UInt32> scratch(static_cast<size_t>(std::min<UInt64>(words, BLOCK_BYTES / 4)));
+        UInt32 state[3];
+        random.GetState(state);
+        while (words != 0) {
+            size_t count = static_cast<size_t>(std::min<UInt64>(words, scratch.size()));
+            if (engine == RandomCompatible) {
+                kernels::FillTaus88(scratch.data(), count, state);
+            } else {
+                kernels::FillXoshiro(scratch.data(), count, fast);
+            }
+            words -= count;
+        }
+        random.SetState(state);
+        sector = target;
+    }
+
+    std::mutex mutex;
+    UInt32 seed;
+    size_t sector;
+    Random32 random;
+    kernels::XoshiroState fast;
+};
+
+PatternBuffer::PatternBuffer(size_t sectorCount, size_t bytesPerSector)
+    : _sectorCount(sectorCount),
+      _bytesPerSector(bytesPerSector),
+      _fill(PatternFillConstant),
+      _value(0),
+      _phase(PatternContinuous),
+      _seed(0),
+      _firstKeySector(0),
+      _testPattern(PatternWalkingOnes),
+      _prbsOrder(Prbs31),
+      _engine(RandomCompatible) {
+    if (sectorCount < 1) {
+        throw ArgumentError("sectorCount must be greater than zero.");
+    }
+
+    if (bytesPerSector < 1) {
+        throw ArgumentError("bytesPerSector must be greater than zero.");
+    }
+}
+
+PatternBuffer::PatternBuffer(const PatternBuffer& pattern)
+    : _sectorCount(pattern._sectorCount),
+      _bytesPerSector(pattern._bytesPerSector),
+      _fill(pattern._fill),
+      _value(pattern._value),
+      _bytes(pattern._bytes),
+      _phase(pattern._phase),
+      _seed(pattern._seed),
+      _firstKeySector(pattern._firstKeySector),
+      _testPattern(pattern._testPattern),
+      _options(pattern._options),
+      _prbsOrder(pattern._prbsOrder),
+      _engine(pattern._engine),
+      _overlay(pattern._overlay) {
+    // The stream is where the other pattern's last range ended. A new one
+    // from the seed keeps the two from moving each other's.
+    if (pattern._stream) {
+        _stream = std::make_shared<RandomStream>(pattern._stream->seed);
+    }
+}
+
+PatternBuffer& PatternBuffer::operator=(const PatternBuffer& pattern) {
+    if (this != &pattern) {
+        PatternBuffer copy(pattern);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+size_t PatternBuffer::GetBlockSectors() const {
+    return std::max<size_t>(BLOCK_BYTES / _bytesPerSector, 1);
+}
+
+PatternBuffer& PatternBuffer::Fill(UInt8 value) {
+    _fill = PatternFillConstant;
+    _value = value;
+    return *this;
+}
+
+PatternBuffer& PatternBuffer::FillZeros() {
+    return Fill(0);
+}
+
+PatternBuffer& PatternBuffer::FillOnes() {
+    return Fill(0xFF);
+}
+
+PatternBuffer& PatternBuffer::FillBytes(const std::vector<UInt8>& list, PatternPhase phase) {
+    if (list.empty()) {
+        throw ArgumentError("The list of bytes must not be empty.");
+    }
+
+    _fill = PatternFillBytes;
+    _bytes = list;
+    _phase = phase;
+    return *this;
+}
+
+PatternBuffer& PatternBuffer::FillIncrementing(UInt8 startingValue) {
+    _fill = PatternFillIncrementing;
+    _value = startingValue;
+    return *this;
+}
+
+PatternBuffer& PatternBuffer::FillDecrementing(UInt8 startingValue) {
+    _fill = PatternFillDecrementing;
+    _value = startingValue;
+    return *this;
+}
+
+PatternBuffer& PatternBuffer::FillRandomSeeded(UInt32 seed, RandomEngine engine) {
+    if (_bytesPerSector % 4 != 0) {
+        throw RuntimeError("Filling random data is not supported for sector sizes that are not a multiple of 4.");
+    }
+
+    // The fast generators only continue across calls on whole rounds.
+    if (engine == RandomFast && _bytesPerSector % 32 != 0) {
+        throw RuntimeError("RandomFast patterns are not supported for sector sizes that are not a multiple of 32.");
+    }
+
+    _fill = PatternFillRandomSeeded;
+    _seed = seed;
+    _engine = engine;
+    _stream = std::make_shared<RandomStream>(seed);
+    return *this;
+}
+
+PatternBuffer& PatternBuffer::FillRandomSeededBySector(UInt32 seed) {
+    if (_bytesPerSector % 4 != 0) {
+        throw RuntimeError("Filling random data is not supported for sector sizes that are not a multiple of 4.");
+    }
+
+    _fill = PatternFillRandomBySector;
+    _seed = seed;
+    return *this;
+}
+
+PatternBuffer& PatternBuffer::FillRandomCounter(UInt64 seed, UInt64 firstKeySector) {
+    if (_bytesPerSector % 4 != 0) {
+        throw RuntimeError("Filling random data is not supported for sector sizes that are not a multiple of 4.");
+    }
+
+    _fill = PatternFillRandomCounter;
+    _seed = seed;
+    _firstKeySector = firstKeySector;
+    return *this;
+}
+
+PatternBuffer& PatternBuffer::FillTestPattern(TestPattern pattern, const TestPatternOptions& options) {
+    patterns::Validate(options, _bytesPerSector);
+    _fill = PatternFillTestPattern;
+    _testPattern = pattern;
+    _options = options;
+    return *this;
+}
+
+PatternBuffer& PatternBuffer::FillPrbs(PrbsOrder order, UInt32 seed) {
+    PrbsGenerator::GetTap(order);
+    _fill = PatternFillPrbs;
+    _prbsOrder = order;
+    _seed = seed;
+    return *this;
+}
+
+PatternBuffer& PatternBuffer::FillAddressOverlay(UInt64 startingValue) {
+    return SetSectorOverlay(SectorOverlay::AddressOverlay(startingValue));
+}
+
+PatternBuffer& PatternBuffer::SetSectorOverlay(const SectorOverlay& overlay) {
+    overlay.Validate(_bytesPerSector);
+    _overlay = overlay.IsEmpty() ? NULL : std::make_shared<const SectorOverlay>(overlay);
+    return *this;
+}
+
+PatternBuffer& PatternBuffer::ClearSectorOverlay() {
+    _overlay.reset();
+    return *this;
+}
+
+Buffer& PatternBuffer::CopyTo(Buffer& destinationBuffer) const {
+    return CopyTo(destinationBuffer, 0, 0, 0);
+}
+
+Buffer& PatternBuffer::CopyTo(Buffer& destinationBuffer, size_t startSector) const {
+    return CopyTo(destinationBuffer, startSector, 0, 0);
+}
+
+Buffer& PatternBuffer::CopyTo(Buffer& destinationBuffer, size_t startSector, size_t destStartSector) const {
+    return CopyTo(destinationBuffer, startSector, destStartSector, 0);
+}
+
+Buffer& PatternBuffer::CopyTo(Buffer& destinationBuffer, size_t startSector, size_t destStartSector, size_t sectorCount) const {
+    sectorCount = ValidateSectorRange(startSector, sectorCount);
+    FillRange(destinationBuffer, destStartSector, startSector, sectorCount);
+    return destinationBuffer;
+}
+
+const PatternBuffer& PatternBuffer::SaveToFileBinary(const std::string& fileName) const {
+    return SaveToFileBinary(fileName, 0);
+}
+
+const PatternBuffer& PatternBuffer::SaveToFileBinary(const std::string& fileName, size_t startSector) const {
+    return SaveToFileBinary(fileName, startSector, 0);
+}
+
+const PatternBuffer& PatternBuffer::SaveToFileBinary(const std::string& fileName, size_t startSector, size_t sectorCount) const {
+    sectorCount = ValidateSectorRange(startSector, sectorCount);
+    std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw RuntimeError("Unable to open " + fileName + " for writing.");
+    }
+
+    Buffer block(std::min(GetBlockSectors(), sectorCount), _bytesPerSector);
+    for (size_t done = 0; done < sectorCount; done += block.GetSectorCount()) {
+        size_t count = std::min(block.GetSectorCount(), sectorCount - done);
+        FillRange(block, 0, startSector + done, count);
+        file.write(reinterpret_cast<const char*>(block.GetDataStart()), static_cast<std::streamsize>(count * _bytesPerSector));
+    }
+
+    if (!file.flush()) {
+        throw RuntimeError("Unable to write " + fileName + ".");
+    }
+    return *this;
+}
+
+size_t PatternBuffer::ValidateSectorRange(size_t startSector, size_t sectorCount) const {
+    if (startSector >= _sectorCount) {
+        throw OutOfRangeError("startSector must be less than SectorCount of pattern.");
+    }
+
+    sectorCount = sectorCount == 0 ? _sectorCount - startSector : sectorCount;
+    if (sectorCount > _sectorCount - startSector) {
+        throw OutOfRangeError("startSector plus sectorCount must be less the SectorCount of pattern.");
+    }
+    return sectorCount;
+}
+
+void PatternBuffer::FillRange(Buffer& buffer, size_t bufferStartSector, size_t patternStartSector, size_t sectorCount) const {
+    if (buffer.GetBytesPerSector() != _bytesPerSector) {
+        throw ArgumentError("The buffer and the pattern must have the same number of bytes per sector.");
+    }
+
+    if (sectorCount == 0) {
+        return;
+    }
+
+    // The fills count sectors from the start of the buffer, the pattern
+    // from its own start.
+    std::shared_ptr<const SectorOverlay> overlay;
+    if (_overlay) {
+        SectorOverlay shifted(*_overlay);
+        shifted.SetFirstLba(_overlay->GetFirstLba() + patternStartSector - bufferStartSector);
+        overlay = std::make_shared<const SectorOverlay>(shifted);
+    }
+
+    overlay.swap(buffer._overlay);
+    try {
+        switch (_fill) {
+        case PatternFillConstant:
+            buffer.Fill(_value, bufferStartSector, sectorCount);
+            break;
+        case PatternFillBytes: {
+            // A continuous list starts again at the start of each fill.
+            std::vector<UInt8> rotated(_bytes);
+            if (_phase == PatternContinuous) {
+                size_t phase = (patternStartSector % _bytes.size()) * (_bytesPerSector % _bytes.size()) % _bytes.size();
+                std::rotate(rotated.begin(), rotated.begin() + phase, rotated.end());
+            }
+            buffer.FillBytes(rotated, bufferStartSector, sectorCount, _phase);
+            break;
+        }
+        case PatternFillIncrementing:
+            buffer.FillIncrementing(_value, bufferStartSector, sectorCount);
+            break;
+        case PatternFillDecrementing:
+            buffer.FillDecrementing(_value, bufferStartSector, sectorCount);
+            break;
+        case PatternFillRandomBySector:
+            buffer.FillRandomSeededBySector(static_cast<UInt32>(_seed + patternStartSector), bufferStartSector, sectorCount);
+            break;
+        case PatternFillRandomCounter:
+            buffer.FillRandomCounter(_seed, bufferStartSector, sectorCount, _firstKeySector + patternStartSector);
+            break;
+        case PatternFillTestPattern: {
+            // Sector phases repeat every cycle sectors, so only the
+            // distance between the two starts within a cycle matters.
+            size_t cycle = patterns::GetCycleSectors(_testPattern, _options, _bytesPerSector);
+            size_t shift = (patternStartSector % cycle + cycle - bufferStartSector % cycle) % cycle;
+            TestPatternOptions options(_options.wordBits, _options.phase + shift * _options.phaseStep, _options.phaseStep);
+            buffer.FillTestPattern(_testPattern, bufferStartSector, sectorCount, options);
+            break;
+        }
+        case PatternFillPrbs: {
+            PrbsGenerator generator(_prbsOrder, static_cast<UInt32>(_seed));
+            generator.Skip(static_cast<UInt64>(patternStartSector) * _bytesPerSector * 8);
+            buffer.FillPrbs(generator, bufferStartSector, sectorCount);
+            break;
+        }
+        case PatternFillRandomSeeded: {
+            std::lock_guard<std::mutex> lock(_stream->mutex);
+            _stream->MoveTo(patternStartSector, _bytesPerSector, _engine);
+            if (_engine == RandomCompatible) {
+                buffer.FillSectorsWithRandomData(_stream->random, bufferStartSector, sectorCount);
+            } else {
+                buffer.FillSectorsWithFastRandomData(_stream->fast, bufferStartSector, sectorCount);
+            }
+            _stream->sector = patternStartSector + sectorCount;
+            break;
+        }
+        }
+    } catch (...) {
+        overlay.swap(buffer._overlay);
+        throw;
+    }
+    overlay.swap(buffer._overlay);
+}
+
+} // namespace ufs
@@ -0,0 +1,157 @@
+#pragma once
+#ifndef _PATTERNBUFFER_H_
+#define _PATTERNBUFFER_H_
+
+#include "TypeDefs.h"
+#include "Buffer.h"
+#include "Prbs.h"
+#include "SectorOverlay.h"
+#include "TestPatterns.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ufs {
+
+/// <summary>
+/// The fill a PatternBuffer describes.
+/// </summary>
+enum PatternFill
+{
+    PatternFillConstant,
+    PatternFillBytes,
+    PatternFillIncrementing,
+    PatternFillDecrementing,
+    PatternFillRandomBySector,
+    PatternFillRandomCounter,
+    PatternFillTestPattern,
+    PatternFillPrbs,
+    PatternFillRandomSeeded
+};
+
+/// <summary>
+/// A read-only buffer of sectors that holds no data, only the fill that
+/// made it. Any range of it is generated on demand, a cache-sized block at a
+/// time, by the Buffer fill of the same name, so the expected data of a
+/// verify never has to be kept in memory:
+///
+///     PatternBuffer expected(sectors);
+///     expected.FillRandomCounter(seed).FillAddressOverlay(lba);
+///     CompareResult result = readBack.CompareTo(expected);
+///
+/// FillRandomSeeded is one random stream from the first sector, so a range
+/// of it is generated by running the stream up to the range. The stream is
+/// kept where the last range ended, so ranges taken in order, as a compare
+/// or a save takes them, cost only their own bytes. A copy starts its own
+/// stream, so copies can be verified against on different threads at once;
+/// one PatternBuffer used from two threads keeps rewinding its stream for
+/// each of them. Unseeded FillRandom can not be described. A PatternBuffer
+/// starts out as zeros.
+/// </summary>
+class PatternBuffer {
+public:
+    PatternBuffer(size_t sectorCount, size_t bytesPerSector = DEFAULT_BYTES_PER_SECTOR);
+    PatternBuffer(const PatternBuffer& pattern);
+    PatternBuffer(PatternBuffer&& pattern) = default;
+    PatternBuffer& operator=(const PatternBuffer& pattern);
+    PatternBuffer& operator=(PatternBuffer&& pattern) = default;
+
+    size_t GetSectorCount() const { return _sectorCount; }
+    size_t GetBytesPerSector() const { return _bytesPerSector; }
+    size_t GetTotalBytes() const { return _sectorCount * _bytesPerSector; }
+    PatternFill GetFill() const { return _fill; }
+
+    /// <summary>
+    /// Check whether ranges have to be generated from the start of the
+    /// pattern, so are best taken in order on one thread.
+    /// </summary>
+    bool IsSequential() const { return _fill == PatternFillRandomSeeded; }
+
+    /// <summary>
+    /// Get the number of sectors generated at a time when the data is
+    /// compared or saved.
+    /// </summary>
+    size_t GetBlockSectors() const;
+
+    // The fills, as the Buffer fills over the whole buffer. Each replaces
+    // the one before.
+    PatternBuffer& Fill(UInt8 value);
+    PatternBuffer& FillZeros();
+    PatternBuffer& FillOnes();
+    PatternBuffer& FillBytes(const std::vector<UInt8>& list, PatternPhase phase = PatternContinuous);
+    PatternBuffer& FillIncrementing(UInt8 startingValue = 0);
+    PatternBuffer& FillDecrementing(UInt8 startingValue = 255);
+    PatternBuffer& FillRandomSeeded(UInt32 seed, RandomEngine engine = RandomCompatible);
+    PatternBuffer& FillRandomSeededBySector(UInt32 seed);
+    PatternBuffer& FillRandomCounter(UInt64 seed, UInt64 firstKeySector = 0);
+    PatternBuffer& FillTestPattern(TestPattern pattern, const TestPatternOptions& options = TestPatternOptions());
+    PatternBuffer& FillPrbs(PrbsOrder order, UInt32 seed);
+
+    /// <summary>
+    /// Stamp the sector address into the first and last 8 bytes of every
+    /// sector, as Buffer::FillAddressOverlay does after a fill. Replaces the
+    /// sector overlay.
+    /// </summary>
+    PatternBuffer& FillAddressOverlay(UInt64 startingValue = 0);
+
+    /// <summary>
+    /// Stamp overlay into every sector over the fill, as a Buffer with the
+    /// overlay set does. Sector indexes are counted from the start of the
+    /// pattern wherever its sectors are written.
+    /// </summary>
+    PatternBuffer& SetSectorOverlay(const SectorOverlay& overlay);
+    PatternBuffer& ClearSectorOverlay();
+    const SectorOverlay* GetSectorOverlay() const { return _overlay.get(); }
+
+    /// <summary>
+    /// Write sectorCount sectors of the pattern from startSector into
+    /// destinationBuffer from destStartSector. A sectorCount of 0 writes up
+    /// to the end of the pattern. The destination's own overlay is not
+    /// stamped.
+    /// </summary>
+    Buffer& CopyTo(Buffer& destinationBuffer) const;
+    Buffer& CopyTo(Buffer& destinationBuffer, size_t startSector) const;
+    Buffer& CopyTo(Buffer& destinationBuffer, size_t startSector, size_t destStartSector) const;
+    Buffer& CopyTo(Buffer& destinationBuffer, size_t startSector, size_t destStartSector, size_t sectorCount) const;
+
+    /// <summary>
+    /// Write sectorCount sectors of the pattern from startSector to a file
+    /// as raw bytes, a block at a time. A sectorCount of 0 writes up to the
+    /// end of the pattern.
+    /// </summary>
+    const PatternBuffer& SaveToFileBinary(const std::string& fileName) const;
+    const PatternBuffer& SaveToFileBinary(const std::string& fileName, size_t startSector) const;
+    const PatternBuffer& SaveToFileBinary(const std::string& fileName, size_t startSector, size_t sectorCount) const;
+
+    /// <summary>
+    /// Throw OutOfRangeError unless the sectors are in the pattern, and
+    /// return sectorCount, or the sectors to the end for a sectorCount of 0.
+    /// </summary>
+    size_t ValidateSectorRange(size_t startSector, size_t sectorCount) const;
+
+private:
+    struct RandomStream;
+
+    void FillRange(Buffer& buffer, size_t bufferStartSector, size_t patternStartSector, size_t sectorCount) const;
+
+    size_t _sectorCount;
+    size_t _bytesPerSector;
+    PatternFill _fill;
+    UInt8 _value;
+    std::vector<UInt8> _bytes;
+    PatternPhase _phase;
+    UInt64 _seed;
+    UInt64 _firstKeySector;
+    TestPattern _testPattern;
+    TestPatternOptions _options;
+    PrbsOrder _prbsOrder;
+    RandomEngine _engine;
+    std::shared_ptr<RandomStream> _stream;
+    std::shared_ptr<const SectorOverlay> _overlay;
+};
+
+} // namespace ufs
+
+#endif // _PATTERNBUFFER_H_
@@ -0,0 +1,213 @@
+#include "Prbs.h"
+#include "DataKernels.h"
+#include "Errors.h"
+
+#include <algorithm>
+
+namespace ufs {
+
+namespace {
+
+// Bytes of expected data generated at a time by the checker.
+const size_t CHECK_CHUNK = 4096;
+
+// The LFSR step as a matrix over GF(2), and its powers of two. Column j is
+// the register one step (or 2^i steps) on from a register of just bit j.
+struct PrbsJumpTable {
+    UInt32 powers[64][32];
+
+    PrbsJumpTable(unsigned order, unsigned tap) {
+        const UInt32 mask = (1U << order) - 1;
+        for (unsigned j = 0; j < order; j++) {
+            UInt32 column = (1U << (j + 1)) & mask;
+            if (j == order - 1 || j == tap - 1) {
+                column ^= 1;
+            }
+            powers[0][j] = column;
+        }
+        for (int i = 1; i < 64; i++) {
+            for (unsigned j = 0; j < order; j++) {
+                powers[i][j] = Apply(powers[i - 1], powers[i - 1][j]);
+            }
+        }
+    }
+
+    static UInt32 Apply(const UInt32 (&matrix)[32], UInt32 state) {
+        UInt32 result = 0;
+        for (unsigned j = 0; state != 0; j++, state >>= 1) {
+            if (state & 1) {
+                result ^= matrix[j];
+            }
+        }
+        return result;
+    }
+};
+
+const PrbsJumpTable& GetJumpTable(PrbsOrder order) {
+    static const PrbsJumpTable tables[4] = {
+        PrbsJumpTable(Prbs7, PrbsGenerator::GetTap(Prbs7)),
+        PrbsJumpTable(Prbs15, PrbsGenerator::GetTap(Prbs15)),
+        PrbsJumpTable(Prbs23, PrbsGenerator::GetTap(Prbs23)),
+        PrbsJumpTable(Prbs31, PrbsGenerator::GetTap(Prbs31))
+    };
+    return tables[order / 8];
+}
+
+} // namespace
+
+PrbsGenerator::PrbsGenerator(PrbsOrder order, UInt32 seed)
+    : _order(order),
+      _mask((1U << order) - 1),
+      _state(0) {
+    GetTap(order);
+    SetState(seed);
+}
+
+void PrbsGenerator::SetState(UInt32 state) {
+    _state = state & _mask;
+    if (_state == 0) {
+        _state = _mask;
+    }
+}
+
+void PrbsGenerator::Fill(UInt8* data, size_t length) {
+    kernels::FillPrbs(data, length, _order, GetTap(_order), _state);
+}
+
+void PrbsGenerator::Skip(UInt64 bits) {
+    const PrbsJumpTable& table = GetJumpTable(_order);
+    for (int i = 0; bits != 0; i++, bits >>= 1) {
+        if (bits & 1) {
+            _state = PrbsJumpTable::Apply(table.powers[i], _state);
+        }
+    }
+}
+
+unsigned PrbsGenerator::GetTap(PrbsOrder order) {
+    switch (order) {
+    case Prbs7:
+        return 6;
+    case Prbs15:
+        return 14;
+    case Prbs23:
+        return 18;
+    case Prbs31:
+        return 28;
+    }
+    throw ArgumentError("PRBS order must be 7, 15, 23 or 31.");
+}
+
+UInt32 PrbsGenerator::StateBefore(PrbsOrder order, UInt32 lastBits) {
+    // Each step back recovers the bit that left the register:
+    // b[n - 1 - order] = b[n - 1] ^ b[n - 1 - tap].
+    unsigned tap = GetTap(order);
+    UInt32 state = lastBits & ((1U << order) - 1);
+    for (unsigned i = 0; i < order; i++) {
+        UInt32 oldest = (state ^ (state >> tap)) & 1;
+        state = (state >> 1) | (oldest << (order - 1));
+    }
+    return state;
+}
+
+PrbsChecker::PrbsChecker(PrbsOrder order)
+    : _generator(order, 0),
+      _initialGenerator(_generator),
+      _startsLocked(false),
+      _isLocked(false),
+      _bitsChecked(0),
+      _bitErrors(0),
+      _syncLosses(0),
+      _firstErrorBit(0),
+      _expected(CHECK_CHUNK) {
+}
+
+PrbsChecker::PrbsChecker(const PrbsGenerator& expected)
+    : _generator(expected),
+      _initialGenerator(expected),
+      _startsLocked(true),
+      _isLocked(true),
+      _bitsChecked(0),
+      _bitErrors(0),
+      _syncLosses(0),
+      _firstErrorBit(0),
+      _expected(CHECK_CHUNK) {
+}
+
+void PrbsChecker::Reset() {
+    _generator = _initialGenerator;
+    _isLocked = _startsLocked;
+    _bitsChecked = 0;
+    _bitErrors = 0;
+    _syncLosses = 0;
+    _firstErrorBit = 0;
+}
+
+double PrbsChecker::GetBitErrorRate() const {
+    return _bitsChecked == 0 ? 0.0 : static_cast<double>(_bitErrors) / static_cast<double>(_bitsChecked);
+}
+
+void PrbsChecker::Check(const UInt8* data, size_t length) {
+    const unsigned order = _generator.GetOrder();
+    if (!_isLocked) {
+        // Lock on the first order bits. Calls too short to lock are skipped.
+        if (length * 8 < order) {
+            return;
+        }
+        UInt32 first = 0;
+        for (size_t i = 0; i < 4; i++) {
+            first = (first << 8) | (i < length ? data[i] : 0);
+        }
+        _generator.SetState(PrbsGenerator::StateBefore(_generator.GetOrder(), first >> (32 - order)));
+        _isLocked = true;
+    }
+
+    size_t done = 0;
+    while (done < length) {
+        size_t count = std::min(CHECK_CHUNK, length - done);
+        _generator.Fill(_expected.data(), count);
+        if (kernels::CountBitDifferences(_expected.data(), data + done, count) == 0) {
+            _bitsChecked += count * 8;
+            done += count;
+            continue;
+        }
+
+        // Find the errors a word at a time, relocking where sync is lost.
+        for (size_t word = 0; word < count; word += 8) {
+            size_t bytes = std::min<size_t>(8, count - word);
+            const UInt8* received = data + done + word;
+            UInt64 errors = kernels::CountBitDifferences(_expected.data() + word, received, bytes);
+            if (errors != 0) {
+                CountErrors(_expected.data() + word, received, bytes, _bitsChecked);
+            }
+            _bitsChecked += bytes * 8;
+
+            if (errors * 4 > bytes * 8 && bytes * 8 >= order) {
+                UInt64 last = 0;
+                for (size_t i = 0; i < bytes; i++) {
+                    last = (last << 8) | received[i];
+                }
+                _generator.SetState(static_cast<UInt32>(last));
+                _syncLosses++;
+                count = word + bytes;
+                break;
+            }
+        }
+        done += count;
+    }
+}
+
+void PrbsChecker::CountErrors(const UInt8* expected, const UInt8* data, size_t length, UInt64 firstBit) {
+    for (size_t i = 0; i < length; i++) {
+        UInt8 difference = static_cast<UInt8>(expected[i] ^ data[i]);
+        for (int bit = 0; bit < 8; bit++) {
+            if (difference & (0x80 >> bit)) {
+                if (_bitErrors == 0) {
+                    _firstErrorBit = firstBit + i * 8 + bit;
+                }
+                _bitErrors++;
+            }
+        }
+    }
+}
+
+} // namespace ufs
@@ -0,0 +1,138 @@
+#pragma once
+#ifndef _PRBS_H_
+#define _PRBS_H_
+
+#include "TypeDefs.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace ufs {
+
+/// <summary>
+/// The ITU-T O.150 pseudo-random binary sequences, named by the order of
+/// their polynomial: PRBS7 x^7 + x^6 + 1, PRBS15 x^15 + x^14 + 1,
+/// PRBS23 x^23 + x^18 + 1 and PRBS31 x^31 + x^28 + 1. Sequences are not
+/// inverted.
+/// </summary>
+enum PrbsOrder
+{
+    Prbs7 = 7,
+    Prbs15 = 15,
+    Prbs23 = 23,
+    Prbs31 = 31
+};
+
+/// <summary>
+/// Generates a PRBS as bytes, first bit in the high bit of the first byte.
+/// Each Fill continues where the last one stopped, and Skip jumps ahead any
+/// number of bits through precomputed powers of the LFSR step, so ranges
+/// can be generated on their own.
+/// </summary>
+class PrbsGenerator {
+public:
+    /// <summary>
+    /// Start the sequence from seed, the initial shift register (the low
+    /// order bits). A register of zero would only ever give zeros, so it is
+    /// replaced by all ones.
+    /// </summary>
+    PrbsGenerator(PrbsOrder order, UInt32 seed);
+
+    PrbsOrder GetOrder() const { return _order; }
+
+    /// <summary>
+    /// Get the shift register: the last order bits generated, the newest
+    /// in bit 0.
+    /// </summary>
+    UInt32 GetState() const { return _state; }
+    void SetState(UInt32 state);
+
+    /// <summary>
+    /// Write the next length bytes of the sequence.
+    /// </summary>
+    void Fill(UInt8* data, size_t length);
+
+    /// <summary>
+    /// Advance the sequence by bits without generating them.
+    /// </summary>
+    void Skip(UInt64 bits);
+
+    /// <summary>
+    /// Get the register tap of the feedback polynomial besides order.
+    /// </summary>
+    static unsigned GetTap(PrbsOrder order);
+
+    /// <summary>
+    /// Get the register that, after order more steps, holds the last order
+    /// bits seen. Locks a generator onto received data.
+    /// </summary>
+    static UInt32 StateBefore(PrbsOrder order, UInt32 lastBits);
+
+private:
+    PrbsOrder _order;
+    UInt32 _mask;
+    UInt32 _state;
+};
+
+/// <summary>
+/// Checks received data against a PRBS and counts bit errors. Data is
+/// checked in calls that continue one another. A checker made from just an
+/// order locks onto the first order bits it is given; one made from a
+/// generator expects that generator's sequence from the first bit.
+///
+/// A 64 bit word with more than a quarter of its bits wrong is taken as
+/// lost sync (a slipped or inserted bit, or a different sequence). Its
+/// errors are counted and the checker relocks on the last order bits of
+/// the word, so a slip costs a few errors instead of every bit after it.
+/// </summary>
+class PrbsChecker {
+public:
+    explicit PrbsChecker(PrbsOrder order);
+    explicit PrbsChecker(const PrbsGenerator& expected);
+
+    /// <summary>
+    /// Check the next length bytes of received data. Words are counted from
+    /// the start of each call, and a call too short to lock on is skipped.
+    /// </summary>
+    void Check(const UInt8* data, size_t length);
+
+    /// <summary>
+    /// Forget the data checked so far and the lock, and expect the stream
+    /// from its start again.
+    /// </summary>
+    void Reset();
+
+    PrbsOrder GetOrder() const { return _generator.GetOrder(); }
+    bool IsLocked() const { return _isLocked; }
+    UInt64 GetBitsChecked() const { return _bitsChecked; }
+    UInt64 GetBitErrors() const { return _bitErrors; }
+    UInt64 GetSyncLossCount() const { return _syncLosses; }
+
+    /// <summary>
+    /// Get the bit errors per bit checked.
+    /// </summary>
+    double GetBitErrorRate() const;
+
+    /// <summary>
+    /// Get the bit offset, from the first bit checked, of the first error.
+    /// Only meaningful while GetBitErrors is not zero.
+    /// </summary>
+    UInt64 GetFirstErrorBit() const { return _firstErrorBit; }
+
+private:
+    void CountErrors(const UInt8* expected, const UInt8* data, size_t length, UInt64 firstBit);
+
+    PrbsGenerator _generator;
+    PrbsGenerator _initialGenerator;
+    bool _startsLocked;
+    bool _isLocked;
+    UInt64 _bitsChecked;
+    UInt64 _bitErrors;
+    UInt64 _syncLosses;
+    UInt64 _firstErrorBit;
+    std::vector<UInt8> _expected;
+};
+
+} // namespace ufs
+
+#endif // _PRBS_H_
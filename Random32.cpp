@@ -1,5 +1,6 @@
 #include "Random32.h"
 #include <chrono>
+#include <cstring>
 #include <boost/random.hpp>
 
 namespace ufs {
@@ -38,6 +39,18 @@ UInt8 Random32::NextByte() {
     return static_cast<UInt8>(Next(256));
 }
 
+// The generator is the three component words, in order; the simulator
+// compression info stores it in sectors the same way.
+static_assert(sizeof(boost::random::taus88) == 3 * sizeof(UInt32), "taus88 state must be three words");
+
+void Random32::GetState(UInt32 state[3]) const {
+    ::memcpy(state, &_generator, sizeof(_generator));
+}
+
+void Random32::SetState(const UInt32 state[3]) {
+    ::memcpy(static_cast<void*>(&_generator), state, sizeof(_generator));
+}
+
 void Random32::NextBytes(UInt8* buffer, size_t length) {
     for (size_t i = 0; i < length; ++i) {
         buffer[i] = NextByte();
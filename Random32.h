@@ -8,6 +8,17 @@
 
 namespace ufs {
 
+/// <summary>
+/// Generator used by the Buffer random fills. RandomCompatible gives the
+/// taus88 sequence Random32 has always produced, so existing seeds fill the
+/// same bytes. RandomFast uses a faster generator with a different sequence.
+/// </summary>
+enum RandomEngine
+{
+    RandomCompatible,
+    RandomFast
+};
+
 /// <summary>
 /// 32-bit random number generator using boost::random::taus88
 /// 
@@ -71,6 +82,13 @@ public:
     /// </summary>
     bool GetIsSeeded() const { return _isSeeded; }
     
+    /// <summary>
+    /// Get or set the generator state, the three taus88 component words.
+    /// Lets a bulk fill continue the sequence outside of Next().
+    /// </summary>
+    void GetState(UInt32 state[3]) const;
+    void SetState(const UInt32 state[3]);
+    
     /// <summary>
     /// Get the underlying generator (for compatibility)
     /// </summary>
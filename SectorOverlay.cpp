@@ -0,0 +1,116 @@
+#include "SectorOverlay.h"
+#include "DataKernels.h"
+#include "Errors.h"
+
+#include <chrono>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+namespace ufs {
+
+namespace {
+
+inline UInt64 ReadTimestamp() {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    return __rdtsc();
+#else
+    return static_cast<UInt64>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+inline size_t FieldStart(const OverlayField& field, size_t bytesPerSector) {
+    return field.offset < 0 ? bytesPerSector - static_cast<size_t>(-field.offset) : static_cast<size_t>(field.offset);
+}
+
+} // namespace
+
+SectorOverlay::SectorOverlay()
+    : _hasCrc(false),
+      _firstLba(0),
+      _seed(0),
+      _pass(0) {
+}
+
+SectorOverlay SectorOverlay::AddressOverlay(UInt64 startingValue) {
+    SectorOverlay overlay;
+    overlay.SetFirstLba(startingValue);
+    overlay.AddField(OverlayLba, 0, 8);
+    overlay.AddField(OverlayLba, -8, 8);
+    return overlay;
+}
+
+SectorOverlay& SectorOverlay::AddField(OverlaySource source, std::ptrdiff_t offset, size_t width, OverlayByteOrder byteOrder) {
+    if (width == 0 || width > 8) {
+        throw ArgumentError("Overlay fields are 1 to 8 bytes wide.");
+    }
+
+    OverlayField field = { source, offset, width, byteOrder, 0 };
+    _fields.push_back(field);
+    _hasCrc = _hasCrc || source == OverlayCrc32c;
+    return *this;
+}
+
+SectorOverlay& SectorOverlay::AddConstant(UInt64 value, std::ptrdiff_t offset, size_t width, OverlayByteOrder byteOrder) {
+    AddField(OverlayConstant, offset, width, byteOrder);
+    _fields.back().value = value;
+    return *this;
+}
+
+void SectorOverlay::Validate(size_t bytesPerSector) const {
+    for (const OverlayField& field : _fields) {
+        bool fits = field.offset < 0
+            ? static_cast<size_t>(-field.offset) <= bytesPerSector && static_cast<size_t>(-field.offset) >= field.width
+            : static_cast<size_t>(field.offset) + field.width <= bytesPerSector;
+        if (!fits) {
+            throw ArgumentError("Overlay field at offset " + std::to_string(field.offset) + " does not fit in a sector of "
+                + std::to_string(bytesPerSector) + " bytes.");
+        }
+    }
+}
+
+void SectorOverlay::Apply(UInt8* sector, size_t bytesPerSector, UInt64 sectorIndex) const {
+    for (const OverlayField& field : _fields) {
+        UInt64 value = 0;
+        switch (field.source) {
+        case OverlayLba:
+            value = _firstLba + sectorIndex;
+            break;
+        case OverlaySeed:
+            value = _seed;
+            break;
+        case OverlayPass:
+            value = _pass;
+            break;
+        case OverlayTimestamp:
+            value = ReadTimestamp();
+            break;
+        case OverlayConstant:
+            value = field.value;
+            break;
+        case OverlayCrc32c:
+            // Zeroed now, filled in once everything else is written.
+            break;
+        }
+        WriteValue(sector + FieldStart(field, bytesPerSector), value, field.width, field.byteOrder);
+    }
+
+    if (_hasCrc) {
+        UInt32 crc = kernels::Crc32c(sector, bytesPerSector);
+        for (const OverlayField& field : _fields) {
+            if (field.source == OverlayCrc32c) {
+                WriteValue(sector + FieldStart(field, bytesPerSector), crc, field.width, field.byteOrder);
+            }
+        }
+    }
+}
+
+void SectorOverlay::WriteValue(UInt8* out, UInt64 value, size_t width, OverlayByteOrder byteOrder) {
+    for (size_t i = 0; i < width; i++) {
+        UInt8 byte = static_cast<UInt8>(value >> (8 * i));
+        out[byteOrder == OverlayLittleEndian ? i : width - 1 - i] = byte;
+    }
+}
+
+} // namespace ufs
@@ -0,0 +1,112 @@
+#pragma once
+#ifndef _SECTOROVERLAY_H_
+#define _SECTOROVERLAY_H_
+
+#include "TypeDefs.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace ufs {
+
+/// <summary>
+/// Where the value of an overlay field comes from.
+/// </summary>
+enum OverlaySource
+{
+    OverlayLba,         // The first LBA plus the sector index in the buffer
+    OverlaySeed,        // The overlay seed
+    OverlayPass,        // The overlay pass number
+    OverlayTimestamp,   // The CPU timestamp counter as the sector is written
+    OverlayCrc32c,      // CRC-32C of the sector with every CRC field zeroed
+    OverlayConstant     // A fixed value
+};
+
+enum OverlayByteOrder
+{
+    OverlayLittleEndian,
+    OverlayBigEndian
+};
+
+/// <summary>
+/// One field of a SectorOverlay. A negative offset counts back from the end
+/// of the sector, so -8 is the last eight bytes. Values are truncated to
+/// width bytes.
+/// </summary>
+struct OverlayField
+{
+    OverlaySource source;
+    std::ptrdiff_t offset;
+    size_t width;
+    OverlayByteOrder byteOrder;
+    UInt64 value;
+};
+
+/// <summary>
+/// Header and footer fields stamped into every sector a Buffer fill writes
+/// (see Buffer::SetSectorOverlay). The fills apply it to each block of
+/// sectors right after generating it, while the block is still in cache, so
+/// stamped data costs one sweep over memory.
+///
+/// Fields are written in the order they were added, except CRC fields,
+/// which are written last so they cover all the others.
+/// </summary>
+class SectorOverlay {
+public:
+    SectorOverlay();
+
+    /// <summary>
+    /// The overlay FillAddressOverlay writes: the address (startingValue plus
+    /// the sector index) in the first and last eight bytes of each sector.
+    /// </summary>
+    static SectorOverlay AddressOverlay(UInt64 startingValue);
+
+    /// <summary>
+    /// Add a field of width bytes (1 to 8) at offset.
+    /// </summary>
+    SectorOverlay& AddField(OverlaySource source, std::ptrdiff_t offset, size_t width, OverlayByteOrder byteOrder = OverlayLittleEndian);
+
+    /// <summary>
+    /// Add a field holding value.
+    /// </summary>
+    SectorOverlay& AddConstant(UInt64 value, std::ptrdiff_t offset, size_t width, OverlayByteOrder byteOrder = OverlayLittleEndian);
+
+    const std::vector<OverlayField>& GetFields() const { return _fields; }
+    bool IsEmpty() const { return _fields.empty(); }
+
+    /// <summary>
+    /// The LBA of sector 0 of the buffer.
+    /// </summary>
+    SectorOverlay& SetFirstLba(UInt64 lba) { _firstLba = lba; return *this; }
+    UInt64 GetFirstLba() const { return _firstLba; }
+
+    SectorOverlay& SetSeed(UInt64 seed) { _seed = seed; return *this; }
+    UInt64 GetSeed() const { return _seed; }
+
+    SectorOverlay& SetPass(UInt64 pass) { _pass = pass; return *this; }
+    UInt64 GetPass() const { return _pass; }
+
+    /// <summary>
+    /// Throw ArgumentError unless every field fits in a sector of
+    /// bytesPerSector bytes.
+    /// </summary>
+    void Validate(size_t bytesPerSector) const;
+
+    /// <summary>
+    /// Stamp the fields into one sector, sector sectorIndex of the buffer.
+    /// </summary>
+    void Apply(UInt8* sector, size_t bytesPerSector, UInt64 sectorIndex) const;
+
+private:
+    static void WriteValue(UInt8* out, UInt64 value, size_t width, OverlayByteOrder byteOrder);
+
+    std::vector<OverlayField> _fields;
+    bool _hasCrc;
+    UInt64 _firstLba;
+    UInt64 _seed;
+    UInt64 _pass;
+};
+
+} // namespace ufs
+
+#endif // _SECTOROVERLAY_H_
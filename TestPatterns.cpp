@@ -0,0 +1,167 @@
+#include "TestPatterns.h"
+#include "DataKernels.h"
+#include "Errors.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <string>
+
+namespace ufs {
+namespace patterns {
+
+namespace {
+
+template<class Word>
+inline void StoreLittleEndian(UInt8* out, Word value) {
+    for (size_t i = 0; i < sizeof(Word); i++) {
+        out[i] = static_cast<UInt8>(value >> (8 * i));
+    }
+}
+
+// Sectors until the phases repeat, for phases stepping phaseStep through a
+// cycle of cycle words.
+inline size_t CycleSectors(size_t cycle, size_t phaseStep) {
+    return cycle / std::gcd(phaseStep % cycle, cycle);
+}
+
+inline size_t SectorPhase(const TestPatternOptions& options, size_t cycle, size_t sector) {
+    return (options.phase % cycle + (sector % cycle) * (options.phaseStep % cycle)) % cycle;
+}
+
+template<class Pattern, class Word>
+void FillPeriodic(const TestPatternOptions& options, UInt8* data, size_t length, size_t bytesPerSector, size_t firstSector) {
+    const size_t cycle = Pattern::Cycle();
+
+    // Two cycles, so a cycle from any phase is one contiguous pattern.
+    UInt8 tile[2 * WordTraits<UInt64>::bits * sizeof(UInt64)];
+    for (size_t k = 0; k < 2 * cycle; k++) {
+        StoreLittleEndian(tile + k * sizeof(Word), Pattern::At(k));
+    }
+
+    // Only the first cycle of sectors is generated, the rest repeats it.
+    size_t sectors = length / bytesPerSector;
+    size_t distinct = std::min(sectors, CycleSectors(cycle, options.phaseStep));
+    for (size_t s = 0; s < distinct; s++) {
+        size_t phase = SectorPhase(options, cycle, firstSector + s);
+        kernels::FillBytes(data + s * bytesPerSector, bytesPerSector, tile + phase * sizeof(Word), cycle * sizeof(Word));
+    }
+    kernels::FillRepeating(data, distinct * bytesPerSector, length);
+}
+
+template<class Pattern, class Word>
+void FillPositional(const TestPatternOptions& options, UInt8* data, size_t length, size_t bytesPerSector, size_t firstSector) {
+    const size_t words = bytesPerSector / sizeof(Word);
+    const size_t cycle = Pattern::Cycle(words);
+
+    // Background and changed words are all zero or all one bits, so whole
+    // runs of them are memsets.
+    const UInt8 background = static_cast<UInt8>(Pattern::background);
+    const UInt8 changed = static_cast<UInt8>(~background);
+
+    size_t sectors = length / bytesPerSector;
+    size_t distinct = std::min(sectors, CycleSectors(cycle, options.phaseStep));
+    for (size_t s = 0; s < distinct; s++) {
+        UInt8* out = data + s * bytesPerSector;
+        size_t phase = SectorPhase(options, cycle, firstSector + s);
+        size_t from = Pattern::ChangedFrom(phase) * sizeof(Word);
+        size_t to = Pattern::ChangedTo(phase) * sizeof(Word);
+        ::memset(out, background, from);
+        ::memset(out + from, changed, to - from);
+        ::memset(out + to, background, bytesPerSector - to);
+    }
+    kernels::FillRepeating(data, distinct * bytesPerSector, length);
+}
+
+template<class Word>
+void FillSectorsOfWidth(TestPattern pattern, const TestPatternOptions& options, UInt8* data, size_t length, size_t bytesPerSector, size_t firstSector) {
+    switch (pattern) {
+    case PatternWalkingOnes:
+        FillPeriodic<WalkingOnes<Word>, Word>(options, data, length, bytesPerSector, firstSector);
+        break;
+    case PatternWalkingZeros:
+        FillPeriodic<WalkingZeros<Word>, Word>(options, data, length, bytesPerSector, firstSector);
+        break;
+    case PatternCheckerboard:
+        FillPeriodic<Checkerboard<Word>, Word>(options, data, length, bytesPerSector, firstSector);
+        break;
+    case PatternInverseCheckerboard:
+        FillPeriodic<InverseCheckerboard<Word>, Word>(options, data, length, bytesPerSector, firstSector);
+        break;
+    case PatternButterfly:
+        FillPeriodic<Butterfly<Word>, Word>(options, data, length, bytesPerSector, firstSector);
+        break;
+    case PatternGallopingOnes:
+        FillPositional<Galloping<Word, true>, Word>(options, data, length, bytesPerSector, firstSector);
+        break;
+    case PatternGallopingZeros:
+        FillPositional<Galloping<Word, false>, Word>(options, data, length, bytesPerSector, firstSector);
+        break;
+    case PatternMarchingOnes:
+        FillPositional<Marching<Word, true>, Word>(options, data, length, bytesPerSector, firstSector);
+        break;
+    case PatternMarchingZeros:
+        FillPositional<Marching<Word, false>, Word>(options, data, length, bytesPerSector, firstSector);
+        break;
+    }
+}
+
+} // namespace
+
+size_t GetCycleSectors(TestPattern pattern, const TestPatternOptions& options, size_t bytesPerSector) {
+    size_t words = bytesPerSector / (options.wordBits / 8);
+    size_t cycle = 1;
+    switch (pattern) {
+    case PatternWalkingOnes:
+    case PatternWalkingZeros:
+    case PatternButterfly:
+        cycle = options.wordBits;
+        break;
+    case PatternCheckerboard:
+    case PatternInverseCheckerboard:
+        cycle = 2;
+        break;
+    case PatternGallopingOnes:
+    case PatternGallopingZeros:
+        cycle = words;
+        break;
+    case PatternMarchingOnes:
+    case PatternMarchingZeros:
+        cycle = words + 1;
+        break;
+    }
+    return CycleSectors(cycle, options.phaseStep);
+}
+
+void FillSectors(TestPattern pattern, const TestPatternOptions& options, UInt8* data, size_t length, size_t bytesPerSector, size_t firstSector) {
+    switch (options.wordBits) {
+    case 8:
+        FillSectorsOfWidth<UInt8>(pattern, options, data, length, bytesPerSector, firstSector);
+        break;
+    case 16:
+        FillSectorsOfWidth<UInt16>(pattern, options, data, length, bytesPerSector, firstSector);
+        break;
+    case 32:
+        FillSectorsOfWidth<UInt32>(pattern, options, data, length, bytesPerSector, firstSector);
+        break;
+    case 64:
+        FillSectorsOfWidth<UInt64>(pattern, options, data, length, bytesPerSector, firstSector);
+        break;
+    default:
+        Validate(options, bytesPerSector);
+        break;
+    }
+}
+
+void Validate(const TestPatternOptions& options, size_t bytesPerSector) {
+    if (options.wordBits != 8 && options.wordBits != 16 && options.wordBits != 32 && options.wordBits != 64) {
+        throw ArgumentError("Test pattern words must be 8, 16, 32 or 64 bits, not " + std::to_string(options.wordBits) + ".");
+    }
+    if (bytesPerSector % (options.wordBits / 8) != 0) {
+        throw ArgumentError("Sectors of " + std::to_string(bytesPerSector) + " bytes are not a whole number of "
+            + std::to_string(options.wordBits) + " bit words.");
+    }
+}
+
+} // namespace patterns
+} // namespace ufs
@@ -0,0 +1,143 @@
+#pragma once
+#ifndef _TESTPATTERNS_H_
+#define _TESTPATTERNS_H_
+
+#include "TypeDefs.h"
+
+#include <cstddef>
+
+namespace ufs {
+
+/// <summary>
+/// Storage test patterns, built from words of TestPatternOptions::wordBits
+/// bits stored little endian. W is the word width in bits.
+/// </summary>
+enum TestPattern
+{
+    PatternWalkingOnes,             // Word k has only bit k % W set
+    PatternWalkingZeros,            // Word k has only bit k % W clear
+    PatternCheckerboard,            // 0x55.. and 0xAA.. words alternating
+    PatternInverseCheckerboard,     // 0xAA.. and 0x55.. words alternating
+    PatternButterfly,               // Bits k and W-1-k set, closing in then opening out (81 42 24 18 18 24 42 81)
+    PatternGallopingOnes,           // Zero words with one all ones word, at the phase
+    PatternGallopingZeros,          // All ones words with one zero word, at the phase
+    PatternMarchingOnes,            // All ones words before the phase, zero words from it
+    PatternMarchingZeros            // Zero words before the phase, all ones words from it
+};
+
+/// <summary>
+/// Word width and per-sector phase of a test pattern. Sector s of the buffer
+/// starts at word phase + s * phaseStep of the pattern, so a phaseStep of 1
+/// walks (or gallops, or marches) the pattern one word further in each
+/// sector. Sectors are counted from the start of the buffer, so filling a
+/// range gives the same data as filling the whole buffer.
+/// </summary>
+struct TestPatternOptions
+{
+    TestPatternOptions(size_t wordBits = 8, size_t phase = 0, size_t phaseStep = 0)
+        : wordBits(wordBits), phase(phase), phaseStep(phaseStep) {}
+
+    size_t wordBits;    // 8, 16, 32 or 64
+    size_t phase;
+    size_t phaseStep;
+};
+
+namespace patterns {
+
+template<class Word>
+struct WordTraits
+{
+    static constexpr size_t bits = sizeof(Word) * 8;
+    static constexpr Word ones = static_cast<Word>(~static_cast<Word>(0));
+
+    // byte repeated across the word
+    static constexpr Word Repeat(UInt8 byte) { return static_cast<Word>(ones / 0xFF * byte); }
+};
+
+// Periodic patterns: word k of the pattern is At(k), repeating every Cycle
+// words.
+
+template<class Word>
+struct WalkingOnes
+{
+    static constexpr size_t Cycle() { return WordTraits<Word>::bits; }
+    static constexpr Word At(size_t k) { return static_cast<Word>(static_cast<Word>(1) << (k % WordTraits<Word>::bits)); }
+};
+
+template<class Word>
+struct WalkingZeros
+{
+    static constexpr size_t Cycle() { return WordTraits<Word>::bits; }
+    static constexpr Word At(size_t k) { return static_cast<Word>(~WalkingOnes<Word>::At(k)); }
+};
+
+template<class Word>
+struct Checkerboard
+{
+    static constexpr size_t Cycle() { return 2; }
+    static constexpr Word At(size_t k) { return WordTraits<Word>::Repeat(k % 2 == 0 ? 0x55 : 0xAA); }
+};
+
+template<class Word>
+struct InverseCheckerboard
+{
+    static constexpr size_t Cycle() { return 2; }
+    static constexpr Word At(size_t k) { return static_cast<Word>(~Checkerboard<Word>::At(k)); }
+};
+
+template<class Word>
+struct Butterfly
+{
+    static constexpr size_t Cycle() { return WordTraits<Word>::bits; }
+    static constexpr Word At(size_t k)
+    {
+        // Steps 0 .. W/2-1 close in, the second half mirrors them.
+        size_t step = k % WordTraits<Word>::bits;
+        size_t bit = step < WordTraits<Word>::bits / 2 ? step : WordTraits<Word>::bits - 1 - step;
+        return static_cast<Word>((static_cast<Word>(1) << bit) | (static_cast<Word>(1) << (WordTraits<Word>::bits - 1 - bit)));
+    }
+};
+
+// Positional patterns: a sector of words background words, changed at the
+// phase. The phase repeats every Cycle(words).
+
+template<class Word, bool ones>
+struct Galloping
+{
+    static constexpr Word background = ones ? 0 : WordTraits<Word>::ones;
+    static constexpr size_t Cycle(size_t words) { return words; }
+    static constexpr size_t ChangedFrom(size_t phase) { return phase; }
+    static constexpr size_t ChangedTo(size_t phase) { return phase + 1; }
+};
+
+template<class Word, bool ones>
+struct Marching
+{
+    static constexpr Word background = ones ? 0 : WordTraits<Word>::ones;
+    static constexpr size_t Cycle(size_t words) { return words + 1; }
+    static constexpr size_t ChangedFrom(size_t) { return 0; }
+    static constexpr size_t ChangedTo(size_t phase) { return phase; }
+};
+
+/// <summary>
+/// Get the number of sectors after which the sector phases of pattern
+/// repeat, so fills can be split at multiples of it.
+/// </summary>
+size_t GetCycleSectors(TestPattern pattern, const TestPatternOptions& options, size_t bytesPerSector);
+
+/// <summary>
+/// Fill length bytes (whole sectors) with pattern, starting with sector
+/// firstSector of the buffer.
+/// </summary>
+void FillSectors(TestPattern pattern, const TestPatternOptions& options, UInt8* data, size_t length, size_t bytesPerSector, size_t firstSector);
+
+/// <summary>
+/// Throw ArgumentError unless options can be used with sectors of
+/// bytesPerSector bytes.
+/// </summary>
+void Validate(const TestPatternOptions& options, size_t bytesPerSector);
+
+} // namespace patterns
+} // namespace ufs
+
+#endif // _TESTPATTERNS_H_
@@ -0,0 +1,261 @@
+// pthread_setaffinity_np and cpu_set_t are GNU extensions.
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ufs {
+
+namespace {
+
+const size_t MAX_DEFAULT_THREADS = 16;
+
+// Ranges ParallelForBytes leaves on the calling thread by default; below
+// this, waking the workers costs more than it saves.
+const size_t DEFAULT_PARALLEL_THRESHOLD = 4 * 1024 * 1024;
+
+// Bytes per chunk handed to a thread by ParallelForBytes, before rounding
+// to the alignment.
+const size_t BYTES_PER_CHUNK = 64 * 1024;
+
+// Polls of the job counter before a worker or the caller goes to sleep.
+const int SPIN_COUNT = 2000;
+
+// Set while a thread runs part of a job, so nested calls run inline.
+thread_local bool insideJob = false;
+
+inline void CpuRelax() {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+} // namespace
+
+WorkerPool& WorkerPool::GetInstance() {
+    // Never destroyed, so buffers in static storage can still use it while
+    // the process exits.
+    static WorkerPool* instance = new WorkerPool();
+    return *instance;
+}
+
+WorkerPool::WorkerPool()
+    : _threadCount(std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), MAX_DEFAULT_THREADS)),
+      _parallelThreshold(DEFAULT_PARALLEL_THRESHOLD),
+      _stopping(false),
+      _generation(0),
+      _pending(0),
+      _body(NULL),
+      _count(0),
+      _grain(1),
+      _participants(0),
+      _schedule(ScheduleStatic),
+      _nextChunk(0) {
+}
+
+WorkerPool::~WorkerPool() {
+    StopWorkers();
+}
+
+void WorkerPool::SetThreadCount(size_t threadCount) {
+    std::lock_guard<std::mutex> job(_jobMutex);
+    StopWorkers();
+    _threadCount = std::max<size_t>(threadCount, 1);
+}
+
+void WorkerPool::SetAffinity(const std::vector<int>& cpus) {
+    std::lock_guard<std::mutex> job(_jobMutex);
+    StopWorkers();
+    _affinity = cpus;
+}
+
+std::vector<int> WorkerPool::GetAffinity() const {
+    std::lock_guard<std::mutex> job(const_cast<std::mutex&>(_jobMutex));
+    return _affinity;
+}
+
+void WorkerPool::ParallelFor(size_t count, size_t grain, const RangeFunction& body, Schedule schedule) {
+    if (count == 0) {
+        return;
+    }
+
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = count / grain + (count % grain != 0 ? 1 : 0);
+    size_t threads = std::min<size_t>(_threadCount, chunks);
+    if (threads <= 1 || insideJob) {
+        body(0, count);
+        return;
+    }
+
+    // Someone else's job is running; don't wait for it.
+    std::unique_lock<std::mutex> job(_jobMutex, std::try_to_lock);
+    if (!job.owns_lock()) {
+        body(0, count);
+        return;
+    }
+
+    if (_workers.size() + 1 < _threadCount) {
+        StartWorkers();
+    }
+    threads = std::min(threads, _workers.size() + 1);
+
+    _body = &body;
+    _count = count;
+    _grain = grain;
+    _participants = threads;
+    _schedule = schedule;
+    _nextChunk = 0;
+    _error = std::exception_ptr();
+    // Every worker acknowledges every job, so none can still be looking at
+    // this one when the next is published.
+    _pending = _workers.size();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _generation++;
+    }
+    _wake.notify_all();
+
+    insideJob = true;
+    try {
+        RunShare(0);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_error) {
+            _error = std::current_exception();
+        }
+    }
+    insideJob = false;
+
+    for (int spin = 0; spin < SPIN_COUNT && _pending.load(std::memory_order_acquire) != 0; spin++) {
+        CpuRelax();
+    }
+    if (_pending.load(std::memory_order_acquire) != 0) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [this]() { return _pending.load() == 0; });
+    }
+
+    _body = NULL;
+    if (_error) {
+        std::exception_ptr error = _error;
+        _error = std::exception_ptr();
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkerPool::ParallelForBytes(size_t length, size_t alignment, const RangeFunction& body, Schedule schedule) {
+    if (length < _parallelThreshold || _threadCount <= 1) {
+        if (length != 0) {
+            body(0, length);
+        }
+        return;
+    }
+
+    alignment = std::max<size_t>(alignment, 1);
+    size_t grain = std::max<size_t>(BYTES_PER_CHUNK / alignment, 1) * alignment;
+    ParallelFor(length, grain, body, schedule);
+}
+
+void WorkerPool::StartWorkers() {
+    // Called with _jobMutex held, before the next job is published.
+    UInt64 generation = _generation.load();
+    for (size_t index = _workers.size(); index + 1 < _threadCount; index++) {
+        _workers.push_back(std::thread([this, index, generation]() {
+            UInt64 seen = generation;
+            for (;;) {
+                for (int spin = 0; spin < SPIN_COUNT && _generation.load(std::memory_order_acquire) == seen; spin++) {
+                    CpuRelax();
+                }
+                if (_generation.load(std::memory_order_acquire) == seen) {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _wake.wait(lock, [this, seen]() { return _generation.load() != seen; });
+                }
+                seen = _generation.load(std::memory_order_acquire);
+
+                if (_stopping) {
+                    return;
+                }
+                WorkerMain(index);
+            }
+        }));
+
+#ifdef __linux__
+        if (!_affinity.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(_affinity[index % _affinity.size()], &set);
+            pthread_setaffinity_np(_workers.back().native_handle(), sizeof(set), &set);
+        }
+#endif
+    }
+}
+
+void WorkerPool::StopWorkers() {
+    if (_workers.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+        _generation++;
+    }
+    _wake.notify_all();
+    for (std::thread& worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+    _stopping = false;
+}
+
+void WorkerPool::WorkerMain(size_t index) {
+    if (index + 1 < _participants) {
+        insideJob = true;
+        try {
+            RunShare(index + 1);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_error) {
+                _error = std::current_exception();
+            }
+        }
+        insideJob = false;
+    }
+
+    if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // Taking the lock orders this with the caller's check of _pending.
+        std::lock_guard<std::mutex> lock(_mutex);
+        _done.notify_one();
+    }
+}
+
+void WorkerPool::RunShare(size_t participant) {
+    if (_schedule == ScheduleDynamic) {
+        for (;;) {
+            size_t begin = _nextChunk.fetch_add(1) * _grain;
+            if (begin >= _count) {
+                return;
+            }
+            (*_body)(begin, std::min(begin + _grain, _count));
+        }
+    }
+
+    // Static: participant p takes chunks [chunks * p / n, chunks * (p + 1) / n).
+    UInt64 chunks = _count / _grain + (_count % _grain != 0 ? 1 : 0);
+    size_t begin = static_cast<size_t>(chunks * participant / _participants) * _grain;
+    size_t end = std::min(static_cast<size_t>(chunks * (participant + 1) / _participants) * _grain, _count);
+    if (begin < end) {
+        (*_body)(begin, end);
+    }
+}
+
+} // namespace ufs
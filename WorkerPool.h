@@ -0,0 +1,122 @@
+#pragma once
+#ifndef _WORKERPOOL_H_
+#define _WORKERPOOL_H_
+
+#include "TypeDefs.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ufs {
+
+/// <summary>
+/// How ParallelFor hands out the range. ScheduleStatic gives each thread
+/// one contiguous share, ScheduleDynamic hands out grain sized chunks to
+/// whichever thread is free.
+/// </summary>
+enum Schedule
+{
+    ScheduleStatic,
+    ScheduleDynamic
+};
+
+/// <summary>
+/// The threads Buffer uses to work on large ranges. The calling thread
+/// always takes a share of the work, so a thread count of 1 runs everything
+/// on the caller and starts no threads. Workers are started on first use,
+/// spin briefly after each job so back to back jobs wake quickly, and then
+/// sleep until the next one.
+///
+/// One job runs at a time. A ParallelFor issued while another is running,
+/// or from inside a job, runs on the calling thread.
+/// </summary>
+class WorkerPool {
+public:
+    typedef std::function<void(size_t begin, size_t end)> RangeFunction;
+
+    /// <summary>
+    /// Get the process wide pool used by Buffer.
+    /// </summary>
+    static WorkerPool& GetInstance();
+
+    /// <summary>
+    /// Set the number of threads working on a job, the caller included.
+    /// Defaults to the number of CPUs, at most 16.
+    /// </summary>
+    void SetThreadCount(size_t threadCount);
+    size_t GetThreadCount() const { return _threadCount; }
+
+    /// <summary>
+    /// Pin worker i to cpus[i % cpus.size()]. An empty list lets the
+    /// scheduler place them. The calling thread is never pinned.
+    /// </summary>
+    void SetAffinity(const std::vector<int>& cpus);
+    std::vector<int> GetAffinity() const;
+
+    /// <summary>
+    /// Set the smallest byte range ParallelForBytes splits across threads.
+    /// </summary>
+    void SetParallelThreshold(size_t bytes) { _parallelThreshold = bytes; }
+    size_t GetParallelThreshold() const { return _parallelThreshold; }
+
+    /// <summary>
+    /// Call body(begin, end) over sub-ranges covering [0, count). Every
+    /// boundary but count is a multiple of grain. Exceptions thrown by body
+    /// are rethrown on the calling thread once the job is finished.
+    /// </summary>
+    void ParallelFor(size_t count, size_t grain, const RangeFunction& body, Schedule schedule = ScheduleStatic);
+
+    /// <summary>
+    /// ParallelFor over length bytes, for ranges of at least the parallel
+    /// threshold; shorter ranges are one call to body on the calling thread.
+    /// Boundaries are multiples of alignment. ScheduleStatic gives each
+    /// thread one share; ScheduleDynamic hands out chunks in ascending order,
+    /// so a body that finds what it looks for can skip the chunks after it.
+    /// </summary>
+    void ParallelForBytes(size_t length, size_t alignment, const RangeFunction& body, Schedule schedule = ScheduleStatic);
+
+private:
+    WorkerPool();
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void StartWorkers();
+    void StopWorkers();
+    void WorkerMain(size_t index);
+    void RunShare(size_t participant);
+
+    std::atomic<size_t> _threadCount;
+    std::atomic<size_t> _parallelThreshold;
+    std::vector<int> _affinity;
+
+    // Held by the thread running a job, and while reconfiguring.
+    std::mutex _jobMutex;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    std::vector<std::thread> _workers;
+    bool _stopping;
+
+    // The current job, published by bumping _generation.
+    std::atomic<UInt64> _generation;
+    std::atomic<size_t> _pending;
+    const RangeFunction* _body;
+    size_t _count;
+    size_t _grain;
+    size_t _participants;
+    Schedule _schedule;
+    std::atomic<size_t> _nextChunk;
+    std::exception_ptr _error;
+};
+
+} // namespace ufs
+
+#endif // _WORKERPOOL_H_
@@ -1,6 +1,9 @@
 #include "../Buffer.h"
+#include "../DataKernels.h"
+#include "../PatternBuffer.h"
 #include "../Random32.h"
 #include "../Utils.h"
+#include "../WorkerPool.h"
 #include <chrono>
 #include <iostream>
 #include <vector>
@@ -105,6 +108,14 @@ int main() {
         bench.printResults();
     }
     
+    {
+        PerformanceBenchmark bench("Single Sector Buffer Creation (compact layout)");
+        bench.run([&]() {
+            ufs::CompactBuffer buffer(1);
+        }, ITERATIONS);
+        bench.printResults();
+    }
+
     {
         PerformanceBenchmark bench("Medium Buffer Creation (1000 sectors)");
         bench.run([&]() {
@@ -121,6 +132,27 @@ int main() {
         bench.printResults();
     }
     
+    {
+        PerformanceBenchmark bench("Medium Buffer Create+Fill (unpooled)");
+        bench.run([&]() {
+            ufs::Buffer buffer(MEDIUM_SECTORS);
+            buffer.Fill(0xA5);
+        }, ITERATIONS);
+        bench.printResults();
+    }
+
+    {
+        ufs::BufferPool::GetInstance().SetEnabled(true);
+        PerformanceBenchmark bench("Medium Buffer Create+Fill (pooled)");
+        bench.run([&]() {
+            ufs::Buffer buffer(MEDIUM_SECTORS);
+            buffer.Fill(0xA5);
+        }, ITERATIONS);
+        bench.printResults();
+        ufs::BufferPool::GetInstance().SetEnabled(false);
+        ufs::BufferPool::GetInstance().Trim();
+    }
+    
     // === Fill Operation Performance ===
     std::cout << std::endl << "Fill Operation Performance:" << std::endl;
     std::cout << "---------------------------" << std::endl;
@@ -178,6 +210,34 @@ int main() {
         bench.printResults();
     }
     
+    {
+        PerformanceBenchmark bench("Fill Random Data (fast engine)");
+        bench.run([&]() {
+            testBuffer.FillRandom(0, 0, ufs::RandomFast);
+        }, ITERATIONS);
+        bench.printResults();
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        testBuffer.FillRandom(0, 0, ufs::RandomFast);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        printThroughput("Fill Random Throughput (fast engine)", dataSize, duration.count());
+    }
+    
+    {
+        PerformanceBenchmark bench("Fill Counter Random Data");
+        bench.run([&]() {
+            testBuffer.FillRandomCounter(12345);
+        }, ITERATIONS);
+        bench.printResults();
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        testBuffer.FillRandomCounter(12345);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        printThroughput("Fill Counter Random Throughput", dataSize, duration.count());
+    }
+    
     // === Data Access Performance ===
     std::cout << std::endl << "Data Access Performance:" << std::endl;
     std::cout << "------------------------" << std::endl;
@@ -320,6 +380,17 @@ int main() {
         bench.printResults();
     }
     
+    {
+        ufs::Buffer buffer(LARGE_SECTORS);
+        buffer.FillIncrementing();
+        PerformanceBenchmark bench("Large Resize (10000<->20000 sectors)");
+        bench.run([&]() {
+            buffer.Resize(LARGE_SECTORS * 2);
+            buffer.Resize(LARGE_SECTORS);
+        }, ITERATIONS);
+        bench.printResults();
+    }
+    
     {
         PerformanceBenchmark bench("Buffer Copy Constructor");
         bench.run([&]() {
@@ -330,6 +401,468 @@ int main() {
         bench.printResults();
     }
     
+    {
+        ufs::Buffer original(1000);
+        original.FillIncrementing();
+        PerformanceBenchmark bench("Buffer Move Constructor");
+        bench.run([&]() {
+            ufs::Buffer moved(std::move(original));
+            original = std::move(moved);
+        }, ITERATIONS);
+        bench.printResults();
+    }
+
+    {
+        ufs::Buffer golden(LARGE_SECTORS);
+        golden.FillIncrementing();
+        PerformanceBenchmark copyBench("Large Buffer Deep Copy + 1 Sector Write");
+        copyBench.run([&]() {
+            ufs::Buffer copy(golden);
+            copy.Fill(0xA5, 0, 1);
+        }, ITERATIONS);
+        copyBench.printResults();
+
+        PerformanceBenchmark cloneBench("Large Buffer COW Clone + 1 Sector Write");
+        cloneBench.run([&]() {
+            ufs::Buffer clone = golden.CloneCopyOnWrite();
+            clone.Fill(0xA5, 0, 1);
+        }, ITERATIONS);
+        cloneBench.printResults();
+    }
+    
+    // === Vector Fill Kernels ===
+    std::cout << std::endl << "=== Vector Fill Kernels ===" << std::endl;
+    {
+        ufs::Buffer buffer(LARGE_SECTORS);
+        size_t dataSize = buffer.GetTotalBytes();
+        ufs::kernels::SimdLevel supported = ufs::kernels::GetSupportedSimdLevel();
+        const char* names[] = { "scalar", "SSE2", "AVX2", "AVX-512" };
+        for (int level = ufs::kernels::SimdScalar; level <= supported; level++) {
+            ufs::kernels::SetSimdLevel(static_cast<ufs::kernels::SimdLevel>(level));
+            PerformanceBenchmark bench(std::string("Large Fill Incrementing (") + names[level] + ")");
+            bench.run([&]() {
+                buffer.FillIncrementing();
+            }, ITERATIONS);
+            bench.printResults();
+
+            auto start = std::chrono::high_resolution_clock::now();
+            buffer.FillIncrementing();
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+            printThroughput(std::string("Fill Incrementing Throughput (") + names[level] + ")", dataSize, duration.count());
+        }
+        ufs::kernels::SetSimdLevel(supported);
+    }
+    
+    // === Worker Pool ===
+    std::cout << std::endl << "=== Worker Pool ===" << std::endl;
+    {
+        ufs::WorkerPool& pool = ufs::WorkerPool::GetInstance();
+        size_t threads = pool.GetThreadCount();
+        ufs::Buffer buffer(LARGE_SECTORS);
+        for (size_t count : { static_cast<size_t>(1), threads }) {
+            pool.SetThreadCount(count);
+            PerformanceBenchmark bench("Large Fill (" + std::to_string(count) + " threads)");
+            bench.run([&]() {
+                buffer.Fill(0x5A);
+            }, ITERATIONS);
+            bench.printResults();
+        }
+        pool.SetThreadCount(threads);
+    }
+    
+    // === Streaming Stores ===
+    std::cout << std::endl << "=== Streaming Stores ===" << std::endl;
+    {
+        size_t savedThreshold = ufs::kernels::GetStreamingThreshold();
+        ufs::Buffer source(LARGE_SECTORS);
+        ufs::Buffer destination(LARGE_SECTORS);
+        source.FillRandomSeeded(42);
+        size_t dataSize = LARGE_SECTORS * BYTES_PER_SECTOR;
+        for (bool streaming : { false, true }) {
+            ufs::kernels::SetStreamingThreshold(streaming ? 0 : SIZE_MAX);
+            std::string mode = streaming ? " (non-temporal)" : " (temporal)";
+
+            {
+                PerformanceBenchmark bench("Large Fill" + mode);
+                bench.run([&]() {
+                    destination.Fill(0x5A);
+                }, ITERATIONS);
+                bench.printResults();
+
+                auto start = std::chrono::high_resolution_clock::now();
+                destination.Fill(0x5A);
+                auto end = std::chrono::high_resolution_clock::now();
+                auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+                printThroughput("Large Fill Throughput" + mode, dataSize, duration.count());
+            }
+
+            {
+                PerformanceBenchmark bench("Large CopyFrom" + mode);
+                bench.run([&]() {
+                    destination.CopyFrom(source);
+                }, ITERATIONS);
+                bench.printResults();
+
+                auto start = std::chrono::high_resolution_clock::now();
+                destination.CopyFrom(source);
+                auto end = std::chrono::high_resolution_clock::now();
+                auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+                printThroughput("Large CopyFrom Throughput" + mode, dataSize, duration.count());
+            }
+        }
+        ufs::kernels::SetStreamingThreshold(savedThreshold);
+    }
+    
+    // === Sector Overlay ===
+    std::cout << std::endl << "=== Sector Overlay ===" << std::endl;
+    {
+        ufs::SectorOverlay overlay;
+        overlay.AddField(ufs::OverlayLba, 0, 8).AddField(ufs::OverlayPass, 8, 4).AddField(ufs::OverlayCrc32c, -4, 4);
+        ufs::Buffer buffer(LARGE_SECTORS);
+
+        PerformanceBenchmark twoPass("Large Fill Incrementing + ApplySectorOverlay");
+        twoPass.run([&]() {
+            buffer.ClearSectorOverlay().FillIncrementing();
+            buffer.SetSectorOverlay(overlay).ApplySectorOverlay();
+        }, ITERATIONS);
+        twoPass.printResults();
+
+        buffer.SetSectorOverlay(overlay);
+        PerformanceBenchmark fused("Large Fill Incrementing (fused overlay)");
+        fused.run([&]() {
+            buffer.FillIncrementing();
+        }, ITERATIONS);
+        fused.printResults();
+    }
+    
+    // === Storage Test Patterns ===
+    std::cout << std::endl << "=== Storage Test Patterns ===" << std::endl;
+    {
+        const char* names[] = { "Walking Ones", "Walking Zeros", "Checkerboard", "Inverse Checkerboard", "Butterfly",
+            "Galloping Ones", "Galloping Zeros", "Marching Ones", "Marching Zeros" };
+        ufs::Buffer buffer(LARGE_SECTORS);
+        size_t dataSize = LARGE_SECTORS * BYTES_PER_SECTOR;
+        for (int pattern = ufs::PatternWalkingOnes; pattern <= ufs::PatternMarchingZeros; pattern++) {
+            // 32 bit words, one word further on in each sector.
+            ufs::TestPatternOptions options(32, 0, 1);
+            std::string name = std::string("Large Fill ") + names[pattern];
+            PerformanceBenchmark bench(name);
+            bench.run([&]() {
+                buffer.FillTestPattern(static_cast<ufs::TestPattern>(pattern), 0, 0, options);
+            }, ITERATIONS);
+            bench.printResults();
+
+            auto start = std::chrono::high_resolution_clock::now();
+            buffer.FillTestPattern(static_cast<ufs::TestPattern>(pattern), 0, 0, options);
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+            printThroughput(name + " Throughput", dataSize, duration.count());
+        }
+    }
+    
+    // === PRBS ===
+    std::cout << std::endl << "=== PRBS ===" << std::endl;
+    {
+        ufs::Buffer buffer(LARGE_SECTORS);
+        size_t dataSize = LARGE_SECTORS * BYTES_PER_SECTOR;
+        PerformanceBenchmark fillBench("Large Fill PRBS31");
+        fillBench.run([&]() {
+            buffer.FillPrbs(ufs::Prbs31, 1);
+        }, ITERATIONS);
+        fillBench.printResults();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        buffer.FillPrbs(ufs::Prbs31, 1);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        printThroughput("Large Fill PRBS31 Throughput", dataSize, duration.count());
+
+        PerformanceBenchmark verifyBench("Large Verify PRBS31");
+        verifyBench.run([&]() {
+            buffer.VerifyPrbs(ufs::Prbs31);
+        }, ITERATIONS);
+        verifyBench.printResults();
+
+        start = std::chrono::high_resolution_clock::now();
+        ufs::PrbsChecker checker = buffer.VerifyPrbs(ufs::Prbs31);
+        end = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        printThroughput("Large Verify PRBS31 Throughput", dataSize, duration.count());
+        std::cout << "Bit errors: " << checker.GetBitErrors() << std::endl;
+    }
+    
+    // === Pattern Buffer ===
+    std::cout << std::endl << "=== Pattern Buffer ===" << std::endl;
+    {
+        ufs::Buffer actual(LARGE_SECTORS);
+        ufs::Buffer expectedBuffer(LARGE_SECTORS);
+        ufs::PatternBuffer expected(LARGE_SECTORS);
+        size_t dataSize = LARGE_SECTORS * BYTES_PER_SECTOR;
+        actual.FillRandomCounter(1).FillAddressOverlay(0);
+        expected.FillRandomCounter(1).FillAddressOverlay(0);
+
+        // The expected data filled into a second buffer, then compared.
+        PerformanceBenchmark bufferBench("Large Fill And Compare Buffer");
+        bufferBench.run([&]() {
+            expectedBuffer.FillRandomCounter(1).FillAddressOverlay(0);
+            actual.CompareTo(expectedBuffer);
+        }, ITERATIONS);
+        bufferBench.printResults();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        expectedBuffer.FillRandomCounter(1).FillAddressOverlay(0);
+        actual.CompareTo(expectedBuffer);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        printThroughput("Large Fill And Compare Buffer Throughput", dataSize, duration.count());
+
+        // The expected data generated a block at a time.
+        PerformanceBenchmark patternBench("Large Compare Pattern Buffer");
+        patternBench.run([&]() {
+            actual.CompareTo(expected);
+        }, ITERATIONS);
+        patternBench.printResults();
+
+        start = std::chrono::high_resolution_clock::now();
+        actual.CompareTo(expected);
+        end = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        printThroughput("Large Compare Pattern Buffer Throughput", dataSize, duration.count());
+    }
+    
+    // === Verify Pattern ===
+    std::cout << std::endl << "=== Verify Pattern ===" << std::endl;
+    {
+        // A sequential random stream with the address stamped, refilled into
+        // a second buffer or regenerated a block at a time.
+        ufs::Buffer actual(LARGE_SECTORS);
+        ufs::Buffer expectedBuffer(LARGE_SECTORS);
+        ufs::PatternBuffer expected(LARGE_SECTORS);
+        size_t dataSize = LARGE_SECTORS * BYTES_PER_SECTOR;
+        actual.FillRandomSeeded(7).FillAddressOverlay(0);
+        expected.FillRandomSeeded(7).FillAddressOverlay(0);
+
+        PerformanceBenchmark bufferBench("Large Refill And Compare All");
+        bufferBench.run([&]() {
+            expectedBuffer.FillRandomSeeded(7).FillAddressOverlay(0);
+            actual.CompareTo(expectedBuffer, ufs::CompareOptions(ufs::CompareAllDifferences));
+        }, ITERATIONS);
+        bufferBench.printResults();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        expectedBuffer.FillRandomSeeded(7).FillAddressOverlay(0);
+        actual.CompareTo(expectedBuffer, ufs::CompareOptions(ufs::CompareAllDifferences));
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        printThroughput("Large Refill And Compare All Throughput", dataSize, duration.count());
+
+        PerformanceBenchmark verifyBench("Large Verify Pattern");
+        verifyBench.run([&]() {
+            actual.VerifyPattern(expected);
+        }, ITERATIONS);
+        verifyBench.printResults();
+
+        start = std::chrono::high_resolution_clock::now();
+        actual.VerifyPattern(expected);
+        end = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        printThroughput("Large Verify Pattern Throughput", dataSize, duration.count());
+    }
+    
+    // === Tiled FillBytes ===
+    std::cout << std::endl << "=== Tiled FillBytes ===" << std::endl;
+    {
+        // Scalar repeats the list with doubling copies; the vector levels
+        // store a tile of whole lists and whole cache lines.
+        ufs::Buffer buffer(LARGE_SECTORS);
+        size_t dataSize = buffer.GetTotalBytes();
+        ufs::kernels::SimdLevel supported = ufs::kernels::GetSupportedSimdLevel();
+        const char* names[] = { "scalar", "SSE2", "AVX2", "AVX-512" };
+        const size_t lengths[] = { 3, 7, 13 };
+        for (size_t length : lengths) {
+            std::vector<UInt8> list(length, 0x5A);
+            for (int level = ufs::kernels::SimdScalar; level <= supported; level = level == ufs::kernels::SimdScalar ? supported : level + 1) {
+                ufs::kernels::SetSimdLevel(static_cast<ufs::kernels::SimdLevel>(level));
+                std::string name = "Large FillBytes " + std::to_string(length) + " bytes (" + names[level] + ")";
+                PerformanceBenchmark bench(name);
+                bench.run([&]() {
+                    buffer.FillBytes(list);
+                }, ITERATIONS);
+                bench.printResults();
+
+                auto start = std::chrono::high_resolution_clock::now();
+                buffer.FillBytes(list);
+                auto end = std::chrono::high_resolution_clock::now();
+                auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+                printThroughput(name + " Throughput", dataSize, duration.count());
+            }
+        }
+        ufs::kernels::SetSimdLevel(supported);
+    }
+    
+    // === First Mismatch ===
+    std::cout << std::endl << "=== First Mismatch ===" << std::endl;
+    {
+        // A mismatch in the last sector: scalar compares with memcmp and
+        // then rescans for the byte, the vector levels find it in one pass.
+        ufs::Buffer left(LARGE_SECTORS);
+        ufs::Buffer right(LARGE_SECTORS);
+        size_t dataSize = left.GetTotalBytes();
+        left.FillRandomCounter(1);
+        right.FillRandomCounter(1);
+        right.SetByte(dataSize - 100, left.GetByte(dataSize - 100) ^ 0xFF);
+        ufs::kernels::SimdLevel supported = ufs::kernels::GetSupportedSimdLevel();
+        const char* names[] = { "scalar", "SSE2", "AVX2", "AVX-512" };
+        for (int level = ufs::kernels::SimdScalar; level <= supported; level++) {
+            ufs::kernels::SetSimdLevel(static_cast<ufs::kernels::SimdLevel>(level));
+            std::string name = std::string("Large Compare Late Mismatch (") + names[level] + ")";
+            PerformanceBenchmark bench(name);
+            bench.run([&]() {
+                left.CompareTo(right);
+            }, ITERATIONS);
+            bench.printResults();
+
+            auto start = std::chrono::high_resolution_clock::now();
+            left.CompareTo(right);
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+            printThroughput(name + " Throughput", dataSize, duration.count());
+        }
+        ufs::kernels::SetSimdLevel(supported);
+    }
+    
+    // === All Differences ===
+    std::cout << std::endl << "=== All Differences ===" << std::endl;
+    {
+        ufs::Buffer left(LARGE_SECTORS);
+        ufs::Buffer right(LARGE_SECTORS);
+        size_t dataSize = left.GetTotalBytes();
+        left.FillRandomCounter(1);
+        right.FillRandomCounter(1);
+        // One flipped byte every 64KB, then every byte flipped.
+        for (size_t i = 0; i < dataSize; i += 64 * 1024) {
+            right.SetByte(i, left.GetByte(i) ^ 0x01);
+        }
+        ufs::CompareOptions options(ufs::CompareAllDifferences);
+
+        PerformanceBenchmark sparse("Large Compare All (sparse)");
+        sparse.run([&]() {
+            left.CompareTo(right, options);
+        }, ITERATIONS);
+        sparse.printResults();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        ufs::CompareResult result = left.CompareTo(right, options);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        printThroughput("Large Compare All (sparse) Throughput", dataSize, duration.count());
+        std::cout << "  " << result.ToString() << std::endl;
+
+        right.Fill(0);
+        left.Fill(0xFF);
+        PerformanceBenchmark dense("Large Compare All (every byte)");
+        dense.run([&]() {
+            left.CompareTo(right, options);
+        }, ITERATIONS);
+        dense.printResults();
+
+        start = std::chrono::high_resolution_clock::now();
+        result = left.CompareTo(right, options);
+        end = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        printThroughput("Large Compare All (every byte) Throughput", dataSize, duration.count());
+    }
+    
+    // === Parallel Compare ===
+    std::cout << std::endl << "=== Parallel Compare ===" << std::endl;
+    {
+        // Equal data is read by every thread to the end; a mismatch near the
+        // start stops the chunks after it.
+        ufs::WorkerPool& pool = ufs::WorkerPool::GetInstance();
+        size_t threads = pool.GetThreadCount();
+        ufs::Buffer left(LARGE_SECTORS);
+        ufs::Buffer right(LARGE_SECTORS);
+        size_t dataSize = left.GetTotalBytes();
+        left.FillRandomCounter(3);
+        right.FillRandomCounter(3);
+        for (size_t count : { static_cast<size_t>(1), threads }) {
+            pool.SetThreadCount(count);
+            std::string suffix = " (" + std::to_string(count) + " threads)";
+            PerformanceBenchmark equal("Large Compare Equal" + suffix);
+            equal.run([&]() {
+                left.CompareTo(right);
+            }, ITERATIONS);
+            equal.printResults();
+
+            auto start = std::chrono::high_resolution_clock::now();
+            left.CompareTo(right);
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+            printThroughput("Large Compare Equal" + suffix + " Throughput", dataSize, duration.count());
+        }
+
+        right.SetByte(dataSize / 8, static_cast<UInt8>(left.GetByte(dataSize / 8) + 1));
+        for (size_t count : { static_cast<size_t>(1), threads }) {
+            pool.SetThreadCount(count);
+            PerformanceBenchmark early("Large Compare Early Mismatch (" + std::to_string(count) + " threads)");
+            early.run([&]() {
+                left.CompareTo(right);
+            }, ITERATIONS);
+            early.printResults();
+        }
+        pool.SetThreadCount(threads);
+    }
+    
+    // === Bit Error Rate ===
+    std::cout << std::endl << "=== Bit Error Rate ===" << std::endl;
+    {
+        // A read-back with a raw bit error rate of about 1e-4, counted on
+        // every read of an endurance loop, against a buffer or the pattern.
+        ufs::Buffer written(LARGE_SECTORS);
+        ufs::Buffer readBack(LARGE_SECTORS);
+        ufs::PatternBuffer pattern(LARGE_SECTORS);
+        size_t dataSize = written.GetTotalBytes();
+        written.FillRandomCounter(9);
+        readBack.FillRandomCounter(9);
+        pattern.FillRandomCounter(9);
+        for (size_t offset = 0; offset < dataSize; offset += 1237) {
+            readBack.SetByte(offset, readBack.GetByte(offset) ^ static_cast<UInt8>(1 << (offset % 8)));
+        }
+
+        ufs::kernels::SimdLevel saved = ufs::kernels::GetSimdLevel();
+        ufs::kernels::SimdLevel supported = ufs::kernels::GetSupportedSimdLevel();
+        const char* names[] = { "scalar", "SSE2", "AVX2", "AVX-512" };
+        for (int level = ufs::kernels::SimdScalar; level <= supported; level = level == ufs::kernels::SimdScalar ? supported : level + 1) {
+            ufs::kernels::SetSimdLevel(static_cast<ufs::kernels::SimdLevel>(level));
+            std::string name = std::string("Large Compare Bits (") + names[level] + ")";
+            PerformanceBenchmark bench(name);
+            bench.run([&]() {
+                written.CompareBits(readBack);
+            }, ITERATIONS);
+            bench.printResults();
+
+            auto start = std::chrono::high_resolution_clock::now();
+            written.CompareBits(readBack);
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+            printThroughput(name + " Throughput", dataSize, duration.count());
+        }
+        ufs::kernels::SetSimdLevel(saved);
+
+        PerformanceBenchmark patternBench("Large Compare Bits Pattern");
+        patternBench.run([&]() {
+            readBack.CompareBits(pattern);
+        }, ITERATIONS);
+        patternBench.printResults();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        readBack.CompareBits(pattern);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        printThroughput("Large Compare Bits Pattern Throughput", dataSize, duration.count());
+    }
+    
     // === Summary ===
     std::cout << std::endl << "Performance Benchmarks Complete!" << std::endl;
     std::cout << "=================================" << std::endl;
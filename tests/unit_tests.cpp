@@ -1,7 +1,19 @@
 #include <iostream>
+#include <atomic>
 #include <cassert>
 #include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <sys/stat.h>
+#include <thread>
 #include "../Buffer.h"
+#include "../CounterRandom.h"
+#include "../DataKernels.h"
+#include "../PatternBuffer.h"
+#include "../WorkerPool.h"
 
 // Simple test framework macros
 #define TEST_ASSERT(condition, message) \
@@ -19,6 +31,27 @@
         return 1; \
     }
 
+// Sets the worker pool up for a test and puts the old settings back when
+// the test returns, also when an assertion fails.
+struct ScopedPoolSettings {
+    ScopedPoolSettings(size_t threadCount, size_t parallelThreshold)
+        : pool(ufs::WorkerPool::GetInstance()),
+          savedThreads(pool.GetThreadCount()),
+          savedThreshold(pool.GetParallelThreshold()) {
+        pool.SetThreadCount(threadCount);
+        pool.SetParallelThreshold(parallelThreshold);
+    }
+
+    ~ScopedPoolSettings() {
+        pool.SetThreadCount(savedThreads);
+        pool.SetParallelThreshold(savedThreshold);
+    }
+
+    ufs::WorkerPool& pool;
+    size_t savedThreads;
+    size_t savedThreshold;
+};
+
 bool test_buffer_construction() {
     // Test default constructor
     ufs::Buffer buffer1;
@@ -246,6 +279,1544 @@ bool test_utility_functions() {
     return true;
 }
 
+bool test_huge_page_allocation() {
+    ufs::Buffer buffer(4096, 512, ufs::HugePages);
+    TEST_ASSERT(buffer.GetAllocationMode() == ufs::HugePages, "Requested allocation mode");
+    TEST_ASSERT(buffer.IsAllZeros(), "Huge page buffer starts zeroed");
+
+    // Whatever backing was obtained, the 4K alignment and 4K prefix must hold.
+    UInt64 dataStart = reinterpret_cast<UInt64>(buffer.GetDataStart());
+    UInt64 allocationStart = reinterpret_cast<UInt64>(buffer.GetAllocationStart());
+    TEST_ASSERT((dataStart & 0xFFF) == 0, "Huge page data start is 4K aligned");
+    TEST_ASSERT(dataStart - allocationStart >= 0x1000, "Huge page data start keeps 4K prefix");
+
+    buffer.FillIncrementing();
+    ufs::Buffer copy(buffer);
+    TEST_ASSERT(copy.GetAllocationMode() == ufs::HugePages, "Copy keeps allocation mode");
+    TEST_ASSERT(copy.CompareTo(buffer).AreEqual(), "Huge page copy data integrity");
+
+    buffer.Resize(8192);
+    TEST_ASSERT(buffer.GetByte(511) == 0xFF, "Data preserved after huge page resize");
+
+    ufs::Buffer gigantic(16, 512, ufs::GiganticPages);
+    gigantic.FillOnes();
+    TEST_ASSERT(gigantic.GetBitCount() == gigantic.GetTotalBytes() * 8, "Gigantic page request falls back cleanly");
+
+    return true;
+}
+
+bool test_lazy_zero_construction() {
+    // Large buffers get untouched zero pages from the OS.
+    ufs::Buffer buffer;
+    TEST_ASSERT(buffer.GetPageBacking() == ufs::MappedBacking, "Default buffer is mapped");
+    TEST_ASSERT(buffer.IsAllZeros(), "Fresh buffer is known zero");
+    TEST_ASSERT(buffer.GetByte(buffer.GetTotalBytes() - 1) == 0, "Last byte reads zero");
+
+    buffer.FillZeros();
+    TEST_ASSERT(buffer.IsAllZeros(), "Zero fill keeps buffer zero");
+
+    buffer.SetByte(0x123456, 0x01);
+    TEST_ASSERT(!buffer.IsAllZeros(), "Write clears known zero state");
+    buffer.SetByte(0x123456, 0x00);
+    TEST_ASSERT(buffer.IsAllZeros(), "Scan still finds all zeros");
+
+    // Copies and resizes of zero buffers stay zero.
+    ufs::Buffer small(3, 512);
+    ufs::Buffer copy(small);
+    TEST_ASSERT(copy.IsAllZeros(), "Copy of zero buffer is zero");
+    copy.Resize(300);
+    TEST_ASSERT(copy.IsAllZeros(), "Resized zero buffer is zero");
+
+    // Writes through the raw pointer must not be hidden by the known zero state.
+    ufs::Buffer raw(3, 512);
+    raw.GetDataStart()[10] = 0x5A;
+    TEST_ASSERT(!raw.IsAllZeros(), "Raw pointer write is seen");
+
+    ufs::Buffer source(3, 512);
+    ufs::Buffer dest(3, 512);
+    source.Fill(0x11, 1, 1);
+    source.CopyTo(dest);
+    TEST_ASSERT(!dest.IsAllZeros(), "Copy destination is not zero");
+    TEST_ASSERT(dest.GetByte(512) == 0x11, "Copy destination data");
+
+    return true;
+}
+
+bool test_buffer_pool() {
+    ufs::BufferPool& pool = ufs::BufferPool::GetInstance();
+    pool.SetEnabled(true);
+    pool.Trim();
+    pool.ResetCounters();
+
+    {
+        ufs::Buffer buffer(1000, 512);
+        TEST_ASSERT(buffer.GetIsPooled(), "Buffer draws from enabled pool");
+        buffer.FillOnes();
+    }
+    TEST_ASSERT(pool.GetMissCount() == 1, "First allocation misses");
+    TEST_ASSERT(pool.GetCachedBytes() > 0, "Destructor returns block to pool");
+
+    {
+        ufs::Buffer buffer(1000, 512);
+        TEST_ASSERT(pool.GetHitCount() == 1, "Same size allocation hits");
+        TEST_ASSERT(buffer.IsAllZeros(), "Recycled dirty block is zeroed");
+        buffer.FillIncrementing();
+        buffer.Resize(1001);
+        TEST_ASSERT(buffer.GetByte(1000) == 1000 % 256, "Pooled resize preserves data");
+    }
+
+    TEST_ASSERT(ufs::BufferPool::GetSizeClass(5000) == 5120, "Size class rounding");
+    TEST_ASSERT(ufs::BufferPool::GetSizeClass(1 << 20) == (1 << 20), "Power of two size class");
+
+    size_t cap = pool.GetMemoryCap();
+    pool.SetMemoryCap(0);
+    TEST_ASSERT(pool.GetCachedBytes() == 0, "Lowering cap trims the pool");
+    {
+        ufs::Buffer buffer(1000, 512);
+    }
+    TEST_ASSERT(pool.GetCachedBytes() == 0, "Blocks over the cap are not cached");
+
+    pool.SetMemoryCap(cap);
+    pool.SetEnabled(false);
+    ufs::Buffer unpooled(10, 512);
+    TEST_ASSERT(!unpooled.GetIsPooled(), "Disabled pool is not used");
+    return true;
+}
+
+bool test_move_and_swap() {
+    ufs::Buffer source(100, 512);
+    source.FillIncrementing(0x20);
+    source.SetName("source");
+    UInt8* allocation = source.GetAllocationStart();
+
+    // Moving transfers the allocation without copying.
+    ufs::Buffer moved(std::move(source));
+    TEST_ASSERT(moved.GetAllocationStart() == allocation, "Move constructor keeps allocation");
+    TEST_ASSERT(moved.GetName() == "source", "Move constructor keeps name");
+    TEST_ASSERT(moved.GetByte(0) == 0x20, "Move constructor keeps data");
+    TEST_ASSERT(source.GetSectorCount() == 0, "Moved from buffer is empty");
+
+    ufs::Buffer target(10, 512);
+    target = std::move(moved);
+    TEST_ASSERT(target.GetAllocationStart() == allocation, "Move assignment keeps allocation");
+    TEST_ASSERT(target.GetSectorCount() == 100, "Move assignment sector count");
+
+    // Buffers can now live in standard containers.
+    std::vector<ufs::Buffer> buffers;
+    buffers.push_back(ufs::Buffer(8, 512));
+    buffers.emplace_back(16, 512);
+    buffers.push_back(std::move(target));
+    TEST_ASSERT(buffers[2].GetAllocationStart() == allocation, "Vector growth does not copy");
+
+    // Copy assignment reuses the allocation when the sizes match.
+    ufs::Buffer copy(100, 512);
+    UInt8* copyAllocation = copy.GetAllocationStart();
+    copy = buffers[2];
+    TEST_ASSERT(copy.GetAllocationStart() == copyAllocation, "Copy assignment reuses allocation");
+    TEST_ASSERT(copy.CompareTo(buffers[2]).AreEqual(), "Copy assignment data");
+
+    ufs::Buffer differentSize(3, 512);
+    differentSize = buffers[2];
+    TEST_ASSERT(differentSize.GetSectorCount() == 100, "Copy assignment resizes");
+    TEST_ASSERT(differentSize.CompareTo(buffers[2]).AreEqual(), "Copy assignment resized data");
+
+    ufs::Buffer left(2, 512);
+    ufs::Buffer right(4, 1024);
+    left.Fill(0x11);
+    right.Fill(0x22);
+    swap(left, right);
+    TEST_ASSERT(left.GetSectorCount() == 4 && left.GetByte(0) == 0x22, "Swap left");
+    TEST_ASSERT(right.GetSectorCount() == 2 && right.GetByte(0) == 0x11, "Swap right");
+
+    return true;
+}
+
+bool test_in_place_resize() {
+    // Shrinking and growing back within the allocation keeps it in place
+    // and exposes zeros, not the old data.
+    ufs::Buffer buffer(100, 512);
+    buffer.Fill(0x77);
+    UInt8* allocation = buffer.GetAllocationStart();
+    buffer.Resize(50);
+    buffer.Resize(100);
+    TEST_ASSERT(buffer.GetAllocationStart() == allocation, "Resize within allocation stays in place");
+    TEST_ASSERT(buffer.GetByte(50 * 512 - 1) == 0x77, "Kept data after regrow");
+    TEST_ASSERT(buffer.GetByte(50 * 512) == 0x00, "Regrown tail is zero");
+    TEST_ASSERT(buffer.GetBitCount(50 * 512) == 0, "Whole regrown tail is zero");
+
+    // Mapped buffers are remapped, keeping data and alignment.
+    ufs::Buffer mapped(4096, 512);
+    TEST_ASSERT(mapped.GetPageBacking() == ufs::MappedBacking, "Large buffer is mapped");
+    mapped.FillIncrementing();
+    mapped.Resize(64 * 1024);
+    TEST_ASSERT(mapped.GetSectorCount() == 64 * 1024, "Remapped sector count");
+    TEST_ASSERT((reinterpret_cast<UInt64>(mapped.GetDataStart()) & 0xFFF) == 0, "Remapped data start alignment");
+    TEST_ASSERT(mapped.GetByte(4096 * 512 - 1) == 0xFF, "Remapped data kept");
+    TEST_ASSERT(mapped.GetBitCount(4096 * 512) == 0, "Remapped tail is zero");
+    mapped.Resize(1);
+    TEST_ASSERT(mapped.GetByte(511) == 0xFF, "Shrunk mapping keeps data");
+
+    // Changing the sector size keeps the bytes.
+    ufs::Buffer sized(8, 512);
+    sized.FillIncrementing();
+    sized.Resize(4, 1024);
+    TEST_ASSERT(sized.GetBytesPerSector() == 1024, "Resize bytes per sector");
+    TEST_ASSERT(sized.GetByte(600) == 600 % 256, "Resize bytes per sector keeps bytes");
+
+    bool threw = false;
+    try {
+        sized.Resize(0);
+    } catch (const ufs::ArgumentError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw && sized.GetSectorCount() == 4, "Invalid resize leaves buffer unchanged");
+
+    // A grow that cannot be allocated leaves the old block in place.
+    UInt8* sizedStart = sized.GetDataStart();
+    size_t sizedBufferSize = sized.GetDataBufferSize();
+    threw = false;
+    try {
+        sized.Resize((1ULL << 48) / 1024, 1024);
+    } catch (const std::bad_alloc&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw && sized.GetSectorCount() == 4 && sized.GetDataStart() == sizedStart
+        && sized.GetDataBufferSize() == sizedBufferSize && sized.GetByte(600) == 600 % 256, "Failed grow leaves buffer unchanged");
+    sized.Resize(16);
+    TEST_ASSERT(sized.GetByte(600) == 600 % 256 && sized.GetByte(15 * 1024) == 0, "Resize after a failed grow");
+
+    // Transparent huge page blocks keep their huge page alignment.
+    size_t hugePageSize = ufs::PageAllocator::GetHugePageSize();
+    ufs::Buffer huge(hugePageSize / 512, 512, ufs::HugePages);
+    if (huge.GetPageBacking() == ufs::TransparentHugeBacking) {
+        huge.Fill(0x3C);
+        huge.Resize(3 * hugePageSize / 512);
+        TEST_ASSERT(huge.GetPageBacking() == ufs::TransparentHugeBacking
+            && reinterpret_cast<UInt64>(huge.GetAllocationStart()) % hugePageSize == 0, "Grown huge page block stays aligned");
+        TEST_ASSERT(huge.GetByte(hugePageSize - 1) == 0x3C && huge.GetBitCount(hugePageSize) == 0, "Grown huge page block keeps data");
+    }
+
+    return true;
+}
+
+bool test_numa_placement() {
+    int nodeCount = ufs::Numa::GetNodeCount();
+    TEST_ASSERT(nodeCount >= 1, "At least one NUMA node");
+
+    // Bound buffers are mapped even when small, and are faulted in up front.
+    size_t pageCount = 64 * 512 / ufs::PageAllocator::GetPageSize();
+    ufs::Buffer bound(64, 512, ufs::NumaPlacement::OnNode(nodeCount - 1));
+    TEST_ASSERT(bound.GetPageBacking() == ufs::MappedBacking, "NUMA placed buffer is mapped");
+    TEST_ASSERT(bound.GetNumaPlacement().policy == ufs::NumaBind, "NUMA placement kept");
+    TEST_ASSERT(bound.IsAllZeros(), "NUMA placed buffer is zero");
+    std::vector<size_t> counts = bound.GetNumaNodePageCounts();
+    TEST_ASSERT(counts.size() == static_cast<size_t>(nodeCount), "One count per node");
+    size_t resident = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        resident += counts[i];
+    }
+    TEST_ASSERT(resident == 0 || counts[nodeCount - 1] == resident, "Bound pages are on the bound node");
+    TEST_ASSERT(resident == 0 || resident >= pageCount, "Bound pages were first touched");
+
+    // Interleaved buffers keep their placement through copies and resizes.
+    ufs::Buffer interleaved(4096, 512, ufs::NumaPlacement::Interleaved());
+    interleaved.FillIncrementing();
+    ufs::Buffer copy(interleaved);
+    TEST_ASSERT(copy.GetNumaPlacement().policy == ufs::NumaInterleave, "Copy keeps NUMA placement");
+    TEST_ASSERT(copy.CompareTo(interleaved).AreEqual(), "Copy of NUMA placed buffer");
+    interleaved.Resize(8192);
+    TEST_ASSERT(interleaved.GetByte(4096 * 512 - 1) == 0xFF, "Resize keeps NUMA placed data");
+
+    bool threw = false;
+    try {
+        ufs::Buffer invalid(1, 512, ufs::NumaPlacement::OnNode(nodeCount));
+    } catch (const ufs::ArgumentError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Binding to a missing node throws");
+
+    return true;
+}
+
+bool test_buffer_layout() {
+    // The default layout keeps 4K alignment and the 4K UFS header slot.
+    ufs::Buffer standard(1, 512);
+    TEST_ASSERT((reinterpret_cast<UInt64>(standard.GetDataStart()) & 0xFFF) == 0, "Default data start alignment");
+    TEST_ASSERT(standard.GetDataStart() - standard.GetAllocationStart() >= 4096, "Default header reserve");
+    TEST_ASSERT(standard.GetDataBufferSize() == 4096, "Default data buffer size");
+
+    // Compact buffers drop the header slot and round to a cache line.
+    ufs::CompactBuffer compact(1);
+    TEST_ASSERT(compact.GetDataStart() == compact.GetAllocationStart(), "Compact buffer has no header reserve");
+    TEST_ASSERT(compact.GetDataBufferSize() == 512, "Compact data buffer size");
+    compact.FillIncrementing();
+    compact.Resize(3);
+    TEST_ASSERT(compact.GetByte(511) == 0xFF && compact.GetByte(512) == 0, "Compact buffer resize");
+    TEST_ASSERT(compact.GetLayout() == ufs::BufferLayout::FromPolicy<ufs::CompactLayout>(), "Resize keeps layout");
+
+    // Run time layouts with larger alignment and an odd header reserve.
+    ufs::Buffer aligned(8, 512, ufs::BufferLayout::Create(64 * 1024, 100));
+    UInt64 dataStart = reinterpret_cast<UInt64>(aligned.GetDataStart());
+    TEST_ASSERT((dataStart & 0xFFFF) == 0, "64K data start alignment");
+    TEST_ASSERT(aligned.GetDataStart() - aligned.GetAllocationStart() >= 100, "Odd header reserve");
+    aligned.FillOnes();
+    aligned.Resize(1024);
+    TEST_ASSERT((reinterpret_cast<UInt64>(aligned.GetDataStart()) & 0xFFFF) == 0, "Resize keeps 64K alignment");
+    TEST_ASSERT(aligned.GetByte(8 * 512 - 1) == 0xFF && aligned.GetBitCount(8 * 512) == 0, "Aligned resize data");
+
+    ufs::Buffer copy(aligned);
+    TEST_ASSERT(copy.GetLayout() == aligned.GetLayout(), "Copy keeps layout");
+    TEST_ASSERT((reinterpret_cast<UInt64>(copy.GetDataStart()) & 0xFFFF) == 0, "Copy keeps alignment");
+
+    bool threw = false;
+    try {
+        ufs::Buffer invalid(1, 512, ufs::BufferLayout::Create(3000, 0));
+    } catch (const ufs::ArgumentError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Alignment must be a power of two");
+
+    return true;
+}
+
+bool test_copy_on_write_clone() {
+    ufs::Buffer golden(2048, 512);
+    golden.FillIncrementing();
+    UInt8* goldenData = golden.GetDataStart();
+
+    ufs::Buffer clone = golden.CloneCopyOnWrite();
+    TEST_ASSERT(golden.GetDataStart() == goldenData, "Snapshot keeps the source address");
+    TEST_ASSERT(clone.GetSectorCount() == 2048 && clone.CompareTo(golden).AreEqual(), "Clone matches source");
+
+    // Writes stay private to the writer.
+    clone.SetByte(5 * 512, 0xEE);
+    clone.Fill(0x11, 100, 1);
+    TEST_ASSERT(golden.GetByte(5 * 512) == 0x00 && golden.GetByte(100 * 512) == 0x00, "Source unchanged by clone writes");
+    TEST_ASSERT(clone.GetByte(5 * 512) == 0xEE && clone.GetByte(100 * 512) == 0x11, "Clone sees its writes");
+
+    ufs::CompareResult result = clone.CompareTo(golden);
+    TEST_ASSERT(!result.AreEqual() && result.GetFirstDifferenceOffset() == 5 * 512, "Compare finds clone writes");
+    TEST_ASSERT(clone.CompareTo(golden, 6, 6, 90).AreEqual(), "Compare between writes is equal");
+
+    golden.SetByte(1024 * 512, 0x99);
+    result = clone.CompareTo(golden, 500);
+    TEST_ASSERT(!result.AreEqual() && result.GetFirstDifferenceOffset() == 1024 * 512, "Compare finds source writes");
+
+    // Only the written pages were privatized, where that can be observed.
+    size_t allocationPages = clone.GetSharedPageCount();
+    if (allocationPages > 0) {
+        ufs::Buffer second = golden.CloneCopyOnWrite();
+        size_t sharedBefore = second.GetSharedPageCount();
+        second.SetByte(0, 0x01);
+        TEST_ASSERT(second.GetSharedPageCount() == sharedBefore - 1, "One write privatizes one page");
+        TEST_ASSERT(second.GetByte(1024 * 512) == 0x99, "New clone sees source writes");
+    }
+
+    // Resizing a clone gives it its own data.
+    clone.Resize(4096);
+    TEST_ASSERT(clone.GetByte(5 * 512) == 0xEE && clone.GetByte(2048 * 512 - 1) == 0xFF, "Resized clone keeps data");
+    TEST_ASSERT(clone.GetBitCount(2048 * 512) == 0, "Resized clone tail is zero");
+
+    // Views of a source stay valid across its snapshot, whatever backs it.
+    ufs::Buffer small(4, 512);
+    small.FillIncrementing();
+    ufs::BufferView smallView = small.GetView(1, 1);
+    ufs::Buffer smallClone = small.CloneCopyOnWrite();
+    TEST_ASSERT(small.GetPageBacking() == ufs::HeapBacking && smallView.GetData() == small.GetDataStart() + 512
+        && smallClone.GetSharedPageCount() == 0 && smallClone.CompareTo(small).AreEqual(), "Heap block clone is a copy in place");
+    ufs::Buffer mappedSource(1024, 512);
+    mappedSource.FillIncrementing();
+    ufs::BufferView mappedView = mappedSource.GetView(10, 1);
+    ufs::Buffer mappedClone = mappedSource.CloneCopyOnWrite();
+    mappedSource.SetByte(10 * 512, 0x42);
+    TEST_ASSERT(mappedView.GetByte(0) == 0x42 && mappedClone.GetByte(10 * 512) == 0x00, "View writes reach the snapshotted source");
+
+    // Bytes a resize exposes in place are zero in a later clone too.
+    ufs::Buffer shrunk(100, 512);
+    shrunk.Fill(0xAB);
+    ufs::Buffer beforeResize = shrunk.CloneCopyOnWrite();
+    shrunk.Resize(50);
+    shrunk.Resize(100);
+    ufs::Buffer afterResize = shrunk.CloneCopyOnWrite();
+    TEST_ASSERT(shrunk.GetBitCount(50 * 512) == 0 && afterResize.GetBitCount(50 * 512) == 0
+        && afterResize.CompareTo(shrunk).AreEqual() && beforeResize.GetByte(99 * 512) == 0xAB, "Clone after a resize sees the zeroed tail");
+
+    // Huge page blocks are copied rather than lose their huge pages, and NUMA
+    // placement is kept.
+    ufs::Buffer huge(ufs::PageAllocator::GetHugePageSize() / 512, 512, ufs::HugePages);
+    ufs::PageBacking hugeBacking = huge.GetPageBacking();
+    UInt8* hugeData = huge.GetDataStart();
+    ufs::Buffer hugeClone = huge.CloneCopyOnWrite();
+    TEST_ASSERT(huge.GetPageBacking() == hugeBacking && huge.GetDataStart() == hugeData, "Huge page source keeps its block");
+    TEST_ASSERT(hugeBacking == ufs::MappedBacking || hugeClone.GetSharedPageCount() == 0, "Huge page clone is a copy");
+    ufs::Buffer placed(1024, 512, ufs::NumaPlacement::OnNode(0));
+    ufs::Buffer placedClone = placed.CloneCopyOnWrite();
+    placedClone.Fill(0x5A);
+    TEST_ASSERT(placed.GetNumaPlacement().policy == ufs::NumaBind && placedClone.GetNumaPlacement().policy == ufs::NumaBind
+        && placed.IsAllZeros(), "Placed clone keeps the placement");
+
+    return true;
+}
+
+bool test_buffer_view() {
+    ufs::Buffer buffer(300, 512);
+    buffer.FillIncrementing();
+
+    // A sector range view, sliced further, without copying.
+    ufs::BufferView view = buffer.GetView(100, 101);
+    TEST_ASSERT(view.GetSectorCount() == 101 && view.GetOffset() == 100 * 512, "View range");
+    TEST_ASSERT(view.GetData() == buffer.GetDataStart() + 100 * 512, "View does not copy");
+    ufs::BufferView slice = view.Slice(1, 2);
+    TEST_ASSERT(slice.GetTotalBytes() == 1024 && slice.GetOffset() == 101 * 512, "Slice range");
+    TEST_ASSERT(slice.GetWord(0) == 0x0100 && slice.GetQWord(8) == 0x0F0E0D0C0B0A0908ULL, "Slice reads");
+
+    // Fills match the Buffer fills of the same range.
+    ufs::Buffer reference(300, 512);
+    reference.FillIncrementing();
+    slice.FillDecrementing(0x80);
+    reference.FillDecrementing(0x80, 101, 2);
+    TEST_ASSERT(buffer.CompareTo(reference).AreEqual(), "View decrementing fill matches Buffer fill");
+    view.SliceBytes(10, 20).FillBytes({ 0xDE, 0xAD });
+    reference.SetWord(100 * 512 + 10, 0xADDE);
+    TEST_ASSERT(buffer.GetWord(100 * 512 + 28) == 0xADDE && buffer.GetByte(100 * 512 + 30) == 30, "Byte view fill stays in range");
+    view.SetDWord(0, 0x11223344);
+    TEST_ASSERT(buffer.GetDWord(100 * 512) == 0x11223344, "View writes reach the buffer");
+
+    // Compare, checksum and bit counts are relative to the view.
+    ufs::BufferView left = buffer.GetView(200, 10);
+    ufs::BufferView right = reference.GetView(200, 10);
+    TEST_ASSERT(left.CompareTo(right).AreEqual(), "Equal views");
+    right.SetByte(700, 0x55);
+    ufs::CompareResult result = left.CompareTo(right);
+    TEST_ASSERT(!result.AreEqual() && result.GetFirstDifferenceOffset() == 700, "View compare offset");
+    TEST_ASSERT(left.CalculateChecksumByte() == buffer.CalculateChecksumByte(200 * 512, 10 * 512), "View checksum");
+    TEST_ASSERT(left.GetBitCount() == buffer.GetBitCount(200 * 512, 10 * 512), "View bit count");
+    right.CopyFrom(left);
+    TEST_ASSERT(left.CompareTo(right).AreEqual(), "View copy");
+
+    ufs::Buffer zeros(8, 512);
+    TEST_ASSERT(zeros.GetView(2, 2).IsAllZeros(), "Zero view");
+    zeros.GetView(4).FillOnes();
+    TEST_ASSERT(zeros.GetView(0, 4).IsAllZeros() && zeros.GetBitCount(0, 4 * 512) == 0, "Fill stays in view");
+    TEST_ASSERT(!zeros.IsAllZeros() && zeros.GetView(4).GetBitCount(0) == 0, "Fill through view");
+
+    // A byte view counts on from where it starts in its sector.
+    ufs::BufferView bytes = zeros.GetByteView(3 * 512 + 500, 20);
+    bytes.FillIncrementing(1);
+    TEST_ASSERT(zeros.GetByte(3 * 512 + 500) == 501 % 256 && zeros.GetByte(3 * 512 + 511) == 512 % 256
+        && zeros.GetByte(4 * 512) == 1 && zeros.GetByte(4 * 512 + 7) == 8, "Byte view incrementing keeps the sector phase");
+
+    // Whole sector views stamp the overlay and take the per-sector fills,
+    // as the Buffer fills of the same sectors do.
+    ufs::Buffer stamped(64, 512);
+    ufs::Buffer stampedReference(64, 512);
+    stamped.SetSectorOverlay(ufs::SectorOverlay::AddressOverlay(1000));
+    stampedReference.SetSectorOverlay(ufs::SectorOverlay::AddressOverlay(1000));
+    stamped.GetView(8, 8).Fill(0x5A);
+    stampedReference.Fill(0x5A, 8, 8);
+    stamped.GetView(16, 8).FillRandomCounter(77);
+    stampedReference.FillRandomCounter(77, 16, 8);
+    stamped.GetView(24, 8).FillRandomSeededBySector(78);
+    stampedReference.FillRandomSeededBySector(78, 24, 8);
+    stamped.GetView(32, 8).FillTestPattern(ufs::PatternCheckerboard);
+    stampedReference.FillTestPattern(ufs::PatternCheckerboard, 32, 8);
+    stamped.GetView(40, 8).FillPrbs(ufs::Prbs15, 3);
+    stampedReference.FillPrbs(ufs::Prbs15, 3, 40, 8);
+    stamped.GetView(48, 8).FillRandomSeeded(79);
+    stampedReference.FillRandomSeeded(79, 48, 8);
+    TEST_ASSERT(stamped.GetQWord(8 * 512) == 1008 && stamped.CompareTo(stampedReference).AreEqual(), "Sector view fills match Buffer fills");
+
+    bool threw = false;
+    try {
+        bytes.FillRandomCounter(1);
+    } catch (const ufs::ArgumentError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Per-sector fill of a byte view throws");
+
+    threw = false;
+    try {
+        left.CompareTo(right.Slice(0, 9));
+    } catch (const ufs::ArgumentError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Compare of views of different sizes throws");
+
+    threw = false;
+    try {
+        view.Slice(100, 2);
+    } catch (const ufs::OutOfRangeError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Slice past the end of the view throws");
+
+    threw = false;
+    try {
+        slice.GetDWord(1022);
+    } catch (const ufs::OutOfRangeError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Read past the end of the view throws");
+
+    return true;
+}
+
+bool test_adopt_external_memory() {
+    // Caller owned, 4K aligned memory is used in place and handed back.
+    const size_t length = 8 * 512;
+    UInt8* memory = static_cast<UInt8*>(::operator new(length, std::align_val_t(4096)));
+    ::memset(memory, 0x5A, length);
+    size_t deleted = 0;
+    size_t deletedLength = 0;
+    {
+        ufs::Buffer adopted(memory, length, 512, [&](UInt8* address, size_t bytes) {
+            deleted++;
+            deletedLength = bytes;
+            ::operator delete(address, std::align_val_t(4096));
+        });
+        TEST_ASSERT(adopted.GetSectorCount() == 8 && adopted.GetPageBacking() == ufs::ExternalBacking, "Adopted geometry");
+        TEST_ASSERT(adopted.GetDataStart() == memory && adopted.GetByte(length - 1) == 0x5A, "Adopted memory is not copied");
+        adopted.FillIncrementing(0, 2, 1);
+        TEST_ASSERT(memory[2 * 512 + 7] == 7, "Writes reach adopted memory");
+        adopted.Resize(4);
+        TEST_ASSERT(adopted.GetDataStart() == memory && deleted == 0, "Shrinking keeps adopted memory");
+        adopted.Resize(16);
+        TEST_ASSERT(deleted == 1 && adopted.GetByte(2 * 512 + 7) == 7 && adopted.GetByte(8 * 512) == 0, "Growing copies and releases");
+    }
+    TEST_ASSERT(deleted == 1 && deletedLength == length, "Deleter runs once with the adopted length");
+
+    // Adopted memory honours the simulator pattern mode like owned buffers.
+    ::setenv("DMX_SIMULATOR_ENABLED", "1", 1);
+    std::vector<UInt8> patternStorage(8 * 512 + 4096);
+    UInt8* patternMemory = reinterpret_cast<UInt8*>((reinterpret_cast<UInt64>(patternStorage.data()) + 4095) & ~4095ULL);
+    {
+        ufs::Buffer adopted(patternMemory, 8 * 512, 512, ufs::ExternalDeleter());
+        ufs::Buffer owned(8, 512);
+        adopted.Fill(0x5A);
+        owned.Fill(0x5A);
+        ::unsetenv("DMX_SIMULATOR_ENABLED");
+        ufs::Buffer plain(8, 512);
+        plain.Fill(0x5A);
+        TEST_ASSERT(adopted.CompareTo(owned).AreEqual() && !owned.CompareTo(plain).AreEqual(), "Adopted memory uses pattern mode");
+    }
+
+    // An empty deleter leaves ownership with the caller; misaligned memory is refused.
+    std::vector<UInt8> storage(3 * 4096);
+    UInt8* aligned = reinterpret_cast<UInt8*>((reinterpret_cast<UInt64>(storage.data()) + 4095) & ~0xFFFULL);
+    {
+        ufs::Buffer borrowed(aligned, 4096, 2, 512, ufs::ExternalDeleter(),
+                             ufs::BufferLayout::Create(512, 1024));
+        borrowed.Fill(0x33);
+        TEST_ASSERT(borrowed.GetDataStart() == aligned + 1024 && aligned[1024] == 0x33 && aligned[0] == 0, "Header reserve in adopted memory");
+    }
+    TEST_ASSERT(aligned[1024] == 0x33, "Borrowed memory kept by the caller");
+    bool threw = false;
+    try {
+        ufs::Buffer misaligned(aligned + 8, 4096, 512, ufs::ExternalDeleter());
+    } catch (const ufs::ArgumentError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Misaligned memory is refused");
+
+    // A file mapping reads and writes the file.
+    const std::string fileName = "adopt_external_memory_test.bin";
+    {
+        std::vector<char> contents(4 * 512);
+        for (size_t i = 0; i < contents.size(); i++) {
+            contents[i] = static_cast<char>(i % 512);
+        }
+        std::ofstream file(fileName.c_str(), std::ios::binary);
+        file.write(contents.data(), contents.size());
+    }
+    {
+        ufs::Buffer mapped = ufs::Buffer::MapFile(fileName, 512);
+        TEST_ASSERT(mapped.GetSectorCount() == 4 && mapped.GetPageBacking() == ufs::FileBacking, "Mapped file geometry");
+        TEST_ASSERT(mapped.GetByte(3 * 512 + 9) == 9, "Mapped file contents");
+        mapped.SetByte(0, 0xAB);
+    }
+    {
+        ufs::Buffer reopened = ufs::Buffer::MapFile(fileName, 512);
+        TEST_ASSERT(reopened.GetByte(0) == 0xAB, "Writes reach the mapped file");
+    }
+
+    // A read-only mapping needs no write permission and refuses writes.
+    ::chmod(fileName.c_str(), 0444);
+    {
+        ufs::Buffer readOnly = ufs::Buffer::MapFile(fileName, 512, ufs::MapReadOnly);
+        TEST_ASSERT(readOnly.IsReadOnly() && readOnly.GetPageBacking() == ufs::ReadOnlyFileBacking
+            && readOnly.GetByte(0) == 0xAB && readOnly.GetByte(3 * 512 + 9) == 9, "Read-only mapped file contents");
+        bool refused = false;
+        try {
+            readOnly.Fill(0x11);
+        } catch (const ufs::RuntimeError&) {
+            refused = true;
+        }
+        TEST_ASSERT(refused && readOnly.GetByte(1) == 1, "Read-only mapped file refuses writes");
+
+        ufs::Buffer copy = readOnly.CloneCopyOnWrite();
+        copy.SetByte(0, 0x12);
+        readOnly.Resize(8);
+        TEST_ASSERT(copy.GetByte(1) == 1 && !readOnly.IsReadOnly() && readOnly.GetByte(0) == 0xAB
+            && readOnly.GetBitCount(4 * 512) == 0, "Copies and resizes of a read-only mapping are writable");
+        readOnly.SetByte(0, 0x13);
+    }
+    {
+        ufs::Buffer reopened = ufs::Buffer::MapFile(fileName, 512, ufs::MapReadOnly);
+        TEST_ASSERT(reopened.GetByte(0) == 0xAB, "Detached buffer leaves the file alone");
+    }
+    ::chmod(fileName.c_str(), 0644);
+    std::remove(fileName.c_str());
+
+    return true;
+}
+
+bool test_simd_counting_fills() {
+    // Every instruction set must produce exactly the scalar bytes, including
+    // partial vectors at the end of each period and of the range.
+    const size_t periods[] = { 1, 7, 64, 100, 512, 520, 4096 };
+    const UInt8 starts[] = { 0, 1, 0x7F, 0xFF };
+    const size_t length = 3 * 4096 + 37;
+    ufs::kernels::SimdLevel saved = ufs::kernels::GetSimdLevel();
+    std::vector<UInt8> expected(length);
+    std::vector<UInt8> actual(length);
+    for (size_t period : periods) {
+        for (UInt8 start : starts) {
+            for (int direction = 0; direction < 2; direction++) {
+                ufs::kernels::SetSimdLevel(ufs::kernels::SimdScalar);
+                for (size_t i = 0; i < length; i++) {
+                    size_t j = i % period;
+                    expected[i] = static_cast<UInt8>(direction == 0 ? start + j : start - j);
+                }
+                for (int level = ufs::kernels::SimdScalar; level <= ufs::kernels::SimdAvx512; level++) {
+                    ufs::kernels::SetSimdLevel(static_cast<ufs::kernels::SimdLevel>(level));
+                    std::fill(actual.begin(), actual.end(), 0xCC);
+                    if (direction == 0) {
+                        ufs::kernels::FillIncrementing(actual.data(), length, period, start);
+                    } else {
+                        ufs::kernels::FillDecrementing(actual.data(), length, period, start);
+                    }
+                    TEST_ASSERT(actual == expected, "Counting fill matches scalar at every level");
+                }
+            }
+        }
+    }
+    ufs::kernels::SetSimdLevel(saved);
+    TEST_ASSERT(ufs::kernels::GetSimdLevel() <= ufs::kernels::GetSupportedSimdLevel(), "Level is clamped to the CPU");
+    return true;
+}
+
+bool test_random_engines() {
+    // The compatible engine reproduces the boost::random::taus88 stream word
+    // for word, on every instruction set and on either side of the lanes.
+    ufs::kernels::SimdLevel saved = ufs::kernels::GetSimdLevel();
+    const size_t sectorCounts[] = { 1, 3, 64, 1000 };
+    for (size_t sectors : sectorCounts) {
+        boost::random::taus88 reference(777);
+        std::vector<UInt32> expected(sectors * 512 / 4);
+        for (UInt32& word : expected) {
+            word = reference();
+        }
+        for (int level = ufs::kernels::SimdScalar; level <= ufs::kernels::SimdAvx512; level++) {
+            ufs::kernels::SetSimdLevel(static_cast<ufs::kernels::SimdLevel>(level));
+            ufs::Buffer buffer(sectors);
+            buffer.FillRandomSeeded(777);
+            TEST_ASSERT(::memcmp(buffer.GetDataStart(), expected.data(), buffer.GetTotalBytes()) == 0,
+                        "Compatible fill matches taus88");
+        }
+    }
+    ufs::kernels::SetSimdLevel(saved);
+
+    // A bulk fill continues from, and hands back, the Random32 state.
+    ufs::Random32 random(99);
+    boost::random::taus88 reference(99);
+    std::vector<UInt32> words(5000);
+    UInt32 state[3];
+    random.GetState(state);
+    ufs::kernels::FillTaus88(words.data(), words.size(), state);
+    random.SetState(state);
+    bool same = true;
+    for (UInt32 word : words) {
+        same = same && word == reference();
+    }
+    TEST_ASSERT(same && random.Next() == reference(), "Random32 continues after a bulk fill");
+
+    // The fast engine is repeatable per seed and different from taus88.
+    ufs::Buffer fast1(1000);
+    ufs::Buffer fast2(1000);
+    fast1.FillRandomSeeded(777, 0, 0, ufs::RandomFast);
+    fast2.FillRandomSeeded(777, 0, 0, ufs::RandomFast);
+    TEST_ASSERT(fast1.CompareTo(fast2).AreEqual(), "Fast engine is repeatable");
+    ufs::Buffer compatible(1000);
+    compatible.FillRandomSeeded(777);
+    TEST_ASSERT(!fast1.CompareTo(compatible).AreEqual(), "Fast engine is a different sequence");
+    UInt64 ones = fast1.GetBitCount();
+    UInt64 bits = fast1.GetTotalBytes() * 8;
+    TEST_ASSERT(ones > bits / 2 - bits / 100 && ones < bits / 2 + bits / 100, "Fast engine bits are balanced");
+    fast2.FillRandom(0, 0, ufs::RandomFast);
+    TEST_ASSERT(!fast1.CompareTo(fast2).AreEqual(), "Unseeded fast fills differ");
+    return true;
+}
+
+bool test_worker_pool() {
+    ScopedPoolSettings settings(4, 64 * 1024);
+    ufs::WorkerPool& pool = settings.pool;
+
+    // Every index is visited exactly once, with either schedule.
+    for (int schedule = ufs::ScheduleStatic; schedule <= ufs::ScheduleDynamic; schedule++) {
+        std::vector<std::atomic<int>> visits(10007);
+        std::atomic<bool> onGrain(true);
+        pool.ParallelFor(visits.size(), 100, [&](size_t begin, size_t end) {
+            if (begin % 100 != 0) {
+                onGrain = false;
+            }
+            for (size_t i = begin; i < end; i++) {
+                visits[i]++;
+            }
+        }, static_cast<ufs::Schedule>(schedule));
+        bool once = true;
+        for (std::atomic<int>& count : visits) {
+            once = once && count == 1;
+        }
+        TEST_ASSERT(once && onGrain, "Each index visited once, pieces start on the grain");
+    }
+
+    bool threw = false;
+    try {
+        pool.ParallelFor(1000, 10, [](size_t begin, size_t) {
+            if (begin >= 500) {
+                throw ufs::RuntimeError("piece failed");
+            }
+        });
+    } catch (const ufs::RuntimeError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Exceptions reach the caller");
+
+    // Buffer operations split across the pool give the serial results.
+    ufs::Buffer parallel(3001);
+    ufs::Buffer copy(3001);
+    parallel.FillBytes({ 1, 2, 3, 4, 5, 6, 7 });
+    pool.SetThreadCount(1);
+    ufs::Buffer serial(3001);
+    serial.FillBytes({ 1, 2, 3, 4, 5, 6, 7 });
+    pool.SetThreadCount(4);
+    TEST_ASSERT(parallel.CompareTo(serial).AreEqual(), "Parallel FillBytes keeps the pattern phase");
+
+    parallel.FillIncrementing(3);
+    copy.CopyFrom(parallel);
+    TEST_ASSERT(copy.GetByte(2999 * 512 + 10) == 13 && copy.CompareTo(parallel).AreEqual(), "Parallel fill and copy");
+    copy.SetByte(2500 * 512, 0xEE);
+    copy.SetByte(1000 * 512 + 1, 0xEE);
+    ufs::CompareResult result = parallel.CompareTo(copy);
+    TEST_ASSERT(!result.AreEqual() && result.GetFirstDifferenceOffset() == 1000 * 512 + 1, "Parallel compare finds the first mismatch");
+
+    // Chunks handed out in order are each visited once, and a compare with
+    // a mismatch in many chunks still reports the lowest.
+    std::vector<std::atomic<int>> bytes(1000003);
+    pool.ParallelForBytes(bytes.size(), 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            bytes[i]++;
+        }
+    }, ufs::ScheduleDynamic);
+    bool visited = true;
+    for (std::atomic<int>& count : bytes) {
+        visited = visited && count == 1;
+    }
+    TEST_ASSERT(visited, "Dynamic byte chunks visited once");
+    for (size_t i = 1; i < 3001; i += 7) {
+        copy.SetByte(i * 512 + 3, 0xEE);
+    }
+    result = parallel.CompareTo(copy);
+    TEST_ASSERT(result.GetFirstDifferenceOffset() == 512 + 3, "Early exit keeps the first mismatch");
+    copy.SetByte(0, static_cast<UInt8>(parallel.GetByte(0) + 1));
+    result = parallel.CompareTo(copy);
+    TEST_ASSERT(result.GetFirstDifferenceOffset() == 0 && result.GetExpectedValue() == parallel.GetByte(0), "Mismatch in the first chunk");
+
+    parallel.FillOnes();
+    TEST_ASSERT(parallel.GetBitCount() == 3001ULL * 512 * 8, "Parallel bit count");
+
+    parallel.FillRandomSeededBySector(42);
+    parallel.FillAddressOverlay(100);
+    pool.SetThreadCount(1);
+    serial.FillRandomSeededBySector(42);
+    serial.FillAddressOverlay(100);
+    TEST_ASSERT(parallel.CompareTo(serial).AreEqual(), "Parallel seeded-by-sector fill and overlay match serial");
+    TEST_ASSERT(parallel.GetQWord(3000 * 512) == 3100, "Overlay counts sectors");
+    return true;
+}
+
+bool test_counter_random() {
+    // Philox4x32-10 known answers from the Random123 distribution.
+    const UInt32 counters[3][4] = {
+        { 0, 0, 0, 0 },
+        { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF },
+        { 0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344 } };
+    const UInt32 keys[3][2] = { { 0, 0 }, { 0xFFFFFFFF, 0xFFFFFFFF }, { 0xA4093822, 0x299F31D0 } };
+    const UInt32 answers[3][4] = {
+        { 0x6627E8D5, 0xE169C58D, 0xBC57AC4C, 0x9B00DBD8 },
+        { 0x408F276D, 0x41C83B0E, 0xA20BC7C6, 0x6D5451FD },
+        { 0xD16CFE09, 0x94FDCCEB, 0x5001E420, 0x24126EA1 } };
+    for (int i = 0; i < 3; i++) {
+        UInt32 result[4];
+        ufs::kernels::Philox4x32(counters[i], keys[i], result);
+        TEST_ASSERT(::memcmp(result, answers[i], sizeof(result)) == 0, "Philox known answer");
+    }
+
+    // Filling in pieces, in any order, on any level, gives the whole fill.
+    ufs::Buffer whole(300);
+    whole.FillRandomCounter(0x123456789ULL);
+    ufs::kernels::SimdLevel saved = ufs::kernels::GetSimdLevel();
+    for (int level = ufs::kernels::SimdScalar; level <= ufs::kernels::SimdAvx512; level++) {
+        ufs::kernels::SetSimdLevel(static_cast<ufs::kernels::SimdLevel>(level));
+        ufs::Buffer pieces(300);
+        pieces.FillRandomCounter(0x123456789ULL, 200, 100);
+        pieces.FillRandomCounter(0x123456789ULL, 0, 7);
+        pieces.FillRandomCounter(0x123456789ULL, 7, 193);
+        TEST_ASSERT(pieces.CompareTo(whole).AreEqual(), "Pieces match the whole fill");
+    }
+    ufs::kernels::SetSimdLevel(saved);
+
+    // Any sector regenerates on its own, keyed by the LBA when given one.
+    ufs::CounterRandom random(0x123456789ULL);
+    std::vector<UInt8> sector = random.GetSector(250, 512);
+    TEST_ASSERT(::memcmp(sector.data(), whole.GetDataStart() + 250 * 512, 512) == 0, "Expected sector matches");
+    TEST_ASSERT(whole.GetDWord(250 * 512 + 4 * 37) == random.GetWord(250, 37), "Expected word matches");
+    ufs::Buffer lba(4, 520);
+    lba.FillRandomCounter(0x123456789ULL, 0, 0, 1000000);
+    sector = random.GetSector(1000003, 520);
+    TEST_ASSERT(::memcmp(sector.data(), lba.GetDataStart() + 3 * 520, 520) == 0, "Key sector follows the LBA");
+    ufs::Buffer other(300);
+    other.FillRandomCounter(0x123456788ULL);
+    TEST_ASSERT(!other.CompareTo(whole).AreEqual(), "Seeds give different data");
+
+    bool threw = false;
+    try {
+        random.GetSector(0, 514);
+    } catch (const ufs::RuntimeError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Sector size must be a multiple of 4");
+    return true;
+}
+
+bool test_streaming_stores() {
+    // Every bulk writer gives the same bytes with streaming stores forced on.
+    // 520 byte sectors and a start at sector 1 leave the writes unaligned.
+    size_t saved = ufs::kernels::GetStreamingThreshold();
+    ufs::Buffer source(40, 520);
+    source.FillRandomSeeded(99);
+    ufs::Buffer results[2] = { ufs::Buffer(40, 520), ufs::Buffer(40, 520) };
+    for (int streaming = 0; streaming < 2; streaming++) {
+        ufs::kernels::SetStreamingThreshold(streaming ? 0 : SIZE_MAX);
+        ufs::Buffer& buffer = results[streaming];
+        buffer.Fill(0x3C, 1, 3);
+        buffer.FillBytes(std::vector<UInt8>{ 1, 2, 3, 4, 5, 6, 7 }, 4, 3);
+        buffer.FillIncrementing(9, 7, 3);
+        buffer.FillDecrementing(9, 10, 3);
+        buffer.FillRandomSeeded(5, 13, 3);
+        buffer.FillRandomSeeded(5, 16, 3, ufs::RandomFast);
+        buffer.FillRandomCounter(5, 19, 3);
+        buffer.FillRandomSeeded(6, 22, 9);
+        buffer.CopyFrom(source, 31, 2, 9);
+    }
+    ufs::kernels::SetStreamingThreshold(saved);
+    TEST_ASSERT(results[0].CompareTo(results[1]).AreEqual(), "Streaming fills match cached fills");
+
+    // Tiles of any length, into any alignment.
+    std::vector<UInt8> tile(100);
+    for (size_t i = 0; i < tile.size(); i++) {
+        tile[i] = static_cast<UInt8>(i * 7);
+    }
+    std::vector<UInt8> out(1000);
+    for (size_t tileLength : { static_cast<size_t>(1), static_cast<size_t>(3), static_cast<size_t>(64), static_cast<size_t>(100) }) {
+        for (size_t offset = 0; offset < 3; offset++) {
+            ufs::kernels::StreamRepeat(out.data() + offset, 900, tile.data(), tileLength);
+            bool matches = true;
+            for (size_t i = 0; i < 900; i++) {
+                matches = matches && out[offset + i] == tile[i % tileLength];
+            }
+            TEST_ASSERT(matches, "Streamed tile repeats");
+        }
+    }
+    return true;
+}
+
+bool test_sector_overlay() {
+    const UInt8 check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    ufs::kernels::SimdLevel saved = ufs::kernels::GetSimdLevel();
+    ufs::kernels::SetSimdLevel(ufs::kernels::SimdScalar);
+    TEST_ASSERT(ufs::kernels::Crc32c(check, sizeof(check)) == 0xE3069283, "CRC-32C check value (table)");
+    ufs::kernels::SetSimdLevel(saved);
+    TEST_ASSERT(ufs::kernels::Crc32c(check, sizeof(check)) == 0xE3069283, "CRC-32C check value");
+    TEST_ASSERT(ufs::kernels::Crc32c(check + 4, 5, ufs::kernels::Crc32c(check, 4)) == 0xE3069283, "CRC-32C continues");
+
+    ufs::SectorOverlay overlay;
+    overlay.SetFirstLba(1000).SetPass(3);
+    overlay.AddField(ufs::OverlayLba, 0, 8)
+        .AddField(ufs::OverlayPass, 8, 2, ufs::OverlayBigEndian)
+        .AddConstant(0xFEEDFACE, -12, 4)
+        .AddField(ufs::OverlayCrc32c, -4, 4);
+
+    // Each fill stamps as it writes, matching a fill followed by a separate
+    // overlay pass, with and without streaming stores.
+    size_t threshold = ufs::kernels::GetStreamingThreshold();
+    for (int streaming = 0; streaming < 2; streaming++) {
+        ufs::kernels::SetStreamingThreshold(streaming ? 0 : SIZE_MAX);
+        ufs::Buffer fused(24, 520);
+        ufs::Buffer separate(24, 520);
+        fused.SetSectorOverlay(overlay);
+        fused.Fill(0x3C, 1, 3);
+        fused.FillBytes(std::vector<UInt8>{ 1, 2, 3, 4, 5, 6, 7 }, 4, 3);
+        fused.FillIncrementing(9, 7, 3);
+        fused.FillDecrementing(9, 10, 3);
+        fused.FillRandomSeeded(5, 13, 3);
+        fused.FillRandomSeeded(5, 16, 3, ufs::RandomFast);
+        fused.FillRandomCounter(5, 19, 3);
+        fused.FillRandomSeededBySector(6, 22, 2);
+        separate.Fill(0x3C, 1, 3);
+        separate.FillBytes(std::vector<UInt8>{ 1, 2, 3, 4, 5, 6, 7 }, 4, 3);
+        separate.FillIncrementing(9, 7, 3);
+        separate.FillDecrementing(9, 10, 3);
+        separate.FillRandomSeeded(5, 13, 3);
+        separate.FillRandomSeeded(5, 16, 3, ufs::RandomFast);
+        separate.FillRandomCounter(5, 19, 3);
+        separate.FillRandomSeededBySector(6, 22, 2);
+        separate.SetSectorOverlay(overlay).ApplySectorOverlay(1);
+        TEST_ASSERT(fused.CompareTo(separate).AreEqual(), "Fused overlay matches a separate pass");
+        TEST_ASSERT(fused.GetByte(0) == 0, "Sectors not filled are not stamped");
+
+        TEST_ASSERT(fused.GetQWord(5 * 520) == 1005, "LBA field");
+        TEST_ASSERT(fused.GetWordBigEndian(5 * 520 + 8) == 3, "Pass field");
+        TEST_ASSERT(fused.GetDWord(6 * 520 - 12) == 0xFEEDFACE, "Constant field");
+        std::vector<UInt8> sector(fused.GetDataStart() + 5 * 520, fused.GetDataStart() + 6 * 520);
+        UInt32 stored = fused.GetDWord(6 * 520 - 4);
+        ::memset(&sector[516], 0, 4);
+        TEST_ASSERT(ufs::kernels::Crc32c(sector.data(), sector.size()) == stored, "CRC field covers the sector");
+    }
+    ufs::kernels::SetStreamingThreshold(threshold);
+
+    // The address overlay is one spec.
+    ufs::Buffer address(10);
+    ufs::Buffer expected(10);
+    address.SetSectorOverlay(ufs::SectorOverlay::AddressOverlay(77)).FillOnes();
+    expected.FillOnes().FillAddressOverlay(77);
+    TEST_ASSERT(address.CompareTo(expected).AreEqual(), "Address overlay spec");
+    address.ClearSectorOverlay().FillOnes();
+    TEST_ASSERT(address.GetSectorOverlay() == NULL && address.GetQWord(0) == UINT64_MAX, "Cleared overlay");
+
+    bool threw = false;
+    try {
+        ufs::SectorOverlay tooFar;
+        tooFar.AddField(ufs::OverlayTimestamp, 510, 4);
+        address.SetSectorOverlay(tooFar);
+    } catch (const ufs::ArgumentError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Fields must fit in a sector");
+
+    // Shrinking the sectors must not leave a field past the sector end.
+    ufs::SectorOverlay late;
+    late.AddField(ufs::OverlayLba, 500, 8);
+    ufs::Buffer resized(4, 512);
+    resized.SetSectorOverlay(late).FillOnes();
+    threw = false;
+    try {
+        resized.Resize(8, 256);
+    } catch (const ufs::ArgumentError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Resize checks the overlay against the new sector size");
+    TEST_ASSERT(resized.GetSectorCount() == 4 && resized.GetBytesPerSector() == 512, "Failed resize leaves the size");
+    TEST_ASSERT(resized.GetQWord(512 + 500) == 1, "Failed resize leaves the data");
+    resized.Resize(2, 1024).FillZeros();
+    TEST_ASSERT(resized.GetQWord(1024 + 500) == 1, "Overlay stamps after a resize it fits");
+    return true;
+}
+
+bool test_test_patterns() {
+    ufs::Buffer buffer(64, 512);
+    buffer.FillWalkingOnes();
+    TEST_ASSERT(buffer.GetByte(0) == 0x01 && buffer.GetByte(7) == 0x80 && buffer.GetByte(8) == 0x01, "Walking ones");
+    buffer.FillWalkingZeros(0, 0, ufs::TestPatternOptions(16));
+    TEST_ASSERT(buffer.GetWord(0) == 0xFFFE && buffer.GetWord(2 * 15) == 0x7FFF && buffer.GetWord(2 * 16) == 0xFFFE, "Walking zeros");
+    buffer.FillCheckerboard(0, 0, ufs::TestPatternOptions(32));
+    TEST_ASSERT(buffer.GetDWord(0) == 0x55555555 && buffer.GetDWord(4) == 0xAAAAAAAA, "Checkerboard");
+    buffer.FillInverseCheckerboard();
+    TEST_ASSERT(buffer.GetByte(0) == 0xAA && buffer.GetByte(1) == 0x55, "Inverse checkerboard");
+    buffer.FillButterfly();
+    const UInt8 butterfly[] = { 0x81, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x81 };
+    TEST_ASSERT(::memcmp(buffer.GetDataStart() + 512, butterfly, sizeof(butterfly)) == 0, "Butterfly");
+
+    // Per-sector phase: each sector starts one word further on.
+    buffer.FillWalkingOnes(0, 0, ufs::TestPatternOptions(8, 2, 1));
+    bool walks = true;
+    for (size_t sector = 0; sector < 64; sector++) {
+        walks = walks && buffer.GetByte(sector * 512) == (1 << ((sector + 2) % 8));
+    }
+    TEST_ASSERT(walks, "Walking ones phase steps per sector");
+
+    buffer.FillGallopingOnes(0, 0, ufs::TestPatternOptions(64, 0, 1));
+    TEST_ASSERT(buffer.GetQWord(5 * 512 + 5 * 8) == UINT64_MAX && buffer.GetQWord(5 * 512 + 4 * 8) == 0
+        && buffer.GetQWord(5 * 512 + 6 * 8) == 0 && buffer.GetBitCount(5 * 512, 512) == 64, "Galloping ones");
+    buffer.FillGallopingZeros(0, 0, ufs::TestPatternOptions(64, 0, 1));
+    TEST_ASSERT(buffer.GetQWord(9 * 512 + 9 * 8) == 0 && buffer.GetQWord(9 * 512) == UINT64_MAX, "Galloping zeros");
+    buffer.FillMarchingZeros(0, 0, ufs::TestPatternOptions(32, 0, 1));
+    TEST_ASSERT(buffer.GetBitCount(0, 512) == 4096 && buffer.GetBitCount(10 * 512, 512) == 4096 - 10 * 32, "Marching zeros");
+    buffer.FillMarchingOnes(0, 0, ufs::TestPatternOptions(8, 0, 100));
+    TEST_ASSERT(buffer.GetBitCount(3 * 512, 512) == 300 * 8, "Marching ones");
+
+    // Filling ranges gives the same data as filling the whole buffer.
+    for (int pattern = ufs::PatternWalkingOnes; pattern <= ufs::PatternMarchingZeros; pattern++) {
+        ufs::TestPattern testPattern = static_cast<ufs::TestPattern>(pattern);
+        ufs::TestPatternOptions options(16, 5, 3);
+        ufs::Buffer whole(64, 520);
+        ufs::Buffer pieces(64, 520);
+        whole.FillTestPattern(testPattern, 0, 0, options);
+        pieces.FillTestPattern(testPattern, 0, 13, options);
+        pieces.FillTestPattern(testPattern, 13, 0, options);
+        TEST_ASSERT(whole.CompareTo(pieces).AreEqual(), "Ranges match the whole fill");
+    }
+
+    bool threw = false;
+    try {
+        buffer.FillCheckerboard(0, 0, ufs::TestPatternOptions(12));
+    } catch (const ufs::ArgumentError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Word width must be 8, 16, 32 or 64 bits");
+    return true;
+}
+
+// Bit-serial PRBS: each step shifts in the feedback bit, which is also the
+// output bit, first bit in the high bit of the first byte.
+static std::vector<UInt8> ReferencePrbs(unsigned order, unsigned tap, UInt32 state, size_t length) {
+    std::vector<UInt8> data(length, 0);
+    for (size_t bit = 0; bit < length * 8; bit++) {
+        UInt32 next = ((state >> (order - 1)) ^ (state >> (tap - 1))) & 1;
+        state = ((state << 1) | next) & ((1U << order) - 1);
+        data[bit / 8] |= static_cast<UInt8>(next << (7 - bit % 8));
+    }
+    return data;
+}
+
+bool test_prbs() {
+    const ufs::PrbsOrder orders[] = { ufs::Prbs7, ufs::Prbs15, ufs::Prbs23, ufs::Prbs31 };
+    for (ufs::PrbsOrder order : orders) {
+        ufs::Buffer buffer(4, 512);
+        buffer.FillPrbs(order, 0x1234);
+        std::vector<UInt8> expected = ReferencePrbs(order, ufs::PrbsGenerator::GetTap(order), 0x1234 & ((1U << order) - 1), 4 * 512);
+        TEST_ASSERT(::memcmp(buffer.GetDataStart(), expected.data(), expected.size()) == 0, "PRBS matches the bit-serial LFSR");
+
+        ufs::PrbsChecker checker = buffer.VerifyPrbs(order);
+        TEST_ASSERT(checker.IsLocked() && checker.GetBitsChecked() == 4 * 512 * 8 && checker.GetBitErrors() == 0, "Clean PRBS verifies");
+
+        // Continuing a generator across fills gives the same data as one fill.
+        ufs::Buffer pieces(4, 512);
+        ufs::PrbsGenerator generator(order, 0x1234);
+        pieces.FillPrbs(generator, 0, 1);
+        pieces.FillPrbs(generator, 1, 3);
+        TEST_ASSERT(buffer.CompareTo(pieces).AreEqual(), "Continued fills match one fill");
+
+        ufs::PrbsGenerator skipped(order, 0x1234);
+        skipped.Skip(4 * 512 * 8);
+        TEST_ASSERT(skipped.GetState() == generator.GetState(), "Skip matches generating");
+        skipped.Skip(13);
+        std::vector<UInt8> longer = ReferencePrbs(order, ufs::PrbsGenerator::GetTap(order), generator.GetState(), 2);
+        UInt32 lastBits = order < 13 ? (1U << order) - 1 : 0x1FFF;
+        UInt32 afterThirteen = static_cast<UInt32>((longer[0] << 5) | (longer[1] >> 3)) & lastBits;
+        TEST_ASSERT((skipped.GetState() & lastBits) == afterThirteen, "Skip by an odd number of bits");
+    }
+
+    // PRBS7 repeats every 127 bits.
+    std::vector<UInt8> prbs7(64);
+    ufs::PrbsGenerator(ufs::Prbs7, 1).Fill(prbs7.data(), prbs7.size());
+    bool periodic = true;
+    for (size_t bit = 0; bit + 127 < prbs7.size() * 8; bit++) {
+        size_t other = bit + 127;
+        periodic = periodic && ((prbs7[bit / 8] >> (7 - bit % 8)) & 1) == ((prbs7[other / 8] >> (7 - other % 8)) & 1);
+    }
+    TEST_ASSERT(periodic, "PRBS7 period is 127 bits");
+
+    // Single bit errors are counted exactly.
+    ufs::Buffer buffer(8, 512);
+    buffer.FillPrbs(ufs::Prbs31, 99);
+    buffer.SetByte(100, buffer.GetByte(100) ^ 0x10);
+    buffer.SetByte(2000, buffer.GetByte(2000) ^ 0x01);
+    buffer.SetByte(4000, buffer.GetByte(4000) ^ 0x80);
+    ufs::PrbsChecker checker = buffer.VerifyPrbs(ufs::Prbs31);
+    TEST_ASSERT(checker.GetBitErrors() == 3 && checker.GetSyncLossCount() == 0, "Bit errors counted");
+    TEST_ASSERT(checker.GetFirstErrorBit() == 100 * 8 + 3, "First error bit");
+
+    // A slipped bit loses sync once and costs a handful of errors.
+    std::vector<UInt8> sent(4096);
+    ufs::PrbsGenerator(ufs::Prbs23, 7).Fill(sent.data(), sent.size());
+    std::vector<UInt8> received(sent.size(), 0);
+    for (size_t bit = 0; bit < received.size() * 8; bit++) {
+        size_t from = bit < 10000 ? bit : bit + 1;
+        if (from < sent.size() * 8 && ((sent[from / 8] >> (7 - from % 8)) & 1)) {
+            received[bit / 8] |= static_cast<UInt8>(0x80 >> (bit % 8));
+        }
+    }
+    ufs::PrbsChecker slipped(ufs::Prbs23);
+    slipped.Check(received.data(), 1000);
+    slipped.Check(received.data() + 1000, received.size() - 1000);
+    TEST_ASSERT(slipped.GetSyncLossCount() == 1 && slipped.GetBitErrors() > 0 && slipped.GetBitErrors() < 200, "Resynchronized after a slip");
+    TEST_ASSERT(slipped.GetFirstErrorBit() >= 10000 && slipped.GetBitsChecked() == received.size() * 8, "Slip located");
+
+    // Reset expects the stream from its start again.
+    ufs::PrbsChecker rechecked(ufs::PrbsGenerator(ufs::Prbs23, 7));
+    rechecked.Check(sent.data(), sent.size());
+    TEST_ASSERT(rechecked.GetBitErrors() == 0, "Locked checker verifies the stream");
+    rechecked.Reset();
+    rechecked.Check(sent.data(), sent.size());
+    TEST_ASSERT(rechecked.GetBitErrors() == 0 && rechecked.GetSyncLossCount() == 0
+        && rechecked.GetBitsChecked() == sent.size() * 8, "Reset checker verifies the same stream again");
+    return true;
+}
+
+bool test_pattern_buffer() {
+    // Each description generates what the matching fill writes, across the
+    // pattern's 64KB blocks and with the overlay stamped.
+    const size_t sectors = 300;
+    ufs::SectorOverlay overlay;
+    overlay.SetFirstLba(1000).AddField(ufs::OverlayLba, 8, 4).AddField(ufs::OverlayCrc32c, -4, 4);
+    for (int fill = ufs::PatternFillConstant; fill <= ufs::PatternFillRandomSeeded; fill++) {
+        ufs::Buffer actual(sectors, 512);
+        ufs::PatternBuffer expected(sectors, 512);
+        actual.SetSectorOverlay(overlay);
+        expected.SetSectorOverlay(overlay);
+        switch (static_cast<ufs::PatternFill>(fill)) {
+        case ufs::PatternFillConstant: actual.Fill(0xA5); expected.Fill(0xA5); break;
+        case ufs::PatternFillBytes: actual.FillBytes({ 1, 2, 3, 4, 5, 6, 7 }); expected.FillBytes({ 1, 2, 3, 4, 5, 6, 7 }); break;
+        case ufs::PatternFillIncrementing: actual.FillIncrementing(9); expected.FillIncrementing(9); break;
+        case ufs::PatternFillDecrementing: actual.FillDecrementing(9); expected.FillDecrementing(9); break;
+        case ufs::PatternFillRandomBySector: actual.FillRandomSeededBySector(77); expected.FillRandomSeededBySector(77); break;
+        case ufs::PatternFillRandomCounter: actual.FillRandomCounter(77, 0, 0, 5); expected.FillRandomCounter(77, 5); break;
+        case ufs::PatternFillTestPattern:
+            actual.FillWalkingOnes(0, 0, ufs::TestPatternOptions(16, 3, 1));
+            expected.FillTestPattern(ufs::PatternWalkingOnes, ufs::TestPatternOptions(16, 3, 1));
+            break;
+        case ufs::PatternFillPrbs: actual.FillPrbs(ufs::Prbs23, 5); expected.FillPrbs(ufs::Prbs23, 5); break;
+        case ufs::PatternFillRandomSeeded: actual.FillRandomSeeded(77); expected.FillRandomSeeded(77); break;
+        }
+        TEST_ASSERT(actual.CompareTo(expected).AreEqual(), "Pattern matches the fill");
+        TEST_ASSERT(actual.CompareTo(expected, 130, 130, 150).AreEqual(), "Pattern range matches");
+
+        // Copying a range anywhere gives the same sectors as the fill.
+        ufs::Buffer copy(10, 512);
+        expected.CopyTo(copy, 201, 3, 7);
+        TEST_ASSERT(copy.CompareTo(actual, 3, 201, 7).AreEqual(), "Copied range matches");
+    }
+
+    // Address overlay over a fill.
+    ufs::Buffer actual(sectors, 512);
+    actual.FillRandomCounter(3).FillAddressOverlay(0x100);
+    ufs::PatternBuffer expected(sectors, 512);
+    expected.FillRandomCounter(3).FillAddressOverlay(0x100);
+    TEST_ASSERT(actual.CompareTo(expected).AreEqual(), "Address overlay matches");
+
+    // The first mismatch is reported with the pattern's byte as expected.
+    UInt8 original = actual.GetByte(200 * 512 + 77);
+    actual.SetByte(200 * 512 + 77, original ^ 0xFF);
+    actual.SetByte(250 * 512, actual.GetByte(250 * 512) ^ 0xFF);
+    ufs::CompareResult result = actual.CompareTo(expected);
+    TEST_ASSERT(!result.AreEqual() && result.GetFirstDifferenceOffset() == 200 * 512 + 77, "First mismatch offset");
+    TEST_ASSERT(result.GetExpectedValue() == original && result.GetActualValue() == (original ^ 0xFF), "Mismatch values");
+    TEST_ASSERT(actual.CompareTo(expected, 201, 201, 40).AreEqual(), "Range before the second mismatch");
+
+    // Saving writes the generated bytes.
+    const char* fileName = "pattern_buffer_test.bin";
+    expected.SaveToFileBinary(fileName, 150);
+    std::ifstream file(fileName, std::ios::binary);
+    std::vector<char> saved((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove(fileName);
+    actual.FillRandomCounter(3).FillAddressOverlay(0x100);
+    TEST_ASSERT(saved.size() == 150 * 512 && ::memcmp(saved.data(), actual.GetDataStart() + 150 * 512, saved.size()) == 0, "Saved pattern");
+    return true;
+}
+
+bool test_fill_bytes_tiles() {
+    // Odd list lengths, sector sizes that aren't whole cache lines and both
+    // phases, at every instruction set.
+    const ufs::kernels::SimdLevel saved = ufs::kernels::GetSimdLevel();
+    const ufs::kernels::SimdLevel supported = ufs::kernels::GetSupportedSimdLevel();
+    const size_t lengths[] = { 1, 3, 7, 13, 64, 65, 100, 2000 };
+    bool matches = true;
+    for (int level = ufs::kernels::SimdScalar; level <= supported; level++) {
+        ufs::kernels::SetSimdLevel(static_cast<ufs::kernels::SimdLevel>(level));
+        for (size_t length : lengths) {
+            std::vector<UInt8> list(length);
+            for (size_t i = 0; i < length; i++) {
+                list[i] = static_cast<UInt8>(i * 37 + 11);
+            }
+
+            ufs::Buffer buffer(12, 520);
+            buffer.FillBytes(list, 1, 10);
+            buffer.FillBytes(list, 11, 1, ufs::PatternPerSector);
+            for (size_t i = 520; i < 11 * 520; i++) {
+                matches = matches && buffer.GetByte(i) == list[(i - 520) % length];
+            }
+            for (size_t i = 11 * 520; i < 12 * 520; i++) {
+                matches = matches && buffer.GetByte(i) == list[(i - 11 * 520) % length];
+            }
+
+            buffer.FillBytes(list, 0, 0, ufs::PatternPerSector);
+            for (size_t i = 0; i < 12 * 520; i++) {
+                matches = matches && buffer.GetByte(i) == list[(i % 520) % length];
+            }
+        }
+    }
+    ufs::kernels::SetSimdLevel(saved);
+    TEST_ASSERT(matches, "Tiled FillBytes matches the list at every level");
+    return true;
+}
+
+bool test_find_first_mismatch() {
+    // Every length up to a few blocks, every mismatch position and both
+    // alignments, at every instruction set.
+    const ufs::kernels::SimdLevel saved = ufs::kernels::GetSimdLevel();
+    const ufs::kernels::SimdLevel supported = ufs::kernels::GetSupportedSimdLevel();
+    std::vector<UInt8> left(300);
+    for (size_t i = 0; i < left.size(); i++) {
+        left[i] = static_cast<UInt8>(i * 13 + 1);
+    }
+    bool matches = true;
+    for (int level = ufs::kernels::SimdScalar; level <= supported; level++) {
+        ufs::kernels::SetSimdLevel(static_cast<ufs::kernels::SimdLevel>(level));
+        for (size_t start = 0; start < 2; start++) {
+            for (size_t length = 0; length + start <= 200; length++) {
+                std::vector<UInt8> right(left);
+                size_t offset = SIZE_MAX;
+                matches = matches && !ufs::kernels::FindFirstMismatch(left.data() + start, right.data() + start, length, offset);
+                for (size_t at = 0; at < length; at++) {
+                    right[start + at] ^= 0x40;
+                    // A later difference doesn't hide the first.
+                    right[start + length - 1] ^= (at + 1 < length) ? 0x01 : 0x00;
+                    matches = matches && ufs::kernels::FindFirstMismatch(left.data() + start, right.data() + start, length, offset) && offset == at;
+                    right[start + length - 1] ^= (at + 1 < length) ? 0x01 : 0x00;
+                    right[start + at] ^= 0x40;
+                }
+            }
+        }
+
+        ufs::Buffer a(64, 512);
+        ufs::Buffer b(64, 512);
+        a.FillRandomCounter(4);
+        b.FillRandomCounter(4);
+        b.SetByte(20000, a.GetByte(20000) ^ 0x80);
+        ufs::CompareResult result = a.CompareTo(b);
+        matches = matches && result.GetFirstDifferenceOffset() == 20000 && result.GetExpectedValue() == a.GetByte(20000)
+            && result.GetActualValue() == b.GetByte(20000) && result.GetDifferenceCount() == 1;
+    }
+    ufs::kernels::SetSimdLevel(saved);
+    TEST_ASSERT(matches, "First mismatch found at every level");
+    return true;
+}
+
+bool test_compare_all_differences() {
+    const ufs::kernels::SimdLevel saved = ufs::kernels::GetSimdLevel();
+    const ufs::kernels::SimdLevel supported = ufs::kernels::GetSupportedSimdLevel();
+    ufs::Buffer a(64, 512);
+    ufs::Buffer b(64, 512);
+    a.FillRandomCounter(9);
+    b.FillRandomCounter(9);
+    for (size_t i = 100; i < 110; i++) {
+        b.SetByte(i, a.GetByte(i) ^ 0x01);
+    }
+    for (size_t i = 511; i < 514; i++) {
+        b.SetByte(i, a.GetByte(i) ^ 0x02);
+    }
+    for (size_t i = 10 * 512; i <= 11 * 512; i++) {
+        b.SetByte(i, a.GetByte(i) ^ 0x04);
+    }
+    for (size_t i = 20 * 512; i < 20 * 512 + 32; i += 2) {
+        b.SetByte(i, a.GetByte(i) ^ 0x08);
+    }
+
+    bool matches = true;
+    for (int level = ufs::kernels::SimdScalar; level <= supported; level++) {
+        ufs::kernels::SetSimdLevel(static_cast<ufs::kernels::SimdLevel>(level));
+        // The run and count kernels over every length and tail.
+        for (size_t length = 0; length <= 200; length++) {
+            std::vector<UInt8> left(length, 0x5A);
+            std::vector<UInt8> right(length, 0xA5);
+            size_t expectedCount = length;
+            for (size_t i = 0; i < length; i += 3) {
+                right[i] = left[i];
+                expectedCount--;
+            }
+            size_t offset = SIZE_MAX;
+            matches = matches && ufs::kernels::CountMismatches(left.data(), right.data(), length) == expectedCount
+                && (length < 2 || (ufs::kernels::FindFirstMatch(left.data() + 1, right.data() + 1, length - 1, offset) == (length > 3) && (length <= 3 || offset == 2)));
+            std::vector<UInt8> different(length, 0xA5);
+            if (length != 0) {
+                different[length - 1] = left[length - 1];
+            }
+            matches = matches && ufs::kernels::FindFirstMatch(left.data(), different.data(), length, offset) == (length != 0)
+                && (length == 0 || offset == length - 1);
+        }
+
+        ufs::CompareResult result = a.CompareTo(b, ufs::CompareOptions(ufs::CompareAllDifferences));
+        const std::vector<ufs::DifferenceRange>& ranges = result.GetDifferenceRanges();
+        const std::vector<ufs::SectorDifferences>& sectors = result.GetSectorDifferences();
+        matches = matches && result.GetFirstDifferenceOffset() == 100 && result.GetDifferenceCount() == 542
+            && ranges.size() == 19 && ranges[1].offset == 511 && ranges[1].length == 3
+            && ranges[2].offset == 10 * 512 && ranges[2].length == 513 && ranges[18].offset == 20 * 512 + 30
+            && sectors.size() == 5 && sectors[0].sector == 0 && sectors[0].count == 11 && sectors[1].count == 2
+            && sectors[2].sector == 10 && sectors[2].count == 512 && sectors[3].count == 1 && sectors[4].count == 16
+            && result.GetDifferentSectorCount() == 5 && result.IsSectorDifferent(11) && !result.IsSectorDifferent(12)
+            && !result.IsTruncated();
+    }
+    ufs::kernels::SetSimdLevel(saved);
+    TEST_ASSERT(matches, "Every difference found, in coalesced ranges and per sector, at every level");
+
+    // The first difference mode is unchanged.
+    ufs::CompareResult first = a.CompareTo(b);
+    TEST_ASSERT(first.GetFirstDifferenceOffset() == 100 && first.GetDifferenceCount() == 1, "First difference mode stops at the first");
+
+    // Past the limit only the counts and the bitmap grow.
+    ufs::CompareResult limited = a.CompareTo(b, ufs::CompareOptions(ufs::CompareAllDifferences, 3));
+    TEST_ASSERT(limited.GetDifferenceRanges().size() == 3 && limited.GetSectorDifferences().size() == 3
+        && limited.GetDifferenceCount() == 542 && limited.GetDifferentSectorCount() == 5
+        && limited.IsSectorDifferent(20) && limited.IsTruncated(), "Detail stops at the limit");
+
+    // Sectors and offsets are those of this buffer.
+    ufs::CompareResult range = a.CompareTo(b, 10, 10, 20, ufs::CompareOptions(ufs::CompareAllDifferences));
+    TEST_ASSERT(range.GetFirstSector() == 10 && range.GetSectorCount() == 20 && range.GetDifferenceCount() == 529
+        && range.GetFirstDifferenceOffset() == 10 * 512 && range.GetDifferenceRanges().size() == 17
+        && range.IsSectorDifferent(20) && !range.IsSectorDifferent(0), "A range compare counts from its own sectors");
+
+    // Every byte different is one range however long.
+    ufs::Buffer inverse(64, 512);
+    for (size_t i = 0; i < inverse.GetTotalBytes(); i++) {
+        inverse.SetByte(i, static_cast<UInt8>(~a.GetByte(i)));
+    }
+    ufs::CompareResult all = a.CompareTo(inverse, ufs::CompareOptions(ufs::CompareAllDifferences, 2));
+    TEST_ASSERT(all.GetDifferenceCount() == 64 * 512 && all.GetDifferenceRanges().size() == 1
+        && all.GetDifferenceRanges()[0].length == 64 * 512 && all.GetSectorDifferences().size() == 2
+        && all.GetDifferentSectorCount() == 64 && all.IsSectorDifferent(63), "All different data stays bounded");
+
+    // Pieces split across the pool join into the serial result.
+    ScopedPoolSettings settings(4, 64 * 1024);
+    ufs::WorkerPool& pool = settings.pool;
+    ufs::Buffer left(3001);
+    ufs::Buffer right(3001);
+    left.FillRandomCounter(5);
+    right.FillRandomCounter(5);
+    for (size_t i = 0; i < right.GetTotalBytes(); i += 4099) {
+        right.SetByte(i, left.GetByte(i) ^ 0x10);
+        right.SetByte(i + 1, left.GetByte(i + 1) ^ 0x10);
+    }
+    pool.SetThreadCount(1);
+    ufs::CompareResult serial = left.CompareTo(right, ufs::CompareOptions(ufs::CompareAllDifferences, 100));
+    pool.SetThreadCount(4);
+    ufs::CompareResult parallel = left.CompareTo(right, ufs::CompareOptions(ufs::CompareAllDifferences, 100));
+    bool same = serial.GetDifferenceCount() == parallel.GetDifferenceCount()
+        && serial.GetDifferentSectorCount() == parallel.GetDifferentSectorCount()
+        && serial.GetSectorBitmap() == parallel.GetSectorBitmap()
+        && serial.GetDifferenceRanges().size() == parallel.GetDifferenceRanges().size()
+        && serial.GetSectorDifferences().size() == parallel.GetSectorDifferences().size();
+    for (size_t i = 0; same && i < serial.GetDifferenceRanges().size(); i++) {
+        same = serial.GetDifferenceRanges()[i].offset == parallel.GetDifferenceRanges()[i].offset
+            && serial.GetDifferenceRanges()[i].length == parallel.GetDifferenceRanges()[i].length;
+    }
+    TEST_ASSERT(same && serial.GetDifferenceRanges().size() == 100 && serial.GetDifferenceCount() == 2 * 375,
+        "Parallel pieces join in order");
+
+    // A last range crossing a sector boundary fills the limit without
+    // truncating, whichever piece holds it.
+    right.CopyFrom(left);
+    right.SetByte(100, left.GetByte(100) ^ 0x10);
+    right.SetByte(200, left.GetByte(200) ^ 0x10);
+    for (size_t i = 1500 * 512 - 4; i < 1500 * 512 + 4; i++) {
+        right.SetByte(i, left.GetByte(i) ^ 0x10);
+    }
+    pool.SetThreadCount(1);
+    ufs::CompareResult serialFull = left.CompareTo(right, ufs::CompareOptions(ufs::CompareAllDifferences, 3));
+    pool.SetThreadCount(4);
+    ufs::CompareResult parallelFull = left.CompareTo(right, ufs::CompareOptions(ufs::CompareAllDifferences, 3));
+    TEST_ASSERT(!serialFull.IsTruncated() && !parallelFull.IsTruncated()
+        && serialFull.GetDifferenceRanges().size() == 3 && serialFull.GetDifferenceRanges()[2].length == 8
+        && parallelFull.GetDifferenceRanges().size() == 3 && parallelFull.GetDifferenceRanges()[2].length == 8,
+        "Truncation does not depend on the thread count");
+
+    // Against a pattern the expected values come from the pattern.
+    ufs::PatternBuffer pattern(64, 512);
+    pattern.FillIncrementing(7).FillAddressOverlay(1000);
+    ufs::Buffer readBack(64, 512);
+    pattern.CopyTo(readBack);
+    readBack.SetByte(3000, 0);
+    readBack.SetByte(3001, 0);
+    readBack.SetByte(40 * 512 + 8, 0xAA);
+    ufs::CompareResult verified = readBack.CompareTo(pattern, ufs::CompareOptions(ufs::CompareAllDifferences));
+    TEST_ASSERT(verified.GetDifferenceCount() == 3 && verified.GetDifferenceRanges().size() == 2
+        && verified.GetFirstDifferenceOffset() == 3000 && verified.GetExpectedValue() == static_cast<UInt8>(3000 + 7)
+        && verified.IsSectorDifferent(5) && verified.IsSectorDifferent(40), "Pattern compare finds every difference");
+    return true;
+}
+
+bool test_verify_pattern() {
+    // A seeded random read-back with the address stamped, verified without
+    // a second buffer.
+    ufs::Buffer readBack(500, 512);
+    readBack.FillRandomSeeded(11);
+    readBack.FillAddressOverlay(2000);
+    ufs::PatternBuffer pattern(500, 512);
+    pattern.FillRandomSeeded(11).FillAddressOverlay(2000);
+    TEST_ASSERT(pattern.IsSequential() && readBack.VerifyPattern(pattern).AreEqual(), "Seeded random read-back verifies");
+
+    // Copies keep their own stream, so they verify side by side.
+    ufs::PatternBuffer copies[2] = { pattern, pattern };
+    ufs::Buffer readBacks[2] = { readBack, readBack };
+    bool copiesVerify[2] = { false, false };
+    std::thread verifiers[2];
+    for (int i = 0; i < 2; i++) {
+        verifiers[i] = std::thread([&, i]() {
+            copiesVerify[i] = readBacks[i].VerifyPattern(copies[i], 250 * i, 250).AreEqual()
+                && readBacks[i].VerifyPattern(copies[i], 0, 100).AreEqual();
+        });
+    }
+    for (std::thread& verifier : verifiers) {
+        verifier.join();
+    }
+    TEST_ASSERT(copiesVerify[0] && copiesVerify[1], "Copies of a seeded pattern verify on two threads");
+
+    readBack.SetByte(300 * 512 + 100, readBack.GetByte(300 * 512 + 100) ^ 0xFF);
+    readBack.SetQWord(450 * 512, 0);
+    ufs::CompareResult result = readBack.VerifyPattern(pattern);
+    TEST_ASSERT(!result.AreEqual() && result.GetFirstDifferenceOffset() == 300 * 512 + 100
+        && result.GetDifferenceRanges().size() == 2 && result.GetDifferentSectorCount() == 2
+        && result.IsSectorDifferent(450) && result.GetSectorDifferences()[1].count <= 8, "Every corrupted byte found");
+
+    // Ranges, in any order, regenerate the stream up to their start.
+    TEST_ASSERT(readBack.VerifyPattern(pattern, 400, 40).AreEqual(), "Later range verifies");
+    TEST_ASSERT(readBack.VerifyPattern(pattern, 10, 20).AreEqual(), "Earlier range verifies");
+    TEST_ASSERT(readBack.VerifyPattern(pattern, 290, 20, 1).GetDifferenceCount() == 1, "Range finds its difference");
+
+    // The fast engine, split across the pool.
+    ScopedPoolSettings settings(4, 64 * 1024);
+    ufs::Buffer fast(700, 512);
+    fast.FillRandomSeeded(12, 0, 0, ufs::RandomFast);
+    ufs::PatternBuffer fastPattern(700, 512);
+    fastPattern.FillRandomSeeded(12, ufs::RandomFast);
+    bool fastVerifies = fast.VerifyPattern(fastPattern).AreEqual();
+    fast.SetByte(699 * 512, fast.GetByte(699 * 512) ^ 1);
+    ufs::CompareResult fastResult = fast.VerifyPattern(fastPattern);
+    ufs::CompareResult firstOnly = fast.CompareTo(fastPattern);
+    TEST_ASSERT(fastVerifies && fastResult.GetDifferenceCount() == 1 && fastResult.GetFirstDifferenceOffset() == 699 * 512
+        && firstOnly.GetFirstDifferenceOffset() == 699 * 512 && firstOnly.GetExpectedValue() == static_cast<UInt8>(fast.GetByte(699 * 512) ^ 1),
+        "Fast seeded random verifies, first difference keeps its expected value");
+
+    bool threw = false;
+    try {
+        ufs::PatternBuffer odd(10, 48);
+        odd.FillRandomSeeded(1, ufs::RandomFast);
+    } catch (const ufs::RuntimeError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Fast stream needs sectors of whole generator rounds");
+
+    // The other fills verify the same way.
+    ufs::Buffer counting(64, 512);
+    counting.FillIncrementing(3);
+    ufs::PatternBuffer countingPattern(64, 512);
+    countingPattern.FillIncrementing(3);
+    TEST_ASSERT(counting.VerifyPattern(countingPattern).AreEqual(), "Incrementing verifies");
+    return true;
+}
+
+bool test_bit_error_stats() {
+    // Known flips: bit 4 of byte 4 set in sector 2, and bit 3 of byte 9 plus
+    // bit 1 of byte 511 cleared in sector 5.
+    ufs::Buffer expected(10, 512);
+    expected.Fill(0x0F);
+    ufs::Buffer actual(10, 512);
+    actual.Fill(0x0F);
+    TEST_ASSERT(expected.CompareBits(actual).AreEqual(), "Equal buffers have no bit errors");
+
+    actual.SetByte(2 * 512 + 4, 0x0F | 0x10);
+    actual.SetByte(5 * 512 + 9, 0x0F ^ 0x08);
+    actual.SetByte(5 * 512 + 511, 0x0F ^ 0x02);
+    ufs::BitErrorStats stats = expected.CompareBits(actual);
+    TEST_ASSERT(stats.GetBitErrors() == 3 && stats.GetZeroToOneCount() == 1 && stats.GetOneToZeroCount() == 2,
+        "Flips counted by direction");
+    TEST_ASSERT(stats.GetBitsCompared() == 10ULL * 512 * 8 && stats.GetBitErrorRate() == 3.0 / (10 * 512 * 8), "Bit error rate");
+    TEST_ASSERT(stats.GetSectorBitErrors(2) == 1 && stats.GetSectorBitErrors(5) == 2 && stats.GetSectorBitErrors(3) == 0
+        && stats.GetSectorsWithErrors() == 2 && stats.GetMaxSectorBitErrors() == 2 && stats.GetMaxSectorBitErrorsSector() == 5,
+        "Errors per sector");
+    TEST_ASSERT(stats.GetWordBitCounts()[4 * 8 + 4] == 1 && stats.GetWordBitCounts()[1 * 8 + 3] == 1
+        && stats.GetWordBitCounts()[7 * 8 + 1] == 1, "Errors by bit of the word");
+    std::vector<UInt64> byteBits = stats.GetByteBitCounts();
+    TEST_ASSERT(byteBits[4] == 1 && byteBits[3] == 1 && byteBits[1] == 1, "Errors by bit of the byte");
+    TEST_ASSERT(stats.GetColumnCounts().size() == 512 && stats.GetColumnCounts()[4] == 1 && stats.GetColumnCounts()[9] == 1
+        && stats.GetColumnCounts()[511] == 1, "Errors by byte of the sector");
+
+    // A range counts sectors as this buffer's.
+    ufs::BitErrorStats range = expected.CompareBits(actual, 4, 3);
+    TEST_ASSERT(range.GetFirstSector() == 4 && range.GetSectorCount() == 3 && range.GetBitErrors() == 2
+        && range.GetSectorBitErrors(5) == 2 && range.GetSectorBitErrors(2) == 0, "Range of sectors");
+
+    // Every level counts as the scalar kernel, and as CountBitDifferences.
+    ufs::Buffer left(64, 512);
+    left.FillRandomSeeded(21);
+    ufs::Buffer right(64, 512);
+    right.FillRandomSeeded(22);
+    ufs::kernels::SimdLevel saved = ufs::kernels::GetSimdLevel();
+    ufs::kernels::SetSimdLevel(ufs::kernels::SimdScalar);
+    UInt64 scalarUp = 0;
+    UInt64 scalarDown = 0;
+    ufs::kernels::CountBitFlips(left.GetDataStart(), right.GetDataStart() + 1, left.GetTotalBytes() - 1, scalarUp, scalarDown);
+    ufs::BitErrorStats scalarStats = left.CompareBits(right);
+    bool levelsMatch = true;
+    for (int level = ufs::kernels::SimdScalar; level <= ufs::kernels::GetSupportedSimdLevel(); level++) {
+        ufs::kernels::SetSimdLevel(static_cast<ufs::kernels::SimdLevel>(level));
+        UInt64 up = 0;
+        UInt64 down = 0;
+        ufs::kernels::CountBitFlips(left.GetDataStart(), right.GetDataStart() + 1, left.GetTotalBytes() - 1, up, down);
+        ufs::BitErrorStats levelStats = left.CompareBits(right);
+        levelsMatch = levelsMatch && up == scalarUp && down == scalarDown
+            && up + down == ufs::kernels::CountBitDifferences(left.GetDataStart(), right.GetDataStart() + 1, left.GetTotalBytes() - 1)
+            && levelStats.GetZeroToOneCount() == scalarStats.GetZeroToOneCount()
+            && levelStats.GetWordBitCounts() == scalarStats.GetWordBitCounts();
+    }
+    ufs::kernels::SetSimdLevel(saved);
+    TEST_ASSERT(levelsMatch, "Every level counts flips as the scalar kernel");
+
+    // Split across the pool, the pieces join to the serial counts.
+    ufs::Buffer written(700, 512);
+    written.FillRandomCounter(5);
+    ufs::Buffer readBack(700, 512);
+    readBack.FillRandomCounter(5);
+    for (size_t i = 0; i < 700; i += 7) {
+        readBack.SetByte(i * 512 + i % 512, readBack.GetByte(i * 512 + i % 512) ^ static_cast<UInt8>(1 << (i % 8)));
+    }
+    readBack.SetByte(651 * 512, readBack.GetByte(651 * 512) ^ 0x81);
+    ufs::BitErrorStats serial = written.CompareBits(readBack);
+    ScopedPoolSettings settings(4, 64 * 1024);
+    ufs::BitErrorStats parallel = written.CompareBits(readBack);
+    ufs::PatternBuffer pattern(700, 512);
+    pattern.FillRandomCounter(5);
+    ufs::BitErrorStats fromPattern = readBack.CompareBits(pattern);
+    TEST_ASSERT(serial.GetBitErrors() == 102 && parallel.GetBitErrors() == 102
+        && parallel.GetSectorBitErrorCounts() == serial.GetSectorBitErrorCounts()
+        && parallel.GetColumnCounts() == serial.GetColumnCounts(), "Parallel compare matches serial");
+    TEST_ASSERT(serial.GetMaxSectorBitErrors() == 3 && serial.GetMaxSectorBitErrorsSector() == 651
+        && parallel.GetMaxSectorBitErrors() == 3 && parallel.GetMaxSectorBitErrorsSector() == 651, "Worst sector carried through the pieces");
+    TEST_ASSERT(fromPattern.GetBitErrors() == 102 && fromPattern.GetSectorBitErrorCounts() == serial.GetSectorBitErrorCounts()
+        && fromPattern.GetZeroToOneCount() == serial.GetZeroToOneCount(), "Pattern compare counts the same errors");
+
+    bool threw = false;
+    try {
+        ufs::Buffer other(10, 4096);
+        expected.CompareBits(other);
+    } catch (const ufs::ArgumentError&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Sector sizes must match");
+    return true;
+}
+
 int main() {
     std::cout << "Running BufferLib Unit Tests\n";
     std::cout << "============================\n\n";
@@ -260,6 +1831,30 @@ int main() {
         RUN_TEST(test_copy_operations);
         RUN_TEST(test_resize_operations);
         RUN_TEST(test_utility_functions);
+        RUN_TEST(test_huge_page_allocation);
+        RUN_TEST(test_lazy_zero_construction);
+        RUN_TEST(test_buffer_pool);
+        RUN_TEST(test_move_and_swap);
+        RUN_TEST(test_in_place_resize);
+        RUN_TEST(test_numa_placement);
+        RUN_TEST(test_buffer_layout);
+        RUN_TEST(test_copy_on_write_clone);
+        RUN_TEST(test_buffer_view);
+        RUN_TEST(test_adopt_external_memory);
+        RUN_TEST(test_simd_counting_fills);
+        RUN_TEST(test_random_engines);
+        RUN_TEST(test_worker_pool);
+        RUN_TEST(test_counter_random);
+        RUN_TEST(test_streaming_stores);
+        RUN_TEST(test_sector_overlay);
+        RUN_TEST(test_test_patterns);
+        RUN_TEST(test_prbs);
+        RUN_TEST(test_pattern_buffer);
+        RUN_TEST(test_fill_bytes_tiles);
+        RUN_TEST(test_find_first_mismatch);
+        RUN_TEST(test_compare_all_differences);
+        RUN_TEST(test_verify_pattern);
+        RUN_TEST(test_bit_error_stats);
         
         std::cout << "\nAll unit tests passed successfully!\n";
         return 0;